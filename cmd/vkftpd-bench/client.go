@@ -0,0 +1,223 @@
+package main
+
+import (
+	"bufio"
+	"bytes"
+	"crypto/tls"
+	"fmt"
+	"io"
+	"net"
+	"strconv"
+	"strings"
+	"time"
+)
+
+// ftpConn is a minimal FTP client for the commands the load test issues.
+// Data connections are passive (EPSV); with TLS, the control and data
+// connections are both encrypted.
+type ftpConn struct {
+	conn    net.Conn
+	r       *bufio.Reader
+	host    string
+	tls     *tls.Config // nil for plain FTP
+	timeout time.Duration
+}
+
+// dialFTP connects to addr and reads the greeting. With tlsConfig, the
+// control connection is upgraded through AUTH TLS and data connections are
+// protected.
+func dialFTP(addr string, tlsConfig *tls.Config, timeout time.Duration) (*ftpConn, error) {
+	host, _, err := net.SplitHostPort(addr)
+	if err != nil {
+		return nil, err
+	}
+	conn, err := net.DialTimeout("tcp", addr, timeout)
+	if err != nil {
+		return nil, err
+	}
+	c := &ftpConn{conn: conn, r: bufio.NewReader(conn), host: host, timeout: timeout}
+	if _, err := c.reply(220); err != nil {
+		conn.Close()
+		return nil, fmt.Errorf("greeting: %w", err)
+	}
+	if tlsConfig == nil {
+		return c, nil
+	}
+
+	if _, err := c.cmd(234, "AUTH TLS"); err != nil {
+		conn.Close()
+		return nil, err
+	}
+	tlsConn := tls.Client(conn, tlsConfig)
+	if err := tlsConn.Handshake(); err != nil {
+		conn.Close()
+		return nil, fmt.Errorf("TLS handshake: %w", err)
+	}
+	c.conn, c.r, c.tls = tlsConn, bufio.NewReader(tlsConn), tlsConfig
+	for _, command := range []string{"PBSZ 0", "PROT P"} {
+		if _, err := c.cmd(200, command); err != nil {
+			c.Close()
+			return nil, err
+		}
+	}
+	return c, nil
+}
+
+// login sends the user name and password
+func (c *ftpConn) login(user, pass string) error {
+	if _, err := c.cmd(331, "USER %s", user); err != nil {
+		return err
+	}
+	_, err := c.cmd(230, "PASS %s", pass)
+	return err
+}
+
+// list reads the listing of dir and returns its size in bytes
+func (c *ftpConn) list(dir string) (int64, error) {
+	return c.download("LIST " + dir)
+}
+
+// retr downloads the file at path and returns its size in bytes
+func (c *ftpConn) retr(path string) (int64, error) {
+	return c.download("RETR " + path)
+}
+
+// stor uploads data to the file at path
+func (c *ftpConn) stor(path string, data []byte) error {
+	conn, err := c.transfer("STOR " + path)
+	if err != nil {
+		return err
+	}
+	_, err = io.Copy(conn, bytes.NewReader(data))
+	if closeErr := conn.Close(); err == nil {
+		err = closeErr
+	}
+	if err != nil {
+		return fmt.Errorf("STOR %s: %w", path, err)
+	}
+	_, err = c.reply(226)
+	return err
+}
+
+// quit ends the session and closes the connection
+func (c *ftpConn) quit() error {
+	_, err := c.cmd(221, "QUIT")
+	c.Close()
+	return err
+}
+
+// Close closes the control connection
+func (c *ftpConn) Close() error {
+	return c.conn.Close()
+}
+
+// download runs a command that sends data and discards it
+func (c *ftpConn) download(command string) (int64, error) {
+	conn, err := c.transfer(command)
+	if err != nil {
+		return 0, err
+	}
+	n, err := io.Copy(io.Discard, conn)
+	conn.Close()
+	if err != nil {
+		return n, fmt.Errorf("%s: %w", command, err)
+	}
+	_, err = c.reply(226)
+	return n, err
+}
+
+// transfer opens a passive data connection and starts command on it
+func (c *ftpConn) transfer(command string) (net.Conn, error) {
+	msg, err := c.cmd(229, "EPSV")
+	if err != nil {
+		return nil, err
+	}
+	// 229 Entering Extended Passive Mode (|||port|)
+	start, end := strings.Index(msg, "(|||"), strings.LastIndex(msg, "|)")
+	if start < 0 || end < start+4 {
+		return nil, fmt.Errorf("EPSV: unexpected reply %q", msg)
+	}
+	port, err := strconv.Atoi(msg[start+4 : end])
+	if err != nil {
+		return nil, fmt.Errorf("EPSV: unexpected reply %q", msg)
+	}
+
+	conn, err := net.DialTimeout("tcp", net.JoinHostPort(c.host, strconv.Itoa(port)), c.timeout)
+	if err != nil {
+		return nil, err
+	}
+	if err := c.send(command); err != nil {
+		conn.Close()
+		return nil, err
+	}
+	code, msg, err := c.readReply()
+	if err != nil || (code != 150 && code != 125) {
+		conn.Close()
+		return nil, replyError(command, code, msg, err)
+	}
+	conn.SetDeadline(time.Now().Add(c.timeout))
+	if c.tls != nil {
+		conn = tls.Client(conn, c.tls)
+	}
+	return conn, nil
+}
+
+// cmd sends a command and reads its reply, which must have code expect
+func (c *ftpConn) cmd(expect int, format string, args ...interface{}) (string, error) {
+	command := fmt.Sprintf(format, args...)
+	if err := c.send(command); err != nil {
+		return "", err
+	}
+	code, msg, err := c.readReply()
+	if err != nil || code != expect {
+		if strings.HasPrefix(command, "PASS ") {
+			command = "PASS"
+		}
+		return msg, replyError(command, code, msg, err)
+	}
+	return msg, nil
+}
+
+// reply reads a reply, which must have code expect
+func (c *ftpConn) reply(expect int) (string, error) {
+	code, msg, err := c.readReply()
+	if err != nil || code != expect {
+		return msg, replyError("reply", code, msg, err)
+	}
+	return msg, nil
+}
+
+func (c *ftpConn) send(command string) error {
+	c.conn.SetDeadline(time.Now().Add(c.timeout))
+	_, err := io.WriteString(c.conn, command+"\r\n")
+	return err
+}
+
+// readReply reads a single or multi-line reply and returns its code and
+// last line
+func (c *ftpConn) readReply() (int, string, error) {
+	c.conn.SetDeadline(time.Now().Add(c.timeout))
+	for {
+		line, err := c.r.ReadString('\n')
+		if err != nil {
+			return 0, "", err
+		}
+		line = strings.TrimRight(line, "\r\n")
+		// The last line of a reply is the code followed by a space
+		if len(line) < 4 || line[3] != ' ' {
+			continue
+		}
+		code, err := strconv.Atoi(line[:3])
+		if err != nil {
+			continue
+		}
+		return code, line[4:], nil
+	}
+}
+
+func replyError(command string, code int, msg string, err error) error {
+	if err != nil {
+		return fmt.Errorf("%s: %w", command, err)
+	}
+	return fmt.Errorf("%s: %d %s", command, code, msg)
+}
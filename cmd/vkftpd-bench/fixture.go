@@ -0,0 +1,235 @@
+package main
+
+import (
+	"crypto/ecdsa"
+	"crypto/elliptic"
+	"crypto/rand"
+	"crypto/x509"
+	"crypto/x509/pkix"
+	"encoding/pem"
+	"fmt"
+	"math/big"
+	"net"
+	"os"
+	"path"
+	"path/filepath"
+	"time"
+
+	"github.com/mmcdole/viking-ftpd/pkg/authentication"
+	"github.com/mmcdole/viking-ftpd/pkg/authorization"
+	"github.com/mmcdole/viking-ftpd/pkg/fixtures"
+	"github.com/mmcdole/viking-ftpd/pkg/ftpserver"
+	"github.com/mmcdole/viking-ftpd/pkg/logging"
+	"github.com/mmcdole/viking-ftpd/pkg/users"
+)
+
+// listingEntries is the number of files besides the downloaded one in each
+// directory the clients list
+const listingEntries = 50
+
+// account is the user a client logs in as, and the paths it works on
+type account struct {
+	name     string
+	home     string // directory listed and uploaded to
+	deepDir  string // directory at the bottom of the user's domain chain
+	download string // file in deepDir that is downloaded
+}
+
+// benchEnv is a temporary MUD installation served by an in-process server
+type benchEnv struct {
+	dir      string
+	addr     string
+	server   *ftpserver.Server
+	accounts []account
+	done     chan error
+}
+
+// setupEnv writes the fixture data files and an FTP root holding a home
+// directory and a domain chain for each of the first opts.users wizards,
+// then starts a server on it
+func setupEnv(opts *options) (*benchEnv, error) {
+	dir, err := os.MkdirTemp("", "vkftpd-bench")
+	if err != nil {
+		return nil, err
+	}
+	env := &benchEnv{dir: dir}
+	if err := env.start(opts); err != nil {
+		env.Close()
+		return nil, err
+	}
+	return env, nil
+}
+
+func (e *benchEnv) start(opts *options) error {
+	cfg := fixtures.DefaultConfig()
+	cfg.Wizards = opts.wizards
+	if opts.users > cfg.Wizards {
+		return fmt.Errorf("--users %d exceeds --wizards %d", opts.users, cfg.Wizards)
+	}
+
+	accessPath := filepath.Join(e.dir, "access.o")
+	charDir := filepath.Join(e.dir, "characters")
+	rootDir := filepath.Join(e.dir, "root")
+	if err := fixtures.WriteAccessFile(accessPath, cfg); err != nil {
+		return err
+	}
+	if err := fixtures.WriteCharacters(charDir, cfg); err != nil {
+		return err
+	}
+
+	payload := make([]byte, opts.fileSize)
+	for i := 0; i < opts.users; i++ {
+		a := account{name: fixtures.WizardName(i), download: fixtures.DeepPath(cfg, i)}
+		a.home = "/players/" + a.name
+		a.deepDir = path.Dir(a.download)
+		for _, d := range []string{a.home, a.deepDir} {
+			if err := populateDir(filepath.Join(rootDir, filepath.FromSlash(d))); err != nil {
+				return err
+			}
+		}
+		if err := os.WriteFile(filepath.Join(rootDir, filepath.FromSlash(a.download)), payload, 0644); err != nil {
+			return err
+		}
+		e.accounts = append(e.accounts, a)
+	}
+
+	if err := logging.Initialize(filepath.Join(e.dir, "access.log"), filepath.Join(e.dir, "app.log"), logging.LogLevelWarn, 100<<20, time.Minute); err != nil {
+		return fmt.Errorf("failed to initialize logging: %w", err)
+	}
+
+	// Wired as in vkftpd's main
+	charSource := users.NewFileSource(charDir)
+	userCache := users.NewRepository(charSource, time.Minute)
+	verifier := authentication.NewMultiVerifier(nil, nil)
+	userCache.SetPrepare(verifier.Prepare)
+	verifyScheduler := authentication.NewScheduler(verifier, authentication.SchedulerConfig{})
+	authenticator := authentication.NewAuthenticator(userCache, verifyScheduler)
+	if opts.authCacheTime > 0 {
+		credentials, err := authentication.NewCredentialCache(opts.authCacheTime)
+		if err != nil {
+			return fmt.Errorf("failed to create credential cache: %w", err)
+		}
+		authenticator.SetCredentialCache(credentials)
+	}
+	authorizer := authorization.NewAuthorizer(authorization.NewAccessFileSource(accessPath), userCache, time.Minute)
+
+	port, err := freePort()
+	if err != nil {
+		return err
+	}
+	config := &ftpserver.Config{
+		ListenAddr:    "127.0.0.1",
+		Port:          port,
+		RootDir:       rootDir,
+		HomePattern:   "players/%s",
+		PasvPortRange: opts.pasvPorts,
+	}
+	if opts.tls {
+		config.TLSCertFile, config.TLSKeyFile = filepath.Join(e.dir, "cert.pem"), filepath.Join(e.dir, "key.pem")
+		if err := writeSelfSigned(config.TLSCertFile, config.TLSKeyFile); err != nil {
+			return fmt.Errorf("failed to write certificate: %w", err)
+		}
+	}
+	server, err := ftpserver.New(config, authorizer, authenticator, "bench")
+	if err != nil {
+		return fmt.Errorf("failed to create FTP server: %w", err)
+	}
+	server.SetVerifyScheduler(verifyScheduler)
+	if opts.dirCacheTime > 0 {
+		server.SetListingCache(ftpserver.NewListingCache(opts.dirCacheTime))
+	}
+	server.SetUploadSync(opts.uploadSync, time.Second)
+
+	e.server = server
+	e.addr = net.JoinHostPort(config.ListenAddr, fmt.Sprint(port))
+	e.done = make(chan error, 1)
+	go func() { e.done <- server.ListenAndServe() }()
+	return e.waitListening()
+}
+
+// waitListening waits until the server accepts connections
+func (e *benchEnv) waitListening() error {
+	deadline := time.Now().Add(10 * time.Second)
+	for {
+		conn, err := net.DialTimeout("tcp", e.addr, time.Second)
+		if err == nil {
+			conn.Close()
+			return nil
+		}
+		select {
+		case err := <-e.done:
+			e.done <- err // for Close
+			return fmt.Errorf("server failed to start: %w", err)
+		default:
+		}
+		if time.Now().After(deadline) {
+			return fmt.Errorf("server not listening on %s: %w", e.addr, err)
+		}
+		time.Sleep(20 * time.Millisecond)
+	}
+}
+
+// Close stops the server and removes the installation
+func (e *benchEnv) Close() error {
+	if e.server != nil {
+		e.server.Stop()
+		<-e.done
+	}
+	logging.Shutdown()
+	return os.RemoveAll(e.dir)
+}
+
+// populateDir creates dir with listingEntries small files in it
+func populateDir(dir string) error {
+	if err := os.MkdirAll(dir, 0755); err != nil {
+		return err
+	}
+	for i := 0; i < listingEntries; i++ {
+		name := filepath.Join(dir, fmt.Sprintf("file%02d.c", i))
+		if err := os.WriteFile(name, []byte("inherit \"/std/room\";\n"), 0644); err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+// freePort returns a TCP port on the loopback interface that nothing
+// listens on
+func freePort() (int, error) {
+	ln, err := net.Listen("tcp", "127.0.0.1:0")
+	if err != nil {
+		return 0, err
+	}
+	defer ln.Close()
+	return ln.Addr().(*net.TCPAddr).Port, nil
+}
+
+// writeSelfSigned writes a fresh self-signed certificate for localhost
+func writeSelfSigned(certFile, keyFile string) error {
+	key, err := ecdsa.GenerateKey(elliptic.P256(), rand.Reader)
+	if err != nil {
+		return err
+	}
+	template := &x509.Certificate{
+		SerialNumber: big.NewInt(1),
+		Subject:      pkix.Name{CommonName: "localhost"},
+		DNSNames:     []string{"localhost"},
+		IPAddresses:  []net.IP{net.IPv4(127, 0, 0, 1)},
+		NotBefore:    time.Now().Add(-time.Hour),
+		NotAfter:     time.Now().Add(24 * time.Hour),
+		KeyUsage:     x509.KeyUsageDigitalSignature,
+		ExtKeyUsage:  []x509.ExtKeyUsage{x509.ExtKeyUsageServerAuth},
+	}
+	certDER, err := x509.CreateCertificate(rand.Reader, template, template, &key.PublicKey, key)
+	if err != nil {
+		return err
+	}
+	keyDER, err := x509.MarshalECPrivateKey(key)
+	if err != nil {
+		return err
+	}
+	if err := os.WriteFile(certFile, pem.EncodeToMemory(&pem.Block{Type: "CERTIFICATE", Bytes: certDER}), 0600); err != nil {
+		return err
+	}
+	return os.WriteFile(keyFile, pem.EncodeToMemory(&pem.Block{Type: "EC PRIVATE KEY", Bytes: keyDER}), 0600)
+}
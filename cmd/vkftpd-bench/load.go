@@ -0,0 +1,154 @@
+package main
+
+import (
+	"crypto/tls"
+	"fmt"
+	"sync"
+	"time"
+
+	"github.com/mmcdole/viking-ftpd/pkg/fixtures"
+)
+
+// op is a kind of measured client operation
+type op int
+
+const (
+	opLogin op = iota // connect, TLS handshake if enabled, USER and PASS
+	opList
+	opRetr
+	opStor
+	numOps
+)
+
+var opNames = [numOps]string{"login", "list", "retr", "stor"}
+
+// recorder collects the outcomes of one client's operations
+type recorder struct {
+	latencies [numOps][]time.Duration
+	errors    [numOps]int
+	bytes     [numOps]int64
+	firstErr  [numOps]error
+}
+
+// observe records an operation that started at start and moved n bytes
+func (r *recorder) observe(o op, start time.Time, n int64, err error) {
+	if err != nil {
+		r.errors[o]++
+		if r.firstErr[o] == nil {
+			r.firstErr[o] = err
+		}
+		return
+	}
+	r.latencies[o] = append(r.latencies[o], time.Since(start))
+	r.bytes[o] += n
+}
+
+// runLoad runs opts.clients clients against env until opts.duration has
+// passed and returns their recorders
+func runLoad(env *benchEnv, opts *options) []*recorder {
+	var tlsConfig *tls.Config
+	if opts.tls {
+		// One session cache, as clients on one host would share; the name
+		// keys the control and data connections to the same sessions
+		tlsConfig = &tls.Config{
+			ServerName:         "localhost",
+			InsecureSkipVerify: true,
+			ClientSessionCache: tls.NewLRUClientSessionCache(opts.clients * 2),
+		}
+	}
+
+	deadline := time.Now().Add(opts.duration)
+	recorders := make([]*recorder, opts.clients)
+	var wg sync.WaitGroup
+	for i := range recorders {
+		recorders[i] = &recorder{}
+		wg.Add(1)
+		go func(id int, rec *recorder) {
+			defer wg.Done()
+			c := &client{
+				env:      env,
+				opts:     opts,
+				tls:      tlsConfig,
+				account:  env.accounts[id%len(env.accounts)],
+				rec:      rec,
+				deadline: deadline,
+				payload:  make([]byte, opts.fileSize),
+			}
+			c.upload = fmt.Sprintf("%s/upload%d.dat", c.account.home, id)
+			c.run()
+		}(i, recorders[i])
+	}
+	wg.Wait()
+	return recorders
+}
+
+// client runs sessions of one user until the deadline
+type client struct {
+	env      *benchEnv
+	opts     *options
+	tls      *tls.Config
+	account  account
+	rec      *recorder
+	deadline time.Time
+	payload  []byte
+	upload   string // path the client uploads to
+}
+
+func (c *client) run() {
+	for time.Now().Before(c.deadline) {
+		if err := c.session(); err != nil {
+			// Don't spin on a server that refuses every session
+			time.Sleep(10 * time.Millisecond)
+		}
+	}
+}
+
+// session logs in, runs the rounds of one session and logs out. A failed
+// operation ends the session.
+func (c *client) session() error {
+	start := time.Now()
+	conn, err := dialFTP(c.env.addr, c.tls, c.opts.timeout)
+	if err == nil {
+		if err = conn.login(c.account.name, fixtures.Password); err != nil {
+			conn.Close()
+		}
+	}
+	c.rec.observe(opLogin, start, 0, err)
+	if err != nil {
+		return err
+	}
+
+	for i := 0; i < c.opts.sessionOps && time.Now().Before(c.deadline); i++ {
+		if err := c.round(conn); err != nil {
+			conn.Close()
+			return err
+		}
+	}
+	return conn.quit()
+}
+
+// round lists the home and domain directories, downloads the domain file
+// and uploads one to the home directory
+func (c *client) round(conn *ftpConn) error {
+	for _, dir := range []string{c.account.home, c.account.deepDir} {
+		start := time.Now()
+		n, err := conn.list(dir)
+		if c.rec.observe(opList, start, n, err); err != nil {
+			return err
+		}
+	}
+
+	start := time.Now()
+	n, err := conn.retr(c.account.download)
+	if err == nil && n != int64(len(c.payload)) {
+		err = fmt.Errorf("RETR %s: got %d bytes, want %d", c.account.download, n, len(c.payload))
+	}
+	if c.rec.observe(opRetr, start, n, err); err != nil {
+		return err
+	}
+
+	start = time.Now()
+	err = conn.stor(c.upload, c.payload)
+	c.rec.observe(opStor, start, int64(len(c.payload)), err)
+	return err
+}
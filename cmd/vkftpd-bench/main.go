@@ -0,0 +1,123 @@
+// Command vkftpd-bench load-tests the FTP server end to end. It generates a
+// synthetic MUD installation, serves it with an in-process server on the
+// loopback interface and runs concurrent clients that log in, list
+// directories, download and upload files, then reports throughput, latency
+// percentiles, allocations and peak memory.
+package main
+
+import (
+	"encoding/json"
+	"fmt"
+	"os"
+	"runtime"
+	"time"
+
+	"github.com/mmcdole/viking-ftpd/pkg/ftpserver"
+	"github.com/spf13/cobra"
+)
+
+// options are the parameters of a load test
+type options struct {
+	clients       int
+	duration      time.Duration
+	sessionOps    int
+	tls           bool
+	users         int
+	wizards       int
+	fileSize      int
+	pasvPorts     [2]int
+	dirCacheTime  time.Duration
+	authCacheTime time.Duration
+	uploadSync    ftpserver.UploadSync
+	timeout       time.Duration
+	json          bool
+}
+
+var (
+	opts       options
+	pasvRange  string
+	uploadSync string
+)
+
+var rootCmd = &cobra.Command{
+	Use:           "vkftpd-bench",
+	Short:         "Load-test the VikingMUD FTP server",
+	SilenceUsage:  true,
+	SilenceErrors: true,
+	Long: `Load-test the VikingMUD FTP server against synthetic MUD data.
+
+Each client repeatedly logs in as one of the first --users wizards and runs
+--session-ops rounds of LIST of its home directory, LIST of a deep domain
+directory, RETR of a --file-size file and STOR of one, then logs out.
+Allocations and peak RSS are those of the whole process, clients included,
+during the run.`,
+	Args: cobra.NoArgs,
+	RunE: func(cmd *cobra.Command, args []string) error {
+		if _, err := fmt.Sscanf(pasvRange, "%d-%d", &opts.pasvPorts[0], &opts.pasvPorts[1]); err != nil {
+			return fmt.Errorf("invalid --pasv-ports %q: %w", pasvRange, err)
+		}
+		mode, err := ftpserver.ParseUploadSync(uploadSync)
+		if err != nil {
+			return fmt.Errorf("invalid --upload-sync: %w", err)
+		}
+		opts.uploadSync = mode
+		if opts.clients <= 0 || opts.users <= 0 || opts.sessionOps <= 0 {
+			return fmt.Errorf("--clients, --users and --session-ops must be positive")
+		}
+
+		env, err := setupEnv(&opts)
+		if err != nil {
+			return err
+		}
+		defer env.Close()
+
+		// Measure the run only, not the generation of the fixtures
+		runtime.GC()
+		resetPeakRSS()
+		var before, after runtime.MemStats
+		runtime.ReadMemStats(&before)
+		start := time.Now()
+		recorders := runLoad(env, &opts)
+		elapsed := time.Since(start)
+		runtime.ReadMemStats(&after)
+
+		r := newReport(&opts, recorders, elapsed, &before, &after)
+		r.PermissionCacheHitRatio = ratio(env.server.GetPermissionCacheHits(), env.server.GetPermissionCacheMisses())
+		r.TLSHandshakes, r.TLSResumed = env.server.GetTLSHandshakes(), env.server.GetTLSResumedHandshakes()
+		if opts.json {
+			enc := json.NewEncoder(os.Stdout)
+			enc.SetIndent("", "  ")
+			if err := enc.Encode(r); err != nil {
+				return err
+			}
+		} else if err := r.print(os.Stdout); err != nil {
+			return err
+		}
+
+		if failed := r.failed(); failed > 0 {
+			return fmt.Errorf("%d operations failed", failed)
+		}
+		return nil
+	},
+}
+
+func init() {
+	flags := rootCmd.Flags()
+	flags.IntVar(&opts.clients, "clients", 32, "number of concurrent clients")
+	flags.DurationVar(&opts.duration, "duration", 10*time.Second, "how long the clients run")
+	flags.IntVar(&opts.sessionOps, "session-ops", 10, "rounds of LIST, RETR and STOR per login")
+	flags.BoolVar(&opts.tls, "tls", false, "use explicit FTPS for control and data connections")
+	flags.IntVar(&opts.users, "users", 100, "number of distinct wizards the clients log in as")
+	flags.IntVar(&opts.wizards, "wizards", 3000, "number of wizards in the generated access.o")
+	flags.IntVar(&opts.fileSize, "file-size", 256<<10, "size in bytes of downloaded and uploaded files")
+	flags.StringVar(&pasvRange, "pasv-ports", "42000-42999", "passive port range of the server")
+	flags.DurationVar(&opts.dirCacheTime, "dir-cache-time", 0, "listing cache TTL (0 = disabled)")
+	flags.DurationVar(&opts.authCacheTime, "auth-cache-time", 0, "credential cache TTL (0 = disabled)")
+	flags.StringVar(&uploadSync, "upload-sync", "none", "when uploads are synced: none, file or batch")
+	flags.DurationVar(&opts.timeout, "timeout", 30*time.Second, "deadline of each network operation")
+	flags.BoolVar(&opts.json, "json", false, "print the report as JSON")
+}
+
+func main() {
+	cobra.CheckErr(rootCmd.Execute())
+}
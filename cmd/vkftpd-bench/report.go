@@ -0,0 +1,158 @@
+package main
+
+import (
+	"fmt"
+	"io"
+	"runtime"
+	"sort"
+	"text/tabwriter"
+	"time"
+)
+
+// report summarizes a load test
+type report struct {
+	Mode            string    `json:"mode"` // "plain" or "tls"
+	Clients         int       `json:"clients"`
+	Users           int       `json:"users"`
+	FileSize        int       `json:"file_size"`
+	DurationSeconds float64   `json:"duration_seconds"`
+	Ops             []opStats `json:"ops"`
+
+	AllocsPerOp float64 `json:"allocs_per_op"` // heap allocations per completed operation
+	BytesPerOp  float64 `json:"bytes_per_op"`  // heap bytes allocated per completed operation
+	GCCycles    uint32  `json:"gc_cycles"`
+	PeakRSS     int64   `json:"peak_rss_bytes"` // -1 if unknown
+
+	PermissionCacheHitRatio float64 `json:"permission_cache_hit_ratio"`
+	TLSHandshakes           int64   `json:"tls_handshakes"`
+	TLSResumed              int64   `json:"tls_resumed"`
+}
+
+// opStats summarizes the operations of one kind
+type opStats struct {
+	Op         string  `json:"op"`
+	Count      int     `json:"count"` // completed operations
+	Errors     int     `json:"errors"`
+	PerSecond  float64 `json:"per_second"`
+	P50Ms      float64 `json:"p50_ms"`
+	P99Ms      float64 `json:"p99_ms"`
+	MaxMs      float64 `json:"max_ms"`
+	MBPerSec   float64 `json:"mb_per_sec"` // payload throughput, 0 for logins
+	FirstError string  `json:"first_error,omitempty"`
+}
+
+// newReport merges the recorders of a run that took elapsed, between the
+// memory statistics before and after
+func newReport(opts *options, recorders []*recorder, elapsed time.Duration, before, after *runtime.MemStats) *report {
+	r := &report{
+		Mode:            "plain",
+		Clients:         opts.clients,
+		Users:           opts.users,
+		FileSize:        opts.fileSize,
+		DurationSeconds: elapsed.Seconds(),
+		GCCycles:        after.NumGC - before.NumGC,
+		PeakRSS:         -1,
+	}
+	if opts.tls {
+		r.Mode = "tls"
+	}
+	if rss, ok := peakRSS(); ok {
+		r.PeakRSS = int64(rss)
+	}
+
+	completed := 0
+	for o := op(0); o < numOps; o++ {
+		s := opStats{Op: opNames[o]}
+		var latencies []time.Duration
+		var bytes int64
+		for _, rec := range recorders {
+			latencies = append(latencies, rec.latencies[o]...)
+			bytes += rec.bytes[o]
+			s.Errors += rec.errors[o]
+			if s.FirstError == "" && rec.firstErr[o] != nil {
+				s.FirstError = rec.firstErr[o].Error()
+			}
+		}
+		sort.Slice(latencies, func(i, j int) bool { return latencies[i] < latencies[j] })
+		s.Count = len(latencies)
+		s.PerSecond = float64(s.Count) / elapsed.Seconds()
+		s.P50Ms = milliseconds(quantile(latencies, 0.50))
+		s.P99Ms = milliseconds(quantile(latencies, 0.99))
+		s.MaxMs = milliseconds(quantile(latencies, 1))
+		if o != opLogin {
+			s.MBPerSec = float64(bytes) / (1 << 20) / elapsed.Seconds()
+		}
+		completed += s.Count
+		r.Ops = append(r.Ops, s)
+	}
+	if completed > 0 {
+		r.AllocsPerOp = float64(after.Mallocs-before.Mallocs) / float64(completed)
+		r.BytesPerOp = float64(after.TotalAlloc-before.TotalAlloc) / float64(completed)
+	}
+	return r
+}
+
+// failed returns the number of operations that failed
+func (r *report) failed() int {
+	n := 0
+	for _, s := range r.Ops {
+		n += s.Errors
+	}
+	return n
+}
+
+// print writes the report as a table
+func (r *report) print(out io.Writer) error {
+	fmt.Fprintf(out, "%s, %d clients as %d users, %d byte files, %.1fs\n\n", r.Mode, r.Clients, r.Users, r.FileSize, r.DurationSeconds)
+	w := tabwriter.NewWriter(out, 0, 8, 2, ' ', tabwriter.AlignRight)
+	fmt.Fprintln(w, "OP\tCOUNT\tERRORS\tOPS/S\tP50 MS\tP99 MS\tMAX MS\tMB/S\t")
+	for _, s := range r.Ops {
+		fmt.Fprintf(w, "%s\t%d\t%d\t%.1f\t%.2f\t%.2f\t%.2f\t%.1f\t\n", s.Op, s.Count, s.Errors, s.PerSecond, s.P50Ms, s.P99Ms, s.MaxMs, s.MBPerSec)
+	}
+	if err := w.Flush(); err != nil {
+		return err
+	}
+
+	fmt.Fprintf(out, "\nallocs/op %.0f, bytes/op %.0f, GC cycles %d", r.AllocsPerOp, r.BytesPerOp, r.GCCycles)
+	if r.PeakRSS >= 0 {
+		fmt.Fprintf(out, ", peak RSS %.1f MiB", float64(r.PeakRSS)/(1<<20))
+	}
+	fmt.Fprintf(out, "\npermission cache hit ratio %.3f", r.PermissionCacheHitRatio)
+	if r.Mode == "tls" {
+		fmt.Fprintf(out, ", TLS handshakes %d (%d resumed)", r.TLSHandshakes, r.TLSResumed)
+	}
+	fmt.Fprintln(out)
+	for _, s := range r.Ops {
+		if s.FirstError != "" {
+			fmt.Fprintf(out, "first %s error: %s\n", s.Op, s.FirstError)
+		}
+	}
+	return nil
+}
+
+// quantile returns the q-th quantile of sorted latencies, 0 if there are none
+func quantile(sorted []time.Duration, q float64) time.Duration {
+	if len(sorted) == 0 {
+		return 0
+	}
+	i := int(q*float64(len(sorted))+0.5) - 1
+	if i < 0 {
+		i = 0
+	}
+	if i >= len(sorted) {
+		i = len(sorted) - 1
+	}
+	return sorted[i]
+}
+
+func milliseconds(d time.Duration) float64 {
+	return float64(d) / float64(time.Millisecond)
+}
+
+// ratio returns hits / (hits + misses), 0 if there were none
+func ratio(hits, misses int64) float64 {
+	if hits+misses == 0 {
+		return 0
+	}
+	return float64(hits) / float64(hits+misses)
+}
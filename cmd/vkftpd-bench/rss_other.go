@@ -0,0 +1,10 @@
+//go:build !linux
+
+package main
+
+// peakRSS is only known on Linux
+func peakRSS() (uint64, bool) {
+	return 0, false
+}
+
+func resetPeakRSS() {}
@@ -0,0 +1,95 @@
+package main
+
+import (
+	"encoding/json"
+	"fmt"
+	"os"
+	"text/tabwriter"
+	"time"
+
+	"github.com/mmcdole/viking-ftpd/pkg/authorization"
+	"github.com/mmcdole/viking-ftpd/pkg/users"
+	"github.com/spf13/cobra"
+)
+
+var accessJSON bool
+
+var accessCmd = &cobra.Command{
+	Use:   "access <user> [path]",
+	Short: "Print a user's effective permissions on a subtree",
+	Long: `Print the effective permissions of a user on path (default "/") and
+everything below it, as the server would resolve them from access.o and the
+user's character file.
+
+Each line gives a path, the permission on the path itself and the permission
+on every path below it that has no line of its own. Paths that would repeat
+their parent's permissions are left out. A "*" segment stands for every entry
+without a line of its own, as in access.o.`,
+	Args: cobra.RangeArgs(1, 2),
+	RunE: func(cmd *cobra.Command, args []string) error {
+		var config Config
+		if err := loadConfigFlag(&config); err != nil {
+			return err
+		}
+
+		root := authorization.RootPath
+		if len(args) == 2 {
+			root = authorization.CleanPath(args[1])
+		}
+
+		accessSource := authorization.NewAccessFileSource(config.AccessFilePath)
+		accessSource.SetSnapshotPath(config.AccessSnapshotPath)
+		authorizer := authorization.NewAuthorizer(accessSource, users.NewFileSource(config.CharacterDirPath), time.Minute)
+		if authorizer.Generation() == 0 {
+			return fmt.Errorf("failed to load access file %s", config.AccessFilePath)
+		}
+		ranges := authorizer.ResolveSubtree(args[0], root)
+
+		if accessJSON {
+			type jsonRange struct {
+				Path  string `json:"path"`
+				Self  string `json:"self"`
+				Below string `json:"below"`
+			}
+			out := make([]jsonRange, len(ranges))
+			for i, r := range ranges {
+				out[i] = jsonRange{Path: r.Path, Self: permissionName(r.Self), Below: permissionName(r.Below)}
+			}
+			enc := json.NewEncoder(os.Stdout)
+			enc.SetIndent("", "  ")
+			return enc.Encode(out)
+		}
+
+		w := tabwriter.NewWriter(os.Stdout, 0, 8, 2, ' ', 0)
+		fmt.Fprintln(w, "PATH\tSELF\tBELOW")
+		for _, r := range ranges {
+			fmt.Fprintf(w, "%s\t%s\t%s\n", r.Path, permissionName(r.Self), permissionName(r.Below))
+		}
+		return w.Flush()
+	},
+}
+
+// permissionName returns the name a report gives a permission. Logs keep
+// permissions as numbers, as access.o stores them.
+func permissionName(p authorization.Permission) string {
+	switch p {
+	case authorization.Revoked:
+		return "revoked"
+	case authorization.Read:
+		return "read"
+	case authorization.GrantRead:
+		return "grant_read"
+	case authorization.Write:
+		return "write"
+	case authorization.GrantWrite:
+		return "grant_write"
+	case authorization.GrantGrant:
+		return "grant_grant"
+	}
+	return fmt.Sprintf("Permission(%d)", int(p))
+}
+
+func init() {
+	accessCmd.Flags().BoolVar(&accessJSON, "json", false, "print the ranges as JSON")
+	rootCmd.AddCommand(accessCmd)
+}
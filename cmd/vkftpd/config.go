@@ -12,37 +12,70 @@ type Config struct {
 	// Core server settings
 	ListenAddr     string `json:"listen_addr"`     // Address to listen on (e.g., "0.0.0.0")
 	Port           int    `json:"port"`            // Port to listen on (e.g., 2121)
-	MaxConnections int    `json:"max_connections"` // Maximum concurrent connections
-	IdleTimeout    int    `json:"idle_timeout"`    // Connection idle timeout in seconds
+	MaxConnections int    `json:"max_connections"` // Maximum concurrent connections (-1 = unlimited)
+	IdleTimeout    int    `json:"idle_timeout"`    // Connection idle timeout in seconds (-1 = never)
 	FTPRootDir     string `json:"ftp_root_dir"`    // Root directory that FTP users will be restricted to
 	HomePattern    string `json:"home_pattern"`    // Pattern for user home directories (e.g., "players/%s")
 
+	MaxConnectionsPerIP   int `json:"max_connections_per_ip"`   // Maximum concurrent connections from one client IP (-1 = unlimited)
+	MaxConnectionsPerUser int `json:"max_connections_per_user"` // Maximum concurrent sessions logged in as one user (-1 = unlimited)
+
 	// Transfer settings
 	PasvPortRange [2]int `json:"pasv_port_range"` // Range of ports for passive mode transfers
 	PasvAddress   string `json:"pasv_address"`    // Public IP for passive mode connections
 	PasvIPVerify  bool   `json:"pasv_ip_verify"`  // Whether to verify data connection IPs
 
+	// Upload settings
+	UploadBufferSize   int    `json:"upload_buffer_size"`   // Bytes buffered per upload before writing
+	UploadSync         string `json:"upload_sync"`          // When uploads are synced to disk ("none", "file" or "batch")
+	UploadSyncInterval int    `json:"upload_sync_interval"` // Seconds between grouped syncs when upload_sync is "batch"
+
+	// Bandwidth settings, in KiB per second (0 = unlimited)
+	BandwidthLimit   int            `json:"bandwidth_limit"`    // Rate shared by all transfers
+	BandwidthPerUser int            `json:"bandwidth_per_user"` // Rate shared by each user's transfers
+	BandwidthGroups  map[string]int `json:"bandwidth_groups"`   // Rate shared by the members of each group (e.g. "arch_full")
+
 	// Security settings
 	TLSCertFile string `json:"tls_cert_file"` // Path to TLS certificate file
 	TLSKeyFile  string `json:"tls_key_file"`  // Path to TLS private key file
 
+	// Password verification settings
+	AuthWorkers      int `json:"auth_workers"`       // Password verifications running at once (0 = number of CPUs)
+	AuthMemoryBudget int `json:"auth_memory_budget"` // Argon2 memory in KiB shared by running verifications
+	AuthQueueSize    int `json:"auth_queue_size"`    // Login attempts that may wait for verification
+	AuthQueuePerIP   int `json:"auth_queue_per_ip"`  // Login attempts one client IP may have waiting
+	AuthQueueTimeout int `json:"auth_queue_timeout"` // Seconds an attempt may wait before it is refused
+	AuthCacheTime    int `json:"auth_cache_time"`    // Seconds a successful login is remembered (0 = disabled)
+	AuthCacheSize    int `json:"auth_cache_size"`    // Maximum number of remembered logins
+
 	// MUD-specific paths
-	CharacterDirPath string `json:"character_dir_path"` // Path to character files directory
-	AccessFilePath   string `json:"access_file_path"`   // Path to the MUD's access.o file
+	CharacterDirPath   string `json:"character_dir_path"`   // Path to character files directory
+	AccessFilePath     string `json:"access_file_path"`     // Path to the MUD's access.o file
+	AccessSnapshotPath string `json:"access_snapshot_path"` // Compiled copy of access.o reused across restarts (empty = disabled)
 
 	// Cache settings
-	CharacterCacheTime int `json:"character_cache_time"` // How long to cache character data (seconds)
-	AccessCacheTime    int `json:"access_cache_time"`    // How long to cache access data (seconds)
+	CharacterCacheTime int    `json:"character_cache_time"` // How long to cache character data (seconds)
+	AccessCacheTime    int    `json:"access_cache_time"`    // How long to cache access data (seconds)
+	AccessRefreshMode  string `json:"access_refresh_mode"`  // How expired access data is reloaded ("inline" or "background")
+	CacheMode          string `json:"cache_mode"`           // "ttl" re-parses on expiry; "watch" re-parses only when files change
+	DirCacheTime       int    `json:"dir_cache_time"`       // How long an unchanged directory listing is reused (seconds, -1 = disabled)
+	DirCacheSize       int    `json:"dir_cache_size"`       // Maximum number of cached directory listings
+	HideUnreadable     bool   `json:"hide_unreadable"`      // Leave entries the user cannot read out of listings
 
 	// Logging settings
-	AccessLogPath     string `json:"access_log_path"`      // Path to access log file
-	AppLogPath        string `json:"app_log_path"`         // Path to application log file
-	LogLevel          string `json:"log_level"`            // Log level (debug, info, warn, error, panic)
-	MaxLogSize        int    `json:"max_log_size"`         // Maximum log size in bytes before rotation
-	LogVerifyInterval int    `json:"log_verify_interval"`  // Seconds between file verification checks
+	AccessLogPath     string `json:"access_log_path"`     // Path to access log file
+	AppLogPath        string `json:"app_log_path"`        // Path to application log file
+	LogLevel          string `json:"log_level"`           // Log level (debug, info, warn, error, panic)
+	MaxLogSize        int    `json:"max_log_size"`        // Maximum log size in bytes before rotation
+	LogVerifyInterval int    `json:"log_verify_interval"` // Seconds between file verification checks
+	LogAsync          bool   `json:"log_async"`           // Write log records from a background goroutine
+	LogBufferSize     int    `json:"log_buffer_size"`     // Records buffered per log file when log_async is set
+	LogFullPolicy     string `json:"log_full_policy"`     // When the buffer is full: "block" waits, "drop" discards
+	LogRotateMode     string `json:"log_rotate_mode"`     // Where log files are rotated ("inline" or "background")
 
 	// Status monitoring (optional)
-	StatusDir string `json:"status_dir"` // Directory for status files (last_start, running, last_stop)
+	StatusDir   string `json:"status_dir"`   // Directory for status files (last_start, running, last_stop)
+	MetricsAddr string `json:"metrics_addr"` // Address serving /metrics and /debug/pprof/ (e.g. "127.0.0.1:9120", empty = disabled)
 }
 
 // LoadConfig loads configuration from a JSON file
@@ -67,6 +100,9 @@ func LoadConfig(path string, config *Config) error {
 	if !filepath.IsAbs(config.AccessFilePath) {
 		config.AccessFilePath = filepath.Join(configDir, config.AccessFilePath)
 	}
+	if config.AccessSnapshotPath != "" && !filepath.IsAbs(config.AccessSnapshotPath) {
+		config.AccessSnapshotPath = filepath.Join(configDir, config.AccessSnapshotPath)
+	}
 
 	// Only convert log paths to absolute if they are specified and not absolute
 	if config.AccessLogPath != "" && !filepath.IsAbs(config.AccessLogPath) {
@@ -105,18 +141,78 @@ func LoadConfig(path string, config *Config) error {
 	if config.IdleTimeout == 0 {
 		config.IdleTimeout = 300 // 5 minutes
 	}
+	if config.MaxConnectionsPerIP == 0 {
+		config.MaxConnectionsPerIP = 5
+	}
+	if config.MaxConnectionsPerUser == 0 {
+		config.MaxConnectionsPerUser = 5
+	}
+	if config.AuthMemoryBudget == 0 {
+		config.AuthMemoryBudget = 256 * 1024 // four default Argon2id hashes
+	}
+	if config.AuthQueueSize == 0 {
+		config.AuthQueueSize = 256
+	}
+	if config.AuthQueuePerIP == 0 {
+		config.AuthQueuePerIP = 4
+	}
+	if config.AuthQueueTimeout == 0 {
+		config.AuthQueueTimeout = 10
+	}
+	if config.AuthCacheSize == 0 {
+		config.AuthCacheSize = 1024
+	}
 	if config.CharacterCacheTime == 0 {
 		config.CharacterCacheTime = 60 // 1 minute
 	}
 	if config.AccessCacheTime == 0 {
 		config.AccessCacheTime = 60 // 1 minute
 	}
+	if config.DirCacheTime == 0 {
+		config.DirCacheTime = 10
+	}
+	if config.DirCacheSize == 0 {
+		config.DirCacheSize = 256
+	}
+	if config.CacheMode == "" {
+		config.CacheMode = "ttl"
+	}
+	if config.CacheMode != "ttl" && config.CacheMode != "watch" {
+		return fmt.Errorf("invalid cache_mode %q (expected ttl or watch)", config.CacheMode)
+	}
 	if config.MaxLogSize == 0 {
 		config.MaxLogSize = 1000000 // 1 MB, matching MUD's MAX_LOG_SIZE
 	}
 	if config.LogVerifyInterval == 0 {
 		config.LogVerifyInterval = 45 // 45 seconds
 	}
+	if config.UploadBufferSize == 0 {
+		config.UploadBufferSize = 256 * 1024
+	}
+	if config.UploadSync == "" {
+		config.UploadSync = "none"
+	}
+	if config.UploadSync != "none" && config.UploadSync != "file" && config.UploadSync != "batch" {
+		return fmt.Errorf("invalid upload_sync %q (expected none, file or batch)", config.UploadSync)
+	}
+	if config.UploadSyncInterval == 0 {
+		config.UploadSyncInterval = 1
+	}
+	if config.LogBufferSize == 0 {
+		config.LogBufferSize = 8192
+	}
+	if config.LogFullPolicy == "" {
+		config.LogFullPolicy = "block"
+	}
+	if config.LogFullPolicy != "block" && config.LogFullPolicy != "drop" {
+		return fmt.Errorf("invalid log_full_policy %q (expected block or drop)", config.LogFullPolicy)
+	}
+	if config.LogRotateMode == "" {
+		config.LogRotateMode = "inline"
+	}
+	if config.LogRotateMode != "inline" && config.LogRotateMode != "background" {
+		return fmt.Errorf("invalid log_rotate_mode %q (expected inline or background)", config.LogRotateMode)
+	}
 
 	return nil
 }
@@ -3,6 +3,8 @@ package main
 import (
 	"context"
 	"fmt"
+	"net"
+	"net/http"
 	"os"
 	"os/signal"
 	"path/filepath"
@@ -11,8 +13,10 @@ import (
 
 	"github.com/mmcdole/viking-ftpd/pkg/authentication"
 	"github.com/mmcdole/viking-ftpd/pkg/authorization"
+	"github.com/mmcdole/viking-ftpd/pkg/filewatch"
 	"github.com/mmcdole/viking-ftpd/pkg/ftpserver"
 	"github.com/mmcdole/viking-ftpd/pkg/logging"
+	"github.com/mmcdole/viking-ftpd/pkg/metrics"
 	"github.com/mmcdole/viking-ftpd/pkg/status"
 	"github.com/mmcdole/viking-ftpd/pkg/users"
 	"github.com/spf13/cobra"
@@ -55,6 +59,8 @@ Configuration file must be in JSON format with the following structure:
     "access_file_path": "/mud/lib/dgd/sys/data/access.o",
     "character_cache_time": 60,
     "access_cache_time": 60,
+    "access_refresh_mode": "inline",
+    "cache_mode": "ttl",
     "access_log_path": "/mud/lib/log/vkftpd-access.log",
     "app_log_path": "/mud/lib/log/vkftpd-app.log",
     "log_level": "info"
@@ -65,47 +71,92 @@ Configuration file must be in JSON format with the following structure:
 			return nil
 		}
 
-		if cfgFile == "" {
-			return fmt.Errorf("config file is required (use --config)")
-		}
-
-		// Convert to absolute path if needed
-		if !filepath.IsAbs(cfgFile) {
-			var err error
-			cfgFile, err = filepath.Abs(cfgFile)
-			if err != nil {
-				return fmt.Errorf("failed to get absolute path: %w", err)
-			}
-		}
-
 		// Load configuration
 		var config Config
-		if err := LoadConfig(cfgFile, &config); err != nil {
-			return fmt.Errorf("failed to load config: %w", err)
+		if err := loadConfigFlag(&config); err != nil {
+			return err
 		}
 
 		// Initialize logging
-		if err := logging.Initialize(
+		if err := logging.InitializeWithOptions(
 			config.AccessLogPath,
 			config.AppLogPath,
 			logging.LogLevel(config.LogLevel),
 			int64(config.MaxLogSize),
 			time.Duration(config.LogVerifyInterval)*time.Second,
+			logging.Options{
+				Async:              config.LogAsync,
+				BufferSize:         config.LogBufferSize,
+				FullPolicy:         logging.FullPolicy(config.LogFullPolicy),
+				BackgroundRotation: config.LogRotateMode == "background",
+			},
 		); err != nil {
 			return fmt.Errorf("failed to initialize logging: %w", err)
 		}
 		defer logging.Shutdown()
 
-		// Create user source
+		// Create user source, cached so that logins and implicit group checks
+		// don't re-read character files on every request
 		charSource := users.NewFileSource(config.CharacterDirPath)
+		userCache := users.NewRepository(charSource, time.Duration(config.CharacterCacheTime)*time.Second)
 
 		// Create authenticator
-		// Use a multi-hash verifier that supports both legacy unixcrypt and argon2id
-		authenticator := authentication.NewAuthenticator(charSource, authentication.NewVerifier())
+		// Use a multi-hash verifier that supports both legacy unixcrypt and argon2id,
+		// behind a scheduler that bounds concurrent verifications and their memory
+		// Password hashes are decoded once when a character is loaded
+		verifier := authentication.NewMultiVerifier(nil, nil)
+		userCache.SetPrepare(verifier.Prepare)
+		verifyScheduler := authentication.NewScheduler(verifier, authentication.SchedulerConfig{
+			Workers:      config.AuthWorkers,
+			MemoryBudget: uint64(config.AuthMemoryBudget),
+			MaxQueue:     config.AuthQueueSize,
+			MaxPerSource: config.AuthQueuePerIP,
+			MaxWait:      time.Duration(config.AuthQueueTimeout) * time.Second,
+		})
+		authenticator := authentication.NewAuthenticator(userCache, verifyScheduler)
+		if config.AuthCacheTime > 0 {
+			credentials, err := authentication.NewCredentialCache(time.Duration(config.AuthCacheTime) * time.Second)
+			if err != nil {
+				return fmt.Errorf("failed to create credential cache: %w", err)
+			}
+			credentials.SetMaxEntries(config.AuthCacheSize)
+			authenticator.SetCredentialCache(credentials)
+		}
 
 		// Create authorizer for permission checks
 		accessSource := authorization.NewAccessFileSource(config.AccessFilePath)
-		authorizer := authorization.NewAuthorizer(accessSource, charSource, time.Duration(config.AccessCacheTime)*time.Second)
+		accessSource.SetSnapshotPath(config.AccessSnapshotPath)
+		authorizer := authorization.NewAuthorizer(accessSource, userCache, time.Duration(config.AccessCacheTime)*time.Second)
+		refreshMode, err := authorization.ParseRefreshMode(config.AccessRefreshMode)
+		if err != nil {
+			return fmt.Errorf("invalid access_refresh_mode: %w", err)
+		}
+		authorizer.SetRefreshMode(refreshMode)
+
+		// A changed character may have a new level, and so a new implicit group
+		charSource.SetChangeHandler(func(username string) {
+			userCache.Invalidate(username)
+			authorizer.InvalidateUser(username)
+		})
+
+		// In watch mode, files are only re-parsed when they change on disk
+		if config.CacheMode == "watch" {
+			charSource.SetChangeDetection(true)
+			authorizer.SetChangeDetection(true)
+
+			watcher, err := filewatch.New()
+			if err != nil {
+				logging.App.Warn("File watching unavailable, checking file stamps on cache expiry instead", "error", err)
+			} else {
+				defer watcher.Close()
+				if err := accessSource.Watch(watcher, authorizer.Invalidate); err != nil {
+					return fmt.Errorf("failed to watch access file: %w", err)
+				}
+				if err := charSource.Watch(watcher); err != nil {
+					return fmt.Errorf("failed to watch character directory: %w", err)
+				}
+			}
+		}
 
 		// Create and start FTP server
 		server, err := ftpserver.New(&ftpserver.Config{
@@ -118,10 +169,57 @@ Configuration file must be in JSON format with the following structure:
 			PasvPortRange: config.PasvPortRange,
 			PasvAddress:   config.PasvAddress,
 			PasvIPVerify:  config.PasvIPVerify,
+
+			MaxConnections:        config.MaxConnections,
+			MaxConnectionsPerIP:   config.MaxConnectionsPerIP,
+			MaxConnectionsPerUser: config.MaxConnectionsPerUser,
+			IdleTimeout:           config.IdleTimeout,
 		}, authorizer, authenticator, version)
 		if err != nil {
 			return fmt.Errorf("failed to create FTP server: %w", err)
 		}
+		server.SetVerifyScheduler(verifyScheduler)
+		if config.DirCacheTime > 0 {
+			listings := ftpserver.NewListingCache(time.Duration(config.DirCacheTime) * time.Second)
+			listings.SetMaxEntries(config.DirCacheSize)
+			server.SetListingCache(listings)
+		}
+		server.SetHideUnreadable(config.HideUnreadable)
+		server.SetUploadBufferSize(config.UploadBufferSize)
+		server.SetUploadSync(ftpserver.UploadSync(config.UploadSync), time.Duration(config.UploadSyncInterval)*time.Second)
+		if config.BandwidthLimit > 0 || config.BandwidthPerUser > 0 || len(config.BandwidthGroups) > 0 {
+			groups := make(map[string]int64, len(config.BandwidthGroups))
+			for name, rate := range config.BandwidthGroups {
+				groups[name] = int64(rate) * 1024
+				if !authorizer.DefinesGroup(name) {
+					logging.App.Warn("Bandwidth group has no access tree, so no user is in it", "group", name)
+				}
+			}
+			server.SetBandwidthLimiter(ftpserver.NewBandwidthLimiter(int64(config.BandwidthLimit)*1024, int64(config.BandwidthPerUser)*1024, groups))
+		}
+
+		// Metrics are kept for the status file as well as the listener
+		registry := metrics.NewRegistry()
+		if config.MetricsAddr != "" || config.StatusDir != "" {
+			authorizer.SetMetrics(registry)
+			server.SetMetrics(registry)
+		}
+
+		// Serve Prometheus metrics and pprof profiles if configured
+		if config.MetricsAddr != "" {
+			ln, err := net.Listen("tcp", config.MetricsAddr)
+			if err != nil {
+				return fmt.Errorf("failed to listen for metrics: %w", err)
+			}
+			metricsServer := &http.Server{Handler: metrics.NewServeMux(registry), ReadHeaderTimeout: 10 * time.Second}
+			go func() {
+				if err := metricsServer.Serve(ln); err != nil && err != http.ErrServerClosed {
+					logging.App.Error("Metrics server error", "error", err)
+				}
+			}()
+			defer metricsServer.Close()
+			logging.App.Info("Serving metrics", "addr", ln.Addr().String())
+		}
 
 		// Initialize status writer if configured
 		var statusWriter *status.Writer
@@ -201,6 +299,24 @@ Configuration file must be in JSON format with the following structure:
 	},
 }
 
+// loadConfigFlag loads the configuration file named by --config
+func loadConfigFlag(config *Config) error {
+	if cfgFile == "" {
+		return fmt.Errorf("config file is required (use --config)")
+	}
+
+	// Convert to absolute path if needed
+	path, err := filepath.Abs(cfgFile)
+	if err != nil {
+		return fmt.Errorf("failed to get absolute path: %w", err)
+	}
+
+	if err := LoadConfig(path, config); err != nil {
+		return fmt.Errorf("failed to load config: %w", err)
+	}
+	return nil
+}
+
 func init() {
 	rootCmd.PersistentFlags().StringVarP(&cfgFile, "config", "c", "", "config file path")
 	rootCmd.PersistentFlags().BoolVarP(&showVersion, "version", "v", false, "show version")
@@ -7,6 +7,7 @@ import (
 	"strconv"
 	"strings"
 
+	"github.com/mmcdole/viking-ftpd/pkg/users"
 	"golang.org/x/crypto/argon2"
 )
 
@@ -19,18 +20,47 @@ func NewArgon2ID() *Argon2ID { return &Argon2ID{} }
 
 // VerifyPassword verifies a password against a PHC-formatted argon2id hash.
 func (a *Argon2ID) VerifyPassword(password, hashedPassword string) error {
-	params, salt, expectedHash, err := parsePHCArgon2ID(hashedPassword)
+	prepared, err := a.prepare(hashedPassword)
 	if err != nil {
 		return err
 	}
+	return prepared.Verify(password)
+}
+
+// Prepare decodes a PHC-formatted argon2id hash for repeated verification
+func (a *Argon2ID) Prepare(hashedPassword string) (users.PreparedHash, error) {
+	return a.prepare(hashedPassword)
+}
 
-	derived := argon2.IDKey([]byte(password), salt, params.time, params.memory, params.threads, uint32(len(expectedHash)))
-	if subtle.ConstantTimeCompare(derived, expectedHash) == 1 {
+func (a *Argon2ID) prepare(hashedPassword string) (*argon2Hash, error) {
+	params, salt, expectedHash, err := parsePHCArgon2ID(hashedPassword)
+	if err != nil {
+		return nil, err
+	}
+	return &argon2Hash{params: params, salt: salt, digest: expectedHash}, nil
+}
+
+// argon2Hash is a decoded argon2id hash
+type argon2Hash struct {
+	params argon2Params
+	salt   []byte
+	digest []byte
+}
+
+// Verify implements users.PreparedHash
+func (h *argon2Hash) Verify(password string) error {
+	derived := argon2.IDKey([]byte(password), h.salt, h.params.time, h.params.memory, h.params.threads, uint32(len(h.digest)))
+	if subtle.ConstantTimeCompare(derived, h.digest) == 1 {
 		return nil
 	}
 	return fmt.Errorf("password mismatch")
 }
 
+// MemoryKiB returns the memory verification needs, for the Scheduler
+func (h *argon2Hash) MemoryKiB() uint64 {
+	return uint64(h.params.memory)
+}
+
 type argon2Params struct {
 	memory  uint32
 	time    uint32
@@ -108,3 +108,28 @@ func TestArgon2ID_VerifyPassword_Table(t *testing.T) {
 		})
 	}
 }
+
+func TestArgon2ID_Prepare(t *testing.T) {
+	v := NewArgon2ID()
+	salt := []byte("0123456789abcdef")
+	phc := buildPHC("secret", salt, 1, 1024, 1, 32)
+
+	prepared, err := v.Prepare(phc)
+	assert.NoError(t, err)
+	assert.NoError(t, prepared.Verify("secret"))
+	assert.Error(t, prepared.Verify("wrong"))
+	assert.Equal(t, uint64(1024), prepared.(*argon2Hash).MemoryKiB())
+
+	_, err = v.Prepare("$argon2id$v=19$m=65536,t=2,p=1$")
+	assert.Error(t, err)
+}
+
+func TestDummyHash(t *testing.T) {
+	// Unknown users are checked against a realistic argon2id hash
+	prepared, ok := dummyPrepared.(*argon2Hash)
+	if !ok {
+		t.Fatalf("dummyPrepared = %T, want *argon2Hash", dummyPrepared)
+	}
+	assert.Equal(t, argon2Params{memory: 64 * 1024, time: 2, threads: 1}, prepared.params)
+	assert.Len(t, prepared.digest, 32)
+}
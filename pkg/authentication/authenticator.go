@@ -1,14 +1,35 @@
 package authentication
 
 import (
+	"errors"
+
 	"github.com/mmcdole/viking-ftpd/pkg/logging"
 	"github.com/mmcdole/viking-ftpd/pkg/users"
 )
 
+// dummyHash is verified for unknown users, so that their logins take as long
+// as those of real users. It is an argon2id hash with the default parameters
+// that no password matches.
+const dummyHash = "$argon2id$v=19$m=65536,t=2,p=1$ZHVtbXlzYWx0ZHVtbXlzYQ$XQ3Yb4M5e1zplS4rXrH8w7/vcNk3bqm7Vt4ChzKrKqA"
+
+// dummyPrepared is dummyHash decoded once
+var dummyPrepared = mustPrepare(dummyHash)
+
+// mustPrepare decodes an argon2id hash that is part of the program,
+// panicking if it is malformed
+func mustPrepare(hash string) users.PreparedHash {
+	prepared, err := NewArgon2ID().Prepare(hash)
+	if err != nil {
+		panic("authentication: invalid built-in hash: " + err.Error())
+	}
+	return prepared
+}
+
 // Authenticator handles user authentication
 type Authenticator struct {
-	source   users.Source
-	verifier PasswordHashVerifier
+	source      users.Source
+	verifier    PasswordHashVerifier
+	credentials *CredentialCache
 }
 
 // NewAuthenticator creates a new authenticator with the given configuration
@@ -19,44 +40,103 @@ func NewAuthenticator(source users.Source, verifier PasswordHashVerifier) *Authe
 	}
 }
 
+// SetCredentialCache enables remembering successful logins in cache, so that
+// repeated logins with the same credentials skip password verification
+// until the cache entry expires. It should be called before the
+// authenticator is used.
+func (a *Authenticator) SetCredentialCache(cache *CredentialCache) {
+	a.credentials = cache
+}
+
 // Authenticate verifies a username and password combination.
 // Returns ErrInvalidCredentials for any authentication failure to prevent user enumeration.
 // This implements constant-time authentication by always performing password verification.
 func (a *Authenticator) Authenticate(username, password string) (*users.User, error) {
-	logging.App.Debug("Authentication attempt", "user", username)
+	return a.AuthenticateFrom(username, password, "")
+}
+
+// AuthenticateFrom is like Authenticate for an attempt from source, usually
+// the client IP, which verifiers implementing SourceVerifier use to queue
+// attempts fairly. It returns ErrVerificationBusy or ErrVerificationTimeout
+// when the verifier refused to run the attempt; both are independent of
+// whether the user exists.
+func (a *Authenticator) AuthenticateFrom(username, password, source string) (*users.User, error) {
+	debug := logging.App.IsDebug()
+	if debug {
+		logging.App.Debug("Authentication attempt", "user", username)
+	}
 
 	user, err := a.source.LoadUser(username)
 	var userExists bool = err == nil
 	var passwordHash string
+	var prepared users.PreparedHash
 
 	if userExists {
 		passwordHash = user.PasswordHash
+		prepared = user.Prepared
 		// Do not log password hashes
-		logging.App.Debug("Found user, verifying password", "user", username)
+		if debug {
+			logging.App.Debug("Found user, verifying password", "user", username)
+		}
 	} else {
 		// Use a dummy hash to maintain constant timing behavior
-		// This is a bcrypt hash of "dummy" to ensure consistent verification time
-		passwordHash = "$2a$10$N9qo8uLOickgx2ZMRZoMye1NW8k3xPGLhpMeE.f0aK5bPHQu3CcI2"
-		if err == users.ErrUserNotFound {
-			logging.App.Debug("User not found", "user", username)
-		} else {
-			logging.App.Debug("Error loading user", "user", username, "error", err)
+		passwordHash = dummyHash
+		prepared = dummyPrepared
+		if debug {
+			if err == users.ErrUserNotFound {
+				logging.App.Debug("User not found", "user", username)
+			} else {
+				logging.App.Debug("Error loading user", "user", username, "error", err)
+			}
 		}
 	}
 
+	// A cached login only matches the correct password, so skipping the
+	// verification on a hit tells nothing to someone who doesn't know it.
+	// The lookup itself runs for unknown users too.
+	if a.credentials != nil && a.credentials.Contains(username, password, passwordHash) && userExists {
+		if debug {
+			logging.App.Debug("Authentication successful from credential cache", "user", username)
+		}
+		return user, nil
+	}
+
 	// Always perform password verification to prevent timing attacks
-	passwordErr := a.verifier.VerifyPassword(password, passwordHash)
+	passwordErr := a.verify(source, password, passwordHash, prepared)
+	if errors.Is(passwordErr, ErrVerificationBusy) || errors.Is(passwordErr, ErrVerificationTimeout) {
+		if debug {
+			logging.App.Debug("Password verification not run", "user", username, "source", source, "error", passwordErr)
+		}
+		return nil, passwordErr
+	}
 
 	// Only return success if user exists AND password is correct
 	if userExists && passwordErr == nil {
-		logging.App.Debug("Authentication successful", "user", username)
+		if a.credentials != nil {
+			a.credentials.Add(username, password, passwordHash)
+		}
+		if debug {
+			logging.App.Debug("Authentication successful", "user", username)
+		}
 		return user, nil
 	}
 
 	// Log specific failure reason for debugging, but return generic error
-	if userExists {
+	if userExists && debug {
 		logging.App.Debug("Password verification failed", "user", username, "error", passwordErr)
 	}
 
 	return nil, ErrInvalidCredentials
 }
+
+// verify checks a password, letting a SourceVerifier schedule the work and
+// using the prepared hash when the verifier supports it
+func (a *Authenticator) verify(source, password, passwordHash string, prepared users.PreparedHash) error {
+	if sv, ok := a.verifier.(SourceVerifier); ok {
+		return sv.VerifyPasswordFrom(source, password, passwordHash, prepared)
+	}
+	if pv, ok := a.verifier.(PreparedVerifier); ok && prepared != nil {
+		return pv.VerifyPrepared(password, prepared)
+	}
+	return a.verifier.VerifyPassword(password, passwordHash)
+}
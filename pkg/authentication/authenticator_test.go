@@ -3,6 +3,7 @@ package authentication
 import (
 	"errors"
 	"testing"
+	"time"
 
 	"github.com/mmcdole/viking-ftpd/pkg/users"
 	"github.com/stretchr/testify/assert"
@@ -108,3 +109,52 @@ func TestAuthenticator_Authenticate(t *testing.T) {
 		})
 	}
 }
+
+// preparedVerifier counts string and prepared verifications
+type preparedVerifier struct {
+	countingVerifier
+	prepared int
+}
+
+// preparedPassword accepts one password
+type preparedPassword string
+
+func (p preparedPassword) Verify(password string) error {
+	if password != string(p) {
+		return ErrInvalidPassword
+	}
+	return nil
+}
+
+func (v *preparedVerifier) Prepare(hashedPassword string) (users.PreparedHash, error) {
+	return preparedPassword(v.password), nil
+}
+
+func (v *preparedVerifier) VerifyPrepared(password string, prepared users.PreparedHash) error {
+	v.prepared++
+	return prepared.Verify(password)
+}
+
+func TestAuthenticator_PreparedHash(t *testing.T) {
+	source := newMockSource()
+	source.addUser("user1", "hash1", 1)
+	verifier := &preparedVerifier{countingVerifier: countingVerifier{password: "testpass"}}
+
+	repository := users.NewRepository(source, time.Hour)
+	repository.SetPrepare(verifier.Prepare)
+
+	for _, auth := range []*Authenticator{
+		NewAuthenticator(repository, verifier),
+		NewAuthenticator(repository, NewScheduler(verifier, SchedulerConfig{Workers: 1})),
+	} {
+		_, err := auth.Authenticate("user1", "testpass")
+		assert.NoError(t, err)
+		_, err = auth.Authenticate("user1", "wrong")
+		assert.ErrorIs(t, err, ErrInvalidCredentials)
+	}
+	assert.Equal(t, 4, verifier.prepared)
+	assert.Equal(t, 0, verifier.calls, "prepared users should not be verified from the hash string")
+
+	// The source's user is left as it was
+	assert.Nil(t, source.users["user1"].Prepared)
+}
@@ -0,0 +1,129 @@
+package authentication
+
+import (
+	"container/list"
+	"crypto/hmac"
+	"crypto/rand"
+	"crypto/sha256"
+	"crypto/subtle"
+	"encoding/binary"
+	"fmt"
+	"sync"
+	"time"
+)
+
+// DefaultMaxCachedCredentials is the default number of verified credentials
+// a CredentialCache keeps
+const DefaultMaxCachedCredentials = 1024
+
+// CredentialCache remembers recently verified logins for a short time, so
+// clients opening several control connections with the same credentials
+// only pay for one password verification. Entries are identified by an
+// HMAC, under a key generated at startup, of the username, password and
+// stored hash; neither the password nor the hash is kept. Because the
+// stored hash is part of the HMAC, changing a password in the character
+// file makes old entries unreachable at once.
+type CredentialCache struct {
+	key        []byte
+	ttl        time.Duration
+	maxEntries int
+
+	mu      sync.Mutex
+	entries map[uint64]*list.Element
+	order   *list.List // of *credentialEntry, oldest first
+}
+
+// credentialEntry is one verified login
+type credentialEntry struct {
+	id      uint64
+	mac     [sha256.Size]byte
+	expires time.Time
+}
+
+// NewCredentialCache creates a cache keeping verified logins for ttl
+func NewCredentialCache(ttl time.Duration) (*CredentialCache, error) {
+	key := make([]byte, sha256.Size)
+	if _, err := rand.Read(key); err != nil {
+		return nil, fmt.Errorf("generating credential cache key: %w", err)
+	}
+	return &CredentialCache{
+		key:        key,
+		ttl:        ttl,
+		maxEntries: DefaultMaxCachedCredentials,
+		entries:    make(map[uint64]*list.Element),
+		order:      list.New(),
+	}, nil
+}
+
+// SetMaxEntries bounds the number of verified logins kept. When the cache is
+// full the oldest entry is dropped. It should be called before the cache is
+// used.
+func (c *CredentialCache) SetMaxEntries(n int) {
+	if n > 0 {
+		c.maxEntries = n
+	}
+}
+
+// Contains reports whether the login was verified within the TTL. The MAC is
+// compared in constant time.
+func (c *CredentialCache) Contains(username, password, hashedPassword string) bool {
+	mac := c.mac(username, password, hashedPassword)
+	id := binary.BigEndian.Uint64(mac[:8])
+
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	elem, ok := c.entries[id]
+	if !ok {
+		return false
+	}
+	entry := elem.Value.(*credentialEntry)
+	if !time.Now().Before(entry.expires) {
+		c.removeLocked(elem)
+		return false
+	}
+	return subtle.ConstantTimeCompare(entry.mac[:], mac[:]) == 1
+}
+
+// Add records a successfully verified login
+func (c *CredentialCache) Add(username, password, hashedPassword string) {
+	mac := c.mac(username, password, hashedPassword)
+	id := binary.BigEndian.Uint64(mac[:8])
+	expires := time.Now().Add(c.ttl)
+
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	if elem, ok := c.entries[id]; ok {
+		c.removeLocked(elem)
+	}
+	for c.order.Len() >= c.maxEntries {
+		c.removeLocked(c.order.Front())
+	}
+	c.entries[id] = c.order.PushBack(&credentialEntry{id: id, mac: mac, expires: expires})
+}
+
+// Len returns the number of logins kept, including expired ones not yet dropped
+func (c *CredentialCache) Len() int {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	return c.order.Len()
+}
+
+func (c *CredentialCache) removeLocked(elem *list.Element) {
+	delete(c.entries, elem.Value.(*credentialEntry).id)
+	c.order.Remove(elem)
+}
+
+// mac returns the HMAC identifying a login. Each field is length-prefixed
+// so that different logins cannot produce the same input.
+func (c *CredentialCache) mac(username, password, hashedPassword string) [sha256.Size]byte {
+	h := hmac.New(sha256.New, c.key)
+	var length [4]byte
+	for _, field := range []string{username, password, hashedPassword} {
+		binary.BigEndian.PutUint32(length[:], uint32(len(field)))
+		h.Write(length[:])
+		h.Write([]byte(field))
+	}
+	var mac [sha256.Size]byte
+	h.Sum(mac[:0])
+	return mac
+}
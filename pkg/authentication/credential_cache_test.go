@@ -0,0 +1,114 @@
+package authentication
+
+import (
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/assert"
+)
+
+func newTestCredentialCache(t *testing.T, ttl time.Duration) *CredentialCache {
+	t.Helper()
+	cache, err := NewCredentialCache(ttl)
+	if err != nil {
+		t.Fatalf("NewCredentialCache failed: %v", err)
+	}
+	return cache
+}
+
+func TestCredentialCache(t *testing.T) {
+	cache := newTestCredentialCache(t, time.Hour)
+	cache.Add("drake", "secret", "hash1")
+
+	tests := []struct {
+		name     string
+		username string
+		password string
+		hash     string
+		want     bool
+	}{
+		{"same login", "drake", "secret", "hash1", true},
+		{"wrong password", "drake", "Secret", "hash1", false},
+		{"changed hash", "drake", "secret", "hash2", false},
+		{"other user", "frodo", "secret", "hash1", false},
+		{"fields shifted", "drakes", "ecret", "hash1", false},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			assert.Equal(t, tt.want, cache.Contains(tt.username, tt.password, tt.hash))
+		})
+	}
+}
+
+func TestCredentialCache_TTL(t *testing.T) {
+	cache := newTestCredentialCache(t, 20*time.Millisecond)
+	cache.Add("drake", "secret", "hash")
+	assert.True(t, cache.Contains("drake", "secret", "hash"))
+
+	time.Sleep(30 * time.Millisecond)
+	assert.False(t, cache.Contains("drake", "secret", "hash"))
+	assert.Equal(t, 0, cache.Len(), "expired entries should be dropped on lookup")
+}
+
+func TestCredentialCache_MaxEntries(t *testing.T) {
+	cache := newTestCredentialCache(t, time.Hour)
+	cache.SetMaxEntries(2)
+	cache.Add("a", "pass", "hash")
+	cache.Add("b", "pass", "hash")
+	cache.Add("c", "pass", "hash")
+
+	assert.Equal(t, 2, cache.Len())
+	assert.False(t, cache.Contains("a", "pass", "hash"), "oldest entry should be evicted")
+	assert.True(t, cache.Contains("b", "pass", "hash"))
+	assert.True(t, cache.Contains("c", "pass", "hash"))
+}
+
+// countingVerifier accepts one password and counts verifications
+type countingVerifier struct {
+	password string
+	calls    int
+}
+
+func (v *countingVerifier) VerifyPassword(password, hashedPassword string) error {
+	v.calls++
+	if password != v.password {
+		return ErrInvalidPassword
+	}
+	return nil
+}
+
+func TestAuthenticator_CredentialCache(t *testing.T) {
+	source := newMockSource()
+	source.addUser("user1", "hash1", 1)
+	verifier := &countingVerifier{password: "testpass"}
+
+	auth := NewAuthenticator(source, verifier)
+	auth.SetCredentialCache(newTestCredentialCache(t, time.Hour))
+
+	// Repeated logins verify once
+	for i := 0; i < 3; i++ {
+		_, err := auth.Authenticate("user1", "testpass")
+		assert.NoError(t, err)
+	}
+	assert.Equal(t, 1, verifier.calls)
+
+	// A wrong password is always verified and never cached
+	for i := 0; i < 2; i++ {
+		_, err := auth.Authenticate("user1", "wrong")
+		assert.ErrorIs(t, err, ErrInvalidCredentials)
+	}
+	assert.Equal(t, 3, verifier.calls)
+
+	// A changed stored hash misses the cache
+	source.addUser("user1", "hash2", 1)
+	_, err := auth.Authenticate("user1", "testpass")
+	assert.NoError(t, err)
+	assert.Equal(t, 4, verifier.calls)
+
+	// Unknown users still go through the verifier every time
+	for i := 0; i < 2; i++ {
+		_, err := auth.Authenticate("nobody", "testpass")
+		assert.ErrorIs(t, err, ErrInvalidCredentials)
+	}
+	assert.Equal(t, 6, verifier.calls)
+}
@@ -1,6 +1,10 @@
 package authentication
 
-import "strings"
+import (
+	"strings"
+
+	"github.com/mmcdole/viking-ftpd/pkg/users"
+)
 
 // MultiVerifier delegates verification based on the hash token format.
 // - $argon2id$... -> Argon2ID
@@ -33,3 +37,18 @@ func (m *MultiVerifier) VerifyPassword(password, hashedPassword string) error {
 	// Fallback to legacy unix crypt
 	return m.unix.VerifyPassword(password, hashedPassword)
 }
+
+// Prepare decodes a hash with the verifier its format selects, so that it
+// can be checked repeatedly without parsing it again. It can be passed to
+// users.Repository.SetPrepare.
+func (m *MultiVerifier) Prepare(hashedPassword string) (users.PreparedHash, error) {
+	if strings.HasPrefix(hashedPassword, "$argon2id$") {
+		return m.argon2.Prepare(hashedPassword)
+	}
+	return m.unix.Prepare(hashedPassword)
+}
+
+// VerifyPrepared checks a password against a hash decoded by Prepare
+func (m *MultiVerifier) VerifyPrepared(password string, prepared users.PreparedHash) error {
+	return prepared.Verify(password)
+}
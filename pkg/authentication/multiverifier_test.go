@@ -52,3 +52,24 @@ func TestMultiVerifier_RoutesAndErrors_Table(t *testing.T) {
 		})
 	}
 }
+
+func TestMultiVerifier_Prepare(t *testing.T) {
+	mv := NewMultiVerifier(nil, nil)
+
+	salt := []byte("0123456789abcdef")
+	phc := buildPHC("p@ssw0rd", salt, 1, 1024, 1, 32)
+	prepared, err := mv.Prepare(phc)
+	assert.NoError(t, err)
+	_, isArgon2 := prepared.(*argon2Hash)
+	assert.True(t, isArgon2)
+	assert.NoError(t, mv.VerifyPrepared("p@ssw0rd", prepared))
+	assert.Error(t, mv.VerifyPrepared("nope", prepared))
+
+	prepared, err = mv.Prepare("tek4edTZE898g")
+	assert.NoError(t, err)
+	_, isCrypt := prepared.(*cryptHash)
+	assert.True(t, isCrypt)
+
+	_, err = mv.Prepare("x")
+	assert.Error(t, err)
+}
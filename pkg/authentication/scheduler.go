@@ -0,0 +1,323 @@
+package authentication
+
+import (
+	"container/list"
+	"errors"
+	"runtime"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/mmcdole/viking-ftpd/pkg/users"
+)
+
+var (
+	// ErrVerificationBusy is returned when the verification queue is full,
+	// either overall or for the attempt's source
+	ErrVerificationBusy = errors.New("too many pending password verifications")
+
+	// ErrVerificationTimeout is returned when an attempt waited in the queue
+	// longer than the scheduler's maximum wait
+	ErrVerificationTimeout = errors.New("password verification timed out in queue")
+)
+
+// SourceVerifier is implemented by verifiers that schedule work by the
+// source of the attempt, usually the client IP. prepared is the decoded form
+// of hashedPassword, or nil if there is none.
+type SourceVerifier interface {
+	VerifyPasswordFrom(source, plaintext, hashedPassword string, prepared users.PreparedHash) error
+}
+
+// memoryUser is implemented by prepared hashes that need Argon2 memory
+type memoryUser interface {
+	MemoryKiB() uint64
+}
+
+// SchedulerConfig controls how many verifications run at once and how many
+// may wait
+type SchedulerConfig struct {
+	Workers      int           // verifications running at once, GOMAXPROCS if 0
+	MemoryBudget uint64        // total Argon2 memory in KiB for running verifications, unlimited if 0
+	MaxQueue     int           // attempts waiting overall, unlimited if 0
+	MaxPerSource int           // attempts waiting for one source, unlimited if 0
+	MaxWait      time.Duration // longest an attempt may wait before it starts, unlimited if 0
+}
+
+// SchedulerStats is a snapshot of the scheduler's queue and counters
+type SchedulerStats struct {
+	QueueDepth  int           // attempts waiting to start
+	Running     int           // verifications in progress
+	MemoryInUse uint64        // Argon2 memory reserved by running verifications, in KiB
+	Completed   uint64        // verifications that ran
+	Rejected    uint64        // attempts refused because the queue was full
+	TimedOut    uint64        // attempts dropped after waiting MaxWait
+	TotalWait   time.Duration // time completed attempts spent queued
+	MaxWait     time.Duration // longest time an attempt spent queued
+}
+
+// Scheduler verifies passwords on a bounded number of workers, within a
+// global budget for Argon2 memory. Waiting attempts are queued per source
+// and served round-robin, so one client flooding logins only delays its own
+// attempts. It implements PasswordHashVerifier and SourceVerifier.
+type Scheduler struct {
+	verifier PasswordHashVerifier
+	config   SchedulerConfig
+
+	mu          sync.Mutex
+	sources     map[string]*sourceQueue
+	order       *list.List    // sources with waiting attempts, in service order
+	next        *list.Element // source to serve next, the front if nil
+	queued      int
+	running     int
+	memoryInUse uint64
+
+	completed atomic.Uint64
+	rejected  atomic.Uint64
+	timedOut  atomic.Uint64
+	totalWait atomic.Int64
+	maxWait   atomic.Int64
+}
+
+// sourceQueue holds the waiting attempts of one source
+type sourceQueue struct {
+	source string
+	jobs   []*verifyJob
+	elem   *list.Element
+}
+
+// verifyJob is one queued verification
+type verifyJob struct {
+	verify   func() error
+	cost     uint64
+	queuedAt time.Time
+	done     chan struct{}
+	err      error
+}
+
+// NewScheduler creates a scheduler running verifications through verifier
+func NewScheduler(verifier PasswordHashVerifier, config SchedulerConfig) *Scheduler {
+	if config.Workers <= 0 {
+		config.Workers = runtime.GOMAXPROCS(0)
+	}
+	return &Scheduler{
+		verifier: verifier,
+		config:   config,
+		sources:  make(map[string]*sourceQueue),
+		order:    list.New(),
+	}
+}
+
+// VerifyPassword implements PasswordHashVerifier, queueing the attempt
+// under an anonymous source
+func (s *Scheduler) VerifyPassword(plaintext, hashedPassword string) error {
+	return s.VerifyPasswordFrom("", plaintext, hashedPassword, nil)
+}
+
+// VerifyPasswordFrom implements SourceVerifier. It waits for a worker and
+// enough Argon2 memory, then verifies the password. The prepared hash is
+// used when the wrapped verifier implements PreparedVerifier.
+func (s *Scheduler) VerifyPasswordFrom(source, plaintext, hashedPassword string, prepared users.PreparedHash) error {
+	if pv, ok := s.verifier.(PreparedVerifier); ok && prepared != nil {
+		var cost uint64
+		if m, ok := prepared.(memoryUser); ok {
+			cost = s.clampCost(m.MemoryKiB())
+		}
+		return s.schedule(source, cost, func() error {
+			return pv.VerifyPrepared(plaintext, prepared)
+		})
+	}
+	return s.schedule(source, s.memoryCost(hashedPassword), func() error {
+		return s.verifier.VerifyPassword(plaintext, hashedPassword)
+	})
+}
+
+// schedule queues verify under source and waits for its result
+func (s *Scheduler) schedule(source string, cost uint64, verify func() error) error {
+	job := &verifyJob{
+		verify:   verify,
+		cost:     cost,
+		queuedAt: time.Now(),
+		done:     make(chan struct{}),
+	}
+
+	s.mu.Lock()
+	if err := s.enqueueLocked(source, job); err != nil {
+		s.mu.Unlock()
+		s.rejected.Add(1)
+		return err
+	}
+	s.dispatchLocked()
+	s.mu.Unlock()
+
+	if s.config.MaxWait <= 0 {
+		<-job.done
+		return job.err
+	}
+
+	timer := time.NewTimer(s.config.MaxWait)
+	defer timer.Stop()
+	select {
+	case <-job.done:
+		return job.err
+	case <-timer.C:
+	}
+
+	// Drop the attempt unless it started meanwhile, in which case it is
+	// allowed to finish
+	s.mu.Lock()
+	removed := s.removeLocked(source, job)
+	s.mu.Unlock()
+	if removed {
+		s.timedOut.Add(1)
+		return ErrVerificationTimeout
+	}
+	<-job.done
+	return job.err
+}
+
+// Stats returns the current queue depth and counters
+func (s *Scheduler) Stats() SchedulerStats {
+	s.mu.Lock()
+	stats := SchedulerStats{
+		QueueDepth:  s.queued,
+		Running:     s.running,
+		MemoryInUse: s.memoryInUse,
+	}
+	s.mu.Unlock()
+
+	stats.Completed = s.completed.Load()
+	stats.Rejected = s.rejected.Load()
+	stats.TimedOut = s.timedOut.Load()
+	stats.TotalWait = time.Duration(s.totalWait.Load())
+	stats.MaxWait = time.Duration(s.maxWait.Load())
+	return stats
+}
+
+// memoryCost returns the Argon2 memory in KiB a hash needs to verify. Hashes
+// that need more than the whole budget are charged the budget, so they run
+// alone rather than never.
+func (s *Scheduler) memoryCost(hashedPassword string) uint64 {
+	if !strings.HasPrefix(hashedPassword, "$argon2id$") {
+		return 0
+	}
+	params, _, _, err := parsePHCArgon2ID(hashedPassword)
+	if err != nil {
+		return 0
+	}
+	return s.clampCost(uint64(params.memory))
+}
+
+// clampCost limits a memory cost to the budget
+func (s *Scheduler) clampCost(cost uint64) uint64 {
+	if s.config.MemoryBudget > 0 && cost > s.config.MemoryBudget {
+		return s.config.MemoryBudget
+	}
+	return cost
+}
+
+// enqueueLocked adds job to the queue of its source
+func (s *Scheduler) enqueueLocked(source string, job *verifyJob) error {
+	if s.config.MaxQueue > 0 && s.queued >= s.config.MaxQueue {
+		return ErrVerificationBusy
+	}
+	q, ok := s.sources[source]
+	if !ok {
+		q = &sourceQueue{source: source}
+		q.elem = s.order.PushBack(q)
+		s.sources[source] = q
+	}
+	if s.config.MaxPerSource > 0 && len(q.jobs) >= s.config.MaxPerSource {
+		return ErrVerificationBusy
+	}
+	q.jobs = append(q.jobs, job)
+	s.queued++
+	return nil
+}
+
+// removeLocked removes a job that has not started yet, reporting whether it
+// was still queued
+func (s *Scheduler) removeLocked(source string, job *verifyJob) bool {
+	q, ok := s.sources[source]
+	if !ok {
+		return false
+	}
+	for i, j := range q.jobs {
+		if j == job {
+			q.jobs = append(q.jobs[:i], q.jobs[i+1:]...)
+			s.queued--
+			if len(q.jobs) == 0 {
+				s.dropSourceLocked(q)
+			}
+			// The head of a queue may have been waiting for memory
+			s.dispatchLocked()
+			return true
+		}
+	}
+	return false
+}
+
+// dropSourceLocked removes a source whose queue is empty
+func (s *Scheduler) dropSourceLocked(q *sourceQueue) {
+	if s.next == q.elem {
+		s.next = q.elem.Next()
+	}
+	s.order.Remove(q.elem)
+	delete(s.sources, q.source)
+}
+
+// dispatchLocked starts queued jobs while workers and memory are available.
+// Sources take turns; when the next job does not fit in the remaining
+// memory, dispatching stops until running jobs release theirs, so large
+// hashes are not starved by small ones.
+func (s *Scheduler) dispatchLocked() {
+	for s.running < s.config.Workers && s.queued > 0 {
+		elem := s.next
+		if elem == nil {
+			elem = s.order.Front()
+		}
+		q := elem.Value.(*sourceQueue)
+		job := q.jobs[0]
+		if s.config.MemoryBudget > 0 && s.memoryInUse+job.cost > s.config.MemoryBudget {
+			return
+		}
+
+		q.jobs[0] = nil
+		q.jobs = q.jobs[1:]
+		s.next = elem.Next()
+		if len(q.jobs) == 0 {
+			s.dropSourceLocked(q)
+		}
+		s.queued--
+		s.running++
+		s.memoryInUse += job.cost
+
+		s.recordWait(time.Since(job.queuedAt))
+		go s.run(job)
+	}
+}
+
+// run verifies a job and hands its worker and memory to the next one
+func (s *Scheduler) run(job *verifyJob) {
+	job.err = job.verify()
+	s.completed.Add(1)
+
+	s.mu.Lock()
+	s.running--
+	s.memoryInUse -= job.cost
+	s.dispatchLocked()
+	s.mu.Unlock()
+
+	close(job.done)
+}
+
+// recordWait adds a queue wait to the totals
+func (s *Scheduler) recordWait(wait time.Duration) {
+	s.totalWait.Add(int64(wait))
+	for {
+		current := s.maxWait.Load()
+		if int64(wait) <= current || s.maxWait.CompareAndSwap(current, int64(wait)) {
+			return
+		}
+	}
+}
@@ -0,0 +1,219 @@
+package authentication
+
+import (
+	"errors"
+	"fmt"
+	"sync"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/assert"
+)
+
+// blockingVerifier holds every verification until released and records the
+// order and concurrency of the calls
+type blockingVerifier struct {
+	release chan struct{}
+
+	mu            sync.Mutex
+	order         []string
+	running       int
+	maxConcurrent int
+}
+
+func newBlockingVerifier() *blockingVerifier {
+	return &blockingVerifier{release: make(chan struct{})}
+}
+
+func (v *blockingVerifier) VerifyPassword(plaintext, hashedPassword string) error {
+	v.mu.Lock()
+	v.order = append(v.order, plaintext)
+	v.running++
+	v.maxConcurrent = max(v.maxConcurrent, v.running)
+	v.mu.Unlock()
+
+	<-v.release
+
+	v.mu.Lock()
+	v.running--
+	v.mu.Unlock()
+	if plaintext == "wrong" {
+		return errors.New("password mismatch")
+	}
+	return nil
+}
+
+// testArgon2Hash returns a PHC string asking for memory KiB
+func testArgon2Hash(memory int) string {
+	return fmt.Sprintf("$argon2id$v=19$m=%d,t=1,p=1$c2FsdHNhbHQ$aGFzaGhhc2g", memory)
+}
+
+// waitForQueue waits until the scheduler has queued and running attempts
+func waitForQueue(t *testing.T, s *Scheduler, queued, running int) {
+	t.Helper()
+	deadline := time.Now().Add(5 * time.Second)
+	for time.Now().Before(deadline) {
+		stats := s.Stats()
+		if stats.QueueDepth == queued && stats.Running == running {
+			return
+		}
+		time.Sleep(time.Millisecond)
+	}
+	stats := s.Stats()
+	t.Fatalf("scheduler has %d queued and %d running, want %d and %d", stats.QueueDepth, stats.Running, queued, running)
+}
+
+// submit starts a verification in the background and returns its result channel
+func submit(s *Scheduler, source, plaintext, hash string) <-chan error {
+	result := make(chan error, 1)
+	go func() { result <- s.VerifyPasswordFrom(source, plaintext, hash, nil) }()
+	return result
+}
+
+func TestScheduler_Workers(t *testing.T) {
+	v := newBlockingVerifier()
+	s := NewScheduler(v, SchedulerConfig{Workers: 2})
+
+	var results []<-chan error
+	for i := 0; i < 6; i++ {
+		results = append(results, submit(s, fmt.Sprintf("10.0.0.%d", i), "pass", "hash"))
+	}
+	waitForQueue(t, s, 4, 2)
+
+	close(v.release)
+	for _, r := range results {
+		assert.NoError(t, <-r)
+	}
+	assert.Equal(t, 2, v.maxConcurrent)
+	assert.Equal(t, uint64(6), s.Stats().Completed)
+}
+
+func TestScheduler_MemoryBudget(t *testing.T) {
+	v := newBlockingVerifier()
+	s := NewScheduler(v, SchedulerConfig{Workers: 4, MemoryBudget: 100})
+
+	// Two 60 KiB hashes don't fit in the budget together, but legacy hashes
+	// need no Argon2 memory
+	big1 := submit(s, "a", "pass", testArgon2Hash(60))
+	waitForQueue(t, s, 0, 1)
+	big2 := submit(s, "b", "pass", testArgon2Hash(60))
+	waitForQueue(t, s, 1, 1)
+	assert.Equal(t, uint64(60), s.Stats().MemoryInUse)
+
+	v.release <- struct{}{}
+	assert.NoError(t, <-big1)
+	waitForQueue(t, s, 0, 1)
+
+	legacy := submit(s, "c", "pass", "abJnggxhB/yWI")
+	waitForQueue(t, s, 0, 2)
+
+	// A hash larger than the whole budget still runs, alone
+	huge := submit(s, "d", "pass", testArgon2Hash(1000))
+	waitForQueue(t, s, 1, 2)
+
+	close(v.release)
+	assert.NoError(t, <-big2)
+	assert.NoError(t, <-legacy)
+	assert.NoError(t, <-huge)
+	assert.Equal(t, uint64(0), s.Stats().MemoryInUse)
+}
+
+func TestScheduler_FairQueue(t *testing.T) {
+	v := newBlockingVerifier()
+	s := NewScheduler(v, SchedulerConfig{Workers: 1})
+
+	var results []<-chan error
+	results = append(results, submit(s, "flood", "flood1", "hash"))
+	waitForQueue(t, s, 0, 1)
+	for i, name := range []string{"flood2", "flood3", "flood4"} {
+		results = append(results, submit(s, "flood", name, "hash"))
+		waitForQueue(t, s, i+1, 1)
+	}
+	results = append(results, submit(s, "other", "other1", "hash"))
+	waitForQueue(t, s, 4, 1)
+
+	close(v.release)
+	for _, r := range results {
+		assert.NoError(t, <-r)
+	}
+	// The other client is served after one more flood attempt, not after all of them
+	assert.Equal(t, []string{"flood1", "flood2", "other1", "flood3", "flood4"}, v.order)
+}
+
+func TestScheduler_QueueLimits(t *testing.T) {
+	v := newBlockingVerifier()
+	s := NewScheduler(v, SchedulerConfig{Workers: 1, MaxQueue: 3, MaxPerSource: 2})
+
+	running := submit(s, "a", "pass", "hash")
+	waitForQueue(t, s, 0, 1)
+	queued := []<-chan error{submit(s, "a", "pass", "hash")}
+	waitForQueue(t, s, 1, 1)
+	queued = append(queued, submit(s, "a", "pass", "hash"))
+	waitForQueue(t, s, 2, 1)
+
+	// A third waiting attempt from the same IP is refused, another IP is not
+	assert.ErrorIs(t, s.VerifyPasswordFrom("a", "pass", "hash", nil), ErrVerificationBusy)
+	queued = append(queued, submit(s, "b", "pass", "hash"))
+	waitForQueue(t, s, 3, 1)
+
+	// The queue as a whole is full
+	assert.ErrorIs(t, s.VerifyPasswordFrom("c", "pass", "hash", nil), ErrVerificationBusy)
+	assert.Equal(t, uint64(2), s.Stats().Rejected)
+
+	close(v.release)
+	assert.NoError(t, <-running)
+	for _, r := range queued {
+		assert.NoError(t, <-r)
+	}
+}
+
+func TestScheduler_MaxWait(t *testing.T) {
+	v := newBlockingVerifier()
+	s := NewScheduler(v, SchedulerConfig{Workers: 1, MaxWait: 20 * time.Millisecond})
+
+	running := submit(s, "a", "wrong", "hash")
+	waitForQueue(t, s, 0, 1)
+
+	// A queued attempt gives up, the running one is allowed to finish
+	assert.ErrorIs(t, s.VerifyPasswordFrom("b", "pass", "hash", nil), ErrVerificationTimeout)
+	time.Sleep(30 * time.Millisecond)
+	close(v.release)
+	assert.Error(t, <-running)
+
+	stats := s.Stats()
+	assert.Equal(t, uint64(1), stats.TimedOut)
+	assert.Equal(t, 0, stats.QueueDepth)
+	assert.Equal(t, uint64(1), stats.Completed)
+}
+
+func TestAuthenticator_SchedulerBusy(t *testing.T) {
+	source := newMockSource()
+	source.addUser("user1", "hashedpass123", 1)
+
+	v := newBlockingVerifier()
+	s := NewScheduler(v, SchedulerConfig{Workers: 1, MaxPerSource: 1})
+	auth := NewAuthenticator(source, s)
+
+	first := make(chan error, 1)
+	go func() {
+		_, err := auth.AuthenticateFrom("user1", "pass", "10.0.0.1")
+		first <- err
+	}()
+	waitForQueue(t, s, 0, 1)
+	second := make(chan error, 1)
+	go func() {
+		_, err := auth.AuthenticateFrom("nobody", "pass", "10.0.0.1")
+		second <- err
+	}()
+	waitForQueue(t, s, 1, 1)
+
+	// Busy is reported the same way for existing and unknown users
+	for _, username := range []string{"user1", "nobody"} {
+		_, err := auth.AuthenticateFrom(username, "pass", "10.0.0.1")
+		assert.ErrorIs(t, err, ErrVerificationBusy)
+	}
+
+	close(v.release)
+	assert.NoError(t, <-first)
+	assert.ErrorIs(t, <-second, ErrInvalidCredentials)
+}
@@ -3,7 +3,11 @@
 // to validate credentials.
 package authentication
 
-import "errors"
+import (
+	"errors"
+
+	"github.com/mmcdole/viking-ftpd/pkg/users"
+)
 
 // PasswordHashVerifier verifies that a plaintext password matches its hashed version
 type PasswordHashVerifier interface {
@@ -11,6 +15,14 @@ type PasswordHashVerifier interface {
 	VerifyPassword(plaintext, hashedPassword string) error
 }
 
+// PreparedVerifier is implemented by verifiers that can check a password
+// against a hash decoded ahead of time by their Prepare method
+type PreparedVerifier interface {
+	PasswordHashVerifier
+	Prepare(hashedPassword string) (users.PreparedHash, error)
+	VerifyPrepared(plaintext string, prepared users.PreparedHash) error
+}
+
 var (
 	// ErrInvalidUsername is returned when the username does not exist
 	ErrInvalidUsername = errors.New("invalid username")
@@ -1,9 +1,11 @@
 package authentication
 
 import (
+	"crypto/subtle"
 	"errors"
 
 	"github.com/digitive/crypt"
+	"github.com/mmcdole/viking-ftpd/pkg/users"
 )
 
 // UnixCrypt implements a hasher using the traditional Unix crypt algorithm
@@ -23,19 +25,41 @@ func (h *UnixCrypt) Hash(password string) (string, error) {
 
 // VerifyPassword checks if a password matches its hashed version
 func (h *UnixCrypt) VerifyPassword(password, hashedPassword string) error {
+	prepared, err := h.prepare(hashedPassword)
+	if err != nil {
+		return err
+	}
+	return prepared.Verify(password)
+}
+
+// Prepare splits a crypt hash into its salt and digest for repeated verification
+func (h *UnixCrypt) Prepare(hashedPassword string) (users.PreparedHash, error) {
+	return h.prepare(hashedPassword)
+}
+
+func (h *UnixCrypt) prepare(hashedPassword string) (*cryptHash, error) {
 	// Extract salt from the hash (first 2 characters)
 	if len(hashedPassword) < 2 {
-		return errors.New("invalid hash: too short")
+		return nil, errors.New("invalid hash: too short")
 	}
-	salt := hashedPassword[:2]
+	return &cryptHash{salt: hashedPassword[:2], hash: []byte(hashedPassword)}, nil
+}
+
+// cryptHash is a crypt hash with its salt split off
+type cryptHash struct {
+	salt string
+	hash []byte
+}
 
+// Verify implements users.PreparedHash
+func (h *cryptHash) Verify(password string) error {
 	// Hash the password with the same salt
-	computed, err := crypt.Crypt(password, salt)
+	computed, err := crypt.Crypt(password, h.salt)
 	if err != nil {
 		return err
 	}
 
-	if computed != hashedPassword {
+	if subtle.ConstantTimeCompare([]byte(computed), h.hash) != 1 {
 		return errors.New("password mismatch")
 	}
 
@@ -1,15 +1,28 @@
 package authorization
 
 import (
+	"crypto/sha256"
+	"errors"
 	"fmt"
+	"io"
+	"io/fs"
 	"os"
+	"path/filepath"
+	"sync"
+	"time"
 
+	"github.com/mmcdole/viking-ftpd/pkg/filewatch"
+	"github.com/mmcdole/viking-ftpd/pkg/logging"
 	"github.com/mmcdole/viking-ftpd/pkg/lpc"
 )
 
 // AccessFileSource loads access data from a file
 type AccessFileSource struct {
-	filePath string
+	filePath     string
+	snapshotPath string
+
+	mu    sync.Mutex
+	stamp filewatch.Stamp // stamp of the file as of the last successful load
 }
 
 // NewAccessFileSource creates a new file-based access source
@@ -19,8 +32,23 @@ func NewAccessFileSource(filePath string) *AccessFileSource {
 	}
 }
 
+// SetSnapshotPath makes the source keep the compiled access trees in a
+// snapshot file at path, and load them from it instead of parsing the access
+// file while that is unchanged. Instances sharing the path share the file.
+// It should be called before the source is used.
+func (s *AccessFileSource) SetSnapshotPath(path string) {
+	s.snapshotPath = path
+}
+
 // LoadAccessData implements AccessSource
 func (s *AccessFileSource) LoadAccessData() (map[string]interface{}, error) {
+	// Stamp before reading: if the file changes while we read it, the next
+	// Changed call sees a newer stamp and triggers another load
+	stamp, err := filewatch.StatStamp(s.filePath)
+	if err != nil {
+		return nil, fmt.Errorf("reading access file: %w", err)
+	}
+
 	data, err := os.ReadFile(s.filePath)
 	if err != nil {
 		return nil, fmt.Errorf("reading access file: %w", err)
@@ -28,10 +56,128 @@ func (s *AccessFileSource) LoadAccessData() (map[string]interface{}, error) {
 
 	// Parse the LPC object format
 	parser := lpc.NewObjectParser(false)
-	result, err := parser.ParseObject(string(data))
+	result, err := parser.ParseObjectBytes(data)
 	if err != nil {
 		return nil, fmt.Errorf("parsing access file: %w", err)
 	}
 
+	s.mu.Lock()
+	s.stamp = stamp
+	s.mu.Unlock()
+
 	return result.Object, nil
 }
+
+// LoadAccessTrees implements TreeSource. It streams the file through
+// DecodeAccessTrees instead of reading it into memory first.
+func (s *AccessFileSource) LoadAccessTrees() (map[string]*AccessTree, error) {
+	stamp, err := filewatch.StatStamp(s.filePath)
+	if err != nil {
+		return nil, fmt.Errorf("reading access file: %w", err)
+	}
+
+	f, err := os.Open(s.filePath)
+	if err != nil {
+		return nil, fmt.Errorf("reading access file: %w", err)
+	}
+	defer f.Close()
+
+	trees, err := DecodeAccessTrees(f)
+	if err != nil {
+		return nil, fmt.Errorf("parsing access file: %w", err)
+	}
+
+	s.mu.Lock()
+	s.stamp = stamp
+	s.mu.Unlock()
+
+	return trees, nil
+}
+
+// loadSnapshot implements snapshotSource. With a snapshot path it checks the
+// snapshot file against the access file's modification time, size and
+// SHA-256, and only parses the access file, then rewrites the snapshot
+// file, if they differ.
+func (s *AccessFileSource) loadSnapshot(generation uint64) (*snapshot, error) {
+	if s.snapshotPath == "" {
+		trees, err := s.LoadAccessTrees()
+		if err != nil {
+			return nil, err
+		}
+		return compileSnapshot(trees, generation, time.Now()), nil
+	}
+
+	stamp, err := filewatch.StatStamp(s.filePath)
+	if err != nil {
+		return nil, fmt.Errorf("reading access file: %w", err)
+	}
+
+	f, err := os.Open(s.filePath)
+	if err != nil {
+		return nil, fmt.Errorf("reading access file: %w", err)
+	}
+	defer f.Close()
+
+	h := sha256.New()
+	if _, err := io.Copy(h, f); err != nil {
+		return nil, fmt.Errorf("reading access file: %w", err)
+	}
+	key := snapshotKey{modTime: stamp.ModTime().UnixNano(), size: stamp.Size()}
+	h.Sum(key.sum[:0])
+
+	snap, err := readSnapshotFile(s.snapshotPath, key, generation)
+	if err != nil {
+		if !errors.Is(err, fs.ErrNotExist) {
+			logging.App.Info("Rebuilding access snapshot", "path", s.snapshotPath, "reason", err)
+		}
+		if _, err := f.Seek(0, io.SeekStart); err != nil {
+			return nil, fmt.Errorf("reading access file: %w", err)
+		}
+		trees, err := DecodeAccessTrees(f)
+		if err != nil {
+			return nil, fmt.Errorf("parsing access file: %w", err)
+		}
+		snap = compileSnapshot(trees, generation, time.Now())
+		if err := writeSnapshotFile(s.snapshotPath, key, snap); err != nil {
+			// The trees are still good; the next load tries again
+			logging.App.Warn("Failed to write access snapshot", "path", s.snapshotPath, "error", err)
+		}
+	}
+
+	s.mu.Lock()
+	s.stamp = stamp
+	s.mu.Unlock()
+
+	return snap, nil
+}
+
+// LoadedSize implements SizeReporter
+func (s *AccessFileSource) LoadedSize() int64 {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	return s.stamp.Size()
+}
+
+// Changed implements ChangeDetector. It reports true if the file's identity,
+// size or modification time differ from the last successful load, or if the
+// file cannot be examined.
+func (s *AccessFileSource) Changed() bool {
+	current, err := filewatch.StatStamp(s.filePath)
+	if err != nil {
+		return true
+	}
+
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	return !current.Equal(s.stamp)
+}
+
+// Watch calls onChange whenever the access file is written, replaced or removed
+func (s *AccessFileSource) Watch(w *filewatch.Watcher, onChange func()) error {
+	base := filepath.Base(s.filePath)
+	return w.WatchDir(filepath.Dir(s.filePath), func(name string) {
+		if name == "" || name == base {
+			onChange()
+		}
+	})
+}
@@ -0,0 +1,140 @@
+package authorization
+
+import (
+	"errors"
+	"os"
+	"path/filepath"
+	"reflect"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/mmcdole/viking-ftpd/pkg/filewatch"
+)
+
+const testAccessFile = `access_map ([1|"*":([2|".":1,"*":-1,]),])
+`
+
+func TestAccessFileSource(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "access.o")
+	if err := os.WriteFile(path, []byte(testAccessFile), 0644); err != nil {
+		t.Fatalf("Failed to write access file: %v", err)
+	}
+
+	source := NewAccessFileSource(path)
+	if !source.Changed() {
+		t.Error("Changed should be true before the first load")
+	}
+
+	data, err := source.LoadAccessData()
+	if err != nil {
+		t.Fatalf("LoadAccessData failed: %v", err)
+	}
+	if _, ok := data["access_map"]; !ok {
+		t.Fatal("access_map missing from loaded data")
+	}
+	if source.Changed() {
+		t.Error("Changed should be false right after a load")
+	}
+
+	// Replace the file the way the MUD saves it
+	tmp := path + ".tmp"
+	if err := os.WriteFile(tmp, []byte(testAccessFile), 0644); err != nil {
+		t.Fatalf("Failed to write access file: %v", err)
+	}
+	if err := os.Rename(tmp, path); err != nil {
+		t.Fatalf("Failed to replace access file: %v", err)
+	}
+	if !source.Changed() {
+		t.Error("Changed should be true after the file was replaced")
+	}
+}
+
+func TestAccessFileSourceLoadAccessTrees(t *testing.T) {
+	content := "# /secure/access\n" +
+		"comments ({2|\"" + strings.Repeat("x", 100000) + "\",\"y\"})\n" +
+		`access_map ([2|"*":([2|".":1,"*":-1,]),"wizard1":([2|"d":([1|"*":3]),"?":({1|"Arch_junior"})]),])` + "\n" +
+		"trailing this line is never parsed\n"
+	path := filepath.Join(t.TempDir(), "access.o")
+	if err := os.WriteFile(path, []byte(content), 0644); err != nil {
+		t.Fatalf("Failed to write access file: %v", err)
+	}
+
+	source := NewAccessFileSource(path)
+	streamed, err := source.LoadAccessTrees()
+	if err != nil {
+		t.Fatalf("LoadAccessTrees failed: %v", err)
+	}
+	if source.Changed() {
+		t.Error("Changed should be false right after a load")
+	}
+
+	// The streamed trees match the ones built from the whole object
+	data, err := source.LoadAccessData()
+	if err != nil {
+		t.Fatalf("LoadAccessData failed: %v", err)
+	}
+	built, err := BuildAccessTrees(data)
+	if err != nil {
+		t.Fatalf("BuildAccessTrees failed: %v", err)
+	}
+	if !reflect.DeepEqual(streamed, built) {
+		t.Errorf("LoadAccessTrees() = %v, BuildAccessTrees() = %v", streamed, built)
+	}
+}
+
+func TestDecodeAccessTreesErrors(t *testing.T) {
+	tests := []struct {
+		name  string
+		input string
+	}{
+		{"empty", ""},
+		{"missing access_map", "other 1\n"},
+		{"access_map not a mapping", "access_map 5\n"},
+		{"malformed access_map", `access_map ([1|"*":`},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			if _, err := DecodeAccessTrees(strings.NewReader(tt.input)); err == nil {
+				t.Error("expected an error")
+			}
+		})
+	}
+}
+
+func TestAccessFileSourceWatch(t *testing.T) {
+	watcher, err := filewatch.New()
+	if errors.Is(err, filewatch.ErrUnsupported) {
+		t.Skip("file watching is not supported on this platform")
+	}
+	if err != nil {
+		t.Fatalf("Failed to create watcher: %v", err)
+	}
+	defer watcher.Close()
+
+	dir := t.TempDir()
+	path := filepath.Join(dir, "access.o")
+	if err := os.WriteFile(path, []byte(testAccessFile), 0644); err != nil {
+		t.Fatalf("Failed to write access file: %v", err)
+	}
+
+	source := NewAccessFileSource(path)
+	changes := make(chan struct{}, 16)
+	if err := source.Watch(watcher, func() { changes <- struct{}{} }); err != nil {
+		t.Fatalf("Watch failed: %v", err)
+	}
+
+	// Unrelated files in the same directory are ignored
+	if err := os.WriteFile(filepath.Join(dir, "other.o"), []byte("x 1\n"), 0644); err != nil {
+		t.Fatalf("Failed to write file: %v", err)
+	}
+	if err := os.WriteFile(path, []byte(testAccessFile), 0644); err != nil {
+		t.Fatalf("Failed to write access file: %v", err)
+	}
+
+	select {
+	case <-changes:
+	case <-time.After(2 * time.Second):
+		t.Fatal("no change reported for access.o")
+	}
+}
@@ -1,13 +1,51 @@
 package authorization
 
-import "fmt"
+import (
+	"errors"
+	"fmt"
+	"io"
+
+	"github.com/mmcdole/viking-ftpd/pkg/lpc"
+)
+
+// AccessMapKey is the entry of access.o that holds the access trees
+const AccessMapKey = "access_map"
 
 // BuildAccessTrees constructs a map of access trees from raw data
 func BuildAccessTrees(rawData map[string]interface{}) (map[string]*AccessTree, error) {
+	return buildAccessMap(rawData[AccessMapKey])
+}
+
+// DecodeAccessTrees builds access trees straight from access.o data in LPC
+// object format. Only the access_map entry is parsed; every other entry is
+// skipped as it is read. As with BuildAccessTrees, a repeated access_map
+// overrides the earlier ones. The trees
+// are decoded directly from the LPC text, without the interface{} values
+// BuildAccessTrees works from; leaf nodes holding the same permission are
+// shared, so the trees must not be modified.
+func DecodeAccessTrees(r io.Reader) (map[string]*AccessTree, error) {
+	var trees map[string]*AccessTree
+	decoder := lpc.NewDecoder(r, true)
+	decoder.SetKeys(AccessMapKey)
+	err := decoder.DecodeRaw(func(key string, value []byte) error {
+		var err error
+		trees, err = decodeAccessMap(value)
+		return err
+	})
+	if err != nil {
+		return nil, err
+	}
+	if trees == nil {
+		return nil, errors.New("access_map not found or invalid format")
+	}
+	return trees, nil
+}
+
+// buildAccessMap constructs access trees from the value of access_map
+func buildAccessMap(rawAccessMap interface{}) (map[string]*AccessTree, error) {
 	result := make(map[string]*AccessTree)
 
-	// Look for access_map key
-	accessMap, ok := rawData["access_map"].(map[string]interface{})
+	accessMap, ok := rawAccessMap.(map[string]interface{})
 	if !ok {
 		return nil, fmt.Errorf("access_map not found or invalid format")
 	}
@@ -44,7 +82,6 @@ func buildAccessNode(data map[string]interface{}) (*AccessNode, []string, error)
 	node := &AccessNode{
 		DotAccess:  Revoked,
 		StarAccess: Revoked,
-		Children:   make(map[string]*AccessNode),
 	}
 
 	var groups []string
@@ -64,7 +101,7 @@ func buildAccessNode(data map[string]interface{}) (*AccessNode, []string, error)
 				if err != nil {
 					return nil, nil, fmt.Errorf("building star directory: %w", err)
 				}
-				node.Children["*"] = child
+				node.addChild("*", child)
 				groups = append(groups, childGroups...)
 			} else {
 				perm, err := parsePermission(value)
@@ -95,25 +132,29 @@ func buildAccessNode(data map[string]interface{}) (*AccessNode, []string, error)
 				if len(childGroups) > 0 {
 					groups = append(groups, childGroups...)
 				}
-				node.Children[key] = child
+				node.addChild(key, child)
 			default:
 				// Handle direct permission value
 				perm, err := parsePermission(value)
 				if err != nil {
 					return nil, nil, fmt.Errorf("parsing permission for %s: %w", key, err)
 				}
-				child := &AccessNode{
-					DotAccess:  perm,
-					StarAccess: perm,
-					Children:   make(map[string]*AccessNode),
-				}
-				node.Children[key] = child
+				node.addChild(key, &AccessNode{DotAccess: perm, StarAccess: perm})
 			}
 		}
 	}
 	return node, groups, nil
 }
 
+// addChild adds a child node, allocating the children map on first use so
+// that leaf nodes keep a nil map
+func (n *AccessNode) addChild(name string, child *AccessNode) {
+	if n.Children == nil {
+		n.Children = make(map[string]*AccessNode)
+	}
+	n.Children[name] = child
+}
+
 // parsePermission converts a raw permission value into a Permission
 func parsePermission(value interface{}) (Permission, error) {
 	switch v := value.(type) {
@@ -0,0 +1,309 @@
+package authorization
+
+import (
+	"fmt"
+	"strconv"
+
+	"github.com/mmcdole/viking-ftpd/pkg/lpc"
+)
+
+// maxChildrenHint bounds the size hint used for a node's children map, so a
+// corrupt mapping size cannot trigger a huge allocation
+const maxChildrenHint = 256
+
+// accessTreeDecoder builds access trees from the LPC text of access_map.
+// It follows the same rules as BuildAccessTrees, but reads the text with an
+// lpc.ValueReader instead of walking interface{} values. Child and group
+// names are interned, childless nodes have nil Children, and leaf nodes
+// that only carry a permission are shared.
+type accessTreeDecoder struct {
+	r      *lpc.ValueReader
+	names  map[string]string
+	leaves map[Permission]*AccessNode
+}
+
+// decodeAccessMap decodes the raw value of access_map into access trees
+func decodeAccessMap(value []byte) (map[string]*AccessTree, error) {
+	d := &accessTreeDecoder{
+		r:      lpc.NewValueReader(value),
+		names:  make(map[string]string),
+		leaves: make(map[Permission]*AccessNode),
+	}
+
+	trees, err := d.decodeTrees()
+	if err != nil {
+		return nil, err
+	}
+	if err := d.r.Finish(); err != nil {
+		return nil, err
+	}
+	return trees, nil
+}
+
+// decodeTrees decodes the mapping of tree names to trees
+func (d *accessTreeDecoder) decodeTrees() (map[string]*AccessTree, error) {
+	if d.r.Kind() != lpc.KindMap {
+		return nil, fmt.Errorf("access_map not found or invalid format")
+	}
+	size, err := d.r.ReadMapStart()
+	if err != nil {
+		return nil, err
+	}
+
+	result := make(map[string]*AccessTree, min(max(size, 0), maxChildrenHint))
+	count := 0
+	for {
+		more, err := d.r.More()
+		if err != nil {
+			return nil, err
+		}
+		if !more {
+			break
+		}
+		count++
+
+		username, skip, err := d.readKey()
+		if err != nil {
+			return nil, err
+		}
+		if skip {
+			continue
+		}
+
+		if kind := d.r.Kind(); kind != lpc.KindMap {
+			return nil, fmt.Errorf("invalid user tree format for %s: expected map, got %s", username, kind)
+		}
+		root, groups, err := d.decodeNode()
+		if err != nil {
+			return nil, fmt.Errorf("building tree for user %s: %w", username, err)
+		}
+		result[username] = &AccessTree{
+			Root:   root,
+			Groups: groups,
+		}
+	}
+
+	if err := checkSize("map", count, size); err != nil {
+		return nil, err
+	}
+	return result, nil
+}
+
+// decodeNode decodes a directory mapping into a node, returning the groups
+// listed in it or in any of its children
+func (d *accessTreeDecoder) decodeNode() (*AccessNode, []string, error) {
+	size, err := d.r.ReadMapStart()
+	if err != nil {
+		return nil, nil, err
+	}
+
+	node := &AccessNode{
+		DotAccess:  Revoked,
+		StarAccess: Revoked,
+	}
+	var groups []string
+
+	count := 0
+	for {
+		more, err := d.r.More()
+		if err != nil {
+			return nil, nil, err
+		}
+		if !more {
+			break
+		}
+		count++
+
+		key, skip, err := d.readKey()
+		if err != nil {
+			return nil, nil, err
+		}
+		if skip {
+			continue
+		}
+
+		switch key {
+		case ".":
+			perm, err := d.readPermission()
+			if err != nil {
+				return nil, nil, fmt.Errorf("parsing dot access: %w", err)
+			}
+			node.DotAccess = perm
+		case "*":
+			// Star access can be either a direct permission or a directory node
+			if d.r.Kind() == lpc.KindMap {
+				child, childGroups, err := d.decodeNode()
+				if err != nil {
+					return nil, nil, fmt.Errorf("building star directory: %w", err)
+				}
+				d.addChild(node, "*", child, size)
+				groups = append(groups, childGroups...)
+			} else {
+				perm, err := d.readPermission()
+				if err != nil {
+					return nil, nil, fmt.Errorf("parsing star access: %w", err)
+				}
+				node.StarAccess = perm
+			}
+		case "?":
+			groups, err = d.readGroups(groups)
+			if err != nil {
+				return nil, nil, err
+			}
+		default:
+			if d.r.Kind() == lpc.KindMap {
+				child, childGroups, err := d.decodeNode()
+				if err != nil {
+					return nil, nil, fmt.Errorf("building child node %s: %w", key, err)
+				}
+				d.addChild(node, key, child, size)
+				groups = append(groups, childGroups...)
+			} else {
+				perm, err := d.readPermission()
+				if err != nil {
+					return nil, nil, fmt.Errorf("parsing permission for %s: %w", key, err)
+				}
+				d.addChild(node, key, d.leaf(perm), size)
+			}
+		}
+	}
+
+	if err := checkSize("map", count, size); err != nil {
+		return nil, nil, err
+	}
+	return node, groups, nil
+}
+
+// readKey reads a mapping key and its colon. Keys are converted to strings
+// the way lpc.ParseObject does; array and mapping keys are skipped along
+// with their value, in which case skip is true.
+func (d *accessTreeDecoder) readKey() (key string, skip bool, err error) {
+	switch d.r.Kind() {
+	case lpc.KindString:
+		b, err := d.r.ReadStringBytes()
+		if err != nil {
+			return "", false, err
+		}
+		key = d.intern(b)
+	case lpc.KindArray, lpc.KindMap:
+		skip = true
+		if _, err := d.r.ReadValue(); err != nil {
+			return "", false, err
+		}
+	default:
+		v, err := d.r.ReadValue()
+		if err != nil {
+			return "", false, fmt.Errorf("error in map entry: invalid key: %w", err)
+		}
+		switch k := v.(type) {
+		case int:
+			key = strconv.Itoa(k)
+		case float64:
+			key = strconv.FormatFloat(k, 'f', -1, 64)
+		case nil:
+			key = "nil"
+		}
+	}
+
+	if err := d.r.ReadColon(); err != nil {
+		return "", false, err
+	}
+	if skip {
+		if _, err := d.r.ReadValue(); err != nil {
+			return "", false, err
+		}
+	}
+	return key, skip, nil
+}
+
+// readPermission reads a numeric permission value
+func (d *accessTreeDecoder) readPermission() (Permission, error) {
+	switch kind := d.r.Kind(); kind {
+	case lpc.KindInt, lpc.KindFloat:
+		v, err := d.r.ReadNumber()
+		if err != nil {
+			return Revoked, err
+		}
+		return Permission(int(v)), nil
+	default:
+		return Revoked, fmt.Errorf("invalid permission format: expected number, got %s", kind)
+	}
+}
+
+// readGroups reads a "?" group list, appending the names to groups
+func (d *accessTreeDecoder) readGroups(groups []string) ([]string, error) {
+	if kind := d.r.Kind(); kind != lpc.KindArray {
+		return nil, fmt.Errorf("invalid group list format: expected array, got %s", kind)
+	}
+	size, err := d.r.ReadArrayStart()
+	if err != nil {
+		return nil, err
+	}
+
+	count := 0
+	for {
+		more, err := d.r.More()
+		if err != nil {
+			return nil, err
+		}
+		if !more {
+			break
+		}
+		count++
+
+		if kind := d.r.Kind(); kind != lpc.KindString {
+			return nil, fmt.Errorf("invalid group name format: expected string, got %s", kind)
+		}
+		b, err := d.r.ReadStringBytes()
+		if err != nil {
+			return nil, err
+		}
+		groups = append(groups, d.intern(b))
+	}
+
+	if err := checkSize("array", count, size); err != nil {
+		return nil, err
+	}
+	return groups, nil
+}
+
+// addChild adds a child to node, sizing its children map from the number of
+// entries in the node's mapping on first use
+func (d *accessTreeDecoder) addChild(node *AccessNode, name string, child *AccessNode, size int) {
+	if node.Children == nil {
+		node.Children = make(map[string]*AccessNode, min(max(size, 1), maxChildrenHint))
+	}
+	node.Children[name] = child
+}
+
+// leaf returns the shared leaf node for a permission
+func (d *accessTreeDecoder) leaf(perm Permission) *AccessNode {
+	if node, ok := d.leaves[perm]; ok {
+		return node
+	}
+	node := &AccessNode{DotAccess: perm, StarAccess: perm}
+	d.leaves[perm] = node
+	return node
+}
+
+// intern returns a string equal to b, reusing earlier copies of the same name
+func (d *accessTreeDecoder) intern(b []byte) string {
+	if s, ok := d.names[string(b)]; ok {
+		return s
+	}
+	s := string(b)
+	d.names[s] = s
+	return s
+}
+
+// checkSize compares the declared size of an array or mapping with the
+// number of elements read
+func checkSize(what string, count, size int) error {
+	if count > size {
+		return fmt.Errorf("error in %s: too many elements, expected %d", what, size)
+	}
+	if count < size {
+		return fmt.Errorf("error in %s: too few elements, expected %d", what, size)
+	}
+	return nil
+}
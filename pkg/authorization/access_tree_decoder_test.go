@@ -0,0 +1,189 @@
+package authorization
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"reflect"
+	"sort"
+	"strings"
+	"testing"
+	"unsafe"
+
+	"github.com/mmcdole/viking-ftpd/pkg/fixtures"
+)
+
+// encodeLPC writes a test tree in LPC object format, with mapping keys in
+// sorted order
+func encodeLPC(b *strings.Builder, value interface{}) {
+	switch v := value.(type) {
+	case map[string]interface{}:
+		keys := make([]string, 0, len(v))
+		for k := range v {
+			keys = append(keys, k)
+		}
+		sort.Strings(keys)
+		fmt.Fprintf(b, "([%d|", len(v))
+		for _, k := range keys {
+			fmt.Fprintf(b, "%q:", k)
+			encodeLPC(b, v[k])
+			b.WriteByte(',')
+		}
+		b.WriteString("])")
+	case []interface{}:
+		fmt.Fprintf(b, "({%d|", len(v))
+		for _, e := range v {
+			encodeLPC(b, e)
+			b.WriteByte(',')
+		}
+		b.WriteString("})")
+	case string:
+		fmt.Fprintf(b, "%q", v)
+	case Permission:
+		fmt.Fprintf(b, "%d", int(v))
+	default:
+		fmt.Fprintf(b, "%v", v)
+	}
+}
+
+// accessFileFor renders a test tree as the contents of an access.o file
+func accessFileFor(tree map[string]interface{}) string {
+	var b strings.Builder
+	b.WriteString("#/secure/access\n")
+	b.WriteString("access_map ")
+	encodeLPC(&b, tree["access_map"])
+	b.WriteString("\n")
+	return b.String()
+}
+
+func TestDecodeAccessTreesMatchesBuildAccessTrees(t *testing.T) {
+	trees := map[string]map[string]interface{}{
+		"production": productionTree(),
+		"core":       coreTree(),
+		"group":      groupTree(),
+	}
+	for name, tree := range trees {
+		t.Run(name, func(t *testing.T) {
+			want, err := BuildAccessTrees(tree)
+			if err != nil {
+				t.Fatalf("BuildAccessTrees failed: %v", err)
+			}
+			got, err := DecodeAccessTrees(strings.NewReader(accessFileFor(tree)))
+			if err != nil {
+				t.Fatalf("DecodeAccessTrees failed: %v", err)
+			}
+			if !reflect.DeepEqual(got, want) {
+				t.Errorf("DecodeAccessTrees() = %v, BuildAccessTrees() = %v", got, want)
+			}
+		})
+	}
+}
+
+func TestDecodeAccessTreesSharing(t *testing.T) {
+	input := `access_map ([2|"wizard1":([2|"open":1,"d":([1|"open":1])]),"wizard2":([1|"open":3.0])])`
+	trees, err := DecodeAccessTrees(strings.NewReader(input))
+	if err != nil {
+		t.Fatalf("DecodeAccessTrees failed: %v", err)
+	}
+
+	w1 := trees["wizard1"].Root
+	w2 := trees["wizard2"].Root
+	if w1.Children["open"] != w1.Children["d"].Children["open"] {
+		t.Error("leaf nodes with the same permission should be shared")
+	}
+	if w1.Children["open"].Children != nil {
+		t.Error("leaf nodes should have nil children")
+	}
+	if w2.Children["open"].DotAccess != Write {
+		t.Errorf("float permission decoded as %v, want %v", w2.Children["open"].DotAccess, Write)
+	}
+
+	// Repeated names share one string
+	var outer, inner string
+	for name := range w1.Children {
+		if name == "open" {
+			outer = name
+		}
+	}
+	for name := range w1.Children["d"].Children {
+		inner = name
+	}
+	if unsafe.StringData(outer) != unsafe.StringData(inner) {
+		t.Error("repeated child names should be interned")
+	}
+}
+
+func TestDecodeAccessTreesInvalid(t *testing.T) {
+	tests := []struct {
+		name  string
+		value string
+	}{
+		{"tree is not a mapping", `([1|"wizard1":3])`},
+		{"string permission", `([1|"wizard1":([1|"d":"write"])])`},
+		{"nil dot access", `([1|"wizard1":([1|".":nil])])`},
+		{"group list is not an array", `([1|"wizard1":([1|"?":"Group1"])])`},
+		{"group name is not a string", `([1|"wizard1":([1|"?":({1|1})])])`},
+		{"too few entries", `([2|"wizard1":([0|])])`},
+		{"too many entries", `([1|"a":([0|]),"b":([0|])])`},
+		{"trailing garbage", `([0|]) x`},
+		{"unterminated", `([1|"wizard1":([1|"d":1`},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			rawInput := "access_map " + tt.value
+			if _, err := DecodeAccessTrees(strings.NewReader(rawInput)); err == nil {
+				t.Error("DecodeAccessTrees should fail")
+			}
+		})
+	}
+}
+
+func BenchmarkAccessTreeRebuild(b *testing.B) {
+	data := string(fixtures.AccessFile(fixtures.DefaultConfig()))
+
+	b.Run("BuildAccessTrees", func(b *testing.B) {
+		source := NewAccessFileSource(writeBenchmarkFile(b, data))
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			raw, err := source.LoadAccessData()
+			if err != nil {
+				b.Fatal(err)
+			}
+			if _, err := BuildAccessTrees(raw); err != nil {
+				b.Fatal(err)
+			}
+		}
+	})
+
+	b.Run("BuildAccessTreesOnly", func(b *testing.B) {
+		raw, err := NewAccessFileSource(writeBenchmarkFile(b, data)).LoadAccessData()
+		if err != nil {
+			b.Fatal(err)
+		}
+		b.ReportAllocs()
+		b.ResetTimer()
+		for i := 0; i < b.N; i++ {
+			if _, err := BuildAccessTrees(raw); err != nil {
+				b.Fatal(err)
+			}
+		}
+	})
+
+	b.Run("DecodeAccessTrees", func(b *testing.B) {
+		source := NewAccessFileSource(writeBenchmarkFile(b, data))
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			if _, err := source.LoadAccessTrees(); err != nil {
+				b.Fatal(err)
+			}
+		}
+	})
+}
+
+func writeBenchmarkFile(b *testing.B, data string) string {
+	path := filepath.Join(b.TempDir(), "access.o")
+	if err := os.WriteFile(path, []byte(data), 0644); err != nil {
+		b.Fatalf("Failed to write access file: %v", err)
+	}
+	return path
+}
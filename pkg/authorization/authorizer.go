@@ -2,24 +2,52 @@ package authorization
 
 import (
 	"fmt"
-	"path"
 	"strings"
 	"sync"
+	"sync/atomic"
 	"time"
 
 	"github.com/mmcdole/viking-ftpd/pkg/logging"
+	"github.com/mmcdole/viking-ftpd/pkg/metrics"
 	"github.com/mmcdole/viking-ftpd/pkg/users"
 )
 
-// Authorizer handles access control and permissions with caching
+// Authorizer handles access control and permissions with caching.
+// The access trees are compiled into an immutable snapshot that is published
+// through an atomic pointer, so permission checks never take a lock.
 type Authorizer struct {
 	source        AccessSource
 	characterData users.Source
 	cacheDuration time.Duration
 
-	mu          sync.RWMutex
-	trees       map[string]*AccessTree
-	lastRefresh time.Time
+	refreshMode     RefreshMode
+	changeDetection bool
+
+	snap        atomic.Pointer[snapshot]
+	generation  atomic.Uint64
+	refreshMu   sync.Mutex   // serializes reloads of the access source
+	refreshing  atomic.Bool  // set while a background reload is running
+	epoch       time.Time    // monotonic reference point for lastAttempt
+	lastAttempt atomic.Int64 // time of the last reload attempt, as nanoseconds since epoch
+	invalidated atomic.Bool  // set by Invalidate until the next reload starts
+
+	levels sync.Map // username -> levelEntry, the implicit group of each character seen
+
+	// Bumped by InvalidateUser, so that permission caches drop results
+	// resolved with a level that has since changed
+	userEpochs    sync.Map // username -> *atomic.Uint64
+	allUsersEpoch atomic.Uint64
+
+	reloadDuration *metrics.Histogram // nil unless SetMetrics was called
+	reloadSize     *metrics.Histogram
+	reloadFailures *metrics.Counter
+}
+
+// levelEntry is the implicit group a character's level was last found to
+// entitle it to
+type levelEntry struct {
+	group   implicitGroup
+	checked int64 // nanoseconds since epoch
 }
 
 // NewAuthorizer creates a new Authorizer instance
@@ -28,7 +56,7 @@ func NewAuthorizer(source AccessSource, characterData users.Source, cacheDuratio
 		source:        source,
 		characterData: characterData,
 		cacheDuration: cacheDuration,
-		trees:         make(map[string]*AccessTree),
+		epoch:         time.Now(),
 	}
 }
 
@@ -40,100 +68,162 @@ func (a *Authorizer) HasPermission(username string, filepath string, requiredPer
 
 // ResolvePermission returns the effective permission for a user on a path
 func (a *Authorizer) ResolvePermission(username string, filepath string) Permission {
-	if err := a.ensureFreshCache(); err != nil {
-		logging.App.Debug("Cache refresh failed", "user", username, "path", filepath, "error", err)
+	return a.ResolvePath(username, CleanPath(filepath))
+}
+
+// ResolvePath returns the effective permission for a user on a canonical
+// path, without cleaning it again
+func (a *Authorizer) ResolvePath(username string, p Path) Permission {
+	cleanPath := p.String()
+	snap, err := a.ensureFreshCache()
+	if err != nil {
+		if logging.App.IsDebug() {
+			logging.App.Debug("Cache refresh failed", "user", username, "path", cleanPath, "error", err)
+		}
 		return Revoked
 	}
 
-	// Clean the path and split into parts
-	parts := strings.Split(path.Clean(filepath), "/")
-	if len(parts) > 0 && parts[0] == "" {
-		parts = parts[1:]
-	}
-	// Handle root path specifically
-	if len(parts) == 1 && parts[0] == "" {
-		parts = []string{} // Empty array for root path
-	}
+	debug := logging.App.IsDebug()
 
 	// Check implicit permissions first
-	if implicitPerm, ok := a.resolveImplicitPermission(username, parts); ok {
-		logging.App.Debug("Resolved implicit permission", "user", username, "path", filepath, "permission", implicitPerm)
+	if implicitPerm, ok := resolveImplicitPermission(username, cleanPath); ok {
+		if debug {
+			logging.App.Debug("Resolved implicit permission", "user", username, "path", cleanPath, "permission", implicitPerm)
+		}
 		return implicitPerm
 	}
 
-	// Check user's direct permissions
-	if tree, ok := a.trees[username]; ok {
-		perm := a.resolveNodePermission(tree.Root, parts)
-		if perm != Revoked {
-			logging.App.Debug("Resolved direct permission", "user", username, "path", filepath, "permission", perm)
+	// Check the user's tree and its explicit groups, then its implicit group
+	// and the default tree, so the level is only needed if the former fail
+	chains := snap.userChainsOf(username)
+	for _, root := range chains.roots[implicitNone][:chains.explicit] {
+		if perm := snap.resolve(root, cleanPath); perm != Revoked {
+			if debug {
+				logging.App.Debug("Resolved direct or explicit group permission", "user", username, "path", cleanPath, "permission", perm)
+			}
 			return perm
 		}
 	}
-
-	// Check all group permissions (both explicit and implicit)
-	for _, group := range a.ResolveGroups(username) {
-		if tree, ok := a.trees[group]; ok {
-			perm := a.resolveNodePermission(tree.Root, parts)
-			if perm != Revoked {
-				logging.App.Debug("Resolved group permission", "user", username, "group", group, "path", filepath, "permission", perm)
-				return perm
+	for _, root := range chains.roots[a.implicitGroupOf(snap, username)][chains.explicit:] {
+		if perm := snap.resolve(root, cleanPath); perm != Revoked {
+			if debug {
+				logging.App.Debug("Resolved implicit group or default permission", "user", username, "path", cleanPath, "permission", perm)
 			}
+			return perm
 		}
 	}
 
-	// Finally check default permissions
-	if tree, ok := a.trees["*"]; ok {
-		perm := a.resolveNodePermission(tree.Root, parts)
-		logging.App.Debug("Using default permission", "user", username, "path", filepath, "permission", perm)
-		return perm
+	if debug {
+		logging.App.Debug("No permission found, defaulting to revoked", "user", username, "path", cleanPath)
 	}
-
-	logging.App.Debug("No permission found, defaulting to revoked", "user", username, "path", filepath)
 	return Revoked
 }
 
+// ResolveChildren returns the effective permissions of a user on the entries
+// of directory dir named by names, in the same order. The results are those
+// ResolvePermission gives for each entry, but every access tree is walked
+// down to dir once and each entry then takes a single child lookup.
+func (a *Authorizer) ResolveChildren(username string, dir string, names []string) []Permission {
+	perms := make([]Permission, len(names))
+	for i := range perms {
+		perms[i] = Revoked
+	}
+	snap, err := a.ensureFreshCache()
+	if err != nil {
+		if logging.App.IsDebug() {
+			logging.App.Debug("Cache refresh failed", "user", username, "path", dir, "error", err)
+		}
+		return perms
+	}
+
+	cleanDir := CleanPath(dir).String()
+	implicit := implicitChildPermissions(username, cleanDir)
+
+	// Walk the user's trees in the order ResolvePermission consults them
+	chain := snap.userChainsOf(username).roots[a.implicitGroupOf(snap, username)]
+	resolvers := make([]childResolver, len(chain))
+	for i, root := range chain {
+		resolvers[i] = snap.walkDir(root, cleanDir)
+	}
+
+	for i, name := range names {
+		if perm, ok := implicit.lookup(name); ok {
+			perms[i] = perm
+			continue
+		}
+		id, known := snap.segments[name]
+		perm := Revoked
+		for _, r := range resolvers {
+			if perm = snap.resolveChild(r, id, known); perm != Revoked {
+				break
+			}
+		}
+		perms[i] = perm
+	}
+	return perms
+}
+
 // ResolveGroups returns all groups that a user belongs to, including both
-// explicit groups from the access tree and implicit groups based on character level.
+// explicit groups from the access tree and implicit groups based on character
+// level. The list is computed when the access trees are loaded and is shared,
+// so callers must not modify it.
 func (a *Authorizer) ResolveGroups(username string) []string {
-	if err := a.ensureFreshCache(); err != nil {
+	snap, err := a.ensureFreshCache()
+	if err != nil {
 		return []string{}
 	}
+	return snap.userChainsOf(username).groups[a.implicitGroupOf(snap, username)]
+}
 
-	// Get explicit groups
-	groups := a.GetExplicitGroups(username)
-	if groups == nil {
-		groups = []string{}
+// DefinesGroup reports whether the access trees hold a tree named group,
+// ignoring case, that users can be given as a group
+func (a *Authorizer) DefinesGroup(group string) bool {
+	snap, err := a.ensureFreshCache()
+	if err != nil {
+		return false
 	}
-
-	// Add implicit groups
-	implicitGroups := a.resolveImplicitGroups(username)
-	if implicitGroups != nil {
-		groups = append(groups, implicitGroups...)
+	for name := range snap.roots {
+		if strings.EqualFold(name, group) {
+			return true
+		}
 	}
-
-	return groups
+	return false
 }
 
 // GetExplicitGroups returns the explicit groups a user belongs to from their access tree
 func (a *Authorizer) GetExplicitGroups(username string) []string {
-	if err := a.ensureFreshCache(); err != nil {
+	snap, err := a.ensureFreshCache()
+	if err != nil {
 		return []string{}
 	}
 
-	a.mu.RLock()
-	defer a.mu.RUnlock()
-
-	// Get user's tree
-	tree, ok := a.trees[username]
-	if !ok || tree == nil {
+	// Groups are stored in the user's tree itself
+	groups, ok := snap.groups[username]
+	if !ok || groups == nil {
 		return []string{}
 	}
+	return groups
+}
 
-	// Groups are stored in the tree itself
-	if tree.Groups == nil {
-		return []string{}
+// Generation returns the generation number of the current access trees.
+// It increases every time access.o is reloaded, and is 0 if no trees could
+// be loaded.
+func (a *Authorizer) Generation() uint64 {
+	snap, err := a.ensureFreshCache()
+	if err != nil {
+		return 0
+	}
+	return snap.generation
+}
+
+// Loaded returns the generation of the access trees in use and when they
+// were loaded, without reloading them if they have expired. Both are zero if
+// no trees have been loaded.
+func (a *Authorizer) Loaded() (uint64, time.Time) {
+	if snap := a.snap.Load(); snap != nil {
+		return snap.generation, snap.loadedAt
 	}
-	return tree.Groups
+	return 0, time.Time{}
 }
 
 // CanRead checks if a user has read permission for a path
@@ -151,106 +241,324 @@ func (a *Authorizer) CanGrant(username string, filepath string) bool {
 	return a.ResolvePermission(username, filepath).CanGrant()
 }
 
-// refreshCache loads fresh data from the source
+// SetRefreshMode selects how expired access trees are reloaded.
+// It should be called before the Authorizer is used.
+func (a *Authorizer) SetRefreshMode(mode RefreshMode) {
+	a.refreshMode = mode
+}
+
+// SetChangeDetection controls whether an expired TTL reloads unconditionally.
+// When enabled and the source implements ChangeDetector, the access trees are
+// only rebuilt once the TTL has expired if the source reports a change, or
+// immediately after Invalidate. It should be called before the Authorizer is
+// used.
+func (a *Authorizer) SetChangeDetection(enabled bool) {
+	a.changeDetection = enabled
+}
+
+// SetMetrics registers the duration and size of access.o reloads, failed
+// reloads and the current generation with reg. It should be called before
+// the Authorizer is used.
+func (a *Authorizer) SetMetrics(reg *metrics.Registry) {
+	a.reloadDuration = reg.NewHistogram("vkftpd_access_reload_duration_seconds",
+		"Time taken to load and compile the access trees.", metrics.DurationBuckets)
+	a.reloadSize = reg.NewHistogram("vkftpd_access_reload_bytes",
+		"Size of the access data parsed by each reload.", metrics.SizeBuckets)
+	a.reloadFailures = reg.NewCounter("vkftpd_access_reload_failures_total",
+		"Reloads of the access trees that failed.")
+	reg.NewGaugeFunc("vkftpd_access_generation", "Generation of the access trees in use.", func() float64 {
+		// Not Generation, which could trigger a reload
+		generation, _ := a.Loaded()
+		return float64(generation)
+	})
+}
+
+// Invalidate marks the access trees as stale and starts reloading them in the
+// background, without waiting for the TTL to expire. It is meant to be called
+// from file watch notifications.
+func (a *Authorizer) Invalidate() {
+	a.invalidated.Store(true)
+	a.refreshInBackground()
+}
+
+// InvalidateUser forgets the implicit group of username, or of every
+// character if username is empty, so that a level change applies on the
+// next check. It is meant to be called from character change notifications.
+func (a *Authorizer) InvalidateUser(username string) {
+	// The level is forgotten before the epoch moves, so a result resolved
+	// under the new epoch never uses the old level
+	if username == "" {
+		a.levels.Range(func(key, _ interface{}) bool {
+			a.levels.Delete(key)
+			return true
+		})
+		a.allUsersEpoch.Add(1)
+		return
+	}
+	a.levels.Delete(username)
+	counter, _ := a.userEpochs.LoadOrStore(username, new(atomic.Uint64))
+	counter.(*atomic.Uint64).Add(1)
+}
+
+// userEpoch returns a number that changes whenever InvalidateUser forgets
+// the level of username
+func (a *Authorizer) userEpoch(username string) uint64 {
+	epoch := a.allUsersEpoch.Load()
+	if counter, ok := a.userEpochs.Load(username); ok {
+		epoch += counter.(*atomic.Uint64).Load()
+	}
+	return epoch
+}
+
+// refreshCache loads fresh data from the source and publishes a new snapshot
 func (a *Authorizer) refreshCache() error {
+	a.refreshMu.Lock()
+	defer a.refreshMu.Unlock()
+	_, err := a.reload()
+	return err
+}
+
+// reload builds a snapshot from the source and publishes it.
+// Callers must hold refreshMu so that only one reload runs at a time.
+func (a *Authorizer) reload() (*snapshot, error) {
+	defer a.lastAttempt.Store(int64(time.Since(a.epoch)))
+
 	logging.App.Debug("Refreshing access cache")
+	start := time.Now()
+	generation := a.generation.Load() + 1
+	snap, err := a.loadSnapshot(generation)
+	if err != nil {
+		a.reloadFailures.Inc()
+		return nil, err
+	}
+
+	a.generation.Store(generation)
+	a.snap.Store(snap)
+	a.reloadDuration.Observe(time.Since(start).Seconds())
+	if sr, ok := a.source.(SizeReporter); ok {
+		a.reloadSize.Observe(float64(sr.LoadedSize()))
+	}
+	return snap, nil
+}
+
+// snapshotSource is implemented by access sources that compile the access
+// trees themselves, so they can keep a compiled copy. The Authorizer prefers
+// it over TreeSource.
+type snapshotSource interface {
+	loadSnapshot(generation uint64) (*snapshot, error)
+}
+
+// loadSnapshot reads the access trees from the source and compiles them
+func (a *Authorizer) loadSnapshot(generation uint64) (*snapshot, error) {
+	if ss, ok := a.source.(snapshotSource); ok {
+		snap, err := ss.loadSnapshot(generation)
+		if err != nil {
+			logging.App.Debug("Failed to load access trees", "error", err)
+			return nil, fmt.Errorf("loading access trees: %w", err)
+		}
+		return snap, nil
+	}
+
+	trees, err := a.loadTrees()
+	if err != nil {
+		return nil, err
+	}
+	return compileSnapshot(trees, generation, time.Now()), nil
+}
+
+// loadTrees reads the access trees from the source, streaming them if the
+// source supports it
+func (a *Authorizer) loadTrees() (map[string]*AccessTree, error) {
+	if ts, ok := a.source.(TreeSource); ok {
+		trees, err := ts.LoadAccessTrees()
+		if err != nil {
+			logging.App.Debug("Failed to load access trees", "error", err)
+			return nil, fmt.Errorf("loading access trees: %w", err)
+		}
+		return trees, nil
+	}
+
 	rawData, err := a.source.LoadAccessData()
 	if err != nil {
 		logging.App.Debug("Failed to load access data", "error", err)
-		return fmt.Errorf("loading raw data: %w", err)
+		return nil, fmt.Errorf("loading raw data: %w", err)
 	}
 
 	trees, err := BuildAccessTrees(rawData)
 	if err != nil {
 		logging.App.Debug("Failed to build access trees", "error", err)
-		return fmt.Errorf("building access trees: %w", err)
+		return nil, fmt.Errorf("building access trees: %w", err)
 	}
+	return trees, nil
+}
 
-	a.mu.Lock()
-	a.trees = trees
-	a.lastRefresh = time.Now()
-	a.mu.Unlock()
+// expired reports whether the access trees were invalidated or the TTL has
+// passed since the last reload attempt. Failed attempts count too, so a
+// broken access.o is retried once per TTL rather than on every request.
+func (a *Authorizer) expired() bool {
+	if a.invalidated.Load() {
+		return true
+	}
+	return time.Since(a.epoch)-time.Duration(a.lastAttempt.Load()) >= a.cacheDuration
+}
 
-	return nil
+// refreshLocked reloads the access trees, unless change detection is enabled
+// and the source reports that nothing changed since current was loaded.
+// Callers must hold refreshMu.
+func (a *Authorizer) refreshLocked(current *snapshot) (*snapshot, error) {
+	if current != nil && a.changeDetection && !a.invalidated.Load() {
+		if detector, ok := a.source.(ChangeDetector); ok && !detector.Changed() {
+			a.lastAttempt.Store(int64(time.Since(a.epoch)))
+			return current, nil
+		}
+	}
+
+	// Clear before loading so an invalidation that races with the load
+	// triggers another one
+	a.invalidated.Store(false)
+	return a.reload()
 }
 
-// ensureFreshCache checks if cache needs refresh
-func (a *Authorizer) ensureFreshCache() error {
-	a.mu.RLock()
-	needsRefresh := time.Since(a.lastRefresh) >= a.cacheDuration
-	a.mu.RUnlock()
+// ensureFreshCache returns the current snapshot, reloading it if it has expired.
+// Only one reload runs at a time. If a reload fails, the last good snapshot
+// keeps being served; an error is only returned if no trees were ever loaded.
+func (a *Authorizer) ensureFreshCache() (*snapshot, error) {
+	snap := a.snap.Load()
+	if snap != nil && !a.expired() {
+		return snap, nil
+	}
 
-	if needsRefresh {
-		return a.refreshCache()
+	if snap != nil && a.refreshMode == RefreshBackground {
+		a.refreshInBackground()
+		return snap, nil
 	}
-	return nil
-}
 
-// resolveImplicitPermission returns any implicit permissions for a path and user
-func (a *Authorizer) resolveImplicitPermission(username string, parts []string) (Permission, bool) {
-	if len(parts) >= 2 && parts[0] == "players" {
-		if parts[1] == username {
-			return GrantGrant, true // Users always have GRANT_GRANT on their own directory
-		}
-		// Check for open directory at exactly level 3
-		if len(parts) >= 3 && parts[2] == "open" && len(parts) == 3 {
-			return Read, true // Everyone can read open directories at level 3
+	a.refreshMu.Lock()
+	defer a.refreshMu.Unlock()
+
+	// Another request may have reloaded while we waited for the lock
+	current := a.snap.Load()
+	if current != nil && !a.expired() {
+		return current, nil
+	}
+
+	fresh, err := a.refreshLocked(current)
+	if err != nil {
+		if current != nil {
+			logging.App.Warn("Access reload failed, keeping previous access trees", "generation", current.generation, "error", err)
+			return current, nil
 		}
+		return nil, err
 	}
-	return Revoked, false
+	return fresh, nil
 }
 
-// resolveImplicitGroups returns implicit groups based on character level
-func (a *Authorizer) resolveImplicitGroups(username string) []string {
-	user, err := a.characterData.LoadUser(username)
-	if err != nil {
-		return []string{}
+// refreshInBackground starts a reload in its own goroutine unless one is
+// already running. Requests keep using the current snapshot meanwhile.
+func (a *Authorizer) refreshInBackground() {
+	if !a.refreshing.CompareAndSwap(false, true) {
+		return
 	}
 
-	groups := make([]string, 0)
+	go func() {
+		defer a.refreshing.Store(false)
 
-	// Check if the groups exist in the access map before adding them
-	a.mu.RLock()
-	defer a.mu.RUnlock()
+		a.refreshMu.Lock()
+		defer a.refreshMu.Unlock()
+		for a.expired() {
+			if _, err := a.refreshLocked(a.snap.Load()); err != nil {
+				logging.App.Warn("Background access reload failed, keeping previous access trees", "error", err)
+			}
+			// Only go around again for invalidations that arrived mid-reload
+			if !a.invalidated.Load() {
+				return
+			}
+		}
+	}()
+}
 
-	// Arch_full for archwizards and above
-	if _, ok := a.trees[GroupArchFull]; ok && user.Level >= users.ARCHWIZARD {
-		groups = append(groups, GroupArchFull)
-	} else if _, ok := a.trees[GroupArchJunior]; ok && user.Level >= users.JUNIOR_ARCH && user.Level != users.ELDER {
-		// Arch_junior for junior arches (except elders)
-		groups = append(groups, GroupArchJunior)
+// resolveImplicitPermission returns any implicit permissions for a cleaned path and user
+func resolveImplicitPermission(username string, cleanPath string) (Permission, bool) {
+	segments := newPathSegments(cleanPath)
+	if first, ok := segments.next(); !ok || first != "players" {
+		return Revoked, false
+	}
+	owner, ok := segments.next()
+	if !ok {
+		return Revoked, false
+	}
+	if owner == username {
+		return GrantGrant, true // Users always have GRANT_GRANT on their own directory
+	}
+	// Check for open directory at exactly level 3
+	if third, ok := segments.next(); ok && third == "open" {
+		if _, deeper := segments.next(); !deeper {
+			return Read, true // Everyone can read open directories at level 3
+		}
 	}
+	return Revoked, false
+}
 
-	return groups
+// implicitChildren describes the implicit permissions on the entries of one
+// directory
+type implicitChildren struct {
+	all    Permission // applies to every entry if hasAll is set
+	hasAll bool
+	name   string // the single entry with an implicit permission, if any
+	perm   Permission
 }
 
-// resolveNodePermission recursively checks permissions in a node
-func (a *Authorizer) resolveNodePermission(node *AccessNode, pathParts []string) Permission {
-	if node == nil {
-		return Revoked
+// implicitChildPermissions returns the implicit permissions resolveImplicitPermission
+// gives the entries of a cleaned directory path
+func implicitChildPermissions(username string, cleanDir string) implicitChildren {
+	segments := newPathSegments(cleanDir)
+	if first, ok := segments.next(); !ok || first != "players" {
+		return implicitChildren{}
 	}
+	owner, ok := segments.next()
+	if !ok {
+		return implicitChildren{name: username, perm: GrantGrant} // the user's own directory
+	}
+	if owner == username {
+		return implicitChildren{all: GrantGrant, hasAll: true}
+	}
+	if _, deeper := segments.next(); !deeper {
+		return implicitChildren{name: "open", perm: Read}
+	}
+	return implicitChildren{}
+}
 
-	// At the target node (final node)
-	if len(pathParts) == 0 {
-		// At final node, dot access overrides star access
-		if node.DotAccess != Revoked {
-			return node.DotAccess
-		}
-		// No dot access, use star access
-		return node.StarAccess
+// lookup returns the implicit permission of an entry, if it has one
+func (c implicitChildren) lookup(name string) (Permission, bool) {
+	if c.hasAll {
+		return c.all, true
+	}
+	if c.name != "" && name == c.name {
+		return c.perm, true
 	}
+	return Revoked, false
+}
 
-	part := pathParts[0]
-	rest := pathParts[1:]
+// implicitGroupOf returns the implicit group of a user based on character
+// level. The level is looked up once per cache duration, or again after
+// InvalidateUser, and not at all if the access map defines no implicit
+// group trees.
+func (a *Authorizer) implicitGroupOf(snap *snapshot, username string) implicitGroup {
+	if !snap.hasImplicitTrees() {
+		return implicitNone
+	}
 
-	// Check for exact match in children
-	if child, ok := node.Children[part]; ok {
-		// Recursively check child permissions
-		childPerm := a.resolveNodePermission(child, rest)
-		// If child returns Revoked, that's final - don't fall back to star access
-		return childPerm
+	now := int64(time.Since(a.epoch))
+	if v, ok := a.levels.Load(username); ok {
+		if entry := v.(levelEntry); now-entry.checked < int64(a.cacheDuration) {
+			return entry.group
+		}
 	}
 
-	// No matching child, use star access
-	return node.StarAccess
+	group := implicitNone
+	if user, err := a.characterData.LoadUser(username); err == nil {
+		group = implicitGroupForLevel(user.Level)
+	}
+	a.levels.Store(username, levelEntry{group: group, checked: now})
+	return group
 }
@@ -1,11 +1,14 @@
 package authorization
 
 import (
+	"fmt"
+	"path"
+	"path/filepath"
 	"reflect"
-	"sort"
 	"testing"
 	"time"
 
+	"github.com/mmcdole/viking-ftpd/pkg/fixtures"
 	"github.com/mmcdole/viking-ftpd/pkg/users"
 )
 
@@ -430,9 +433,9 @@ func TestGroupMembership(t *testing.T) {
 			want:     []string{"Arch_full"},
 		},
 		{
-			name:     "junior gets implicit junior and explicit domain",
+			name:     "junior gets explicit domain then implicit junior",
 			username: "junior",
-			want:     []string{"Arch_junior", "Wiz_domain"},
+			want:     []string{"Wiz_domain", "Arch_junior"},
 		},
 		{
 			name:     "elder gets no groups",
@@ -449,8 +452,6 @@ func TestGroupMembership(t *testing.T) {
 	for _, tt := range tests {
 		t.Run(tt.name, func(t *testing.T) {
 			got := auth.ResolveGroups(tt.username)
-			sort.Strings(got)
-			sort.Strings(tt.want)
 			if !reflect.DeepEqual(got, tt.want) {
 				t.Errorf("ResolveGroups(%q) = %v (type %T), want %v (type %T)",
 					tt.username, got, got, tt.want, tt.want)
@@ -458,3 +459,221 @@ func TestGroupMembership(t *testing.T) {
 		})
 	}
 }
+
+// countingUserSource counts character loads
+type countingUserSource struct {
+	*mockUserSource
+	loads int
+}
+
+func (c *countingUserSource) LoadUser(username string) (*users.User, error) {
+	c.loads++
+	return c.mockUserSource.LoadUser(username)
+}
+
+func TestImplicitGroupLevelCache(t *testing.T) {
+	source := &countingUserSource{mockUserSource: newMockUserSource()}
+	source.addUser("junior", users.JUNIOR_ARCH)
+	tree := map[string]interface{}{
+		"access_map": map[string]interface{}{
+			"Arch_full":   map[string]interface{}{"*": GrantGrant},
+			"Arch_junior": map[string]interface{}{"*": Write},
+		},
+	}
+	auth := NewAuthorizer(newMockAccessSource(tree), source, time.Hour)
+	if err := auth.refreshCache(); err != nil {
+		t.Fatalf("Failed to refresh cache: %v", err)
+	}
+
+	for i := 0; i < 10; i++ {
+		if got := auth.ResolvePermission("junior", "/secure/master.c"); got != Write {
+			t.Fatalf("ResolvePermission before promotion = %v, want %v", got, Write)
+		}
+	}
+	if source.loads != 1 {
+		t.Errorf("character loaded %d times, want 1", source.loads)
+	}
+
+	// A promotion applies once the character change is reported
+	source.addUser("junior", users.ARCHWIZARD)
+	if got := auth.ResolvePermission("junior", "/secure/master.c"); got != Write {
+		t.Errorf("ResolvePermission before invalidation = %v, want %v", got, Write)
+	}
+	auth.InvalidateUser("junior")
+	if got := auth.ResolvePermission("junior", "/secure/master.c"); got != GrantGrant {
+		t.Errorf("ResolvePermission after invalidation = %v, want %v", got, GrantGrant)
+	}
+	if got := auth.ResolveGroups("junior"); !reflect.DeepEqual(got, []string{"Arch_full"}) {
+		t.Errorf("ResolveGroups after invalidation = %v, want [Arch_full]", got)
+	}
+
+	source.addUser("junior", users.WIZARD)
+	auth.InvalidateUser("")
+	if got := auth.ResolvePermission("junior", "/secure/master.c"); got != Revoked {
+		t.Errorf("ResolvePermission after demotion = %v, want %v", got, Revoked)
+	}
+}
+
+func TestResolveGroupsDoesNotAllocate(t *testing.T) {
+	source := newMockUserSource()
+	source.addUser("junior", users.JUNIOR_ARCH)
+	auth := NewAuthorizer(newMockAccessSource(productionTree()), source, time.Hour)
+	if err := auth.refreshCache(); err != nil {
+		t.Fatalf("Failed to refresh cache: %v", err)
+	}
+
+	for _, username := range []string{"junior", "wizard1", "nobody"} {
+		allocs := testing.AllocsPerRun(100, func() {
+			auth.ResolveGroups(username)
+		})
+		if allocs != 0 {
+			t.Errorf("ResolveGroups(%q) allocated %.1f times per run, want 0", username, allocs)
+		}
+	}
+}
+
+// benchmarkAuthorizer returns an authorizer loaded with the default fixture
+// access file and characters
+func benchmarkAuthorizer(b *testing.B, cfg fixtures.Config) *Authorizer {
+	b.Helper()
+	path := filepath.Join(b.TempDir(), "access.o")
+	if err := fixtures.WriteAccessFile(path, cfg); err != nil {
+		b.Fatal(err)
+	}
+
+	characters := users.NewMemorySource()
+	for i := 0; i < cfg.Wizards; i++ {
+		level := users.WIZARD
+		if i%cfg.JuniorEach == 0 {
+			level = users.JUNIOR_ARCH
+		}
+		characters.AddUser(&users.User{Username: fixtures.WizardName(i), Level: level})
+	}
+	characters.AddUser(&users.User{Username: "arch", Level: users.ARCHWIZARD})
+	characters.AddUser(&users.User{Username: fixtures.MortalName(1), Level: 10})
+
+	auth := NewAuthorizer(NewAccessFileSource(path), characters, time.Hour)
+	if err := auth.refreshCache(); err != nil {
+		b.Fatal(err)
+	}
+	return auth
+}
+
+func BenchmarkResolvePermission(b *testing.B) {
+	cfg := fixtures.DefaultConfig()
+	auth := benchmarkAuthorizer(b, cfg)
+
+	wizard := fixtures.WizardName(7)
+	junior := fixtures.WizardName(cfg.JuniorEach)
+	mortal := fixtures.MortalName(1)
+	cases := []struct {
+		name     string
+		username string
+		path     string
+	}{
+		{"User/Shallow", wizard, "/d/" + fixtures.DomainName(7) + "/area0_0"},
+		{"User/Deep", wizard, fixtures.DeepPath(cfg, 7)},
+		{"Implicit/Own", wizard, "/players/" + wizard + "/workroom.c"},
+		{"Group/Explicit", junior, "/players/nobody/notes/todo.txt"},
+		{"Group/Implicit", "arch", "/secure/master.c"},
+		{"Default/Shallow", mortal, "/log/debug.log"},
+		{"Default/Deep", mortal, fixtures.DeepPath(cfg, 10)},
+	}
+	for _, c := range cases {
+		b.Run(c.name, func(b *testing.B) {
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				auth.ResolvePermission(c.username, c.path)
+			}
+		})
+	}
+}
+
+func BenchmarkResolveGroups(b *testing.B) {
+	cfg := fixtures.DefaultConfig()
+	auth := benchmarkAuthorizer(b, cfg)
+	junior := fixtures.WizardName(cfg.JuniorEach)
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		auth.ResolveGroups(junior)
+	}
+}
+
+func BenchmarkResolveChildren(b *testing.B) {
+	cfg := fixtures.DefaultConfig()
+	auth := benchmarkAuthorizer(b, cfg)
+
+	// Listing /players as a junior arch, who has an explicit group, and
+	// a domain directory as its wizard
+	players := make([]string, cfg.Wizards)
+	for i := range players {
+		players[i] = fixtures.WizardName(i)
+	}
+	domain := path.Dir(path.Dir(fixtures.DeepPath(cfg, 7)))
+	areas := make([]string, 1000)
+	for i := range areas {
+		areas[i] = fmt.Sprintf("room%d.c", i)
+	}
+	cases := []struct {
+		name     string
+		username string
+		dir      string
+		names    []string
+	}{
+		{"Players", fixtures.WizardName(cfg.JuniorEach), "/players", players},
+		{"DeepDomain", fixtures.WizardName(7), domain, areas},
+	}
+	for _, c := range cases {
+		b.Run(c.name+"/PerEntry", func(b *testing.B) {
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				for _, name := range c.names {
+					auth.ResolvePermission(c.username, c.dir+"/"+name)
+				}
+			}
+		})
+		b.Run(c.name+"/Batch", func(b *testing.B) {
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				auth.ResolveChildren(c.username, c.dir, c.names)
+			}
+		})
+	}
+}
+
+func TestResolveChildren(t *testing.T) {
+	source := newMockUserSource()
+	source.addUser("arch", users.ARCHWIZARD)
+	source.addUser("junior", users.JUNIOR_ARCH)
+	source.addUser("wizard", users.WIZARD)
+	source.addUser("wizard1", users.WIZARD)
+
+	tree := productionTree()
+	for name, value := range coreTree()["access_map"].(map[string]interface{}) {
+		if name != "*" {
+			tree["access_map"].(map[string]interface{})[name] = value
+		}
+	}
+	auth := NewAuthorizer(newMockAccessSource(tree), source, time.Hour)
+	if err := auth.refreshCache(); err != nil {
+		t.Fatalf("Failed to refresh cache: %v", err)
+	}
+
+	dirs := []string{"/", "/players", "/players/wizard", "/players/arch", "/players/arch/open",
+		"/domains", "/secure", "/override", "/special", "/special/deeper", "/nowhere/at/all", "/players/wizard/", "/d", "/d/SharedRealm", "/log"}
+	names := []string{"players", "wizard", "arch", "open", "domains", "secure", "override", "special",
+		"deeper", "doc.txt", "README", "unknown-name", "d", "MyRealm", "SharedRealm", "log", "Driver", "tmp", "data"}
+	for _, username := range []string{"arch", "junior", "wizard", "wizard1", "user", "nobody"} {
+		for _, dir := range dirs {
+			t.Run(username+dir, func(t *testing.T) {
+				got := auth.ResolveChildren(username, dir, names)
+				for i, name := range names {
+					want := auth.ResolvePermission(username, filepath.Join(dir, name))
+					if got[i] != want {
+						t.Errorf("ResolveChildren(%q, %q)[%q] = %v, want %v", username, dir, name, got[i], want)
+					}
+				}
+			})
+		}
+	}
+}
@@ -0,0 +1,46 @@
+package authorization
+
+import (
+	"errors"
+	"os"
+	"syscall"
+)
+
+// mappedFile is a file mapped read-only into memory. Processes mapping the
+// same file share its pages.
+type mappedFile struct {
+	data []byte
+}
+
+// mapFile maps the whole file at path. vkftpd only ever replaces snapshot
+// files by rename, so a mapping stays valid for as long as it is held.
+// Nothing stops anyone else from truncating or rewriting a mapped file in
+// place, though: reading the pages that changed then faults with SIGBUS.
+func mapFile(path string) (*mappedFile, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+
+	fi, err := f.Stat()
+	if err != nil {
+		return nil, err
+	}
+	if fi.Size() == 0 || int64(int(fi.Size())) != fi.Size() {
+		return nil, errors.New("snapshot file is empty or too large")
+	}
+	data, err := syscall.Mmap(int(f.Fd()), 0, int(fi.Size()), syscall.PROT_READ, syscall.MAP_SHARED)
+	if err != nil {
+		return nil, &os.PathError{Op: "mmap", Path: path, Err: err}
+	}
+	return &mappedFile{data: data}, nil
+}
+
+// close unmaps the file
+func (m *mappedFile) close() {
+	if m.data != nil {
+		syscall.Munmap(m.data)
+		m.data = nil
+	}
+}
@@ -0,0 +1,25 @@
+//go:build !linux
+
+package authorization
+
+import "os"
+
+// mappedFile holds the contents of a file read into memory where mmap is
+// not used
+type mappedFile struct {
+	data []byte
+}
+
+// mapFile reads the whole file at path
+func mapFile(path string) (*mappedFile, error) {
+	data, err := os.ReadFile(path)
+	if err != nil {
+		return nil, err
+	}
+	return &mappedFile{data: data}, nil
+}
+
+// close releases the contents to the garbage collector
+func (m *mappedFile) close() {
+	m.data = nil
+}
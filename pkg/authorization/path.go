@@ -0,0 +1,50 @@
+package authorization
+
+import (
+	"path"
+	"strings"
+)
+
+// Path is a canonical path within the FTP root: absolute, "/"-separated and
+// free of ".", ".." and repeated or trailing slashes. It is computed once
+// per request, by CleanPath or JoinPath, and the same value is then both
+// authorized and handed to the filesystem, so the two cannot disagree and
+// neither needs to clean it again.
+type Path struct {
+	s string
+}
+
+// RootPath is the root of the FTP tree
+var RootPath = Path{s: "/"}
+
+// CleanPath returns the canonical form of p. Relative paths are taken
+// relative to the root, and ".." never climbs above it.
+func CleanPath(p string) Path {
+	return JoinPath("/", p)
+}
+
+// JoinPath returns the canonical path of name as seen from directory dir.
+// An absolute name ignores dir.
+func JoinPath(dir, name string) Path {
+	if !strings.HasPrefix(name, "/") {
+		name = dir + "/" + name
+	}
+	if !strings.HasPrefix(name, "/") {
+		name = "/" + name
+	}
+	// Clean returns its argument as is when it is already canonical
+	return Path{s: path.Clean(name)}
+}
+
+// String returns the path
+func (p Path) String() string {
+	if p.s == "" {
+		return "/"
+	}
+	return p.s
+}
+
+// Dir returns the directory holding p; the root is its own directory
+func (p Path) Dir() Path {
+	return Path{s: path.Dir(p.String())}
+}
@@ -0,0 +1,55 @@
+package authorization
+
+import "testing"
+
+func TestJoinPath(t *testing.T) {
+	tests := []struct {
+		dir  string
+		name string
+		want string
+	}{
+		{"/", "area.c", "/area.c"},
+		{"/players/drake", "workroom.c", "/players/drake/workroom.c"},
+		{"/players/drake", "/d/Realm", "/d/Realm"},
+		{"/players/drake", "../frodo/./notes//", "/players/frodo/notes"},
+		{"/players", "../../..", "/"},
+		{"", "log", "/log"},
+		{"players", "drake", "/players/drake"},
+		{"/d", "", "/d"},
+		{"/", ".", "/"},
+	}
+	for _, tt := range tests {
+		t.Run(tt.dir+"+"+tt.name, func(t *testing.T) {
+			if got := JoinPath(tt.dir, tt.name).String(); got != tt.want {
+				t.Errorf("JoinPath(%q, %q) = %q, want %q", tt.dir, tt.name, got, tt.want)
+			}
+		})
+	}
+}
+
+func TestPath(t *testing.T) {
+	if got := (Path{}).String(); got != "/" {
+		t.Errorf("zero Path = %q, want /", got)
+	}
+	if got := CleanPath("secure/master.c").String(); got != "/secure/master.c" {
+		t.Errorf("CleanPath(secure/master.c) = %q, want /secure/master.c", got)
+	}
+	if got := CleanPath("/players/drake").Dir(); got != CleanPath("/players") {
+		t.Errorf("Dir = %q, want /players", got)
+	}
+	if got := RootPath.Dir(); got != RootPath {
+		t.Errorf("Dir of root = %q, want /", got)
+	}
+
+	// An already canonical path is kept rather than copied
+	name := "/d/Realm/room.c"
+	if got := CleanPath(name).String(); got != name {
+		t.Errorf("CleanPath(%q) = %q", name, got)
+	}
+	allocs := testing.AllocsPerRun(100, func() {
+		CleanPath(name)
+	})
+	if allocs != 0 {
+		t.Errorf("CleanPath of a canonical path allocated %.1f times per run, want 0", allocs)
+	}
+}
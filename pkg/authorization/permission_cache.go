@@ -0,0 +1,181 @@
+package authorization
+
+import (
+	"path"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/mmcdole/viking-ftpd/pkg/metrics"
+)
+
+// CacheStats counts permission cache lookups. It is safe for concurrent use
+// and is normally shared by every session's PermissionCache.
+type CacheStats struct {
+	hits    atomic.Int64
+	misses  atomic.Int64
+	resolve *metrics.Histogram // nil unless SetResolveHistogram was called
+}
+
+// SetResolveHistogram makes the caches sharing s record in h how long each
+// lookup that misses takes to resolve. It should be called before the
+// caches are used.
+func (s *CacheStats) SetResolveHistogram(h *metrics.Histogram) {
+	s.resolve = h
+}
+
+// Hits returns the number of lookups answered from a cache
+func (s *CacheStats) Hits() int64 {
+	return s.hits.Load()
+}
+
+// Misses returns the number of lookups that had to resolve the permission
+func (s *CacheStats) Misses() int64 {
+	return s.misses.Load()
+}
+
+// PermissionCache memoizes ResolvePermission results for a single user.
+// Entries are tagged with the access tree generation and the user's level
+// epoch they were resolved against, so the whole cache is dropped as soon as
+// a new access.o is loaded or the user's level may have changed.
+// The cache holds at most capacity paths, evicting the oldest entry first.
+type PermissionCache struct {
+	authorizer *Authorizer
+	username   string
+	capacity   int
+	stats      *CacheStats
+
+	mu      sync.Mutex
+	state   cacheState
+	entries map[string]Permission
+	order   []string // ring of cached paths in insertion order
+	next    int      // next slot in order to overwrite once full
+}
+
+// cacheState is what a cache's entries were resolved against
+type cacheState struct {
+	generation uint64 // of the access trees
+	epoch      uint64 // of the user's level, see Authorizer.userEpoch
+}
+
+// NewPermissionCache creates a cache of up to capacity paths for username.
+// stats may be nil if hit/miss counts are not needed.
+func NewPermissionCache(authorizer *Authorizer, username string, capacity int, stats *CacheStats) *PermissionCache {
+	if capacity < 1 {
+		capacity = 1
+	}
+	if stats == nil {
+		stats = &CacheStats{}
+	}
+	return &PermissionCache{
+		authorizer: authorizer,
+		username:   username,
+		capacity:   capacity,
+		stats:      stats,
+		entries:    make(map[string]Permission, capacity),
+		order:      make([]string, 0, capacity),
+	}
+}
+
+// ResolvePermission returns the effective permission for the cache's user on a path
+func (c *PermissionCache) ResolvePermission(p Path) Permission {
+	cleanPath := p.String()
+	state := c.current()
+
+	c.mu.Lock()
+	if c.state != state {
+		c.resetLocked(state)
+	}
+	perm, ok := c.entries[cleanPath]
+	c.mu.Unlock()
+
+	if ok {
+		c.stats.hits.Add(1)
+		return perm
+	}
+	c.stats.misses.Add(1)
+
+	if c.stats.resolve != nil {
+		start := time.Now()
+		perm = c.authorizer.ResolvePath(c.username, p)
+		c.stats.resolve.Observe(time.Since(start).Seconds())
+	} else {
+		perm = c.authorizer.ResolvePath(c.username, p)
+	}
+
+	c.mu.Lock()
+	// Only keep the result if nothing changed while resolving it
+	if c.state == state && c.current() == state {
+		c.storeLocked(cleanPath, perm)
+	}
+	c.mu.Unlock()
+	return perm
+}
+
+// ResolveChildren returns the permissions of the cache's user on entries of
+// a directory, as Authorizer.ResolveChildren does. The results are also
+// cached, up to the cache's capacity, so that per-entry checks which usually
+// follow a listing don't resolve the entries again.
+func (c *PermissionCache) ResolveChildren(dir Path, names []string) []Permission {
+	cleanDir := dir.String()
+	state := c.current()
+
+	c.mu.Lock()
+	if c.state != state {
+		c.resetLocked(state)
+	}
+	c.mu.Unlock()
+
+	perms := c.authorizer.ResolveChildren(c.username, cleanDir, names)
+
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	// Only keep the results if nothing changed while resolving them
+	if c.state == state && c.current() == state {
+		for i := 0; i < len(names) && i < c.capacity; i++ {
+			c.storeLocked(path.Join(cleanDir, names[i]), perms[i])
+		}
+	}
+	return perms
+}
+
+// CanRead checks if the cache's user has read permission for a path
+func (c *PermissionCache) CanRead(p Path) bool {
+	return c.ResolvePermission(p).CanRead()
+}
+
+// CanWrite checks if the cache's user has write permission for a path
+func (c *PermissionCache) CanWrite(p Path) bool {
+	return c.ResolvePermission(p).CanWrite()
+}
+
+// current returns the state results resolved now are tagged with
+func (c *PermissionCache) current() cacheState {
+	return cacheState{generation: c.authorizer.Generation(), epoch: c.authorizer.userEpoch(c.username)}
+}
+
+// resetLocked drops every entry and adopts a new state
+func (c *PermissionCache) resetLocked(state cacheState) {
+	for k := range c.entries {
+		delete(c.entries, k)
+	}
+	c.order = c.order[:0]
+	c.next = 0
+	c.state = state
+}
+
+// storeLocked inserts an entry, evicting the oldest one if the cache is full
+func (c *PermissionCache) storeLocked(cleanPath string, perm Permission) {
+	if _, ok := c.entries[cleanPath]; ok {
+		c.entries[cleanPath] = perm
+		return
+	}
+	if len(c.order) < c.capacity {
+		c.order = append(c.order, cleanPath)
+	} else {
+		delete(c.entries, c.order[c.next])
+		c.order[c.next] = cleanPath
+		c.next = (c.next + 1) % c.capacity
+	}
+	c.entries[cleanPath] = perm
+}
@@ -0,0 +1,138 @@
+package authorization
+
+import (
+	"testing"
+	"time"
+
+	"github.com/mmcdole/viking-ftpd/pkg/users"
+)
+
+// switchingAccessSource serves trees[index], letting tests change what a reload sees
+type switchingAccessSource struct {
+	trees []map[string]interface{}
+	index int
+}
+
+func (s *switchingAccessSource) LoadAccessData() (map[string]interface{}, error) {
+	return s.trees[s.index], nil
+}
+
+func TestPermissionCache(t *testing.T) {
+	source := newMockUserSource()
+	source.addUser("user", users.WIZARD)
+
+	restricted := coreTree()
+	opened := coreTree()
+	opened["access_map"].(map[string]interface{})["user"].(map[string]interface{})["private"] = Write
+
+	access := &switchingAccessSource{trees: []map[string]interface{}{restricted, opened}}
+	auth := NewAuthorizer(access, source, time.Hour)
+	stats := &CacheStats{}
+	cache := NewPermissionCache(auth, "user", 2, stats)
+
+	t.Run("memoizes results", func(t *testing.T) {
+		if got := cache.ResolvePermission(CleanPath("/private")); got != Revoked {
+			t.Fatalf("ResolvePermission(/private) = %v, want %v", got, Revoked)
+		}
+		if got := cache.ResolvePermission(CleanPath("/private/")); got != Revoked {
+			t.Fatalf("ResolvePermission(/private/) = %v, want %v", got, Revoked)
+		}
+		if stats.Hits() != 1 || stats.Misses() != 1 {
+			t.Errorf("hits/misses = %d/%d, want 1/1", stats.Hits(), stats.Misses())
+		}
+	})
+
+	t.Run("bounded size", func(t *testing.T) {
+		cache.ResolvePermission(CleanPath("/public"))
+		cache.ResolvePermission(CleanPath("/special"))
+		if len(cache.entries) != 2 {
+			t.Errorf("cache holds %d entries, want 2", len(cache.entries))
+		}
+		if _, ok := cache.entries["/private"]; ok {
+			t.Error("oldest entry was not evicted")
+		}
+	})
+
+	t.Run("new generation invalidates", func(t *testing.T) {
+		access.index = 1
+		if err := auth.refreshCache(); err != nil {
+			t.Fatalf("Failed to refresh cache: %v", err)
+		}
+		if got := cache.ResolvePermission(CleanPath("/private")); got != Write {
+			t.Errorf("ResolvePermission(/private) after reload = %v, want %v", got, Write)
+		}
+		if cache.state.generation != auth.Generation() {
+			t.Errorf("cache generation = %d, want %d", cache.state.generation, auth.Generation())
+		}
+	})
+}
+
+func TestPermissionCache_LevelChange(t *testing.T) {
+	source := newMockUserSource()
+	source.addUser("climber", users.WIZARD)
+	source.addUser("other", users.WIZARD)
+	auth := NewAuthorizer(newMockAccessSource(productionTree()), source, time.Hour)
+	cache := NewPermissionCache(auth, "climber", 16, nil)
+	otherCache := NewPermissionCache(auth, "other", 16, nil)
+
+	if got := cache.ResolvePermission(CleanPath("/")); got != Read {
+		t.Fatalf("ResolvePermission(/) = %v, want %v", got, Read)
+	}
+	if got := cache.ResolveChildren(CleanPath("/"), []string{"log"}); got[0] != Read {
+		t.Fatalf("ResolveChildren(/, log) = %v, want %v", got[0], Read)
+	}
+	otherCache.ResolvePermission(CleanPath("/"))
+
+	// The character is promoted in the middle of the session, and its file
+	// change is reported
+	source.addUser("climber", users.ARCHWIZARD)
+	auth.InvalidateUser("climber")
+
+	if got := cache.ResolvePermission(CleanPath("/")); got != GrantGrant {
+		t.Errorf("ResolvePermission(/) after promotion = %v, want %v", got, GrantGrant)
+	}
+	if got := cache.ResolvePermission(CleanPath("/log")); got != GrantGrant {
+		t.Errorf("ResolvePermission(/log) after promotion = %v, want %v", got, GrantGrant)
+	}
+	if got := cache.ResolveChildren(CleanPath("/"), []string{"log"}); got[0] != GrantGrant {
+		t.Errorf("ResolveChildren(/, log) after promotion = %v, want %v", got[0], GrantGrant)
+	}
+
+	// Other users' caches survive
+	if len(otherCache.entries) != 1 {
+		t.Fatal("other user's cache lost its entry before use")
+	}
+	otherCache.ResolvePermission(CleanPath("/"))
+	if len(otherCache.entries) != 1 || otherCache.state.epoch != auth.userEpoch("other") {
+		t.Error("other user's cache was dropped")
+	}
+
+	// Forgetting every level drops every cache
+	auth.InvalidateUser("")
+	otherCache.ResolvePermission(CleanPath("/log"))
+	if _, ok := otherCache.entries["/"]; ok {
+		t.Error("cache kept entries after every level was forgotten")
+	}
+}
+
+func TestPermissionCache_ResolveChildren(t *testing.T) {
+	auth := NewAuthorizer(newMockAccessSource(coreTree()), newMockUserSource(), time.Hour)
+	stats := &CacheStats{}
+	cache := NewPermissionCache(auth, "user", 2, stats)
+
+	perms := cache.ResolveChildren(RootPath, []string{"public", "override", "private"})
+	want := []Permission{Read, Write, Revoked}
+	for i := range want {
+		if perms[i] != want[i] {
+			t.Errorf("entry %d: got %v, want %v", i, perms[i], want[i])
+		}
+	}
+
+	// Entries up to the cache's capacity are answered without resolving again
+	if got := cache.ResolvePermission(CleanPath("/override")); got != Write {
+		t.Errorf("ResolvePermission(/override) = %v, want Write", got)
+	}
+	if stats.Hits() != 1 || stats.Misses() != 0 {
+		t.Errorf("hits=%d misses=%d, want 1 and 0", stats.Hits(), stats.Misses())
+	}
+}
@@ -0,0 +1,259 @@
+package authorization
+
+import (
+	"errors"
+	"sync"
+	"sync/atomic"
+	"testing"
+	"time"
+
+	"github.com/mmcdole/viking-ftpd/pkg/metrics"
+	"github.com/mmcdole/viking-ftpd/pkg/users"
+)
+
+// countingAccessSource counts loads and can be made to fail or block
+type countingAccessSource struct {
+	tree    map[string]interface{}
+	loads   atomic.Int32
+	fail    atomic.Bool
+	release chan struct{} // if non-nil, loads block until it is closed
+}
+
+func (s *countingAccessSource) LoadAccessData() (map[string]interface{}, error) {
+	s.loads.Add(1)
+	if s.release != nil {
+		<-s.release
+	}
+	if s.fail.Load() {
+		return nil, errors.New("access.o unavailable")
+	}
+	return s.tree, nil
+}
+
+func TestRefreshSingleFlight(t *testing.T) {
+	source := newMockUserSource()
+	source.addUser("wizard1", users.WIZARD)
+
+	access := &countingAccessSource{tree: productionTree(), release: make(chan struct{})}
+	auth := NewAuthorizer(access, source, time.Hour)
+
+	var wg sync.WaitGroup
+	for i := 0; i < 16; i++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			if got := auth.ResolvePermission("wizard1", "/d/MyRealm"); got != Write {
+				t.Errorf("ResolvePermission = %v, want %v", got, Write)
+			}
+		}()
+	}
+
+	// Let the waiting requests pile up behind the first load
+	time.Sleep(50 * time.Millisecond)
+	close(access.release)
+	wg.Wait()
+
+	if n := access.loads.Load(); n != 1 {
+		t.Errorf("access source loaded %d times, want 1", n)
+	}
+}
+
+func TestRefreshFailureKeepsLastGoodTrees(t *testing.T) {
+	source := newMockUserSource()
+	source.addUser("wizard1", users.WIZARD)
+
+	access := &countingAccessSource{tree: productionTree()}
+	auth := NewAuthorizer(access, source, 10*time.Millisecond)
+
+	if got := auth.ResolvePermission("wizard1", "/d/MyRealm"); got != Write {
+		t.Fatalf("ResolvePermission = %v, want %v", got, Write)
+	}
+	generation := auth.Generation()
+
+	access.fail.Store(true)
+	time.Sleep(20 * time.Millisecond)
+
+	if got := auth.ResolvePermission("wizard1", "/d/MyRealm"); got != Write {
+		t.Errorf("ResolvePermission after failed reload = %v, want %v", got, Write)
+	}
+	if auth.Generation() != generation {
+		t.Errorf("generation changed to %d after failed reload, want %d", auth.Generation(), generation)
+	}
+
+	// The failed attempt is not retried until the TTL passes again
+	loads := access.loads.Load()
+	auth.ResolvePermission("wizard1", "/d/MyRealm")
+	if n := access.loads.Load(); n != loads {
+		t.Errorf("failed reload retried immediately (%d loads, want %d)", n, loads)
+	}
+}
+
+func TestRefreshFailureWithoutTrees(t *testing.T) {
+	access := &countingAccessSource{tree: productionTree()}
+	access.fail.Store(true)
+	auth := NewAuthorizer(access, newMockUserSource(), time.Hour)
+
+	if got := auth.ResolvePermission("anonymous", "/"); got != Revoked {
+		t.Errorf("ResolvePermission without any trees = %v, want %v", got, Revoked)
+	}
+}
+
+func TestBackgroundRefresh(t *testing.T) {
+	source := newMockUserSource()
+	source.addUser("wizard1", users.WIZARD)
+
+	access := &countingAccessSource{tree: productionTree()}
+	auth := NewAuthorizer(access, source, 10*time.Millisecond)
+	auth.SetRefreshMode(RefreshBackground)
+
+	// The first load is always synchronous
+	if got := auth.ResolvePermission("wizard1", "/d/MyRealm"); got != Write {
+		t.Fatalf("ResolvePermission = %v, want %v", got, Write)
+	}
+	generation := auth.Generation()
+
+	// Once expired, requests are served from the stale trees while one
+	// reload runs in the background
+	access.release = make(chan struct{})
+	time.Sleep(20 * time.Millisecond)
+	for i := 0; i < 10; i++ {
+		if got := auth.ResolvePermission("wizard1", "/d/MyRealm"); got != Write {
+			t.Fatalf("ResolvePermission during background reload = %v, want %v", got, Write)
+		}
+	}
+	if auth.Generation() != generation {
+		t.Fatalf("generation changed before the background reload finished")
+	}
+	close(access.release)
+
+	deadline := time.Now().Add(time.Second)
+	for auth.Generation() == generation {
+		if time.Now().After(deadline) {
+			t.Fatal("background reload did not publish new trees")
+		}
+		time.Sleep(time.Millisecond)
+	}
+	if n := access.loads.Load(); n != 2 {
+		t.Errorf("access source loaded %d times, want 2", n)
+	}
+}
+
+func TestParseRefreshMode(t *testing.T) {
+	tests := []struct {
+		input   string
+		want    RefreshMode
+		wantErr bool
+	}{
+		{"", RefreshInline, false},
+		{"inline", RefreshInline, false},
+		{"background", RefreshBackground, false},
+		{"sometimes", RefreshInline, true},
+	}
+	for _, tt := range tests {
+		got, err := ParseRefreshMode(tt.input)
+		if (err != nil) != tt.wantErr || got != tt.want {
+			t.Errorf("ParseRefreshMode(%q) = %v, %v; want %v, error %v", tt.input, got, err, tt.want, tt.wantErr)
+		}
+	}
+}
+
+// detectingAccessSource is a countingAccessSource that reports changes on demand
+type detectingAccessSource struct {
+	countingAccessSource
+	changed atomic.Bool
+}
+
+func (s *detectingAccessSource) Changed() bool {
+	return s.changed.Load()
+}
+
+func TestRefreshChangeDetection(t *testing.T) {
+	source := newMockUserSource()
+	source.addUser("wizard1", users.WIZARD)
+
+	access := &detectingAccessSource{countingAccessSource: countingAccessSource{tree: productionTree()}}
+	auth := NewAuthorizer(access, source, 10*time.Millisecond)
+	auth.SetChangeDetection(true)
+
+	auth.ResolvePermission("wizard1", "/d/MyRealm")
+	time.Sleep(20 * time.Millisecond)
+	auth.ResolvePermission("wizard1", "/d/MyRealm")
+	if n := access.loads.Load(); n != 1 {
+		t.Errorf("unchanged source loaded %d times after TTL expiry, want 1", n)
+	}
+
+	access.changed.Store(true)
+	time.Sleep(20 * time.Millisecond)
+	auth.ResolvePermission("wizard1", "/d/MyRealm")
+	if n := access.loads.Load(); n != 2 {
+		t.Errorf("changed source loaded %d times after TTL expiry, want 2", n)
+	}
+}
+
+func TestInvalidate(t *testing.T) {
+	source := newMockUserSource()
+	source.addUser("wizard1", users.WIZARD)
+
+	access := &detectingAccessSource{countingAccessSource: countingAccessSource{tree: productionTree()}}
+	auth := NewAuthorizer(access, source, time.Hour)
+	auth.SetChangeDetection(true)
+
+	generation := auth.Generation()
+	auth.Invalidate()
+
+	// The reload happens in the background, well before the TTL
+	deadline := time.Now().Add(time.Second)
+	for auth.Generation() == generation {
+		if time.Now().After(deadline) {
+			t.Fatal("Invalidate did not reload the access trees")
+		}
+		time.Sleep(time.Millisecond)
+	}
+}
+
+func TestRefreshMetrics(t *testing.T) {
+	access := &countingAccessSource{tree: productionTree()}
+	auth := NewAuthorizer(access, newMockUserSource(), time.Hour)
+	auth.SetMetrics(metrics.NewRegistry())
+
+	if err := auth.refreshCache(); err != nil {
+		t.Fatalf("Failed to refresh cache: %v", err)
+	}
+	access.fail.Store(true)
+	if err := auth.refreshCache(); err == nil {
+		t.Fatal("refreshCache succeeded with a failing source")
+	}
+
+	if got := auth.reloadDuration.Count(); got != 1 {
+		t.Errorf("reload duration observed %d times, want 1", got)
+	}
+	if got := auth.reloadFailures.Value(); got != 1 {
+		t.Errorf("reload failures = %d, want 1", got)
+	}
+	// The mock source cannot report the size of what it loaded
+	if got := auth.reloadSize.Count(); got != 0 {
+		t.Errorf("reload size observed %d times, want 0", got)
+	}
+}
+
+func TestLoadedDoesNotReload(t *testing.T) {
+	access := &countingAccessSource{tree: productionTree()}
+	auth := NewAuthorizer(access, newMockUserSource(), 10*time.Millisecond)
+
+	if generation, loadedAt := auth.Loaded(); generation != 0 || !loadedAt.IsZero() {
+		t.Errorf("Loaded before any load = %d, %v; want 0 and the zero time", generation, loadedAt)
+	}
+
+	before := time.Now()
+	generation := auth.Generation()
+	time.Sleep(20 * time.Millisecond)
+
+	loads := access.loads.Load()
+	got, loadedAt := auth.Loaded()
+	if got != generation || loadedAt.Before(before) {
+		t.Errorf("Loaded = %d, %v; want %d, after %v", got, loadedAt, generation, before)
+	}
+	if n := access.loads.Load(); n != loads {
+		t.Errorf("Loaded reloaded the expired trees (%d loads, want %d)", n, loads)
+	}
+}
@@ -0,0 +1,417 @@
+package authorization
+
+import (
+	"runtime"
+	"sort"
+	"time"
+
+	"github.com/mmcdole/viking-ftpd/pkg/users"
+)
+
+// snapshot is an immutable, compiled form of the access trees returned by
+// BuildAccessTrees. Path segments are interned to small integers and every
+// node of every tree lives in one flat slice, so resolving a permission is a
+// series of slice lookups with no locking and no allocation. A snapshot is
+// never modified after it is published; a refresh builds a new one.
+type snapshot struct {
+	segments map[string]int32 // interned path segment -> segment id
+	names    []string         // segment id -> interned path segment
+	nodes    []compiledNode
+	edges    []compiledEdge // child edges, contiguous per node and sorted by segment id
+
+	roots    map[string]int32 // tree name -> root node index
+	chains   map[string]*userChains
+	fallback userChains // chains of users without a tree of their own
+	groups   map[string][]string
+
+	defaultRoot    int32 // root of the "*" tree, or -1
+	archFullRoot   int32 // root of the Arch_full tree, or -1
+	archJuniorRoot int32 // root of the Arch_junior tree, or -1
+	generation     uint64
+	loadedAt       time.Time
+
+	backing *mappedFile // the snapshot file nodes and edges point into, if any
+}
+
+// compiledNode is the flattened form of an AccessNode. Its fields are all
+// int32, so nodes and edges can be used in place from a snapshot file.
+type compiledNode struct {
+	dot       int32 // a Permission
+	star      int32 // a Permission
+	firstEdge int32
+	edgeCount int32
+}
+
+// compiledEdge links a node to the child reached by one path segment
+type compiledEdge struct {
+	segment int32
+	node    int32
+}
+
+// compileSnapshot flattens access trees into a snapshot
+func compileSnapshot(trees map[string]*AccessTree, generation uint64, loadedAt time.Time) *snapshot {
+	b := &snapshotBuilder{
+		snap: &snapshot{
+			segments:       make(map[string]int32),
+			roots:          make(map[string]int32, len(trees)),
+			groups:         make(map[string][]string, len(trees)),
+			defaultRoot:    -1,
+			archFullRoot:   -1,
+			archJuniorRoot: -1,
+			generation:     generation,
+			loadedAt:       loadedAt,
+		},
+	}
+
+	// Compile trees in a stable order so identical input yields identical layout
+	names := make([]string, 0, len(trees))
+	for name := range trees {
+		names = append(names, name)
+	}
+	sort.Strings(names)
+
+	for _, name := range names {
+		tree := trees[name]
+		var root *AccessNode
+		if tree != nil {
+			root = tree.Root
+			b.snap.groups[name] = tree.Groups
+		}
+		b.snap.roots[name] = b.addNode(root)
+	}
+
+	b.finish(names)
+	return b.snap
+}
+
+// finish resolves the special roots and the user chains of a snapshot whose
+// nodes, roots and groups are in place. names are the tree names, sorted.
+func (b *snapshotBuilder) finish(names []string) {
+	if root, ok := b.snap.roots["*"]; ok {
+		b.snap.defaultRoot = root
+	}
+	if root, ok := b.snap.roots[GroupArchFull]; ok {
+		b.snap.archFullRoot = root
+	}
+	if root, ok := b.snap.roots[GroupArchJunior]; ok {
+		b.snap.archJuniorRoot = root
+	}
+
+	// Resolve every user's chain of trees ahead of time, once per implicit
+	// group, so permission checks only pick one
+	b.snap.chains = make(map[string]*userChains, len(names))
+	for _, name := range names {
+		b.snap.chains[name] = b.userChains(name, b.snap.groups[name])
+	}
+	b.snap.fallback = *b.userChains("", nil)
+}
+
+// implicitGroup is the implicit group a character's level entitles it to
+type implicitGroup uint8
+
+const (
+	implicitNone implicitGroup = iota
+	implicitArchJunior
+	implicitArchFull // also entitles to Arch_junior if there is no Arch_full tree
+	implicitGroups   // number of implicit groups
+)
+
+// implicitGroupForLevel returns the implicit group of a character level.
+// Archwizards and above are full arches; junior arches are too, except
+// elders.
+func implicitGroupForLevel(level int) implicitGroup {
+	switch {
+	case level >= users.ARCHWIZARD:
+		return implicitArchFull
+	case level >= users.JUNIOR_ARCH && level != users.ELDER:
+		return implicitArchJunior
+	default:
+		return implicitNone
+	}
+}
+
+// userChains holds a user's effective chain of trees for each implicit
+// group: the user's own tree, its explicit groups, the implicit group, then
+// the "*" tree, in the order ResolvePermission consults them. groups holds
+// the matching group names returned by ResolveGroups. The first explicit
+// roots are the same in every chain, so the implicit group only needs to be
+// known once they have all been consulted.
+type userChains struct {
+	roots    [implicitGroups][]int32
+	groups   [implicitGroups][]string
+	explicit int
+}
+
+// userChains builds the chains of the user named name, or of a user without
+// a tree if name is empty. Groups that are listed more than once, or only
+// name a missing tree, are consulted once.
+func (b *snapshotBuilder) userChains(name string, explicit []string) *userChains {
+	var base []int32
+	if name != "" {
+		base = append(base, b.snap.roots[name])
+	}
+	groups := make([]string, 0, len(explicit)+1)
+	for _, group := range explicit {
+		if containsString(groups, group) {
+			continue
+		}
+		groups = append(groups, group)
+		if root, ok := b.snap.roots[group]; ok && !containsRoot(base, root) {
+			base = append(base, root)
+		}
+	}
+
+	c := &userChains{explicit: len(base)}
+	for kind := implicitNone; kind < implicitGroups; kind++ {
+		group, root := b.snap.implicitRoot(kind)
+		if kind > implicitNone {
+			// Implicit groups without a tree of their own share a chain
+			if _, prev := b.snap.implicitRoot(kind - 1); prev == root {
+				c.roots[kind], c.groups[kind] = c.roots[kind-1], c.groups[kind-1]
+				continue
+			}
+		}
+		chain := append(make([]int32, 0, len(base)+2), base...)
+		names := groups
+		if root >= 0 {
+			if !containsRoot(chain, root) {
+				chain = append(chain, root)
+			}
+			if !containsString(names, group) {
+				names = append(names[:len(names):len(names)], group)
+			}
+		}
+		if b.snap.defaultRoot >= 0 && !containsRoot(chain, b.snap.defaultRoot) {
+			chain = append(chain, b.snap.defaultRoot)
+		}
+		c.roots[kind] = chain
+		c.groups[kind] = names[:len(names):len(names)]
+	}
+	return c
+}
+
+// implicitRoot returns the name and root of the tree an implicit group
+// grants, or -1 if the access map defines none for it
+func (s *snapshot) implicitRoot(kind implicitGroup) (string, int32) {
+	if kind == implicitArchFull && s.archFullRoot >= 0 {
+		return GroupArchFull, s.archFullRoot
+	}
+	if kind != implicitNone && s.archJuniorRoot >= 0 {
+		return GroupArchJunior, s.archJuniorRoot
+	}
+	return "", -1
+}
+
+// hasImplicitTrees reports whether any implicit group has a tree, and so
+// whether a user's level matters at all
+func (s *snapshot) hasImplicitTrees() bool {
+	return s.archFullRoot >= 0 || s.archJuniorRoot >= 0
+}
+
+// userChainsOf returns the effective chains of username
+func (s *snapshot) userChainsOf(username string) *userChains {
+	if c, ok := s.chains[username]; ok {
+		return c
+	}
+	return &s.fallback
+}
+
+func containsRoot(roots []int32, root int32) bool {
+	for _, r := range roots {
+		if r == root {
+			return true
+		}
+	}
+	return false
+}
+
+func containsString(list []string, s string) bool {
+	for _, v := range list {
+		if v == s {
+			return true
+		}
+	}
+	return false
+}
+
+// snapshotBuilder holds the intermediate state used while compiling a snapshot
+type snapshotBuilder struct {
+	snap *snapshot
+}
+
+// intern returns the id for a path segment, assigning one if needed
+func (b *snapshotBuilder) intern(segment string) int32 {
+	if id, ok := b.snap.segments[segment]; ok {
+		return id
+	}
+	id := int32(len(b.snap.names))
+	b.snap.names = append(b.snap.names, segment)
+	b.snap.segments[segment] = id
+	return id
+}
+
+// addNode appends a node and, recursively, its children to the snapshot
+func (b *snapshotBuilder) addNode(node *AccessNode) int32 {
+	idx := int32(len(b.snap.nodes))
+	if node == nil {
+		b.snap.nodes = append(b.snap.nodes, compiledNode{dot: int32(Revoked), star: int32(Revoked)})
+		return idx
+	}
+	b.snap.nodes = append(b.snap.nodes, compiledNode{dot: int32(node.DotAccess), star: int32(node.StarAccess)})
+	if len(node.Children) == 0 {
+		return idx
+	}
+
+	// Reserve a contiguous block of edges for this node's children
+	first := int32(len(b.snap.edges))
+	for name := range node.Children {
+		b.snap.edges = append(b.snap.edges, compiledEdge{segment: b.intern(name)})
+	}
+	block := b.snap.edges[first:]
+	sort.Slice(block, func(i, j int) bool {
+		return block[i].segment < block[j].segment
+	})
+	b.snap.nodes[idx].firstEdge = first
+	b.snap.nodes[idx].edgeCount = int32(len(block))
+
+	// Children are appended after the block; index edges by position since
+	// the edge slice may grow while recursing
+	for i := int32(0); i < int32(len(block)); i++ {
+		segment := b.snap.edges[first+i].segment
+		child := b.addNode(node.Children[b.snap.names[segment]])
+		b.snap.edges[first+i].node = child
+	}
+	return idx
+}
+
+// child returns the index of the child of node reached by segment, or -1
+func (s *snapshot) child(node compiledNode, segment int32) int32 {
+	lo, hi := node.firstEdge, node.firstEdge+node.edgeCount
+	for lo < hi {
+		mid := int32(uint32(lo+hi) >> 1)
+		switch e := s.edges[mid]; {
+		case e.segment == segment:
+			return e.node
+		case e.segment < segment:
+			lo = mid + 1
+		default:
+			hi = mid
+		}
+	}
+	return -1
+}
+
+// The nodes and edges of a snapshot loaded from a file may live in memory
+// mapped outside the Go heap, which only the snapshot keeps mapped. Walkers
+// therefore copy nodes out by value and keep the snapshot alive until their
+// last read, so the mapping can't be finalized under them.
+
+// resolve walks the tree rooted at root along a cleaned path.
+// It mirrors the inheritance rules of the access tree: an exact child match is
+// followed (and is final even if it yields Revoked), otherwise the star access
+// of the deepest matched node applies. At the target node, dot access
+// overrides star access.
+func (s *snapshot) resolve(root int32, cleanPath string) Permission {
+	defer runtime.KeepAlive(s)
+	node := s.nodes[root]
+	segments := newPathSegments(cleanPath)
+	for {
+		part, ok := segments.next()
+		if !ok {
+			break
+		}
+		id, ok := s.segments[part]
+		if !ok {
+			return Permission(node.star)
+		}
+		child := s.child(node, id)
+		if child < 0 {
+			return Permission(node.star)
+		}
+		node = s.nodes[child]
+	}
+
+	if Permission(node.dot) != Revoked {
+		return Permission(node.dot)
+	}
+	return Permission(node.star)
+}
+
+// childResolver is one tree walked down to a directory. The permission of
+// any entry of the directory follows from it with a single child lookup.
+type childResolver struct {
+	node  int32      // the directory's node, or -1 if the walk left the tree
+	fixed Permission // permission of every entry when node is -1
+}
+
+// walkDir walks the tree rooted at root to a cleaned directory path
+func (s *snapshot) walkDir(root int32, cleanDir string) childResolver {
+	defer runtime.KeepAlive(s)
+	node := root
+	segments := newPathSegments(cleanDir)
+	for {
+		part, ok := segments.next()
+		if !ok {
+			return childResolver{node: node}
+		}
+		id, ok := s.segments[part]
+		if !ok {
+			return childResolver{node: -1, fixed: Permission(s.nodes[node].star)}
+		}
+		child := s.child(s.nodes[node], id)
+		if child < 0 {
+			return childResolver{node: -1, fixed: Permission(s.nodes[node].star)}
+		}
+		node = child
+	}
+}
+
+// resolveChild returns what resolve would for the directory entry whose
+// interned segment is id; known is false if the name was never interned
+func (s *snapshot) resolveChild(r childResolver, id int32, known bool) Permission {
+	if r.node < 0 {
+		return r.fixed
+	}
+	defer runtime.KeepAlive(s)
+	node := s.nodes[r.node]
+	if known {
+		if child := s.child(node, id); child >= 0 {
+			node = s.nodes[child]
+			if Permission(node.dot) != Revoked {
+				return Permission(node.dot)
+			}
+		}
+	}
+	return Permission(node.star)
+}
+
+// pathSegments iterates over the "/"-separated segments of a cleaned path
+// without allocating. A leading "/" is ignored and the root path yields no
+// segments.
+type pathSegments struct {
+	s   string
+	pos int
+}
+
+func newPathSegments(cleanPath string) pathSegments {
+	if len(cleanPath) > 0 && cleanPath[0] == '/' {
+		cleanPath = cleanPath[1:]
+	}
+	return pathSegments{s: cleanPath}
+}
+
+// next returns the next segment, or false when the path is exhausted
+func (p *pathSegments) next() (string, bool) {
+	if p.pos >= len(p.s) {
+		return "", false
+	}
+	rest := p.s[p.pos:]
+	for i := 0; i < len(rest); i++ {
+		if rest[i] == '/' {
+			p.pos += i + 1
+			return rest[:i], true
+		}
+	}
+	p.pos = len(p.s)
+	return rest, true
+}
@@ -0,0 +1,321 @@
+package authorization
+
+import (
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"hash/crc32"
+	"os"
+	"path/filepath"
+	"runtime"
+	"sort"
+	"time"
+	"unsafe"
+)
+
+// A snapshot file holds a compiled snapshot, so that a restart, or another
+// instance on the same host, can serve permission checks without parsing
+// access.o again. It is only used while the access file it was compiled from
+// is unchanged. All integers are little-endian:
+//
+//	header   magic, version, key of the access file, counts and a checksum
+//	nodes    nodeCount compiledNodes of four int32s
+//	edges    edgeCount compiledEdges of two int32s
+//	segments segmentCount strings, in segment id order
+//	trees    treeCount of: name, root int32, group count int32 (-1 for a
+//	         nil tree), group names
+//
+// Strings are a uint32 length followed by the bytes. The node and edge
+// arrays start 8-byte aligned, and on little-endian hosts a mapped file's
+// arrays are used in place: instances sharing a snapshot file share one
+// copy of them in the page cache.
+const (
+	snapshotMagic      = "VKACSNAP"
+	snapshotVersion    = 1
+	snapshotHeaderSize = 88
+	nodeSize           = int(unsafe.Sizeof(compiledNode{}))
+	edgeSize           = int(unsafe.Sizeof(compiledEdge{}))
+)
+
+// The in-place use of mapped arrays depends on their exact layout
+var (
+	_ [16 - nodeSize]struct{}
+	_ [nodeSize - 16]struct{}
+	_ [8 - edgeSize]struct{}
+	_ [edgeSize - 8]struct{}
+)
+
+// errSnapshotStale is returned for a snapshot file compiled from another
+// version of the access file, or by another version of the format
+var errSnapshotStale = errors.New("snapshot is stale")
+
+// crcTable is used for the checksum of everything after the header
+var crcTable = crc32.MakeTable(crc32.Castagnoli)
+
+// snapshotKey identifies the version of the access file a snapshot was
+// compiled from
+type snapshotKey struct {
+	modTime int64 // Unix nanoseconds
+	size    int64
+	sum     [32]byte // SHA-256 of the contents
+}
+
+// littleEndian reports whether the host stores integers the way snapshot
+// files do
+var littleEndian = binary.NativeEndian.Uint16([]byte{1, 0}) == 1
+
+// readSnapshotFile loads the snapshot in the file at path, if it was
+// compiled from the access file version key
+func readSnapshotFile(path string, key snapshotKey, generation uint64) (*snapshot, error) {
+	m, err := mapFile(path)
+	if err != nil {
+		return nil, err
+	}
+	snap, inPlace, err := decodeSnapshot(m.data, key, generation, time.Now())
+	if err != nil || !inPlace {
+		m.close()
+		return snap, err
+	}
+	// The snapshot's nodes and edges point into the mapping, which must
+	// outlive it
+	snap.backing = m
+	runtime.SetFinalizer(m, (*mappedFile).close)
+	return snap, nil
+}
+
+// writeSnapshotFile saves snap to the file at path, replacing it atomically
+// so that instances reading it never see a partial file
+func writeSnapshotFile(path string, key snapshotKey, snap *snapshot) error {
+	f, err := os.CreateTemp(filepath.Dir(path), filepath.Base(path)+".tmp*")
+	if err != nil {
+		return err
+	}
+	_, err = f.Write(encodeSnapshot(key, snap))
+	if closeErr := f.Close(); err == nil {
+		err = closeErr
+	}
+	if err == nil {
+		err = os.Chmod(f.Name(), 0644)
+	}
+	if err == nil {
+		err = os.Rename(f.Name(), path)
+	}
+	if err != nil {
+		os.Remove(f.Name())
+	}
+	return err
+}
+
+// encodeSnapshot returns the snapshot file contents of snap
+func encodeSnapshot(key snapshotKey, snap *snapshot) []byte {
+	names := snap.names
+	trees := make([]string, 0, len(snap.roots))
+	for name := range snap.roots {
+		trees = append(trees, name)
+	}
+	sort.Strings(trees)
+
+	le := binary.LittleEndian
+	b := make([]byte, snapshotHeaderSize, snapshotHeaderSize+len(snap.nodes)*nodeSize+len(snap.edges)*edgeSize)
+	copy(b, snapshotMagic)
+	le.PutUint32(b[8:], snapshotVersion)
+	le.PutUint64(b[16:], uint64(key.modTime))
+	le.PutUint64(b[24:], uint64(key.size))
+	copy(b[32:64], key.sum[:])
+	le.PutUint32(b[64:], uint32(len(snap.nodes)))
+	le.PutUint32(b[68:], uint32(len(snap.edges)))
+	le.PutUint32(b[72:], uint32(len(names)))
+	le.PutUint32(b[76:], uint32(len(trees)))
+
+	for _, n := range snap.nodes {
+		b = le.AppendUint32(b, uint32(n.dot))
+		b = le.AppendUint32(b, uint32(n.star))
+		b = le.AppendUint32(b, uint32(n.firstEdge))
+		b = le.AppendUint32(b, uint32(n.edgeCount))
+	}
+	for _, e := range snap.edges {
+		b = le.AppendUint32(b, uint32(e.segment))
+		b = le.AppendUint32(b, uint32(e.node))
+	}
+	for _, name := range names {
+		b = appendSnapshotString(b, name)
+	}
+	for _, name := range trees {
+		b = appendSnapshotString(b, name)
+		b = le.AppendUint32(b, uint32(snap.roots[name]))
+		groups, ok := snap.groups[name]
+		if !ok {
+			b = le.AppendUint32(b, ^uint32(0))
+			continue
+		}
+		b = le.AppendUint32(b, uint32(len(groups)))
+		for _, group := range groups {
+			b = appendSnapshotString(b, group)
+		}
+	}
+
+	le.PutUint32(b[80:], crc32.Checksum(b[snapshotHeaderSize:], crcTable))
+	return b
+}
+
+func appendSnapshotString(b []byte, s string) []byte {
+	b = binary.LittleEndian.AppendUint32(b, uint32(len(s)))
+	return append(b, s...)
+}
+
+// decodeSnapshot parses and validates the contents of a snapshot file. The
+// result never indexes out of range, whatever data holds. inPlace reports
+// whether the nodes and edges alias data rather than a copy of it.
+func decodeSnapshot(data []byte, key snapshotKey, generation uint64, loadedAt time.Time) (snap *snapshot, inPlace bool, err error) {
+	le := binary.LittleEndian
+	if len(data) < snapshotHeaderSize || string(data[:8]) != snapshotMagic {
+		return nil, false, errors.New("not a snapshot file")
+	}
+	var fileKey snapshotKey
+	fileKey.modTime = int64(le.Uint64(data[16:]))
+	fileKey.size = int64(le.Uint64(data[24:]))
+	copy(fileKey.sum[:], data[32:64])
+	if le.Uint32(data[8:]) != snapshotVersion || fileKey != key {
+		return nil, false, errSnapshotStale
+	}
+	if crc32.Checksum(data[snapshotHeaderSize:], crcTable) != le.Uint32(data[80:]) {
+		return nil, false, errors.New("snapshot checksum mismatch")
+	}
+
+	nodeCount, edgeCount := int(le.Uint32(data[64:])), int(le.Uint32(data[68:]))
+	segmentCount, treeCount := int(le.Uint32(data[72:])), int(le.Uint32(data[76:]))
+	r := snapshotReader{data: data, pos: snapshotHeaderSize}
+	nodeData := r.bytes(nodeCount * nodeSize)
+	edgeData := r.bytes(edgeCount * edgeSize)
+	if r.err != nil {
+		return nil, false, r.err
+	}
+
+	snap = &snapshot{
+		segments:       make(map[string]int32, segmentCount),
+		roots:          make(map[string]int32, treeCount),
+		groups:         make(map[string][]string, treeCount),
+		defaultRoot:    -1,
+		archFullRoot:   -1,
+		archJuniorRoot: -1,
+		generation:     generation,
+		loadedAt:       loadedAt,
+	}
+	inPlace = littleEndian && uintptr(unsafe.Pointer(unsafe.SliceData(data)))%8 == 0
+	switch {
+	case inPlace:
+		if nodeCount > 0 {
+			snap.nodes = unsafe.Slice((*compiledNode)(unsafe.Pointer(&nodeData[0])), nodeCount)
+		}
+		if edgeCount > 0 {
+			snap.edges = unsafe.Slice((*compiledEdge)(unsafe.Pointer(&edgeData[0])), edgeCount)
+		}
+	default:
+		snap.nodes = make([]compiledNode, nodeCount)
+		for i := range snap.nodes {
+			n := nodeData[i*nodeSize:]
+			snap.nodes[i] = compiledNode{
+				dot:       int32(le.Uint32(n)),
+				star:      int32(le.Uint32(n[4:])),
+				firstEdge: int32(le.Uint32(n[8:])),
+				edgeCount: int32(le.Uint32(n[12:])),
+			}
+		}
+		snap.edges = make([]compiledEdge, edgeCount)
+		for i := range snap.edges {
+			e := edgeData[i*edgeSize:]
+			snap.edges[i] = compiledEdge{segment: int32(le.Uint32(e)), node: int32(le.Uint32(e[4:]))}
+		}
+	}
+
+	snap.names = make([]string, 0, segmentCount)
+	for id := 0; id < segmentCount && r.err == nil; id++ {
+		name := r.string()
+		snap.names = append(snap.names, name)
+		snap.segments[name] = int32(id)
+	}
+	names := make([]string, 0, treeCount)
+	for i := 0; i < treeCount && r.err == nil; i++ {
+		name, root, groupCount := r.string(), r.int32(), r.int32()
+		if root < 0 || int(root) >= nodeCount {
+			return nil, false, fmt.Errorf("tree %q has root %d of %d nodes", name, root, nodeCount)
+		}
+		names = append(names, name)
+		snap.roots[name] = root
+		if groupCount < 0 {
+			continue
+		}
+		var groups []string
+		for j := int32(0); j < groupCount && r.err == nil; j++ {
+			groups = append(groups, r.string())
+		}
+		snap.groups[name] = groups
+	}
+	if r.err != nil {
+		return nil, false, r.err
+	}
+	if len(snap.segments) != segmentCount || len(snap.roots) != treeCount || !sort.StringsAreSorted(names) {
+		return nil, false, errors.New("snapshot has duplicate or unsorted names")
+	}
+	if err := snap.validate(); err != nil {
+		return nil, false, err
+	}
+
+	b := &snapshotBuilder{snap: snap}
+	b.finish(names)
+	return snap, inPlace, nil
+}
+
+// validate checks that every edge of the snapshot points at a node and an
+// interned segment, and that each node's edges are in range and sorted
+func (s *snapshot) validate() error {
+	for i, e := range s.edges {
+		if e.node < 0 || int(e.node) >= len(s.nodes) || e.segment < 0 || int(e.segment) >= len(s.segments) {
+			return fmt.Errorf("snapshot edge %d out of range", i)
+		}
+	}
+	for i, n := range s.nodes {
+		if n.firstEdge < 0 || n.edgeCount < 0 || int64(n.firstEdge)+int64(n.edgeCount) > int64(len(s.edges)) {
+			return fmt.Errorf("snapshot node %d has edges out of range", i)
+		}
+		for j := n.firstEdge + 1; j < n.firstEdge+n.edgeCount; j++ {
+			if s.edges[j-1].segment >= s.edges[j].segment {
+				return fmt.Errorf("snapshot node %d has unsorted edges", i)
+			}
+		}
+	}
+	return nil
+}
+
+// snapshotReader reads the variable-length part of a snapshot file,
+// remembering the first read past its end
+type snapshotReader struct {
+	data []byte
+	pos  int
+	err  error
+}
+
+func (r *snapshotReader) bytes(n int) []byte {
+	if r.err != nil {
+		return nil
+	}
+	if n < 0 || n > len(r.data)-r.pos {
+		r.err = errors.New("snapshot file is truncated")
+		return nil
+	}
+	b := r.data[r.pos : r.pos+n]
+	r.pos += n
+	return b
+}
+
+func (r *snapshotReader) int32() int32 {
+	b := r.bytes(4)
+	if b == nil {
+		return 0
+	}
+	return int32(binary.LittleEndian.Uint32(b))
+}
+
+func (r *snapshotReader) string() string {
+	return string(r.bytes(int(uint32(r.int32()))))
+}
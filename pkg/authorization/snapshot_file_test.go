@@ -0,0 +1,273 @@
+package authorization
+
+import (
+	"bytes"
+	"crypto/sha256"
+	"errors"
+	"os"
+	"path/filepath"
+	"reflect"
+	"testing"
+	"time"
+
+	"github.com/mmcdole/viking-ftpd/pkg/fixtures"
+	"github.com/mmcdole/viking-ftpd/pkg/users"
+)
+
+// assertSameSnapshot fails unless got resolves exactly like want
+func assertSameSnapshot(t *testing.T, got, want *snapshot) {
+	t.Helper()
+	if !reflect.DeepEqual(got.nodes, want.nodes) || !reflect.DeepEqual(got.edges, want.edges) {
+		t.Error("nodes or edges differ")
+	}
+	if !reflect.DeepEqual(got.segments, want.segments) || !reflect.DeepEqual(got.names, want.names) || !reflect.DeepEqual(got.roots, want.roots) {
+		t.Error("segments or roots differ")
+	}
+	if got.defaultRoot != want.defaultRoot || got.archFullRoot != want.archFullRoot || got.archJuniorRoot != want.archJuniorRoot {
+		t.Error("special roots differ")
+	}
+	if len(got.groups) != len(want.groups) {
+		t.Errorf("%d trees with groups, want %d", len(got.groups), len(want.groups))
+	}
+	for name, groups := range want.groups {
+		if g, ok := got.groups[name]; !ok || len(g) != len(groups) || (len(g) > 0 && !reflect.DeepEqual(g, groups)) {
+			t.Errorf("groups of %q = %v, want %v", name, g, groups)
+		}
+	}
+	for name, chains := range want.chains {
+		if !reflect.DeepEqual(got.chains[name].roots, chains.roots) {
+			t.Errorf("chains of %q differ", name)
+		}
+	}
+	if !reflect.DeepEqual(got.fallback.roots, want.fallback.roots) {
+		t.Error("fallback chains differ")
+	}
+}
+
+func TestSnapshotFileRoundTrip(t *testing.T) {
+	trees, err := BuildAccessTrees(productionTree())
+	if err != nil {
+		t.Fatalf("Failed to build trees: %v", err)
+	}
+	want := compileSnapshot(trees, 1, time.Now())
+	key := snapshotKey{modTime: 42, size: 7, sum: sha256.Sum256([]byte("access.o"))}
+	data := encodeSnapshot(key, want)
+
+	// Decoding in place and from a misaligned copy give the same snapshot
+	for _, aligned := range []bool{true, false} {
+		buf := data
+		if !aligned {
+			buf = append(make([]byte, 1, len(data)+1), data...)[1:]
+		}
+		got, inPlace, err := decodeSnapshot(buf, key, 3, time.Now())
+		if err != nil {
+			t.Fatalf("decodeSnapshot failed: %v", err)
+		}
+		if aligned && littleEndian && !inPlace {
+			t.Error("aligned snapshot was copied")
+		}
+		if !aligned && inPlace {
+			t.Error("misaligned snapshot was used in place")
+		}
+		if got.generation != 3 {
+			t.Errorf("generation = %d, want 3", got.generation)
+		}
+		assertSameSnapshot(t, got, want)
+	}
+
+	// A file written and mapped back resolves the same
+	path := filepath.Join(t.TempDir(), "access.snap")
+	if err := writeSnapshotFile(path, key, want); err != nil {
+		t.Fatalf("writeSnapshotFile failed: %v", err)
+	}
+	got, err := readSnapshotFile(path, key, 1)
+	if err != nil {
+		t.Fatalf("readSnapshotFile failed: %v", err)
+	}
+	assertSameSnapshot(t, got, want)
+	if perm := got.resolve(got.roots["*"], "/d/MyRealm"); perm != want.resolve(want.roots["*"], "/d/MyRealm") {
+		t.Errorf("resolve = %v, want %v", perm, want.resolve(want.roots["*"], "/d/MyRealm"))
+	}
+}
+
+func TestSnapshotFileRejected(t *testing.T) {
+	trees, err := BuildAccessTrees(productionTree())
+	if err != nil {
+		t.Fatalf("Failed to build trees: %v", err)
+	}
+	key := snapshotKey{modTime: 42, size: 7}
+	data := encodeSnapshot(key, compileSnapshot(trees, 1, time.Now()))
+
+	corrupt := func(off int) []byte {
+		b := append([]byte(nil), data...)
+		b[off] ^= 0xff
+		return b
+	}
+	tests := []struct {
+		name  string
+		data  []byte
+		key   snapshotKey
+		stale bool
+	}{
+		{"other access file", data, snapshotKey{modTime: 43, size: 7}, true},
+		{"other format version", corrupt(8), key, true},
+		{"not a snapshot", []byte("access_map ([])"), key, false},
+		{"truncated", data[:len(data)-3], key, false},
+		{"corrupted", corrupt(len(data) - 1), key, false},
+		{"corrupted node", corrupt(snapshotHeaderSize + 8), key, false},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			_, _, err := decodeSnapshot(tt.data, tt.key, 1, time.Now())
+			if err == nil {
+				t.Fatal("decodeSnapshot succeeded")
+			}
+			if stale := errors.Is(err, errSnapshotStale); stale != tt.stale {
+				t.Errorf("decodeSnapshot error %v, stale = %v, want %v", err, stale, tt.stale)
+			}
+		})
+	}
+}
+
+func TestSnapshotValidate(t *testing.T) {
+	trees, err := BuildAccessTrees(productionTree())
+	if err != nil {
+		t.Fatalf("Failed to build trees: %v", err)
+	}
+	fresh := func() *snapshot {
+		s := compileSnapshot(trees, 1, time.Now())
+		s.nodes = append([]compiledNode(nil), s.nodes...)
+		s.edges = append([]compiledEdge(nil), s.edges...)
+		return s
+	}
+	if err := fresh().validate(); err != nil {
+		t.Fatalf("compiled snapshot is invalid: %v", err)
+	}
+
+	// Checksums catch accidents; validation also catches a file that was
+	// written wrong
+	tests := map[string]func(s *snapshot){
+		"edge to missing node":    func(s *snapshot) { s.edges[0].node = int32(len(s.nodes)) },
+		"edge to missing segment": func(s *snapshot) { s.edges[0].segment = -1 },
+		"edges past the end":      func(s *snapshot) { s.nodes[0].edgeCount = int32(len(s.edges)) + 1 },
+		"unsorted edges": func(s *snapshot) {
+			for _, n := range s.nodes {
+				if n.edgeCount >= 2 {
+					s.edges[n.firstEdge], s.edges[n.firstEdge+1] = s.edges[n.firstEdge+1], s.edges[n.firstEdge]
+					return
+				}
+			}
+		},
+		"negative first edge": func(s *snapshot) { s.nodes[0].firstEdge = -1 },
+		"negative edge count": func(s *snapshot) { s.nodes[0].edgeCount = -1 },
+		"first edge out of range": func(s *snapshot) {
+			s.nodes[0].firstEdge, s.nodes[0].edgeCount = int32(len(s.edges)), 1
+		},
+		"edge to negative node id": func(s *snapshot) { s.edges[0].node = -1 },
+	}
+	for name, breakIt := range tests {
+		t.Run(name, func(t *testing.T) {
+			s := fresh()
+			breakIt(s)
+			if err := s.validate(); err == nil {
+				t.Error("validate succeeded")
+			}
+		})
+	}
+}
+
+func TestAccessFileSourceSnapshot(t *testing.T) {
+	dir := t.TempDir()
+	accessPath := filepath.Join(dir, "access.o")
+	snapPath := filepath.Join(dir, "access.snap")
+	if err := os.WriteFile(accessPath, fixtures.AccessFile(fixtures.DefaultConfig()), 0644); err != nil {
+		t.Fatalf("Failed to write access file: %v", err)
+	}
+	userSource := newMockUserSource()
+	userSource.addUser(fixtures.WizardName(0), users.WIZARD)
+
+	newAuthorizer := func() (*Authorizer, *AccessFileSource) {
+		source := NewAccessFileSource(accessPath)
+		source.SetSnapshotPath(snapPath)
+		return NewAuthorizer(source, userSource, time.Hour), source
+	}
+	plain := NewAuthorizer(NewAccessFileSource(accessPath), userSource, time.Hour)
+	paths := []string{"/", "/d", "/players/" + fixtures.WizardName(1), fixtures.DeepPath(fixtures.DefaultConfig(), 0)}
+
+	// The first load parses access.o and writes the snapshot
+	first, source := newAuthorizer()
+	for _, p := range paths {
+		if got, want := first.ResolvePermission(fixtures.WizardName(0), p), plain.ResolvePermission(fixtures.WizardName(0), p); got != want {
+			t.Errorf("ResolvePermission(%q) = %v, want %v", p, got, want)
+		}
+	}
+	if source.Changed() {
+		t.Error("Changed should be false right after a load")
+	}
+	written, err := os.Stat(snapPath)
+	if err != nil {
+		t.Fatalf("snapshot file not written: %v", err)
+	}
+
+	// A restart loads the snapshot as it is
+	second, source := newAuthorizer()
+	for _, p := range paths {
+		if got, want := second.ResolvePermission(fixtures.WizardName(0), p), plain.ResolvePermission(fixtures.WizardName(0), p); got != want {
+			t.Errorf("ResolvePermission(%q) from snapshot = %v, want %v", p, got, want)
+		}
+	}
+	if source.Changed() {
+		t.Error("Changed should be false after loading the snapshot")
+	}
+	if reread, err := os.Stat(snapPath); err != nil || !os.SameFile(reread, written) {
+		t.Error("snapshot file was rewritten although access.o is unchanged")
+	}
+	if snap, _ := second.ensureFreshCache(); littleEndian && snap.backing == nil {
+		t.Error("snapshot was not used in place")
+	}
+
+	// Changing access.o rebuilds the snapshot
+	if err := os.WriteFile(accessPath, []byte(testAccessFile), 0644); err != nil {
+		t.Fatalf("Failed to write access file: %v", err)
+	}
+	third, _ := newAuthorizer()
+	if got := third.ResolvePermission(fixtures.WizardName(0), "/"); got != Read {
+		t.Errorf("ResolvePermission after change = %v, want %v", got, Read)
+	}
+	if reread, err := os.Stat(snapPath); err != nil || os.SameFile(reread, written) {
+		t.Error("snapshot file was not rewritten after access.o changed")
+	}
+}
+
+func BenchmarkLoadSnapshot(b *testing.B) {
+	accessFile := fixtures.AccessFile(fixtures.DefaultConfig())
+	trees, err := DecodeAccessTrees(bytes.NewReader(accessFile))
+	if err != nil {
+		b.Fatal(err)
+	}
+	path := filepath.Join(b.TempDir(), "access.snap")
+	key := snapshotKey{sum: sha256.Sum256(accessFile)}
+	if err := writeSnapshotFile(path, key, compileSnapshot(trees, 1, time.Now())); err != nil {
+		b.Fatal(err)
+	}
+
+	b.Run("Parse", func(b *testing.B) {
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			trees, err := DecodeAccessTrees(bytes.NewReader(accessFile))
+			if err != nil {
+				b.Fatal(err)
+			}
+			compileSnapshot(trees, 1, time.Now())
+		}
+	})
+	b.Run("Snapshot", func(b *testing.B) {
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			sha256.Sum256(accessFile)
+			if _, err := readSnapshotFile(path, key, 1); err != nil {
+				b.Fatal(err)
+			}
+		}
+	})
+}
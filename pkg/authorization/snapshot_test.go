@@ -0,0 +1,187 @@
+package authorization
+
+import (
+	"bytes"
+	"reflect"
+	"sync"
+	"testing"
+	"time"
+
+	"github.com/mmcdole/viking-ftpd/pkg/fixtures"
+	"github.com/mmcdole/viking-ftpd/pkg/users"
+)
+
+func TestSnapshotPathSegments(t *testing.T) {
+	tests := []struct {
+		path string
+		want []string
+	}{
+		{"/", nil},
+		{".", []string{"."}},
+		{"/players", []string{"players"}},
+		{"/d/MyRealm/room.c", []string{"d", "MyRealm", "room.c"}},
+		{"relative/path", []string{"relative", "path"}},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.path, func(t *testing.T) {
+			var got []string
+			segments := newPathSegments(tt.path)
+			for {
+				part, ok := segments.next()
+				if !ok {
+					break
+				}
+				got = append(got, part)
+			}
+			if len(got) != len(tt.want) {
+				t.Fatalf("segments(%q) = %v, want %v", tt.path, got, tt.want)
+			}
+			for i := range got {
+				if got[i] != tt.want[i] {
+					t.Fatalf("segments(%q) = %v, want %v", tt.path, got, tt.want)
+				}
+			}
+		})
+	}
+}
+
+func TestSnapshotInternsSegments(t *testing.T) {
+	trees, err := BuildAccessTrees(productionTree())
+	if err != nil {
+		t.Fatalf("Failed to build trees: %v", err)
+	}
+	snap := compileSnapshot(trees, 1, time.Now())
+
+	// "*" appears as a child name in several trees but is interned once
+	seen := make(map[int32]string)
+	for name, id := range snap.segments {
+		if other, ok := seen[id]; ok {
+			t.Fatalf("segment id %d shared by %q and %q", id, name, other)
+		}
+		seen[id] = name
+	}
+	if snap.defaultRoot < 0 || snap.archFullRoot < 0 || snap.archJuniorRoot < 0 {
+		t.Errorf("expected default and arch roots to be resolved, got %d/%d/%d",
+			snap.defaultRoot, snap.archFullRoot, snap.archJuniorRoot)
+	}
+}
+
+func TestSnapshotUserChains(t *testing.T) {
+	trees := map[string]*AccessTree{
+		"*":           {Root: &AccessNode{}},
+		"Arch_junior": {Root: &AccessNode{}},
+		"Wiz_qc":      {Root: &AccessNode{}},
+		"drake":       {Root: &AccessNode{}, Groups: []string{"Wiz_qc", "Missing", "Wiz_qc", "Arch_junior"}},
+	}
+	snap := compileSnapshot(trees, 1, time.Now())
+	drake, qc, junior, def := snap.roots["drake"], snap.roots["Wiz_qc"], snap.roots["Arch_junior"], snap.defaultRoot
+
+	tests := []struct {
+		name       string
+		username   string
+		kind       implicitGroup
+		wantRoots  []int32
+		wantGroups []string
+	}{
+		{"explicit groups then default", "drake", implicitNone, []int32{drake, qc, junior, def}, []string{"Wiz_qc", "Missing", "Arch_junior"}},
+		{"implicit group already explicit", "drake", implicitArchJunior, []int32{drake, qc, junior, def}, []string{"Wiz_qc", "Missing", "Arch_junior"}},
+		{"full arch without Arch_full tree", "drake", implicitArchFull, []int32{drake, qc, junior, def}, []string{"Wiz_qc", "Missing", "Arch_junior"}},
+		{"no tree", "frodo", implicitNone, []int32{def}, []string{}},
+		{"no tree with implicit group", "frodo", implicitArchFull, []int32{junior, def}, []string{"Arch_junior"}},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			chains := snap.userChainsOf(tt.username)
+			if got := chains.roots[tt.kind]; !reflect.DeepEqual(got, tt.wantRoots) {
+				t.Errorf("roots[%d] of %q = %v, want %v", tt.kind, tt.username, got, tt.wantRoots)
+			}
+			if got := chains.groups[tt.kind]; !reflect.DeepEqual(got, tt.wantGroups) {
+				t.Errorf("groups[%d] of %q = %v, want %v", tt.kind, tt.username, got, tt.wantGroups)
+			}
+		})
+	}
+}
+
+func TestImplicitGroupForLevel(t *testing.T) {
+	tests := []struct {
+		level int
+		want  implicitGroup
+	}{
+		{users.WIZARD, implicitNone},
+		{users.JUNIOR_ARCH, implicitArchJunior},
+		{users.ELDER, implicitNone},
+		{users.ARCHWIZARD, implicitArchFull},
+		{users.ADMINISTRATOR, implicitArchFull},
+	}
+	for _, tt := range tests {
+		if got := implicitGroupForLevel(tt.level); got != tt.want {
+			t.Errorf("implicitGroupForLevel(%d) = %d, want %d", tt.level, got, tt.want)
+		}
+	}
+}
+
+func TestResolvePermissionDoesNotAllocate(t *testing.T) {
+	source := newMockUserSource()
+	source.addUser("wizard1", users.WIZARD)
+	source.addUser("arch", users.ARCHWIZARD)
+
+	auth := NewAuthorizer(newMockAccessSource(productionTree()), source, time.Hour)
+	if err := auth.refreshCache(); err != nil {
+		t.Fatalf("Failed to refresh cache: %v", err)
+	}
+
+	paths := []struct {
+		username string
+		path     string
+	}{
+		{"wizard1", "/d/SharedRealm/room.c"},
+		{"arch", "/secure/master.c"},
+		{"anonymous", "/log/Driver"},
+		{"wizard1", "/players/wizard1/workroom.c"},
+	}
+	for _, p := range paths {
+		allocs := testing.AllocsPerRun(100, func() {
+			auth.ResolvePermission(p.username, p.path)
+		})
+		if allocs != 0 {
+			t.Errorf("ResolvePermission(%q, %q) allocated %.1f times per run, want 0", p.username, p.path, allocs)
+		}
+	}
+}
+
+func TestResolvePermissionDuringRefresh(t *testing.T) {
+	source := newMockUserSource()
+	source.addUser("wizard1", users.WIZARD)
+
+	// A zero cache duration forces a refresh on every check
+	auth := NewAuthorizer(newMockAccessSource(productionTree()), source, 0)
+
+	var wg sync.WaitGroup
+	for i := 0; i < 8; i++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for j := 0; j < 200; j++ {
+				if got := auth.ResolvePermission("wizard1", "/d/MyRealm/room.c"); got != Write {
+					t.Errorf("ResolvePermission during refresh = %v, want %v", got, Write)
+					return
+				}
+			}
+		}()
+	}
+	wg.Wait()
+}
+
+func BenchmarkCompileSnapshot(b *testing.B) {
+	trees, err := DecodeAccessTrees(bytes.NewReader(fixtures.AccessFile(fixtures.DefaultConfig())))
+	if err != nil {
+		b.Fatal(err)
+	}
+	now := time.Now()
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		compileSnapshot(trees, 1, now)
+	}
+}
@@ -0,0 +1,199 @@
+package authorization
+
+import (
+	"runtime"
+	"sort"
+	"strings"
+)
+
+// AccessRange is a user's effective permission on one path of a subtree
+// and on the paths below it. In a report, each range overrides the Below of
+// the range of its nearest listed ancestor.
+//
+// As in access.o, a "*" segment stands for every entry without a range of
+// its own. Reports only use it for /players/*/open, the open directory of
+// every other player, which everyone may read.
+type AccessRange struct {
+	Path  string     // canonical path
+	Self  Permission // permission on Path itself
+	Below Permission // permission on every path below Path that has no range of its own
+}
+
+// ResolveSubtree returns the effective permissions of a user on root and
+// everything below it, as the ranges the user's trees, groups, implicit
+// group and the default tree define there, merged. The first range is root
+// itself, and each path's ranges are followed by its children's, in name
+// order. Ranges that would repeat the Below of their parent are left out.
+//
+// The permission ResolvePermission gives any path p under root is the Self
+// of the range of p, or else the Below of the range of its nearest listed
+// ancestor. The trees are walked once, however large the subtree.
+func (a *Authorizer) ResolveSubtree(username string, root Path) []AccessRange {
+	snap, err := a.ensureFreshCache()
+	if err != nil {
+		return []AccessRange{{Path: root.String(), Self: Revoked, Below: Revoked}}
+	}
+
+	chain := snap.userChainsOf(username).roots[a.implicitGroupOf(snap, username)]
+	cursors := make([]childResolver, len(chain))
+	for i, r := range chain {
+		cursors[i] = snap.walkDir(r, root.String())
+	}
+
+	w := subtreeWalker{snap: snap, username: username}
+	self := w.selfPermission(root.String(), cursors)
+	w.visit(root.String(), self, Revoked, cursors, true)
+	runtime.KeepAlive(snap) // the walk reads its nodes, see resolve
+	return w.ranges
+}
+
+// subtreeWalker holds the state of one ResolveSubtree walk
+type subtreeWalker struct {
+	snap     *snapshot
+	username string
+	ranges   []AccessRange
+}
+
+// visit adds the ranges of the subtree at path, whose trees are walked down
+// to cursors, unless the subtree only repeats parentBelow. It reports
+// whether any range was added.
+func (w *subtreeWalker) visit(path string, self, parentBelow Permission, cursors []childResolver, keep bool) bool {
+	// Everything at and below the user's own directory is implicit
+	if w.ownsPath(path) {
+		if !keep && self == GrantGrant && parentBelow == GrantGrant {
+			return false
+		}
+		w.ranges = append(w.ranges, AccessRange{Path: path, Self: GrantGrant, Below: GrantGrant})
+		return true
+	}
+
+	below := w.effective(cursors, func(r childResolver) Permission {
+		if r.node < 0 {
+			return r.fixed
+		}
+		return Permission(w.snap.nodes[r.node].star)
+	})
+
+	at := len(w.ranges)
+	w.ranges = append(w.ranges, AccessRange{Path: path, Self: self, Below: below})
+
+	added := false
+	if path == "/players" && below != Read {
+		w.ranges = append(w.ranges, AccessRange{Path: "/players/*/open", Self: Read, Below: below})
+		added = true
+	}
+
+	next := make([]childResolver, len(cursors))
+	for _, name := range w.children(path, cursors) {
+		childPath := path + "/" + name
+		if path == "/" {
+			childPath = "/" + name
+		}
+		id, known := w.snap.segments[name]
+		for i, r := range cursors {
+			next[i] = w.step(r, id, known)
+		}
+		if w.visit(childPath, w.selfPermission(childPath, next), below, next, false) {
+			added = true
+		}
+	}
+
+	if !keep && !added && self == parentBelow && below == parentBelow {
+		w.ranges = w.ranges[:at]
+		return false
+	}
+	return true
+}
+
+// children returns the names of the children of path that any of the
+// trees lists, and of the implicit children no tree need list, sorted
+func (w *subtreeWalker) children(path string, cursors []childResolver) []string {
+	var names []string
+	add := func(name string) {
+		for _, seen := range names {
+			if seen == name {
+				return
+			}
+		}
+		names = append(names, name)
+	}
+	for _, r := range cursors {
+		if r.node < 0 {
+			continue
+		}
+		node := w.snap.nodes[r.node]
+		for _, e := range w.snap.edges[node.firstEdge : node.firstEdge+node.edgeCount] {
+			add(w.snap.names[e.segment])
+		}
+	}
+
+	// The user's own directory and the open directories of other players
+	// have implicit permissions
+	switch {
+	case path == "/":
+		add("players")
+	case path == "/players":
+		add(w.username)
+	case w.isImplicitOpen(path):
+		add("open")
+	}
+
+	sort.Strings(names)
+	return names
+}
+
+// step moves a cursor to the child reached by the segment interned as id;
+// known is false if the segment was never interned
+func (w *subtreeWalker) step(r childResolver, id int32, known bool) childResolver {
+	if r.node < 0 {
+		return r
+	}
+	node := w.snap.nodes[r.node]
+	if known {
+		if child := w.snap.child(node, id); child >= 0 {
+			return childResolver{node: child}
+		}
+	}
+	return childResolver{node: -1, fixed: Permission(node.star)}
+}
+
+// selfPermission returns what ResolvePermission gives path, whose trees are
+// walked down to cursors
+func (w *subtreeWalker) selfPermission(path string, cursors []childResolver) Permission {
+	if perm, ok := resolveImplicitPermission(w.username, path); ok {
+		return perm
+	}
+	return w.effective(cursors, func(r childResolver) Permission {
+		if r.node < 0 {
+			return r.fixed
+		}
+		node := w.snap.nodes[r.node]
+		if Permission(node.dot) != Revoked {
+			return Permission(node.dot)
+		}
+		return Permission(node.star)
+	})
+}
+
+// effective returns the first permission of the chain that is not Revoked
+func (w *subtreeWalker) effective(cursors []childResolver, perm func(childResolver) Permission) Permission {
+	for _, r := range cursors {
+		if p := perm(r); p != Revoked {
+			return p
+		}
+	}
+	return Revoked
+}
+
+// ownsPath reports whether path is the user's own directory or below it
+func (w *subtreeWalker) ownsPath(path string) bool {
+	own := "/players/" + w.username
+	return path == own || strings.HasPrefix(path, own+"/")
+}
+
+// isImplicitOpen reports whether path is a player directory, whose open
+// directory everyone may read
+func (w *subtreeWalker) isImplicitOpen(path string) bool {
+	rest, ok := strings.CutPrefix(path, "/players/")
+	return ok && rest != "" && !strings.Contains(rest, "/")
+}
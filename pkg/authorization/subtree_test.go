@@ -0,0 +1,156 @@
+package authorization
+
+import (
+	"bytes"
+	"reflect"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/mmcdole/viking-ftpd/pkg/fixtures"
+	"github.com/mmcdole/viking-ftpd/pkg/users"
+)
+
+// lookupRange returns the permission a report gives p: the Self of p's own
+// range, or else the Below of its nearest listed ancestor's. The open
+// directories of players without a range are looked up as /players/*/open.
+func lookupRange(ranges []AccessRange, p string) (Permission, bool) {
+	listed := make(map[string]bool)
+	for _, r := range ranges {
+		listed[r.Path] = true
+	}
+	if parts := strings.SplitN(p, "/", 4); len(parts) >= 4 && parts[1] == "players" && !listed["/players/"+parts[2]] {
+		if wildcard := "/players/*/" + parts[3]; listed["/players/*/open"] && (wildcard == "/players/*/open" || strings.HasPrefix(wildcard, "/players/*/open/")) {
+			p = wildcard
+		}
+	}
+
+	best, found := -1, false
+	for i, r := range ranges {
+		if r.Path == p {
+			return r.Self, true
+		}
+		prefix := r.Path + "/"
+		if r.Path == "/" {
+			prefix = "/"
+		}
+		if strings.HasPrefix(p, prefix) && (best < 0 || len(r.Path) > len(ranges[best].Path)) {
+			best, found = i, true
+		}
+	}
+	if !found {
+		return Revoked, false
+	}
+	return ranges[best].Below, true
+}
+
+// checkSubtree compares the report of root with ResolvePermission on every
+// listed path and on unlisted entries below each of them
+func checkSubtree(t *testing.T, auth *Authorizer, username, root string) []AccessRange {
+	t.Helper()
+	ranges := auth.ResolveSubtree(username, CleanPath(root))
+	if len(ranges) == 0 || ranges[0].Path != CleanPath(root).String() {
+		t.Fatalf("ResolveSubtree(%q, %q) does not start at the root: %v", username, root, ranges)
+	}
+
+	var paths []string
+	for _, r := range ranges {
+		paths = append(paths, r.Path, JoinPath(r.Path, "unlisted").String(), JoinPath(r.Path, "unlisted/deeper").String())
+		if r.Path != "/" {
+			paths = append(paths, r.Path+"/"+username, r.Path+"/open")
+		}
+	}
+	for _, p := range append(paths, "/players/"+username+"/x", "/players/other/open", "/players/other/open/x") {
+		if !strings.HasPrefix(p+"/", strings.TrimSuffix(CleanPath(root).String(), "/")+"/") {
+			continue
+		}
+		got, ok := lookupRange(ranges, p)
+		if want := auth.ResolvePermission(username, p); !ok || got != want {
+			t.Errorf("%s: report gives %q %v, ResolvePermission %v", username, p, got, want)
+		}
+	}
+	return ranges
+}
+
+func TestResolveSubtree(t *testing.T) {
+	source := newMockUserSource()
+	source.addUser("wizard1", users.WIZARD)
+	source.addUser("arch", users.ARCHWIZARD)
+	source.addUser("junior", users.JUNIOR_ARCH)
+	source.addUser("elder", users.ELDER)
+	auth := NewAuthorizer(newMockAccessSource(productionTree()), source, time.Hour)
+
+	for _, username := range []string{"wizard1", "arch", "junior", "elder", "nobody"} {
+		for _, root := range []string{"/", "/d", "/d/SharedRealm", "/players", "/players/" + username, "/log"} {
+			checkSubtree(t, auth, username, root)
+		}
+	}
+
+	// Only what the trees or implicit rules list is reported, and entries
+	// that repeat their parent are left out
+	got := auth.ResolveSubtree("wizard1", CleanPath("/d"))
+	want := []AccessRange{
+		{Path: "/d", Self: Revoked, Below: Revoked},
+		{Path: "/d/MyRealm", Self: Write, Below: Write},
+		{Path: "/d/SharedRealm", Self: Write, Below: Read},
+	}
+	if !reflect.DeepEqual(got, want) {
+		t.Errorf("ResolveSubtree(wizard1, /d) = %v, want %v", got, want)
+	}
+
+	got = auth.ResolveSubtree("wizard1", CleanPath("/players"))
+	want = []AccessRange{
+		{Path: "/players", Self: Read, Below: Revoked},
+		{Path: "/players/*/open", Self: Read, Below: Revoked},
+		{Path: "/players/wizard1", Self: GrantGrant, Below: GrantGrant},
+	}
+	if !reflect.DeepEqual(got, want) {
+		t.Errorf("ResolveSubtree(wizard1, /players) = %v, want %v", got, want)
+	}
+}
+
+func TestResolveSubtreeFixture(t *testing.T) {
+	cfg := fixtures.DefaultConfig()
+	trees, err := DecodeAccessTrees(bytes.NewReader(fixtures.AccessFile(cfg)))
+	if err != nil {
+		t.Fatalf("Failed to decode fixture: %v", err)
+	}
+	source := newMockUserSource()
+	for i := 0; i < 3; i++ {
+		source.addUser(fixtures.WizardName(i), users.WIZARD)
+	}
+	auth := NewAuthorizer(staticTreeSource(trees), source, time.Hour)
+
+	for i := 0; i < 3; i++ {
+		ranges := checkSubtree(t, auth, fixtures.WizardName(i), "/")
+		if len(ranges) < 2 {
+			t.Errorf("report of %s has %d ranges", fixtures.WizardName(i), len(ranges))
+		}
+	}
+}
+
+// staticTreeSource serves decoded access trees
+type staticTreeSource map[string]*AccessTree
+
+func (s staticTreeSource) LoadAccessData() (map[string]interface{}, error) {
+	return nil, nil
+}
+
+func (s staticTreeSource) LoadAccessTrees() (map[string]*AccessTree, error) {
+	return s, nil
+}
+
+func BenchmarkResolveSubtree(b *testing.B) {
+	trees, err := DecodeAccessTrees(bytes.NewReader(fixtures.AccessFile(fixtures.DefaultConfig())))
+	if err != nil {
+		b.Fatal(err)
+	}
+	source := newMockUserSource()
+	source.addUser(fixtures.WizardName(0), users.WIZARD)
+	auth := NewAuthorizer(staticTreeSource(trees), source, time.Hour)
+
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		auth.ResolveSubtree(fixtures.WizardName(0), RootPath)
+	}
+}
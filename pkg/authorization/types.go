@@ -1,10 +1,57 @@
 package authorization
 
+import "fmt"
+
 // AccessSource provides access to the raw access tree data
 type AccessSource interface {
 	LoadAccessData() (map[string]interface{}, error)
 }
 
+// TreeSource is implemented by access sources that can build the access
+// trees themselves, without first returning the whole raw object. The
+// Authorizer prefers it over LoadAccessData.
+type TreeSource interface {
+	LoadAccessTrees() (map[string]*AccessTree, error)
+}
+
+// ChangeDetector is implemented by access sources that can cheaply tell
+// whether their data changed since it was last loaded
+type ChangeDetector interface {
+	// Changed reports whether LoadAccessData would return different data
+	Changed() bool
+}
+
+// SizeReporter is implemented by access sources that know how many bytes of
+// access data their last successful load parsed
+type SizeReporter interface {
+	LoadedSize() int64
+}
+
+// RefreshMode controls how expired access trees are reloaded
+type RefreshMode int
+
+const (
+	// RefreshInline reloads the access trees on the request that finds them
+	// expired. Concurrent requests wait for that single reload.
+	RefreshInline RefreshMode = iota
+	// RefreshBackground keeps serving the expired access trees while one
+	// background goroutine reloads them.
+	RefreshBackground
+)
+
+// ParseRefreshMode converts a configuration value into a RefreshMode.
+// An empty string selects RefreshInline.
+func ParseRefreshMode(s string) (RefreshMode, error) {
+	switch s {
+	case "", "inline":
+		return RefreshInline, nil
+	case "background":
+		return RefreshBackground, nil
+	default:
+		return RefreshInline, fmt.Errorf("unknown refresh mode %q (expected inline or background)", s)
+	}
+}
+
 // Permission represents the level of access granted
 type Permission int
 
@@ -0,0 +1,60 @@
+// Package filewatch detects changes to the MUD's data files so that cached,
+// parsed copies are only rebuilt when the file on disk actually changed.
+package filewatch
+
+import (
+	"os"
+	"time"
+)
+
+// Stamp identifies one version of a file by its identity (device and inode),
+// size and modification time. Two stamps taken of the same unchanged file are
+// equal; a rewrite, truncation, or replacement by rename makes them differ.
+type Stamp struct {
+	info os.FileInfo
+}
+
+// StatStamp returns the current stamp of the file at path
+func StatStamp(path string) (Stamp, error) {
+	fi, err := os.Stat(path)
+	if err != nil {
+		return Stamp{}, err
+	}
+	return Stamp{info: fi}, nil
+}
+
+// StampOf returns the stamp described by an existing os.FileInfo
+func StampOf(fi os.FileInfo) Stamp {
+	return Stamp{info: fi}
+}
+
+// IsZero reports whether the stamp was never taken
+func (s Stamp) IsZero() bool {
+	return s.info == nil
+}
+
+// ModTime returns the modification time recorded in the stamp
+func (s Stamp) ModTime() time.Time {
+	if s.info == nil {
+		return time.Time{}
+	}
+	return s.info.ModTime()
+}
+
+// Size returns the file size recorded in the stamp
+func (s Stamp) Size() int64 {
+	if s.info == nil {
+		return 0
+	}
+	return s.info.Size()
+}
+
+// Equal reports whether both stamps describe the same version of the same file
+func (s Stamp) Equal(other Stamp) bool {
+	if s.info == nil || other.info == nil {
+		return false
+	}
+	return os.SameFile(s.info, other.info) &&
+		s.info.Size() == other.info.Size() &&
+		s.info.ModTime().Equal(other.info.ModTime())
+}
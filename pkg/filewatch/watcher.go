@@ -0,0 +1,111 @@
+package filewatch
+
+import (
+	"errors"
+	"sync"
+
+	"github.com/mmcdole/viking-ftpd/pkg/logging"
+)
+
+// ErrUnsupported is returned by New on platforms without a native file
+// notification mechanism. Callers should fall back to comparing Stamps.
+var ErrUnsupported = errors.New("file watching is not supported on this platform")
+
+// Handler is called with the name of the entry that changed inside a watched
+// directory. An empty name means events were lost and anything in the
+// directory may have changed.
+type Handler func(name string)
+
+// Watcher delivers change notifications for files inside watched directories.
+// Handlers run on the watcher's goroutine and should return quickly.
+type Watcher struct {
+	backend backend
+
+	mu       sync.Mutex
+	handlers map[string][]Handler // directory -> handlers
+	closed   bool
+	done     chan struct{}
+}
+
+// backend is the platform specific notification mechanism
+type backend interface {
+	// add starts watching dir
+	add(dir string) error
+	// run delivers events until the backend is closed
+	run(deliver func(dir, name string))
+	close() error
+}
+
+// New creates a Watcher, or returns ErrUnsupported if the platform has no
+// notification mechanism
+func New() (*Watcher, error) {
+	b, err := newBackend()
+	if err != nil {
+		return nil, err
+	}
+
+	w := &Watcher{
+		backend:  b,
+		handlers: make(map[string][]Handler),
+		done:     make(chan struct{}),
+	}
+	go func() {
+		defer close(w.done)
+		b.run(w.deliver)
+	}()
+	return w, nil
+}
+
+// WatchDir calls handler whenever an entry in dir is created, written,
+// renamed, removed or has its attributes changed
+func (w *Watcher) WatchDir(dir string, handler Handler) error {
+	w.mu.Lock()
+	defer w.mu.Unlock()
+
+	if w.closed {
+		return errors.New("watcher is closed")
+	}
+	if _, ok := w.handlers[dir]; !ok {
+		if err := w.backend.add(dir); err != nil {
+			return err
+		}
+	}
+	w.handlers[dir] = append(w.handlers[dir], handler)
+	return nil
+}
+
+// Close stops the watcher and waits for its goroutine to exit
+func (w *Watcher) Close() error {
+	w.mu.Lock()
+	if w.closed {
+		w.mu.Unlock()
+		return nil
+	}
+	w.closed = true
+	w.mu.Unlock()
+
+	err := w.backend.close()
+	<-w.done
+	return err
+}
+
+// deliver dispatches one event to the handlers of its directory. An empty
+// dir means events were lost for every directory.
+func (w *Watcher) deliver(dir, name string) {
+	w.mu.Lock()
+	var handlers []Handler
+	if dir == "" {
+		logging.App.Warn("File watch events were lost, invalidating all watched directories")
+		for _, hs := range w.handlers {
+			handlers = append(handlers, hs...)
+		}
+		name = ""
+	} else {
+		handlers = append(handlers, w.handlers[dir]...)
+	}
+	w.mu.Unlock()
+
+	for _, handler := range handlers {
+		handler(name)
+	}
+}
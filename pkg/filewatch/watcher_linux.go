@@ -0,0 +1,99 @@
+package filewatch
+
+import (
+	"bytes"
+	"errors"
+	"fmt"
+	"os"
+	"sync"
+	"syscall"
+	"unsafe"
+)
+
+// inotifyMask selects every event that can change what a file contains or
+// which file a name refers to
+const inotifyMask = syscall.IN_CLOSE_WRITE | syscall.IN_MODIFY | syscall.IN_ATTRIB |
+	syscall.IN_CREATE | syscall.IN_DELETE | syscall.IN_MOVED_FROM | syscall.IN_MOVED_TO |
+	syscall.IN_DELETE_SELF | syscall.IN_MOVE_SELF
+
+// inotifyBackend watches directories with inotify(7)
+type inotifyBackend struct {
+	fd   int      // raw descriptor; calling file.Fd() would switch it back to blocking mode
+	file *os.File // non-blocking inotify descriptor, registered with the runtime poller
+
+	mu   sync.Mutex
+	dirs map[int32]string // watch descriptor -> directory
+}
+
+func newBackend() (backend, error) {
+	fd, err := syscall.InotifyInit1(syscall.IN_CLOEXEC | syscall.IN_NONBLOCK)
+	if err != nil {
+		return nil, fmt.Errorf("initializing inotify: %w", err)
+	}
+	return &inotifyBackend{
+		fd:   fd,
+		file: os.NewFile(uintptr(fd), "inotify"),
+		dirs: make(map[int32]string),
+	}, nil
+}
+
+func (b *inotifyBackend) add(dir string) error {
+	wd, err := syscall.InotifyAddWatch(b.fd, dir, inotifyMask)
+	if err != nil {
+		return fmt.Errorf("watching %s: %w", dir, err)
+	}
+	b.mu.Lock()
+	b.dirs[int32(wd)] = dir
+	b.mu.Unlock()
+	return nil
+}
+
+func (b *inotifyBackend) run(deliver func(dir, name string)) {
+	buf := make([]byte, 64*1024)
+	for {
+		n, err := b.file.Read(buf)
+		if err != nil {
+			if !errors.Is(err, os.ErrClosed) {
+				// Anything could have changed while we were not reading
+				deliver("", "")
+			}
+			return
+		}
+
+		for offset := 0; offset+syscall.SizeofInotifyEvent <= n; {
+			event := (*syscall.InotifyEvent)(unsafe.Pointer(&buf[offset]))
+			nameStart := offset + syscall.SizeofInotifyEvent
+			nameEnd := nameStart + int(event.Len)
+			if nameEnd > n {
+				break
+			}
+			offset = nameEnd
+
+			if event.Mask&syscall.IN_Q_OVERFLOW != 0 {
+				deliver("", "")
+				continue
+			}
+
+			b.mu.Lock()
+			dir, ok := b.dirs[event.Wd]
+			if event.Mask&syscall.IN_IGNORED != 0 {
+				delete(b.dirs, event.Wd)
+			}
+			b.mu.Unlock()
+			if !ok {
+				continue
+			}
+
+			// The name is NUL padded to an alignment boundary
+			name := buf[nameStart:nameEnd]
+			if i := bytes.IndexByte(name, 0); i >= 0 {
+				name = name[:i]
+			}
+			deliver(dir, string(name))
+		}
+	}
+}
+
+func (b *inotifyBackend) close() error {
+	return b.file.Close()
+}
@@ -0,0 +1,7 @@
+//go:build !linux
+
+package filewatch
+
+func newBackend() (backend, error) {
+	return nil, ErrUnsupported
+}
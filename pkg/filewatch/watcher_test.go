@@ -0,0 +1,86 @@
+package filewatch
+
+import (
+	"errors"
+	"os"
+	"path/filepath"
+	"testing"
+	"time"
+)
+
+func TestStamp(t *testing.T) {
+	dir := t.TempDir()
+	path := filepath.Join(dir, "access.o")
+	if err := os.WriteFile(path, []byte("access_map ([])\n"), 0644); err != nil {
+		t.Fatalf("Failed to write file: %v", err)
+	}
+
+	first, err := StatStamp(path)
+	if err != nil {
+		t.Fatalf("StatStamp failed: %v", err)
+	}
+	again, err := StatStamp(path)
+	if err != nil {
+		t.Fatalf("StatStamp failed: %v", err)
+	}
+	if !first.Equal(again) {
+		t.Error("Stamps of an unchanged file should be equal")
+	}
+
+	// Replace the file by rename, as the MUD does when saving objects
+	tmp := path + ".tmp"
+	if err := os.WriteFile(tmp, []byte("access_map ([])\n"), 0644); err != nil {
+		t.Fatalf("Failed to write file: %v", err)
+	}
+	if err := os.Rename(tmp, path); err != nil {
+		t.Fatalf("Failed to rename file: %v", err)
+	}
+	replaced, err := StatStamp(path)
+	if err != nil {
+		t.Fatalf("StatStamp failed: %v", err)
+	}
+	if first.Equal(replaced) {
+		t.Error("Stamps should differ after the file was replaced")
+	}
+
+	if (Stamp{}).Equal(Stamp{}) {
+		t.Error("Zero stamps should never be equal")
+	}
+}
+
+func TestWatcher(t *testing.T) {
+	w, err := New()
+	if errors.Is(err, ErrUnsupported) {
+		t.Skip("file watching is not supported on this platform")
+	}
+	if err != nil {
+		t.Fatalf("New failed: %v", err)
+	}
+	defer w.Close()
+
+	dir := t.TempDir()
+	events := make(chan string, 16)
+	if err := w.WatchDir(dir, func(name string) { events <- name }); err != nil {
+		t.Fatalf("WatchDir failed: %v", err)
+	}
+
+	if err := os.WriteFile(filepath.Join(dir, "drake.o"), []byte("level 30\n"), 0644); err != nil {
+		t.Fatalf("Failed to write file: %v", err)
+	}
+
+	select {
+	case name := <-events:
+		if name != "drake.o" {
+			t.Errorf("event for %q, want drake.o", name)
+		}
+	case <-time.After(2 * time.Second):
+		t.Fatal("no event received for a written file")
+	}
+
+	if err := w.Close(); err != nil {
+		t.Errorf("Close failed: %v", err)
+	}
+	if err := w.WatchDir(dir, func(string) {}); err == nil {
+		t.Error("WatchDir should fail after Close")
+	}
+}
@@ -0,0 +1,224 @@
+// Package fixtures generates synthetic MUD data files, an access.o and a
+// character directory, shaped like those of a large VikingMUD installation.
+// They are used by benchmarks and load tests; the output is deterministic
+// for a given Config.
+package fixtures
+
+import (
+	"fmt"
+	"math/rand"
+	"os"
+	"path/filepath"
+	"strings"
+)
+
+// Config describes the size of the generated data
+type Config struct {
+	Wizards    int   // number of wizards, each with an access tree and a character file
+	Mortals    int   // number of additional characters without an access tree
+	Domains    int   // number of domains under /d
+	Depth      int   // depth of the directory chain inside each wizard's own domain
+	SaveLines  int   // number of bulky entries (aliases, quests) in each character file
+	Seed       int64 // seed for the random layout
+	JuniorEach int   // every JuniorEach-th wizard is listed in the Arch_junior group, 0 for none
+}
+
+// DefaultConfig returns a configuration sized like a real MUD: thousands of
+// wizards, tens of domains and deep domain trees
+func DefaultConfig() Config {
+	return Config{
+		Wizards:    3000,
+		Mortals:    2000,
+		Domains:    60,
+		Depth:      6,
+		SaveLines:  40,
+		Seed:       1,
+		JuniorEach: 25,
+	}
+}
+
+// Permission values as written in access.o
+const (
+	revoked = -1
+	read    = 1
+	write   = 3
+)
+
+// Levels written to character files
+const (
+	mortalLevel = 10
+	wizardLevel = 31
+	juniorLevel = 40
+	archLevel   = 45
+)
+
+// Password is the plain text password of every generated character
+const Password = "fixture"
+
+// PasswordHash is the stored hash of Password, in the legacy unix crypt
+// format the MUD uses for most characters
+const PasswordHash = "fiT7Y4WZxFVOE"
+
+// WizardName returns the name of the i-th wizard. Names start with
+// different letters so that they spread over the character directories.
+func WizardName(i int) string {
+	return fmt.Sprintf("%cwiz%d", 'a'+rune(i%26), i)
+}
+
+// MortalName returns the name of the i-th mortal
+func MortalName(i int) string {
+	return fmt.Sprintf("%cmortal%d", 'a'+rune(i%26), i)
+}
+
+// DomainName returns the name of the i-th domain
+func DomainName(i int) string {
+	return fmt.Sprintf("Domain%d", i)
+}
+
+// DeepPath returns a path at the bottom of the i-th wizard's domain chain
+func DeepPath(cfg Config, i int) string {
+	parts := []string{"", "d", DomainName(i % max(cfg.Domains, 1))}
+	for depth := 0; depth < cfg.Depth; depth++ {
+		parts = append(parts, chainDir(i, depth))
+	}
+	return strings.Join(append(parts, "room.c"), "/")
+}
+
+// chainDir names the directory at depth in wizard i's domain chain
+func chainDir(i, depth int) string {
+	return fmt.Sprintf("area%d_%d", depth, i%7)
+}
+
+// AccessFile returns the contents of an access.o holding a default tree,
+// the Arch groups and one tree per wizard
+func AccessFile(cfg Config) []byte {
+	rng := rand.New(rand.NewSource(cfg.Seed))
+
+	var entries []string
+	entries = append(entries, `"*":`+defaultTree(cfg))
+	entries = append(entries,
+		`"Arch_full":([1|"*":4,])`,
+		`"Arch_junior":([2|"d":3,"players":3,])`,
+		`"Arch_doc":([2|"doc":3,"help":3,])`,
+		`"Arch_law":([2|"com":([1|"a":([1|"law":3,]),]),"data":([1|"Law":3,]),])`,
+	)
+	for i := 0; i < cfg.Wizards; i++ {
+		entries = append(entries, fmt.Sprintf("%q:%s", WizardName(i), wizardTree(cfg, rng, i)))
+	}
+
+	var b strings.Builder
+	b.WriteString("#/secure/access\n")
+	fmt.Fprintf(&b, "access_map ([%d|%s,])\n", len(entries), strings.Join(entries, ","))
+	b.WriteString("version 2\n")
+	return []byte(b.String())
+}
+
+// defaultTree returns the "*" tree every user falls back to
+func defaultTree(cfg Config) string {
+	domains := []string{`"*":-1`, `".":1`}
+	for i := 0; i < cfg.Domains; i += 10 {
+		domains = append(domains, fmt.Sprintf("%q:1", DomainName(i)))
+	}
+	return fmt.Sprintf(`([11|"*":1,"accounts":-1,"attic":-1,"banish":-1,"characters":-1,`+
+		`"com":([1|"a":([1|"law":-1,]),]),"d":([%d|%s,]),"data":-1,`+
+		`"log":([3|"*":1,"Driver":-1,"old":-1,]),"players":([2|"*":-1,".":1,]),"tmp":3,])`,
+		len(domains), strings.Join(domains, ","))
+}
+
+// wizardTree returns the access tree of wizard i: write access down a deep
+// chain of directories in their own domain, a few other domains, and read
+// access to some other players' directories
+func wizardTree(cfg Config, rng *rand.Rand, i int) string {
+	var entries []string
+
+	// Deep chain in the wizard's own domain, innermost first
+	chain := fmt.Sprintf(`([2|".":%d,"*":%d,])`, write, write)
+	for depth := cfg.Depth - 1; depth >= 0; depth-- {
+		chain = fmt.Sprintf(`([3|".":%d,"*":%d,%q:%s,])`, read, revoked, chainDir(i, depth), chain)
+	}
+	domains := []string{fmt.Sprintf("%q:%s", DomainName(i%max(cfg.Domains, 1)), chain)}
+	for n := rng.Intn(3); n > 0; n-- {
+		domains = append(domains, fmt.Sprintf("%q:%d", DomainName(rng.Intn(max(cfg.Domains, 1))), read+rng.Intn(3)))
+	}
+	entries = append(entries, fmt.Sprintf(`"d":([%d|%s,])`, len(domains), strings.Join(domains, ",")))
+
+	if cfg.Wizards > 1 {
+		var players []string
+		for n := 1 + rng.Intn(3); n > 0; n-- {
+			players = append(players, fmt.Sprintf("%q:%d", WizardName(rng.Intn(cfg.Wizards)), read))
+		}
+		entries = append(entries, fmt.Sprintf(`"players":([%d|%s,])`, len(players), strings.Join(players, ",")))
+	}
+
+	if i%17 == 0 {
+		entries = append(entries, fmt.Sprintf(`"log":([1|"Driver":%d,])`, read))
+	}
+	if cfg.JuniorEach > 0 && i%cfg.JuniorEach == 0 {
+		entries = append(entries, `"?":({1|"Arch_junior",})`)
+	}
+	return fmt.Sprintf("([%d|%s,])", len(entries), strings.Join(entries, ","))
+}
+
+// CharacterFile returns the contents of a character save file. Bulky
+// entries come before and after the password and level, as in real saves.
+func CharacterFile(cfg Config, name string, level int) []byte {
+	var b strings.Builder
+	fmt.Fprintf(&b, "#/obj/player\n")
+	fmt.Fprintf(&b, "name %q\n", name)
+	fmt.Fprintf(&b, "title \"the adventurer\"\n")
+
+	half := cfg.SaveLines / 2
+	for i := 0; i < half; i++ {
+		fmt.Fprintf(&b, "alias_%d ({3|\"say hello\",\"emote waves\",\"look at %s\",})\n", i, name)
+	}
+	fmt.Fprintf(&b, "password %q\n", PasswordHash)
+	fmt.Fprintf(&b, "level %d\n", level)
+	fmt.Fprintf(&b, "experience %d\n", level*123457)
+	for i := half; i < cfg.SaveLines; i++ {
+		fmt.Fprintf(&b, "quest_%d ([2|\"done\":%d,\"notes\":({2|\"first step\",\"second step\",}),])\n", i, i*1000)
+	}
+	return []byte(b.String())
+}
+
+// WriteAccessFile writes AccessFile(cfg) to path
+func WriteAccessFile(path string, cfg Config) error {
+	if err := os.WriteFile(path, AccessFile(cfg), 0644); err != nil {
+		return fmt.Errorf("writing access file: %w", err)
+	}
+	return nil
+}
+
+// WriteCharacters writes a character file for every wizard and mortal into
+// dir, using the one-letter subdirectories the character source expects
+func WriteCharacters(dir string, cfg Config) error {
+	write := func(name string, level int) error {
+		letterDir := filepath.Join(dir, name[:1])
+		if err := os.MkdirAll(letterDir, 0755); err != nil {
+			return fmt.Errorf("creating character directory: %w", err)
+		}
+		path := filepath.Join(letterDir, name+".o")
+		if err := os.WriteFile(path, CharacterFile(cfg, name, level), 0644); err != nil {
+			return fmt.Errorf("writing character file: %w", err)
+		}
+		return nil
+	}
+
+	for i := 0; i < cfg.Wizards; i++ {
+		level := wizardLevel
+		switch {
+		case i%100 == 0:
+			level = archLevel
+		case cfg.JuniorEach > 0 && i%cfg.JuniorEach == 0:
+			level = juniorLevel
+		}
+		if err := write(WizardName(i), level); err != nil {
+			return err
+		}
+	}
+	for i := 0; i < cfg.Mortals; i++ {
+		if err := write(MortalName(i), mortalLevel); err != nil {
+			return err
+		}
+	}
+	return nil
+}
@@ -0,0 +1,96 @@
+package fixtures
+
+import (
+	"bytes"
+	"os"
+	"path/filepath"
+	"testing"
+	"time"
+
+	"github.com/mmcdole/viking-ftpd/pkg/authorization"
+	"github.com/mmcdole/viking-ftpd/pkg/users"
+)
+
+func TestAccessFile(t *testing.T) {
+	cfg := DefaultConfig()
+	cfg.Wizards = 100
+
+	data := AccessFile(cfg)
+	if !bytes.Equal(data, AccessFile(cfg)) {
+		t.Error("AccessFile should be deterministic for a given Config")
+	}
+
+	trees, err := authorization.DecodeAccessTrees(bytes.NewReader(data))
+	if err != nil {
+		t.Fatalf("DecodeAccessTrees failed: %v", err)
+	}
+	// One tree per wizard plus the default tree and four groups
+	if got, want := len(trees), cfg.Wizards+5; got != want {
+		t.Errorf("got %d trees, want %d", got, want)
+	}
+
+	path := filepath.Join(t.TempDir(), "access.o")
+	if err := WriteAccessFile(path, cfg); err != nil {
+		t.Fatalf("WriteAccessFile failed: %v", err)
+	}
+	characters := users.NewMemorySource()
+	characters.AddUser(&users.User{Username: WizardName(1), Level: wizardLevel})
+	auth := authorization.NewAuthorizer(authorization.NewAccessFileSource(path), characters, time.Hour)
+
+	tests := []struct {
+		username string
+		path     string
+		want     authorization.Permission
+	}{
+		{WizardName(1), DeepPath(cfg, 1), authorization.Write},
+		{MortalName(1), DeepPath(cfg, 1), authorization.Revoked},
+		{MortalName(1), DeepPath(cfg, 10), authorization.Read},
+		{MortalName(1), "/log/debug.log", authorization.Read},
+		{MortalName(1), "/log/Driver", authorization.Revoked},
+	}
+	for _, tt := range tests {
+		if got := auth.ResolvePermission(tt.username, tt.path); got != tt.want {
+			t.Errorf("ResolvePermission(%q, %q) = %v, want %v", tt.username, tt.path, got, tt.want)
+		}
+	}
+}
+
+func TestWriteCharacters(t *testing.T) {
+	cfg := DefaultConfig()
+	cfg.Wizards = 30
+	cfg.Mortals = 10
+
+	dir := t.TempDir()
+	if err := WriteCharacters(dir, cfg); err != nil {
+		t.Fatalf("WriteCharacters failed: %v", err)
+	}
+
+	source := users.NewFileSource(dir)
+	tests := []struct {
+		username string
+		level    int
+	}{
+		{WizardName(0), archLevel},
+		{WizardName(25), juniorLevel},
+		{WizardName(29), wizardLevel},
+		{MortalName(9), mortalLevel},
+	}
+	for _, tt := range tests {
+		user, err := source.LoadUser(tt.username)
+		if err != nil {
+			t.Fatalf("LoadUser(%q) failed: %v", tt.username, err)
+		}
+		if user.Level != tt.level || user.PasswordHash != PasswordHash {
+			t.Errorf("LoadUser(%q) = level %d, hash %q, want level %d, hash %q",
+				tt.username, user.Level, user.PasswordHash, tt.level, PasswordHash)
+		}
+	}
+
+	entries, err := os.ReadDir(dir)
+	if err != nil {
+		t.Fatalf("ReadDir failed: %v", err)
+	}
+	if len(entries) != 26 {
+		t.Errorf("got %d letter directories, want 26", len(entries))
+	}
+}
@@ -0,0 +1,160 @@
+package ftpserver
+
+import (
+	"errors"
+	"net"
+	"sync"
+	"sync/atomic"
+)
+
+var (
+	errServerFull  = errors.New("too many connections")
+	errTooManyIP   = errors.New("too many connections from this address")
+	errTooManyUser = errors.New("too many connections for this user")
+)
+
+// admission bounds concurrent sessions in total, per client IP and per user.
+// A limit of zero or less is unlimited. Sessions are keyed by ftpserverlib's
+// client ID, so releasing a session that was never admitted is a no-op.
+type admission struct {
+	maxTotal   int
+	maxPerIP   int
+	maxPerUser int
+
+	mu       sync.Mutex
+	sessions map[uint32]*admittedSession
+	perIP    map[string]int
+	perUser  map[string]int
+
+	rejectedConnections atomic.Int64
+	rejectedLogins      atomic.Int64
+}
+
+// admittedSession is a session holding a slot
+type admittedSession struct {
+	ip   string
+	user string // empty until the session logs in
+}
+
+func newAdmission(maxTotal, maxPerIP, maxPerUser int) *admission {
+	return &admission{
+		maxTotal:   maxTotal,
+		maxPerIP:   maxPerIP,
+		maxPerUser: maxPerUser,
+		sessions:   make(map[uint32]*admittedSession),
+		perIP:      make(map[string]int),
+		perUser:    make(map[string]int),
+	}
+}
+
+// connect admits session id from ip, or returns why it is refused
+func (a *admission) connect(id uint32, ip string) error {
+	a.mu.Lock()
+	defer a.mu.Unlock()
+	if a.maxTotal > 0 && len(a.sessions) >= a.maxTotal {
+		a.rejectedConnections.Add(1)
+		return errServerFull
+	}
+	if a.maxPerIP > 0 && a.perIP[ip] >= a.maxPerIP {
+		a.rejectedConnections.Add(1)
+		return errTooManyIP
+	}
+	a.sessions[id] = &admittedSession{ip: ip}
+	a.perIP[ip]++
+	return nil
+}
+
+// checkUser reports whether user may log in now, without taking a slot. It
+// lets a login be refused before its password is verified.
+func (a *admission) checkUser(id uint32, user string) error {
+	a.mu.Lock()
+	defer a.mu.Unlock()
+	if a.full(id, user) {
+		a.rejectedLogins.Add(1)
+		return errTooManyUser
+	}
+	return nil
+}
+
+// login assigns session id to user, taking one of the user's slots
+func (a *admission) login(id uint32, user string) error {
+	a.mu.Lock()
+	defer a.mu.Unlock()
+	session, ok := a.sessions[id]
+	if !ok {
+		return nil
+	}
+	if session.user == user {
+		return nil
+	}
+	if a.full(id, user) {
+		a.rejectedLogins.Add(1)
+		return errTooManyUser
+	}
+	if session.user != "" {
+		a.releaseUserLocked(session.user)
+	}
+	session.user = user
+	a.perUser[user]++
+	return nil
+}
+
+// full reports whether user has no slot left for session id
+func (a *admission) full(id uint32, user string) bool {
+	if a.maxPerUser <= 0 {
+		return false
+	}
+	if session, ok := a.sessions[id]; ok && session.user == user {
+		return false
+	}
+	return a.perUser[user] >= a.maxPerUser
+}
+
+// disconnect releases the slots of session id. It reports whether the
+// session had been admitted.
+func (a *admission) disconnect(id uint32) bool {
+	a.mu.Lock()
+	defer a.mu.Unlock()
+	session, ok := a.sessions[id]
+	if !ok {
+		return false
+	}
+	delete(a.sessions, id)
+	if a.perIP[session.ip]--; a.perIP[session.ip] <= 0 {
+		delete(a.perIP, session.ip)
+	}
+	if session.user != "" {
+		a.releaseUserLocked(session.user)
+	}
+	return true
+}
+
+func (a *admission) releaseUserLocked(user string) {
+	if a.perUser[user]--; a.perUser[user] <= 0 {
+		delete(a.perUser, user)
+	}
+}
+
+// pendingLogins returns the number of admitted sessions not yet logged in
+func (a *admission) pendingLogins() int {
+	a.mu.Lock()
+	defer a.mu.Unlock()
+	return len(a.sessions) - a.loggedInLocked()
+}
+
+func (a *admission) loggedInLocked() int {
+	n := 0
+	for _, count := range a.perUser {
+		n += count
+	}
+	return n
+}
+
+// hostOf returns the IP of addr without its port
+func hostOf(addr net.Addr) string {
+	host := addr.String()
+	if h, _, err := net.SplitHostPort(host); err == nil {
+		host = h
+	}
+	return host
+}
@@ -0,0 +1,107 @@
+package ftpserver
+
+import (
+	"net"
+	"sync"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+)
+
+func TestAdmission_Connect(t *testing.T) {
+	tests := []struct {
+		name      string
+		maxTotal  int
+		maxPerIP  int
+		ips       []string
+		wantErrs  []error
+		wantCount int64
+	}{
+		{"unlimited", 0, 0, []string{"a", "a", "a"}, []error{nil, nil, nil}, 0},
+		{"total cap", 2, 0, []string{"a", "b", "c"}, []error{nil, nil, errServerFull}, 1},
+		{"per IP cap", 0, 2, []string{"a", "a", "b", "a"}, []error{nil, nil, nil, errTooManyIP}, 1},
+		{"both", 3, 2, []string{"a", "a", "a", "b", "c"}, []error{nil, nil, errTooManyIP, nil, errServerFull}, 2},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			a := newAdmission(tt.maxTotal, tt.maxPerIP, 0)
+			for i, ip := range tt.ips {
+				assert.Equal(t, tt.wantErrs[i], a.connect(uint32(i), ip))
+			}
+			assert.Equal(t, tt.wantCount, a.rejectedConnections.Load())
+		})
+	}
+}
+
+func TestAdmission_Disconnect(t *testing.T) {
+	a := newAdmission(1, 1, 0)
+	assert.NoError(t, a.connect(1, "a"))
+	assert.Equal(t, errServerFull, a.connect(2, "a"))
+
+	// A refused session holds no slot
+	assert.False(t, a.disconnect(2))
+	assert.True(t, a.disconnect(1))
+	assert.False(t, a.disconnect(1))
+
+	assert.NoError(t, a.connect(3, "a"))
+	assert.Equal(t, 0, len(a.perUser))
+	assert.Equal(t, 1, len(a.perIP))
+}
+
+func TestAdmission_Users(t *testing.T) {
+	a := newAdmission(0, 0, 2)
+	for id := uint32(1); id <= 4; id++ {
+		assert.NoError(t, a.connect(id, "a"))
+	}
+	assert.Equal(t, 4, a.pendingLogins())
+
+	assert.NoError(t, a.checkUser(1, "drake"))
+	assert.NoError(t, a.login(1, "drake"))
+	assert.NoError(t, a.login(2, "drake"))
+	assert.Equal(t, 2, a.pendingLogins())
+
+	// The third session is refused before and after password verification
+	assert.Equal(t, errTooManyUser, a.checkUser(3, "drake"))
+	assert.Equal(t, errTooManyUser, a.login(3, "drake"))
+	assert.Equal(t, int64(2), a.rejectedLogins.Load())
+
+	// Logging in again as the same user keeps the session's slot
+	assert.NoError(t, a.checkUser(1, "drake"))
+	assert.NoError(t, a.login(1, "drake"))
+
+	// Logging in as someone else frees it
+	assert.NoError(t, a.login(2, "frodo"))
+	assert.NoError(t, a.login(3, "drake"))
+
+	a.disconnect(1)
+	a.disconnect(3)
+	assert.NoError(t, a.login(4, "drake"))
+	assert.Equal(t, map[string]int{"drake": 1, "frodo": 1}, a.perUser)
+}
+
+func TestAdmission_Concurrent(t *testing.T) {
+	a := newAdmission(50, 10, 3)
+	var wg sync.WaitGroup
+	for g := 0; g < 8; g++ {
+		wg.Add(1)
+		go func(g int) {
+			defer wg.Done()
+			for i := 0; i < 500; i++ {
+				id := uint32(g*1000 + i)
+				if a.connect(id, string(rune('a'+i%7))) == nil {
+					_ = a.login(id, string(rune('m'+i%5)))
+					a.disconnect(id)
+				}
+			}
+		}(g)
+	}
+	wg.Wait()
+	assert.Equal(t, 0, len(a.sessions))
+	assert.Equal(t, 0, len(a.perIP))
+	assert.Equal(t, 0, len(a.perUser))
+}
+
+func TestHostOf(t *testing.T) {
+	assert.Equal(t, "192.0.2.7", hostOf(&net.TCPAddr{IP: net.ParseIP("192.0.2.7"), Port: 4321}))
+	assert.Equal(t, "2001:db8::1", hostOf(&net.TCPAddr{IP: net.ParseIP("2001:db8::1"), Port: 21}))
+}
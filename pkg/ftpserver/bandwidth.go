@@ -0,0 +1,279 @@
+package ftpserver
+
+import (
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+const (
+	// bandwidthTick is the period of the shared clock that refills buckets
+	// and wakes throttled transfers
+	bandwidthTick = 10 * time.Millisecond
+
+	// bandwidthBurst is how long a bucket may save up its rate for
+	bandwidthBurst = 250 * time.Millisecond
+
+	// minBurst keeps slow buckets able to grant a useful chunk at once
+	minBurst = 16 * 1024
+
+	// maxGrant bounds the bytes one take hands out, so transfers waiting on
+	// the same bucket share it in small turns
+	maxGrant = 64 * 1024
+)
+
+// BandwidthLimiter throttles data transfers with token buckets at three
+// levels: one for the whole server, one per configured user group, and one
+// per user shared by all of that user's sessions. A transfer moves only as
+// fast as every bucket above it allows. All buckets are refilled from one
+// shared clock, and a throttled transfer waits for its next tick rather
+// than on a timer of its own.
+type BandwidthLimiter struct {
+	global  *bucket
+	groups  map[string]*bucket // by lower-case group name
+	perUser int64              // bytes per second, 0 = unlimited
+
+	clock  atomic.Int64 // nanoseconds since start, advanced every tick
+	tickMu sync.Mutex
+	tickCh chan struct{} // closed and replaced at every tick
+
+	mu       sync.Mutex
+	users    map[string]*userBucket
+	sessions map[uint32]*flow
+
+	stop     chan struct{}
+	stopOnce sync.Once
+}
+
+// userBucket is the bucket of one user, counted by the sessions using it
+type userBucket struct {
+	bucket *bucket
+	refs   int
+}
+
+// NewBandwidthLimiter creates a limiter from rates in bytes per second. A
+// rate of zero or less is unlimited; groups maps a group name, such as
+// "arch_full", to the rate shared by all its members. Group names are
+// matched regardless of case, so "arch_full" limits the access.o group
+// "Arch_full".
+func NewBandwidthLimiter(global, perUser int64, groups map[string]int64) *BandwidthLimiter {
+	l := &BandwidthLimiter{
+		global:   newBucket(global),
+		groups:   make(map[string]*bucket),
+		perUser:  perUser,
+		tickCh:   make(chan struct{}),
+		users:    make(map[string]*userBucket),
+		sessions: make(map[uint32]*flow),
+		stop:     make(chan struct{}),
+	}
+	for name, rate := range groups {
+		if b := newBucket(rate); b != nil {
+			l.groups[strings.ToLower(name)] = b
+		}
+	}
+	go l.run()
+	return l
+}
+
+// containsBucket reports whether buckets holds b
+func containsBucket(buckets []*bucket, b *bucket) bool {
+	for _, have := range buckets {
+		if have == b {
+			return true
+		}
+	}
+	return false
+}
+
+// Close stops the clock. Transfers still waiting continue unthrottled.
+func (l *BandwidthLimiter) Close() {
+	l.stopOnce.Do(func() { close(l.stop) })
+}
+
+func (l *BandwidthLimiter) run() {
+	start := time.Now()
+	ticker := time.NewTicker(bandwidthTick)
+	defer ticker.Stop()
+	for {
+		select {
+		case now := <-ticker.C:
+			l.clock.Store(int64(now.Sub(start)))
+			l.tickMu.Lock()
+			close(l.tickCh)
+			l.tickCh = make(chan struct{})
+			l.tickMu.Unlock()
+		case <-l.stop:
+			return
+		}
+	}
+}
+
+// nextTick returns a channel closed at the next tick of the clock
+func (l *BandwidthLimiter) nextTick() <-chan struct{} {
+	l.tickMu.Lock()
+	defer l.tickMu.Unlock()
+	return l.tickCh
+}
+
+// attach returns the flow session id's transfers are throttled through,
+// given the session's user and groups. It returns nil when no bucket
+// applies, so unthrottled sessions pay nothing.
+func (l *BandwidthLimiter) attach(id uint32, user string, groups []string) *flow {
+	f := &flow{limiter: l}
+	if l.global != nil {
+		f.buckets = append(f.buckets, l.global)
+	}
+	for _, name := range groups {
+		// Names differing only in case share one bucket, which is taken once
+		if b, ok := l.groups[strings.ToLower(name)]; ok && !containsBucket(f.buckets, b) {
+			f.buckets = append(f.buckets, b)
+		}
+	}
+
+	l.mu.Lock()
+	defer l.mu.Unlock()
+	if l.perUser > 0 {
+		ub, ok := l.users[user]
+		if !ok {
+			ub = &userBucket{bucket: newBucket(l.perUser)}
+			l.users[user] = ub
+		}
+		ub.refs++
+		f.user = user
+		f.buckets = append(f.buckets, ub.bucket)
+	}
+	if old, ok := l.sessions[id]; ok {
+		delete(l.sessions, id)
+		l.releaseLocked(old)
+	}
+	if len(f.buckets) == 0 {
+		return nil
+	}
+	l.sessions[id] = f
+	return f
+}
+
+// detach releases the flow of session id
+func (l *BandwidthLimiter) detach(id uint32) {
+	l.mu.Lock()
+	defer l.mu.Unlock()
+	if f, ok := l.sessions[id]; ok {
+		delete(l.sessions, id)
+		l.releaseLocked(f)
+	}
+}
+
+func (l *BandwidthLimiter) releaseLocked(f *flow) {
+	if f.user == "" {
+		return
+	}
+	if ub, ok := l.users[f.user]; ok {
+		if ub.refs--; ub.refs <= 0 {
+			delete(l.users, f.user)
+		}
+	}
+}
+
+// flow is the set of buckets one session's transfers draw from
+type flow struct {
+	limiter *BandwidthLimiter
+	buckets []*bucket
+	user    string
+}
+
+// take waits until at least one byte may be moved and returns how many, up
+// to n. A nil flow is unlimited.
+func (f *flow) take(n int) int {
+	if f == nil || n <= 0 {
+		return n
+	}
+	if n > maxGrant {
+		n = maxGrant
+	}
+	for {
+		// Fetch the tick before trying, so a refill in between isn't missed
+		tick := f.limiter.nextTick()
+		if granted := f.tryTake(n); granted > 0 {
+			return granted
+		}
+		select {
+		case <-tick:
+		case <-f.limiter.stop:
+			return n
+		}
+	}
+}
+
+// refund returns n granted bytes that were not moved
+func (f *flow) refund(n int) {
+	if f == nil || n <= 0 {
+		return
+	}
+	for _, b := range f.buckets {
+		b.spend(-n)
+	}
+}
+
+// tryTake grants up to n bytes that every bucket can spare, or 0. Buckets
+// are locked one at a time; a bucket drained by another flow in between goes
+// into debt, which its next refills pay off.
+func (f *flow) tryTake(n int) int {
+	now := f.limiter.clock.Load()
+	granted := n
+	for _, b := range f.buckets {
+		if avail := b.available(now); avail < granted {
+			granted = avail
+		}
+	}
+	if granted <= 0 {
+		return 0
+	}
+	for _, b := range f.buckets {
+		b.spend(granted)
+	}
+	return granted
+}
+
+// bucket is a token bucket of bytes
+type bucket struct {
+	rate  float64 // bytes per second
+	burst float64
+
+	mu     sync.Mutex
+	tokens float64
+	last   int64 // clock value of the last refill
+}
+
+// newBucket creates a full bucket, or returns nil for an unlimited rate
+func newBucket(rate int64) *bucket {
+	if rate <= 0 {
+		return nil
+	}
+	burst := float64(rate) * bandwidthBurst.Seconds()
+	if burst < minBurst {
+		burst = minBurst
+	}
+	return &bucket{rate: float64(rate), burst: burst, tokens: burst}
+}
+
+// available refills the bucket up to now and returns its whole tokens
+func (b *bucket) available(now int64) int {
+	b.mu.Lock()
+	defer b.mu.Unlock()
+	if now > b.last {
+		b.tokens += b.rate * float64(now-b.last) / float64(time.Second)
+		if b.tokens > b.burst {
+			b.tokens = b.burst
+		}
+		b.last = now
+	}
+	return int(b.tokens)
+}
+
+// spend removes n tokens
+func (b *bucket) spend(n int) {
+	b.mu.Lock()
+	b.tokens -= float64(n)
+	b.mu.Unlock()
+}
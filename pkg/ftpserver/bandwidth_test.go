@@ -0,0 +1,235 @@
+package ftpserver
+
+import (
+	"bytes"
+	"crypto/tls"
+	"io"
+	"path/filepath"
+	"sync"
+	"testing"
+	"time"
+
+	"github.com/mmcdole/viking-ftpd/pkg/authorization"
+	"github.com/mmcdole/viking-ftpd/pkg/fixtures"
+	"github.com/mmcdole/viking-ftpd/pkg/users"
+	"github.com/stretchr/testify/assert"
+)
+
+// drain takes total bytes through f and returns how long it took
+func drain(f *flow, total int) time.Duration {
+	start := time.Now()
+	for total > 0 {
+		total -= f.take(total)
+	}
+	return time.Since(start)
+}
+
+func TestBucket(t *testing.T) {
+	b := newBucket(40 * 1024)
+	assert.Equal(t, minBurst, b.available(0))
+
+	b.spend(minBurst)
+	assert.Equal(t, 0, b.available(0))
+	// 50ms at 40 KiB/s earns 2 KiB
+	assert.Equal(t, 2*1024, b.available(int64(50*time.Millisecond)))
+	// Savings are capped at the burst
+	assert.Equal(t, minBurst, b.available(int64(time.Hour)))
+
+	assert.True(t, newBucket(0) == nil)
+}
+
+func TestBandwidthLimiter_Attach(t *testing.T) {
+	l := NewBandwidthLimiter(0, 0, map[string]int64{"arch_full": 1 << 20})
+	defer l.Close()
+
+	// Nothing applies to a user outside the limited groups
+	assert.True(t, l.attach(1, "drake", []string{"wizard"}) == nil)
+	f := l.attach(2, "frodo", []string{"wizard", "arch_full"})
+	assert.Equal(t, 1, len(f.buckets))
+	assert.True(t, f.buckets[0] == l.groups["arch_full"])
+
+	l = NewBandwidthLimiter(1<<20, 1<<20, nil)
+	defer l.Close()
+	a := l.attach(1, "drake", nil)
+	b := l.attach(2, "drake", nil)
+	c := l.attach(3, "frodo", nil)
+	// Sessions of one user share the user's bucket, and all share the global
+	assert.True(t, a.buckets[1] == b.buckets[1])
+	assert.False(t, a.buckets[1] == c.buckets[1])
+	assert.True(t, a.buckets[0] == c.buckets[0])
+
+	l.detach(1)
+	l.detach(1)
+	assert.Equal(t, 1, l.users["drake"].refs)
+	l.detach(2)
+	l.detach(3)
+	assert.Equal(t, 0, len(l.users))
+	assert.Equal(t, 0, len(l.sessions))
+}
+
+func TestBandwidthLimiter_AccessGroups(t *testing.T) {
+	dir := t.TempDir()
+	cfg := fixtures.DefaultConfig()
+	cfg.Wizards, cfg.Mortals = 30, 0
+	accessPath, charDir := filepath.Join(dir, "access.o"), filepath.Join(dir, "characters")
+	assert.NoError(t, fixtures.WriteAccessFile(accessPath, cfg))
+	assert.NoError(t, fixtures.WriteCharacters(charDir, cfg))
+	auth := authorization.NewAuthorizer(authorization.NewAccessFileSource(accessPath), users.NewFileSource(charDir), time.Hour)
+
+	// Configured names match the access.o groups "Arch_full" and
+	// "Arch_junior" whatever their case
+	l := NewBandwidthLimiter(0, 0, map[string]int64{"arch_full": 1 << 20, "ARCH_JUNIOR": 1 << 19})
+	defer l.Close()
+	// The fixture's first wizard is an arch also listed in Arch_junior
+	arch := l.attach(1, fixtures.WizardName(0), auth.ResolveGroups(fixtures.WizardName(0)))
+	if assert.True(t, arch != nil) {
+		assert.Equal(t, 2, len(arch.buckets))
+		assert.True(t, containsBucket(arch.buckets, l.groups["arch_full"]))
+		assert.True(t, containsBucket(arch.buckets, l.groups["arch_junior"]))
+	}
+	junior := l.attach(2, fixtures.WizardName(cfg.JuniorEach), auth.ResolveGroups(fixtures.WizardName(cfg.JuniorEach)))
+	if assert.True(t, junior != nil) {
+		assert.Equal(t, 1, len(junior.buckets))
+		assert.True(t, junior.buckets[0] == l.groups["arch_junior"])
+	}
+	assert.True(t, l.attach(3, fixtures.WizardName(1), auth.ResolveGroups(fixtures.WizardName(1))) == nil)
+
+	// A user listed under two spellings of a group takes its bucket once
+	both := l.attach(4, "drake", []string{"Arch_full", "arch_full"})
+	assert.Equal(t, 1, len(both.buckets))
+
+	assert.True(t, auth.DefinesGroup("arch_full"))
+	assert.True(t, auth.DefinesGroup("Arch_junior"))
+	assert.False(t, auth.DefinesGroup("arch_nobody"))
+}
+
+func TestFlow_Rate(t *testing.T) {
+	const rate = 1 << 20
+	l := NewBandwidthLimiter(rate, 0, nil)
+	defer l.Close()
+	f := l.attach(1, "drake", nil)
+
+	// The first quarter second of the rate is the burst
+	elapsed := drain(f, rate/4+rate/4)
+	assert.True(t, elapsed > 150*time.Millisecond, "took %v", elapsed)
+	assert.True(t, elapsed < time.Second, "took %v", elapsed)
+
+	var unlimited *flow
+	assert.Equal(t, 12345, unlimited.take(12345))
+}
+
+func TestFlow_SharedGlobal(t *testing.T) {
+	const rate = 1 << 20
+	l := NewBandwidthLimiter(rate, rate, nil)
+	defer l.Close()
+
+	// Two users each allowed the full rate still share the global bucket
+	start := time.Now()
+	var wg sync.WaitGroup
+	for id, user := range []string{"drake", "frodo"} {
+		f := l.attach(uint32(id), user, nil)
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			drain(f, rate/4)
+		}()
+	}
+	wg.Wait()
+	elapsed := time.Since(start)
+	assert.True(t, elapsed > 150*time.Millisecond, "took %v", elapsed)
+	assert.True(t, elapsed < time.Second, "took %v", elapsed)
+}
+
+func TestFlow_Close(t *testing.T) {
+	l := NewBandwidthLimiter(1024, 0, nil)
+	f := l.attach(1, "drake", nil)
+	f.take(minBurst)
+
+	done := make(chan struct{})
+	go func() {
+		f.take(1 << 20)
+		close(done)
+	}()
+	l.Close()
+	select {
+	case <-done:
+	case <-time.After(5 * time.Second):
+		t.Fatal("take did not return after Close")
+	}
+}
+
+func TestDownloadFile_Throttled(t *testing.T) {
+	const rate = 1 << 20
+	fs, path, data := downloadSource(t, rate/2)
+	cert := testCertificate(t)
+	for _, tt := range []struct {
+		name string
+		cert *tls.Certificate
+		copy func(w io.Writer, file io.Reader) (int64, error)
+	}{
+		{"plain", nil, io.Copy},
+		{"tls", &cert, io.Copy},
+		{"read", nil, func(w io.Writer, file io.Reader) (int64, error) {
+			// ASCII transfers read the file through ftpserverlib's converter
+			return io.Copy(w, struct{ io.Reader }{file})
+		}},
+	} {
+		t.Run(tt.name, func(t *testing.T) {
+			l := NewBandwidthLimiter(rate, 0, nil)
+			defer l.Close()
+			f, err := fs.Open(path)
+			assert.NoError(t, err)
+			file := newDownloadFile(f, l.attach(1, "drake", nil), nil)
+			defer file.Close()
+
+			var got bytes.Buffer
+			conn, received := dataConnection(t, tt.cert, &got)
+			start := time.Now()
+			n, err := tt.copy(conn, file)
+			elapsed := time.Since(start)
+			assert.NoError(t, err)
+			assert.Equal(t, int64(len(data)), n)
+			conn.Close()
+			assert.NoError(t, <-received)
+			assert.True(t, bytes.Equal(data, got.Bytes()))
+			assert.True(t, elapsed > 150*time.Millisecond, "took %v", elapsed)
+		})
+	}
+}
+
+func TestUploadFile_Throttled(t *testing.T) {
+	const rate = 1 << 20
+	l := NewBandwidthLimiter(rate, 0, nil)
+	defer l.Close()
+	fs, _, _ := downloadSource(t, 1)
+	data := uploadData(rate / 2)
+
+	f, err := fs.Create("/upload.o")
+	assert.NoError(t, err)
+	file := (&Server{}).newUploadFile(f, 0, l.attach(1, "drake", nil), nil)
+	start := time.Now()
+	n, err := io.Copy(file, &segmentedReader{data: data, segment: 1460})
+	elapsed := time.Since(start)
+	assert.NoError(t, err)
+	assert.Equal(t, int64(len(data)), n)
+	assert.NoError(t, file.Close())
+	assert.True(t, elapsed > 150*time.Millisecond, "took %v", elapsed)
+}
+
+// BenchmarkFlowTake measures the cost of taking bandwidth when it is plenty,
+// from many sessions at once
+func BenchmarkFlowTake(b *testing.B) {
+	l := NewBandwidthLimiter(1<<40, 1<<40, nil)
+	defer l.Close()
+	var id uint32
+	var mu sync.Mutex
+	b.RunParallel(func(pb *testing.PB) {
+		mu.Lock()
+		id++
+		f := l.attach(id, string(rune('a'+id%26)), nil)
+		mu.Unlock()
+		for pb.Next() {
+			f.take(4096)
+		}
+	})
+}
@@ -0,0 +1,218 @@
+package ftpserver
+
+import (
+	"container/list"
+	"fmt"
+	"io"
+	"os"
+	"sort"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/mmcdole/viking-ftpd/pkg/filewatch"
+	"github.com/spf13/afero"
+)
+
+// DefaultListingCacheSize is the default number of directories a
+// ListingCache keeps
+const DefaultListingCacheSize = 256
+
+// listingReadBatch is the number of entries read from a directory at once,
+// bounding the full os.FileInfo values held while a listing is built
+const listingReadBatch = 1024
+
+// Listing is a sorted, read-only directory listing. Entries are stored
+// compactly and shared by every session listing the directory.
+type Listing struct {
+	entries []listingEntry
+}
+
+// listingEntry is one directory entry. It implements os.FileInfo.
+type listingEntry struct {
+	name    string
+	size    int64
+	modTime int64 // Unix nanoseconds
+	mode    os.FileMode
+}
+
+func (e *listingEntry) Name() string       { return e.name }
+func (e *listingEntry) Size() int64        { return e.size }
+func (e *listingEntry) Mode() os.FileMode  { return e.mode }
+func (e *listingEntry) ModTime() time.Time { return time.Unix(0, e.modTime) }
+func (e *listingEntry) IsDir() bool        { return e.mode.IsDir() }
+func (e *listingEntry) Sys() interface{}   { return nil }
+
+// Len returns the number of entries
+func (l *Listing) Len() int {
+	return len(l.entries)
+}
+
+// FileInfos returns every entry in name order. The values point into the
+// listing, so no entry is copied.
+func (l *Listing) FileInfos() []os.FileInfo {
+	infos := make([]os.FileInfo, len(l.entries))
+	for i := range infos {
+		infos[i] = &l.entries[i]
+	}
+	return infos
+}
+
+// ListingCache keeps directory listings shared by all sessions. A listing is
+// reused while the directory's modification time and identity are unchanged
+// and it is younger than the TTL; the TTL bounds how long sizes and times of
+// files changed in place, which don't touch the directory, can be stale.
+// Sessions listing the same directory at once share a single read.
+type ListingCache struct {
+	ttl        time.Duration
+	maxEntries int
+
+	mu      sync.Mutex
+	entries map[string]*list.Element
+	order   *list.List // of *cachedListing, most recently used first
+
+	hits   atomic.Int64
+	misses atomic.Int64
+}
+
+// cachedListing is the listing of one directory, possibly still being read
+type cachedListing struct {
+	path     string
+	stamp    filewatch.Stamp
+	loadedAt time.Time
+	done     chan struct{} // closed once listing or err is set
+	listing  *Listing
+	err      error
+}
+
+// NewListingCache creates a cache reusing unchanged listings for up to ttl
+func NewListingCache(ttl time.Duration) *ListingCache {
+	return &ListingCache{
+		ttl:        ttl,
+		maxEntries: DefaultListingCacheSize,
+		entries:    make(map[string]*list.Element),
+		order:      list.New(),
+	}
+}
+
+// SetMaxEntries bounds the number of directories kept. When the cache is
+// full the least recently listed directory is dropped. It should be called
+// before the cache is used.
+func (c *ListingCache) SetMaxEntries(n int) {
+	if n > 0 {
+		c.maxEntries = n
+	}
+}
+
+// Get returns the listing of the directory at path in fs, reading it only
+// if the cached copy is missing, stale or the directory changed
+func (c *ListingCache) Get(fs afero.Fs, path string) (*Listing, error) {
+	fi, err := fs.Stat(path)
+	if err != nil {
+		return nil, err
+	}
+	if !fi.IsDir() {
+		return nil, fmt.Errorf("%s: not a directory", path)
+	}
+	stamp := filewatch.StampOf(fi)
+
+	c.mu.Lock()
+	if elem, ok := c.entries[path]; ok {
+		cached := elem.Value.(*cachedListing)
+		select {
+		case <-cached.done:
+			if cached.err == nil && cached.stamp.Equal(stamp) && time.Since(cached.loadedAt) < c.ttl {
+				c.order.MoveToFront(elem)
+				c.mu.Unlock()
+				c.hits.Add(1)
+				return cached.listing, nil
+			}
+		default:
+			// Another session is reading the directory; share its result
+			c.mu.Unlock()
+			c.hits.Add(1)
+			<-cached.done
+			return cached.listing, cached.err
+		}
+		c.removeLocked(elem)
+	}
+
+	cached := &cachedListing{path: path, stamp: stamp, done: make(chan struct{})}
+	c.entries[path] = c.order.PushFront(cached)
+	for c.order.Len() > c.maxEntries {
+		c.removeLocked(c.order.Back())
+	}
+	c.mu.Unlock()
+	c.misses.Add(1)
+
+	cached.listing, cached.err = readListing(fs, path)
+	cached.loadedAt = time.Now()
+	close(cached.done)
+
+	if cached.err != nil {
+		c.mu.Lock()
+		if elem, ok := c.entries[path]; ok && elem.Value == cached {
+			c.removeLocked(elem)
+		}
+		c.mu.Unlock()
+	}
+	return cached.listing, cached.err
+}
+
+// Invalidate drops the cached listing of a directory, so the next Get reads
+// it again
+func (c *ListingCache) Invalidate(path string) {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	if elem, ok := c.entries[path]; ok {
+		c.removeLocked(elem)
+	}
+}
+
+// Hits returns the number of listings served without reading the directory
+func (c *ListingCache) Hits() int64 {
+	return c.hits.Load()
+}
+
+// Misses returns the number of listings that read the directory
+func (c *ListingCache) Misses() int64 {
+	return c.misses.Load()
+}
+
+func (c *ListingCache) removeLocked(elem *list.Element) {
+	delete(c.entries, elem.Value.(*cachedListing).path)
+	c.order.Remove(elem)
+}
+
+// readListing reads and sorts a directory, a batch of entries at a time
+func readListing(fs afero.Fs, path string) (*Listing, error) {
+	f, err := fs.Open(path)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+
+	listing := &Listing{}
+	for {
+		batch, err := f.Readdir(listingReadBatch)
+		for _, fi := range batch {
+			listing.entries = append(listing.entries, listingEntry{
+				name:    fi.Name(),
+				size:    fi.Size(),
+				modTime: fi.ModTime().UnixNano(),
+				mode:    fi.Mode(),
+			})
+		}
+		if err == io.EOF || (err == nil && len(batch) == 0) {
+			break
+		}
+		if err != nil {
+			return nil, err
+		}
+	}
+
+	sort.Slice(listing.entries, func(i, j int) bool {
+		return listing.entries[i].name < listing.entries[j].name
+	})
+	return listing, nil
+}
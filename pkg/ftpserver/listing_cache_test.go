@@ -0,0 +1,166 @@
+package ftpserver
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"sort"
+	"sync"
+	"testing"
+	"time"
+
+	"github.com/spf13/afero"
+	"github.com/stretchr/testify/assert"
+)
+
+// listingDir creates a directory holding files named by names
+func listingDir(t testing.TB, names ...string) (afero.Fs, string) {
+	t.Helper()
+	root := t.TempDir()
+	if err := os.Mkdir(filepath.Join(root, "dir"), 0755); err != nil {
+		t.Fatal(err)
+	}
+	for _, name := range names {
+		if err := os.WriteFile(filepath.Join(root, "dir", name), []byte(name), 0644); err != nil {
+			t.Fatal(err)
+		}
+	}
+	return afero.NewBasePathFs(afero.NewOsFs(), root), "/dir"
+}
+
+func listingNames(l *Listing) []string {
+	var names []string
+	for _, fi := range l.FileInfos() {
+		names = append(names, fi.Name())
+	}
+	return names
+}
+
+func TestListingCache_Get(t *testing.T) {
+	fs, dir := listingDir(t, "c.c", "a.c", "bb.c")
+	cache := NewListingCache(time.Hour)
+
+	listing, err := cache.Get(fs, dir)
+	assert.NoError(t, err)
+	assert.Equal(t, []string{"a.c", "bb.c", "c.c"}, listingNames(listing))
+
+	infos := listing.FileInfos()
+	assert.Equal(t, 3, len(infos))
+	assert.Equal(t, int64(4), infos[1].Size())
+	assert.False(t, infos[1].IsDir())
+
+	// Unchanged, the same listing is served
+	again, err := cache.Get(fs, dir)
+	assert.NoError(t, err)
+	assert.True(t, again == listing)
+	assert.Equal(t, int64(1), cache.Hits())
+	assert.Equal(t, int64(1), cache.Misses())
+}
+
+func TestListingCache_Revalidation(t *testing.T) {
+	fs, dir := listingDir(t, "a.c")
+	cache := NewListingCache(time.Hour)
+	first, _ := cache.Get(fs, dir)
+
+	// Adding a file changes the directory's mtime
+	future := time.Now().Add(time.Minute)
+	f, err := fs.Create("/dir/b.c")
+	assert.NoError(t, err)
+	f.Close()
+	assert.NoError(t, fs.Chtimes(dir, future, future))
+	second, _ := cache.Get(fs, dir)
+	assert.Equal(t, []string{"a.c", "b.c"}, listingNames(second))
+	assert.False(t, first == second)
+
+	// Invalidate forces a re-read even if the directory looks unchanged
+	cache.Invalidate(dir)
+	third, _ := cache.Get(fs, dir)
+	assert.False(t, second == third)
+
+	// So does an expired TTL
+	short := NewListingCache(time.Nanosecond)
+	a, _ := short.Get(fs, dir)
+	b, _ := short.Get(fs, dir)
+	assert.False(t, a == b)
+}
+
+func TestListingCache_LargeDirectory(t *testing.T) {
+	// More entries than one batch of directory reads
+	var names []string
+	for i := 0; i < 2500; i++ {
+		names = append(names, fmt.Sprintf("f%04d", i))
+	}
+	fs, dir := listingDir(t, names...)
+	listing, err := NewListingCache(time.Hour).Get(fs, dir)
+	assert.NoError(t, err)
+	assert.Equal(t, 2500, listing.Len())
+	assert.Equal(t, names, listingNames(listing))
+}
+
+func TestListingCache_Eviction(t *testing.T) {
+	fs, _ := listingDir(t)
+	for _, d := range []string{"/one", "/two", "/three"} {
+		assert.NoError(t, fs.Mkdir(d, 0755))
+	}
+	cache := NewListingCache(time.Hour)
+	cache.SetMaxEntries(2)
+	for _, d := range []string{"/one", "/two", "/three", "/one"} {
+		_, err := cache.Get(fs, d)
+		assert.NoError(t, err)
+	}
+	assert.Equal(t, int64(4), cache.Misses(), "the oldest listing should have been evicted")
+}
+
+func TestListingCache_Errors(t *testing.T) {
+	fs, _ := listingDir(t, "file.c")
+	cache := NewListingCache(time.Hour)
+
+	_, err := cache.Get(fs, "/missing")
+	assert.Error(t, err)
+	_, err = cache.Get(fs, "/dir/file.c")
+	assert.Error(t, err)
+}
+
+func TestListingCache_Concurrent(t *testing.T) {
+	fs, dir := listingDir(t, "a.c", "b.c")
+	cache := NewListingCache(time.Hour)
+
+	var wg sync.WaitGroup
+	for i := 0; i < 16; i++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			listing, err := cache.Get(fs, dir)
+			assert.NoError(t, err)
+			assert.Equal(t, 2, listing.Len())
+		}()
+	}
+	wg.Wait()
+	assert.Equal(t, int64(16), cache.Hits()+cache.Misses())
+}
+
+func BenchmarkReadDir(b *testing.B) {
+	var names []string
+	for i := 0; i < 20000; i++ {
+		names = append(names, fmt.Sprintf("wizard%05d", i))
+	}
+	fs, dir := listingDir(b, names...)
+
+	b.Run("Uncached", func(b *testing.B) {
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			f, _ := fs.Open(dir)
+			entries, _ := f.Readdir(-1)
+			f.Close()
+			sort.Slice(entries, func(i, j int) bool { return entries[i].Name() < entries[j].Name() })
+		}
+	})
+	b.Run("Cached", func(b *testing.B) {
+		cache := NewListingCache(time.Hour)
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			listing, _ := cache.Get(fs, dir)
+			_ = listing.FileInfos()
+		}
+	})
+}
@@ -0,0 +1,81 @@
+package ftpserver
+
+import (
+	"github.com/mmcdole/viking-ftpd/pkg/metrics"
+)
+
+// serverMetrics are the metrics the server updates as it goes. All are nil,
+// and cost nothing, unless SetMetrics was called.
+type serverMetrics struct {
+	authSuccess *metrics.Histogram
+	authFailure *metrics.Histogram
+	retrBytes   *metrics.Counter
+	storBytes   *metrics.Counter
+	retrs       *metrics.Counter
+	stors       *metrics.Counter
+}
+
+// SetMetrics registers the server's metrics with reg: login latency, bytes
+// and files moved per transfer direction, the duration of permission checks
+// that miss the session caches, and the counts the status file reports. It
+// should be called before Start.
+func (s *Server) SetMetrics(reg *metrics.Registry) {
+	auth := reg.NewHistogramVec("vkftpd_auth_duration_seconds",
+		"Time taken to verify a login, including waiting for a verification slot.",
+		metrics.DurationBuckets, "result", "success", "failure")
+	s.metrics.authSuccess, s.metrics.authFailure = auth[0], auth[1]
+
+	bytes := reg.NewCounterVec("vkftpd_transfer_bytes_total", "Bytes moved by file transfers.", "op", "retr", "stor")
+	s.metrics.retrBytes, s.metrics.storBytes = bytes[0], bytes[1]
+	transfers := reg.NewCounterVec("vkftpd_transfers_total", "Files opened for transfer.", "op", "retr", "stor")
+	s.metrics.retrs, s.metrics.stors = transfers[0], transfers[1]
+
+	s.permCacheStats.SetResolveHistogram(reg.NewHistogram("vkftpd_permission_resolve_duration_seconds",
+		"Time taken to resolve a permission missing from the session cache.", metrics.DurationBuckets))
+
+	reg.NewGaugeFunc("vkftpd_active_connections", "Sessions currently admitted.", func() float64 {
+		return float64(s.GetActiveConnections())
+	})
+	reg.NewCounterFunc("vkftpd_connections_total", "Sessions accepted since start.", func() float64 {
+		return float64(s.GetTotalConnections())
+	})
+	reg.NewCounterFunc("vkftpd_rejected_connections_total", "Sessions refused by connection limits.", func() float64 {
+		return float64(s.GetRejectedConnections())
+	})
+	reg.NewCounterFunc("vkftpd_rejected_logins_total", "Logins refused by the per-user limit.", func() float64 {
+		return float64(s.GetRejectedLogins())
+	})
+	reg.NewGaugeFunc("vkftpd_pending_logins", "Sessions admitted but not logged in.", func() float64 {
+		return float64(s.GetPendingLogins())
+	})
+	reg.NewCounterFunc("vkftpd_permission_cache_hits_total", "Permission checks answered from session caches.", func() float64 {
+		return float64(s.GetPermissionCacheHits())
+	})
+	reg.NewCounterFunc("vkftpd_permission_cache_misses_total", "Permission checks resolved against the access trees.", func() float64 {
+		return float64(s.GetPermissionCacheMisses())
+	})
+	reg.NewCounterFunc("vkftpd_listing_cache_hits_total", "Directory listings served from the listing cache.", func() float64 {
+		return float64(s.GetListingCacheHits())
+	})
+	reg.NewCounterFunc("vkftpd_listing_cache_misses_total", "Directory listings read from disk.", func() float64 {
+		return float64(s.GetListingCacheMisses())
+	})
+	reg.NewGaugeFunc("vkftpd_verify_queue_depth", "Logins waiting for a password verification slot.", func() float64 {
+		return float64(s.GetVerifyQueueDepth())
+	})
+	reg.NewCounterFunc("vkftpd_verify_rejected_total", "Logins refused because the verification queue was full or they waited too long.", func() float64 {
+		return float64(s.GetVerifyRejected())
+	})
+	reg.NewCounterFunc("vkftpd_verify_wait_seconds_total", "Time logins spent waiting for a verification slot.", func() float64 {
+		if s.verifyScheduler == nil {
+			return 0
+		}
+		return s.verifyScheduler.Stats().TotalWait.Seconds()
+	})
+	reg.NewCounterFunc("vkftpd_tls_handshakes_total", "TLS handshakes completed.", func() float64 {
+		return float64(s.GetTLSHandshakes())
+	})
+	reg.NewCounterFunc("vkftpd_tls_resumed_handshakes_total", "TLS handshakes that resumed a session.", func() float64 {
+		return float64(s.GetTLSResumedHandshakes())
+	})
+}
@@ -0,0 +1,55 @@
+package ftpserver
+
+import (
+	"bytes"
+	"io"
+	"strings"
+	"testing"
+
+	"github.com/mmcdole/viking-ftpd/pkg/metrics"
+	"github.com/stretchr/testify/assert"
+)
+
+func TestServer_SetMetrics(t *testing.T) {
+	reg := metrics.NewRegistry()
+	s := &Server{admission: newAdmission(0, 0, 0)}
+	s.SetMetrics(reg)
+
+	// Downloads count what reaches the connection, whichever way it is copied
+	fs, path, data := downloadSource(t, 3*transferBufferSize+1)
+	for _, copy := range []func(io.Writer, io.Reader) (int64, error){
+		io.Copy,
+		func(w io.Writer, r io.Reader) (int64, error) { return io.Copy(w, struct{ io.Reader }{r}) },
+	} {
+		f, err := fs.Open(path)
+		assert.NoError(t, err)
+		file := newDownloadFile(f, nil, s.metrics.retrBytes)
+		_, err = copy(io.Discard, file)
+		assert.NoError(t, err)
+		file.Close()
+	}
+	assert.Equal(t, int64(2*len(data)), s.metrics.retrBytes.Value())
+
+	// Uploads count what was accepted from the connection
+	f, err := fs.Create("/upload.o")
+	assert.NoError(t, err)
+	file := s.newUploadFile(f, 0, nil, nil)
+	_, err = io.Copy(file, bytes.NewReader(data))
+	assert.NoError(t, err)
+	_, err = file.Write(data[:10])
+	assert.NoError(t, err)
+	assert.NoError(t, file.Close())
+	assert.Equal(t, int64(len(data)+10), s.metrics.storBytes.Value())
+
+	var out strings.Builder
+	_, err = reg.WriteTo(&out)
+	assert.NoError(t, err)
+	for _, want := range []string{
+		`vkftpd_transfer_bytes_total{op="stor"} 786443`,
+		`vkftpd_auth_duration_seconds_count{result="failure"} 0`,
+		"vkftpd_active_connections 0",
+		"vkftpd_listing_cache_hits_total 0",
+	} {
+		assert.True(t, strings.Contains(out.String(), want), "missing %q in\n%s", want, out.String())
+	}
+}
@@ -7,6 +7,7 @@ import (
 	"os"
 	"path/filepath"
 	"sort"
+	"sync"
 	"sync/atomic"
 	"time"
 
@@ -14,6 +15,7 @@ import (
 	"github.com/mmcdole/viking-ftpd/pkg/authentication"
 	"github.com/mmcdole/viking-ftpd/pkg/authorization"
 	"github.com/mmcdole/viking-ftpd/pkg/logging"
+	"github.com/mmcdole/viking-ftpd/pkg/metrics"
 	"github.com/spf13/afero"
 )
 
@@ -28,6 +30,11 @@ type Config struct {
 	PasvPortRange [2]int // Range of ports for passive mode transfers
 	PasvAddress   string // Public IP for passive mode connections
 	PasvIPVerify  bool   // Whether to verify data connection IPs
+
+	MaxConnections        int // Maximum concurrent sessions (0 = unlimited)
+	MaxConnectionsPerIP   int // Maximum concurrent sessions from one client IP (0 = unlimited)
+	MaxConnectionsPerUser int // Maximum concurrent sessions logged in as one user (0 = unlimited)
+	IdleTimeout           int // Seconds a session may be idle before it is closed (0 = never)
 }
 
 // Server wraps the FTP server with our custom auth
@@ -39,9 +46,26 @@ type Server struct {
 	version           string
 	activeConnections atomic.Int32
 	totalConnections  atomic.Int64
+	admission         *admission
+	permCacheStats    authorization.CacheStats
+	verifyScheduler   *authentication.Scheduler
+	listings          *ListingCache
+	hideUnreadable    bool
+	uploadBuffers     *bufferPool
+	uploadSync        UploadSync
+	syncer            *syncBatcher
+	bandwidth         *BandwidthLimiter
+	metrics           serverMetrics
+	tlsMu             sync.Mutex
+	tls               *tls.Config
+	tlsHandshakes     atomic.Int64
+	tlsResumed        atomic.Int64
 	startTime         time.Time
 }
 
+// permissionCacheSize is the number of paths each session memoizes permissions for
+const permissionCacheSize = 512
+
 // New creates a new FTP server
 func New(config *Config, authorizer *authorization.Authorizer, authenticator *authentication.Authenticator, version string) (*Server, error) {
 	// Validate config
@@ -54,6 +78,7 @@ func New(config *Config, authorizer *authorization.Authorizer, authenticator *au
 		authorizer:    authorizer,
 		authenticator: authenticator,
 		version:       version,
+		admission:     newAdmission(config.MaxConnections, config.MaxConnectionsPerIP, config.MaxConnectionsPerUser),
 		startTime:     time.Now(),
 	}
 
@@ -73,7 +98,14 @@ func (s *Server) ListenAndServe() error {
 
 // Stop stops the server
 func (s *Server) Stop() error {
-	return s.server.Stop()
+	err := s.server.Stop()
+	if s.syncer != nil {
+		s.syncer.Close()
+	}
+	if s.bandwidth != nil {
+		s.bandwidth.Close()
+	}
+	return err
 }
 
 // GetActiveConnections returns the current number of active connections
@@ -86,6 +118,165 @@ func (s *Server) GetTotalConnections() int64 {
 	return s.totalConnections.Load()
 }
 
+// GetRejectedConnections returns the number of connections refused because
+// the server or the client's address had no session slot left
+func (s *Server) GetRejectedConnections() int64 {
+	return s.admission.rejectedConnections.Load()
+}
+
+// GetRejectedLogins returns the number of logins refused because the user had
+// no session slot left
+func (s *Server) GetRejectedLogins() int64 {
+	return s.admission.rejectedLogins.Load()
+}
+
+// GetPendingLogins returns the number of connected sessions that have not
+// logged in yet
+func (s *Server) GetPendingLogins() int {
+	return s.admission.pendingLogins()
+}
+
+// GetPermissionCacheHits returns the number of permission checks answered from session caches
+func (s *Server) GetPermissionCacheHits() int64 {
+	return s.permCacheStats.Hits()
+}
+
+// GetPermissionCacheMisses returns the number of permission checks that were resolved against the access trees
+func (s *Server) GetPermissionCacheMisses() int64 {
+	return s.permCacheStats.Misses()
+}
+
+// GetListingCacheHits returns the number of directory listings served from the listing cache
+func (s *Server) GetListingCacheHits() int64 {
+	if s.listings == nil {
+		return 0
+	}
+	return s.listings.Hits()
+}
+
+// GetListingCacheMisses returns the number of directory listings read from disk
+func (s *Server) GetListingCacheMisses() int64 {
+	if s.listings == nil {
+		return 0
+	}
+	return s.listings.Misses()
+}
+
+// GetAuthLatency returns the bucket counts of login verification times,
+// successful and failed alike. It is empty unless SetMetrics was called.
+func (s *Server) GetAuthLatency() metrics.HistogramSnapshot {
+	return s.metrics.authSuccess.Snapshot().Add(s.metrics.authFailure.Snapshot())
+}
+
+// GetAccessGeneration returns the generation of the access trees in use
+func (s *Server) GetAccessGeneration() uint64 {
+	generation, _ := s.authorizer.Loaded()
+	return generation
+}
+
+// GetAccessLoadedAt returns when the access trees in use were loaded, or the
+// zero time if none have been
+func (s *Server) GetAccessLoadedAt() time.Time {
+	_, loadedAt := s.authorizer.Loaded()
+	return loadedAt
+}
+
+// SetVerifyScheduler registers the scheduler the authenticator verifies
+// passwords through, so that its queue is reported with the other metrics.
+// It should be called before the server is started.
+func (s *Server) SetVerifyScheduler(scheduler *authentication.Scheduler) {
+	s.verifyScheduler = scheduler
+}
+
+// SetListingCache shares directory listings between sessions through cache.
+// Without one, every LIST reads the directory. It should be called before
+// the server is started.
+func (s *Server) SetListingCache(cache *ListingCache) {
+	s.listings = cache
+}
+
+// SetHideUnreadable leaves entries the user cannot read out of directory
+// listings. It should be called before the server is started.
+func (s *Server) SetHideUnreadable(hide bool) {
+	s.hideUnreadable = hide
+}
+
+// SetUploadBufferSize sets the size of the buffer each upload is written
+// through. It should be called before the server is started.
+func (s *Server) SetUploadBufferSize(size int) {
+	if size > 0 {
+		s.uploadBuffers = newBufferPool(size)
+	}
+}
+
+// SetUploadSync selects when uploads are flushed to stable storage. With
+// SyncBatch, closed uploads are synced together every interval. It should be
+// called before the server is started.
+func (s *Server) SetUploadSync(mode UploadSync, interval time.Duration) {
+	s.uploadSync = mode
+	if mode == SyncBatch {
+		if interval <= 0 {
+			interval = DefaultSyncInterval
+		}
+		s.syncer = newSyncBatcher(interval)
+	}
+}
+
+// SetBandwidthLimiter throttles every session's transfers through limiter,
+// which the server closes when it is stopped. It should be called before the
+// server is started.
+func (s *Server) SetBandwidthLimiter(limiter *BandwidthLimiter) {
+	s.bandwidth = limiter
+}
+
+// GetVerifyQueueDepth returns the number of login attempts waiting for password verification
+func (s *Server) GetVerifyQueueDepth() int {
+	if s.verifyScheduler == nil {
+		return 0
+	}
+	return s.verifyScheduler.Stats().QueueDepth
+}
+
+// GetVerifyWaitAverage returns the average time login attempts waited for password verification
+func (s *Server) GetVerifyWaitAverage() time.Duration {
+	if s.verifyScheduler == nil {
+		return 0
+	}
+	stats := s.verifyScheduler.Stats()
+	if stats.Completed == 0 {
+		return 0
+	}
+	return stats.TotalWait / time.Duration(stats.Completed)
+}
+
+// GetVerifyWaitMax returns the longest time a login attempt waited for password verification
+func (s *Server) GetVerifyWaitMax() time.Duration {
+	if s.verifyScheduler == nil {
+		return 0
+	}
+	return s.verifyScheduler.Stats().MaxWait
+}
+
+// GetVerifyRejected returns the number of login attempts refused because the verification queue was full or they waited too long
+func (s *Server) GetVerifyRejected() int64 {
+	if s.verifyScheduler == nil {
+		return 0
+	}
+	stats := s.verifyScheduler.Stats()
+	return int64(stats.Rejected + stats.TimedOut)
+}
+
+// GetTLSHandshakes returns the number of completed TLS handshakes
+func (s *Server) GetTLSHandshakes() int64 {
+	return s.tlsHandshakes.Load()
+}
+
+// GetTLSResumedHandshakes returns the number of TLS handshakes that resumed
+// an earlier session instead of doing a full handshake
+func (s *Server) GetTLSResumedHandshakes() int64 {
+	return s.tlsResumed.Load()
+}
+
 // GetStartTime returns the server start time
 func (s *Server) GetStartTime() time.Time {
 	return s.startTime
@@ -109,6 +300,11 @@ func (d *ftpDriver) GetSettings() (*ftpserverlib.Settings, error) {
 		},
 		TLSRequired:       ftpserverlib.ClearOrEncrypted,
 		DisableActiveMode: true,
+		IdleTimeout:       d.server.config.IdleTimeout,
+	}
+	if settings.IdleTimeout <= 0 {
+		// ftpserverlib applies its own default to zero; negative disables it
+		settings.IdleTimeout = -1
 	}
 
 	if d.server.config.PasvAddress != "" {
@@ -127,11 +323,17 @@ func (d *ftpDriver) GetSettings() (*ftpserverlib.Settings, error) {
 // ClientConnected is called when a client connects
 // Interface: ftpserverlib.MainDriver
 func (d *ftpDriver) ClientConnected(cc ftpserverlib.ClientContext) (string, error) {
-	// Increment active connection counter
-	d.server.activeConnections.Add(1)
 	// Increment total connection counter
 	d.server.totalConnections.Add(1)
 
+	// Refuse the session before it can log in if no slot is left
+	if err := d.server.admission.connect(cc.ID(), hostOf(cc.RemoteAddr())); err != nil {
+		logging.Access.LogAccess("connect", "", cc.RemoteAddr().String(), "denied", "error", err)
+		return "Too many connections, try again later", err
+	}
+	// Increment active connection counter
+	d.server.activeConnections.Add(1)
+
 	// Enable debug logging if log level is debug
 	if logging.App.IsDebug() {
 		cc.SetDebug(true)
@@ -143,21 +345,47 @@ func (d *ftpDriver) ClientConnected(cc ftpserverlib.ClientContext) (string, erro
 // ClientDisconnected is called when a client disconnects
 // Interface: ftpserverlib.MainDriver
 func (d *ftpDriver) ClientDisconnected(cc ftpserverlib.ClientContext) {
-	// Decrement active connection counter
-	d.server.activeConnections.Add(-1)
+	// Decrement active connection counter, unless the session was refused
+	if d.server.admission.disconnect(cc.ID()) {
+		d.server.activeConnections.Add(-1)
+	}
+	if d.server.bandwidth != nil {
+		d.server.bandwidth.detach(cc.ID())
+	}
 
 	logging.Access.LogAccess("disconnect", "", cc.RemoteAddr().String(), "success")
 }
 
+// PreAuthUser refuses a user with no session slot left before the password
+// is sent, so the login costs no verification
+// Interface: ftpserverlib.MainDriverExtensionUserVerifier
+func (d *ftpDriver) PreAuthUser(cc ftpserverlib.ClientContext, user string) error {
+	if err := d.server.admission.checkUser(cc.ID(), user); err != nil {
+		logging.Access.LogAuth("login", user, "denied", "error", err, "client_ip", cc.RemoteAddr().String())
+		return err
+	}
+	return nil
+}
+
 // AuthUser authenticates the user and returns a ClientDriver
 // Interface: ftpserverlib.MainDriver
 func (d *ftpDriver) AuthUser(cc ftpserverlib.ClientContext, user, pass string) (ftpserverlib.ClientDriver, error) {
-	// Authenticate user
-	_, err := d.server.authenticator.Authenticate(user, pass)
+	// Authenticate user, queueing password verification by client IP
+	start := time.Now()
+	_, err := d.server.authenticator.AuthenticateFrom(user, pass, hostOf(cc.RemoteAddr()))
 	if err != nil {
+		d.server.metrics.authFailure.Observe(time.Since(start).Seconds())
 		logging.Access.LogAuth("login", user, "failed", "error", err, "client_ip", cc.RemoteAddr().String())
 		return nil, fmt.Errorf("authentication failed")
 	}
+	d.server.metrics.authSuccess.Observe(time.Since(start).Seconds())
+
+	// Take one of the user's session slots; others may have logged in while
+	// the password was verified
+	if err := d.server.admission.login(cc.ID(), user); err != nil {
+		logging.Access.LogAuth("login", user, "denied", "error", err, "client_ip", cc.RemoteAddr().String())
+		return nil, err
+	}
 
 	// Create filesystem with root already handled
 	fs := afero.NewBasePathFs(afero.NewOsFs(), d.server.config.RootDir)
@@ -176,6 +404,15 @@ func (d *ftpDriver) AuthUser(cc ftpserverlib.ClientContext, user, pass string) (
 
 	cc.SetDebug(logging.App.IsDebug())
 
+	var flow *flow
+	if d.server.bandwidth != nil {
+		var groups []string
+		if len(d.server.bandwidth.groups) > 0 {
+			groups = d.server.authorizer.ResolveGroups(user)
+		}
+		flow = d.server.bandwidth.attach(cc.ID(), user, groups)
+	}
+
 	logging.Access.LogAuth("login", user, "success", "client_ip", cc.RemoteAddr().String())
 	return &ftpClient{
 		server:   d.server,
@@ -184,6 +421,8 @@ func (d *ftpDriver) AuthUser(cc ftpserverlib.ClientContext, user, pass string) (
 		rootPath: d.server.config.RootDir,
 		fs:       fs,
 		cc:       cc,
+		perms:    authorization.NewPermissionCache(d.server.authorizer, user, permissionCacheSize, &d.server.permCacheStats),
+		flow:     flow,
 	}, nil
 }
 
@@ -195,15 +434,7 @@ func (d *ftpDriver) GetTLSConfig() (*tls.Config, error) {
 		return nil, errNoTLS
 	}
 
-	cert, err := tls.LoadX509KeyPair(d.server.config.TLSCertFile, d.server.config.TLSKeyFile)
-	if err != nil {
-		return nil, fmt.Errorf("loading TLS cert/key pair: %v", err)
-	}
-
-	return &tls.Config{
-		Certificates: []tls.Certificate{cert},
-		MinVersion:   tls.VersionTLS12,
-	}, nil
+	return d.server.tlsConfig()
 }
 
 // ftpClient implements ftpserverlib.ClientDriver and afero.Fs
@@ -214,18 +445,16 @@ type ftpClient struct {
 	homePath string                     // User's home directory path (relative to root)
 	rootPath string                     // Server's root directory absolute path
 	cc       ftpserverlib.ClientContext // Current client context
+	perms    *authorization.PermissionCache
+	allocate atomic.Int64 // Size announced by ALLO for the next upload
+	flow     *flow        // Bandwidth the session's transfers draw from (nil = unthrottled)
 }
 
-// resolvePath converts FTP protocol paths to filesystem paths
-func (c *ftpClient) resolvePath(name string) (string, error) {
-	// If path is absolute, it's relative to root
-	if filepath.IsAbs(name) {
-		return filepath.Clean(name), nil
-	}
-
-	// Otherwise, it's relative to current directory
-	currentPath := c.cc.Path()
-	return filepath.Clean(filepath.Join(currentPath, name)), nil
+// resolvePath converts an FTP protocol path, absolute or relative to the
+// current directory, into the canonical path that is both authorized and
+// accessed
+func (c *ftpClient) resolvePath(name string) authorization.Path {
+	return authorization.JoinPath(c.cc.Path(), name)
 }
 
 // GetFS returns the filesystem
@@ -236,29 +465,37 @@ func (c *ftpClient) GetFS() afero.Fs {
 
 // ChangeCwd implements directory change
 // Interface: ftpserverlib.ClientDriver
-func (c *ftpClient) ChangeCwd(path string) error {
-	if !c.server.authorizer.CanRead(c.user, path) {
-		logging.Access.LogAccess("chdir", c.user, path, "denied")
+func (c *ftpClient) ChangeCwd(name string) error {
+	path := c.resolvePath(name)
+	if !c.perms.CanRead(path) {
+		logging.Access.LogAccess("chdir", c.user, path.String(), "denied")
 		return os.ErrPermission
 	}
-	logging.Access.LogAccess("chdir", c.user, path, "success")
+	logging.Access.LogAccess("chdir", c.user, path.String(), "success")
 	return nil
 }
 
 // ReadDir is required for directory listing
 // Interface: ftpserverlib.ClientDriver
 func (c *ftpClient) ReadDir(name string) ([]os.FileInfo, error) {
-	path, err := c.resolvePath(name)
-	if err != nil {
-		return nil, err
-	}
+	path := c.resolvePath(name)
 
-	if !c.server.authorizer.CanRead(c.user, path) {
-		logging.Access.LogAccess("readdir", c.user, path, "denied", "error", os.ErrPermission)
+	if !c.perms.CanRead(path) {
+		logging.Access.LogAccess("readdir", c.user, path.String(), "denied", "error", os.ErrPermission)
 		return nil, os.ErrPermission
 	}
 
-	f, err := c.fs.Open(path)
+	if c.server.listings != nil {
+		listing, err := c.server.listings.Get(c.fs, path.String())
+		if err != nil {
+			return nil, err
+		}
+		entries := c.readable(path, listing.FileInfos())
+		logging.Access.LogAccess("readdir", c.user, path.String(), "success", "count", len(entries))
+		return entries, nil
+	}
+
+	f, err := c.fs.Open(path.String())
 	if err != nil {
 		return nil, err
 	}
@@ -280,29 +517,59 @@ func (c *ftpClient) ReadDir(name string) ([]os.FileInfo, error) {
 	sort.Slice(entries, func(i, j int) bool {
 		return entries[i].Name() < entries[j].Name()
 	})
+	entries = c.readable(path, entries)
 
-	logging.Access.LogAccess("readdir", c.user, path, "success", "count", len(entries))
+	logging.Access.LogAccess("readdir", c.user, path.String(), "success", "count", len(entries))
 	return entries, nil
 }
 
+// readable drops the entries of dir the user cannot read, if the server
+// hides them. All entries are authorized in one batch, which also leaves
+// their permissions in the session cache for the Stat and Open calls
+// clients tend to make next.
+func (c *ftpClient) readable(dir authorization.Path, entries []os.FileInfo) []os.FileInfo {
+	if !c.server.hideUnreadable {
+		return entries
+	}
+	names := make([]string, len(entries))
+	for i, fi := range entries {
+		names[i] = fi.Name()
+	}
+	perms := c.perms.ResolveChildren(dir, names)
+
+	kept := entries[:0]
+	for i, fi := range entries {
+		if perms[i].CanRead() {
+			kept = append(kept, fi)
+		}
+	}
+	return kept
+}
+
+// changed drops the cached listing of the directory holding path after this
+// session modified it
+func (c *ftpClient) changed(path authorization.Path) {
+	if c.server.listings != nil {
+		c.server.listings.Invalidate(path.Dir().String())
+	}
+}
+
 // DeleteFile implements file deletion
 // Interface: ftpserverlib.ClientDriver
 func (c *ftpClient) DeleteFile(name string) error {
-	path, err := c.resolvePath(name)
-	if err != nil {
-		return err
-	}
+	path := c.resolvePath(name)
 
-	if !c.server.authorizer.CanWrite(c.user, path) {
-		logging.Access.LogAccess("remove", c.user, name, "denied", "error", err)
+	if !c.perms.CanWrite(path) {
+		logging.Access.LogAccess("remove", c.user, name, "denied", "error", os.ErrPermission)
 		return os.ErrPermission
 	}
 
-	if err := c.fs.Remove(path); err != nil {
+	if err := c.fs.Remove(path.String()); err != nil {
 		logging.Access.LogAccess("remove", c.user, name, "error", "error", err)
 		return err
 	}
 
+	c.changed(path)
 	logging.Access.LogAccess("remove", c.user, name, "success")
 	return nil
 }
@@ -310,229 +577,225 @@ func (c *ftpClient) DeleteFile(name string) error {
 // MakeDirectory implements directory creation
 // Interface: ftpserverlib.ClientDriver
 func (c *ftpClient) MakeDirectory(name string) error {
-	if !c.server.authorizer.CanWrite(c.user, name) {
-		logging.Access.LogAccess("mkdir", c.user, name, "denied", "error", os.ErrPermission)
+	path := c.resolvePath(name)
+
+	if !c.perms.CanWrite(path) {
+		logging.Access.LogAccess("mkdir", c.user, path.String(), "denied", "error", os.ErrPermission)
 		return os.ErrPermission
 	}
 
-	if err := c.fs.Mkdir(name, 0755); err != nil {
-		logging.Access.LogAccess("mkdir", c.user, name, "error", "error", err)
+	if err := c.fs.Mkdir(path.String(), 0755); err != nil {
+		logging.Access.LogAccess("mkdir", c.user, path.String(), "error", "error", err)
 		return err
 	}
 
-	logging.Access.LogAccess("mkdir", c.user, name, "success")
+	c.changed(path)
+	logging.Access.LogAccess("mkdir", c.user, path.String(), "success")
+	return nil
+}
+
+// AllocateSpace records the size announced by ALLO, so the next upload can
+// preallocate its disk space
+// Interface: ftpserverlib.ClientDriverExtensionAllocate
+func (c *ftpClient) AllocateSpace(size int) error {
+	if size > 0 {
+		c.allocate.Store(int64(size))
+	}
 	return nil
 }
 
 // Open opens a file for reading
 // Interface: afero.Fs
 func (c *ftpClient) Open(name string) (afero.File, error) {
-	path, err := c.resolvePath(name)
-	if err != nil {
-		return nil, err
-	}
+	path := c.resolvePath(name)
 
-	if !c.server.authorizer.CanRead(c.user, path) {
-		logging.Access.LogAccess("open", c.user, path, "denied", "error", os.ErrPermission)
+	if !c.perms.CanRead(path) {
+		logging.Access.LogAccess("open", c.user, path.String(), "denied", "error", os.ErrPermission)
 		return nil, os.ErrPermission
 	}
 
-	file, err := c.fs.Open(path)
+	file, err := c.fs.Open(path.String())
 	if err != nil {
-		logging.Access.LogAccess("open", c.user, path, "error", "error", err)
+		logging.Access.LogAccess("open", c.user, path.String(), "error", "error", err)
 		return nil, err
 	}
 
 	// Get file size for logging
 	if fi, err := file.Stat(); err == nil {
-		logging.Access.LogAccess("open", c.user, path, "success", "size", fi.Size())
+		logging.Access.LogAccess("open", c.user, path.String(), "success", "size", fi.Size())
 	} else {
-		logging.Access.LogAccess("open", c.user, path, "success", "size", 0)
+		logging.Access.LogAccess("open", c.user, path.String(), "success", "size", 0)
 	}
-	return file, nil
+	c.server.metrics.retrs.Inc()
+	return newDownloadFile(file, c.flow, c.server.metrics.retrBytes), nil
 }
 
 // OpenFile opens a file using the given flags and mode
 // Interface: afero.Fs
 func (c *ftpClient) OpenFile(name string, flag int, perm os.FileMode) (afero.File, error) {
-	path, err := c.resolvePath(name)
-	if err != nil {
-		return nil, err
-	}
+	path := c.resolvePath(name)
 
 	// Check write permission if file is being created or modified
 	if flag&(os.O_WRONLY|os.O_RDWR|os.O_APPEND|os.O_CREATE|os.O_TRUNC) != 0 {
-		if !c.server.authorizer.CanWrite(c.user, path) {
-			logging.Access.LogAccess("open", c.user, path, "denied", "error", os.ErrPermission)
+		if !c.perms.CanWrite(path) {
+			logging.Access.LogAccess("open", c.user, path.String(), "denied", "error", os.ErrPermission)
 			return nil, os.ErrPermission
 		}
-		logging.Access.LogAccess("open", c.user, path, "success", "mode", "write")
-	} else if !c.server.authorizer.CanRead(c.user, path) {
-		logging.Access.LogAccess("open", c.user, path, "denied", "error", os.ErrPermission)
+		logging.Access.LogAccess("open", c.user, path.String(), "success", "mode", "write")
+	} else if !c.perms.CanRead(path) {
+		logging.Access.LogAccess("open", c.user, path.String(), "denied", "error", os.ErrPermission)
 		return nil, os.ErrPermission
 	}
 
-	file, err := c.fs.OpenFile(path, flag, perm)
+	file, err := c.fs.OpenFile(path.String(), flag, perm)
 	if err != nil {
 		if flag&(os.O_WRONLY|os.O_RDWR|os.O_APPEND|os.O_CREATE|os.O_TRUNC) != 0 {
-			logging.Access.LogAccess("open", c.user, path, "error", "mode", "write")
+			logging.Access.LogAccess("open", c.user, path.String(), "error", "mode", "write")
 		} else {
-			logging.Access.LogAccess("open", c.user, path, "error", "mode", "read")
+			logging.Access.LogAccess("open", c.user, path.String(), "error", "mode", "read")
 		}
 		return nil, err
 	}
+	if flag&(os.O_WRONLY|os.O_RDWR|os.O_APPEND|os.O_CREATE|os.O_TRUNC) != 0 {
+		c.changed(path)
+		c.server.metrics.stors.Inc()
+		return c.server.newUploadFile(file, c.allocate.Swap(0), c.flow, func() { c.changed(path) }), nil
+	}
 
 	// Only log size for read operations
-	if flag&(os.O_WRONLY|os.O_RDWR|os.O_APPEND|os.O_CREATE|os.O_TRUNC) == 0 {
-		if fi, err := file.Stat(); err == nil {
-			logging.Access.LogAccess("open", c.user, path, "success", "size", fi.Size())
-		} else {
-			logging.Access.LogAccess("open", c.user, path, "success", "size", 0)
-		}
+	if fi, err := file.Stat(); err == nil {
+		logging.Access.LogAccess("open", c.user, path.String(), "success", "size", fi.Size())
+	} else {
+		logging.Access.LogAccess("open", c.user, path.String(), "success", "size", 0)
 	}
-	return file, nil
+	c.server.metrics.retrs.Inc()
+	return newDownloadFile(file, c.flow, c.server.metrics.retrBytes), nil
 }
 
 // Create creates a new file
 // Interface: afero.Fs
 func (c *ftpClient) Create(name string) (afero.File, error) {
-	path, err := c.resolvePath(name)
-	if err != nil {
-		return nil, err
-	}
+	path := c.resolvePath(name)
 
-	if !c.server.authorizer.CanWrite(c.user, path) {
-		logging.Access.LogAccess("create", c.user, path, "denied", "error", os.ErrPermission)
+	if !c.perms.CanWrite(path) {
+		logging.Access.LogAccess("create", c.user, path.String(), "denied", "error", os.ErrPermission)
 		return nil, os.ErrPermission
 	}
 
-	file, err := c.fs.Create(path)
+	file, err := c.fs.Create(path.String())
 	if err != nil {
-		logging.Access.LogAccess("create", c.user, path, "error", "error", err)
+		logging.Access.LogAccess("create", c.user, path.String(), "error", "error", err)
 		return nil, err
 	}
 
-	logging.Access.LogAccess("create", c.user, path, "success", "mode", "write")
-	return file, nil
+	c.changed(path)
+	logging.Access.LogAccess("create", c.user, path.String(), "success", "mode", "write")
+	c.server.metrics.stors.Inc()
+	return c.server.newUploadFile(file, c.allocate.Swap(0), c.flow, func() { c.changed(path) }), nil
 }
 
 // Mkdir creates a directory
 // Interface: afero.Fs
 func (c *ftpClient) Mkdir(name string, perm os.FileMode) error {
-	path, err := c.resolvePath(name)
-	if err != nil {
-		return err
-	}
+	path := c.resolvePath(name)
 
-	if !c.server.authorizer.CanWrite(c.user, path) {
-		logging.Access.LogAccess("mkdir", c.user, path, "denied", "error", os.ErrPermission)
+	if !c.perms.CanWrite(path) {
+		logging.Access.LogAccess("mkdir", c.user, path.String(), "denied", "error", os.ErrPermission)
 		return os.ErrPermission
 	}
-	err = c.fs.Mkdir(name, perm)
-	logging.Access.LogAccess("mkdir", c.user, path, "success", "mode", "write")
+	err := c.fs.Mkdir(path.String(), perm)
+	c.changed(path)
+	logging.Access.LogAccess("mkdir", c.user, path.String(), "success", "mode", "write")
 	return err
 }
 
 // MkdirAll creates a directory and all parent directories
 // Interface: afero.Fs
 func (c *ftpClient) MkdirAll(path string, perm os.FileMode) error {
-	resolvedPath, err := c.resolvePath(path)
-	if err != nil {
-		return err
-	}
+	resolvedPath := c.resolvePath(path)
 
-	if !c.server.authorizer.CanWrite(c.user, resolvedPath) {
-		logging.Access.LogAccess("mkdir", c.user, resolvedPath, "denied", "error", os.ErrPermission)
+	if !c.perms.CanWrite(resolvedPath) {
+		logging.Access.LogAccess("mkdir", c.user, resolvedPath.String(), "denied", "error", os.ErrPermission)
 		return os.ErrPermission
 	}
-	err = c.fs.MkdirAll(resolvedPath, perm)
-	logging.Access.LogAccess("mkdir", c.user, resolvedPath, "success", "mode", "write")
+	err := c.fs.MkdirAll(resolvedPath.String(), perm)
+	c.changed(resolvedPath)
+	logging.Access.LogAccess("mkdir", c.user, resolvedPath.String(), "success", "mode", "write")
 	return err
 }
 
 // Remove removes a file
 // Interface: afero.Fs
 func (c *ftpClient) Remove(name string) error {
-	path, err := c.resolvePath(name)
-	if err != nil {
-		return err
-	}
+	path := c.resolvePath(name)
 
-	if !c.server.authorizer.CanWrite(c.user, path) {
-		logging.Access.LogAccess("remove", c.user, path, "denied", "error", os.ErrPermission)
+	if !c.perms.CanWrite(path) {
+		logging.Access.LogAccess("remove", c.user, path.String(), "denied", "error", os.ErrPermission)
 		return os.ErrPermission
 	}
 
-	if err := c.fs.Remove(path); err != nil {
-		logging.Access.LogAccess("remove", c.user, path, "error", "error", err)
+	if err := c.fs.Remove(path.String()); err != nil {
+		logging.Access.LogAccess("remove", c.user, path.String(), "error", "error", err)
 		return err
 	}
 
-	logging.Access.LogAccess("remove", c.user, path, "success", "mode", "write")
+	c.changed(path)
+	logging.Access.LogAccess("remove", c.user, path.String(), "success", "mode", "write")
 	return nil
 }
 
 // RemoveAll removes a directory and all its contents
 // Interface: afero.Fs
 func (c *ftpClient) RemoveAll(path string) error {
-	resolvedPath, err := c.resolvePath(path)
-	if err != nil {
-		return err
-	}
+	resolvedPath := c.resolvePath(path)
 
-	if !c.server.authorizer.CanWrite(c.user, resolvedPath) {
-		logging.Access.LogAccess("remove", c.user, resolvedPath, "denied", "error", os.ErrPermission)
+	if !c.perms.CanWrite(resolvedPath) {
+		logging.Access.LogAccess("remove", c.user, resolvedPath.String(), "denied", "error", os.ErrPermission)
 		return os.ErrPermission
 	}
 
-	if err := c.fs.RemoveAll(resolvedPath); err != nil {
-		logging.Access.LogAccess("remove", c.user, resolvedPath, "error", "error", err)
+	if err := c.fs.RemoveAll(resolvedPath.String()); err != nil {
+		logging.Access.LogAccess("remove", c.user, resolvedPath.String(), "error", "error", err)
 		return err
 	}
 
-	logging.Access.LogAccess("remove", c.user, resolvedPath, "success", "mode", "write")
+	c.changed(resolvedPath)
+	logging.Access.LogAccess("remove", c.user, resolvedPath.String(), "success", "mode", "write")
 	return nil
 }
 
 // Rename renames a file
 // Interface: afero.Fs
 func (c *ftpClient) Rename(oldname, newname string) error {
-	oldPath, err := c.resolvePath(oldname)
-	if err != nil {
-		return err
-	}
-	newPath, err := c.resolvePath(newname)
-	if err != nil {
-		return err
-	}
+	oldPath := c.resolvePath(oldname)
+	newPath := c.resolvePath(newname)
 
-	if !c.server.authorizer.CanWrite(c.user, oldPath) ||
-		!c.server.authorizer.CanWrite(c.user, newPath) {
-		logging.Access.LogAccess("rename", c.user, oldPath, "denied", "error", os.ErrPermission)
+	if !c.perms.CanWrite(oldPath) ||
+		!c.perms.CanWrite(newPath) {
+		logging.Access.LogAccess("rename", c.user, oldPath.String(), "denied", "error", os.ErrPermission)
 		return os.ErrPermission
 	}
 
-	if err := c.fs.Rename(oldPath, newPath); err != nil {
-		logging.Access.LogAccess("rename", c.user, oldPath, "error", "error", err)
+	if err := c.fs.Rename(oldPath.String(), newPath.String()); err != nil {
+		logging.Access.LogAccess("rename", c.user, oldPath.String(), "error", "error", err)
 		return err
 	}
 
-	logging.Access.LogAccess("rename", c.user, oldPath, "success", "mode", "write")
+	c.changed(oldPath)
+	c.changed(newPath)
+	logging.Access.LogAccess("rename", c.user, oldPath.String(), "success", "mode", "write")
 	return nil
 }
 
 // Stat returns file info
 // Interface: afero.Fs
 func (c *ftpClient) Stat(name string) (os.FileInfo, error) {
-	path, err := c.resolvePath(name)
-	if err != nil {
-		return nil, err
-	}
+	path := c.resolvePath(name)
 
-	if !c.server.authorizer.CanRead(c.user, path) {
+	if !c.perms.CanRead(path) {
 		return nil, os.ErrPermission
 	}
-	return c.fs.Stat(path)
+	return c.fs.Stat(path.String())
 }
 
 // Name returns the name of the filesystem
@@ -544,36 +807,40 @@ func (c *ftpClient) Name() string {
 // Chmod changes file mode
 // Interface: afero.Fs
 func (c *ftpClient) Chmod(name string, mode os.FileMode) error {
-	path, err := c.resolvePath(name)
-	if err != nil {
-		return err
-	}
+	path := c.resolvePath(name)
 
-	if !c.server.authorizer.CanWrite(c.user, path) {
+	if !c.perms.CanWrite(path) {
 		return os.ErrPermission
 	}
-	return c.fs.Chmod(path, mode)
+	if err := c.fs.Chmod(path.String(), mode); err != nil {
+		return err
+	}
+	c.changed(path)
+	return nil
 }
 
 // Chown changes file owner
 // Interface: afero.Fs
 func (c *ftpClient) Chown(name string, uid, gid int) error {
-	path, err := c.resolvePath(name)
-	if err != nil {
-		return err
-	}
+	path := c.resolvePath(name)
 
-	if !c.server.authorizer.CanWrite(c.user, path) {
+	if !c.perms.CanWrite(path) {
 		return os.ErrPermission
 	}
-	return c.fs.Chown(path, uid, gid)
+	return c.fs.Chown(path.String(), uid, gid)
 }
 
 // Chtimes changes file times
 // Interface: afero.Fs
 func (c *ftpClient) Chtimes(name string, atime time.Time, mtime time.Time) error {
-	if !c.server.authorizer.CanWrite(c.user, name) {
+	path := c.resolvePath(name)
+
+	if !c.perms.CanWrite(path) {
 		return os.ErrPermission
 	}
-	return c.fs.Chtimes(name, atime, mtime)
+	if err := c.fs.Chtimes(path.String(), atime, mtime); err != nil {
+		return err
+	}
+	c.changed(path)
+	return nil
 }
@@ -0,0 +1,78 @@
+package ftpserver
+
+import (
+	"os"
+	"path/filepath"
+	"testing"
+	"time"
+
+	ftpserverlib "github.com/fclairamb/ftpserverlib"
+	"github.com/mmcdole/viking-ftpd/pkg/authorization"
+	"github.com/mmcdole/viking-ftpd/pkg/users"
+	"github.com/spf13/afero"
+	"github.com/stretchr/testify/assert"
+)
+
+// cwdContext is a client context that only knows its current directory
+type cwdContext struct {
+	ftpserverlib.ClientContext
+	path string
+}
+
+func (c *cwdContext) Path() string { return c.path }
+
+type staticAccessSource map[string]interface{}
+
+func (s staticAccessSource) LoadAccessData() (map[string]interface{}, error) {
+	return s, nil
+}
+
+// testClient returns a session of drake, whose current directory is their
+// home, over a fresh root directory
+func testClient(t *testing.T) (*ftpClient, string) {
+	t.Helper()
+	root := t.TempDir()
+	for _, dir := range []string{"players/drake", "players/frodo"} {
+		if err := os.MkdirAll(filepath.Join(root, dir), 0755); err != nil {
+			t.Fatal(err)
+		}
+	}
+
+	access := staticAccessSource{"access_map": map[string]interface{}{
+		"*": map[string]interface{}{".": authorization.Read, "*": authorization.Read},
+	}}
+	authorizer := authorization.NewAuthorizer(access, users.NewMemorySource(), time.Hour)
+	return &ftpClient{
+		server: &Server{},
+		user:   "drake",
+		fs:     afero.NewBasePathFs(afero.NewOsFs(), root),
+		cc:     &cwdContext{path: "/players/drake"},
+		perms:  authorization.NewPermissionCache(authorizer, "drake", 16, nil),
+	}, root
+}
+
+func TestFtpClient_RelativePaths(t *testing.T) {
+	c, root := testClient(t)
+
+	// Names are resolved against the current directory before they are
+	// authorized, so drake may write in their own home
+	assert.NoError(t, c.MakeDirectory("notes"))
+	assert.NoError(t, c.Mkdir("notes/old", 0755))
+	assert.NoError(t, c.Chtimes("notes", time.Unix(1000, 0), time.Unix(1000, 0)))
+
+	fi, err := os.Stat(filepath.Join(root, "players/drake/notes/old"))
+	assert.NoError(t, err)
+	assert.True(t, fi.IsDir())
+	fi, err = os.Stat(filepath.Join(root, "players/drake/notes"))
+	assert.NoError(t, err)
+	assert.Equal(t, int64(1000), fi.ModTime().Unix())
+
+	// and the path authorized is the path accessed
+	assert.Equal(t, os.ErrPermission, c.MakeDirectory("../frodo/notes"))
+	assert.Equal(t, os.ErrPermission, c.MakeDirectory("/notes"))
+	assert.Equal(t, os.ErrPermission, c.Chtimes("../frodo", time.Now(), time.Now()))
+	_, err = os.Stat(filepath.Join(root, "players/frodo/notes"))
+	assert.True(t, os.IsNotExist(err))
+	_, err = os.Stat(filepath.Join(root, "notes"))
+	assert.True(t, os.IsNotExist(err))
+}
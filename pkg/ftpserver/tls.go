@@ -0,0 +1,132 @@
+package ftpserver
+
+import (
+	"crypto/tls"
+	"fmt"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/mmcdole/viking-ftpd/pkg/filewatch"
+	"github.com/mmcdole/viking-ftpd/pkg/logging"
+)
+
+// certCheckInterval bounds how often the certificate files are checked for
+// changes
+const certCheckInterval = 10 * time.Second
+
+// certReloader serves a parsed certificate, reloading it when its files
+// change, so a renewal by certbot takes effect without a restart
+type certReloader struct {
+	certFile string
+	keyFile  string
+
+	cert      atomic.Pointer[tls.Certificate]
+	nextCheck atomic.Int64 // Unix nanoseconds
+
+	mu        sync.Mutex // held while checking the files
+	certStamp filewatch.Stamp
+	keyStamp  filewatch.Stamp
+}
+
+// newCertReloader loads the certificate and key pair from files
+func newCertReloader(certFile, keyFile string) (*certReloader, error) {
+	r := &certReloader{certFile: certFile, keyFile: keyFile}
+	certStamp, keyStamp, err := r.stamps()
+	if err != nil {
+		return nil, err
+	}
+	if err := r.load(certStamp, keyStamp); err != nil {
+		return nil, err
+	}
+	r.nextCheck.Store(time.Now().Add(certCheckInterval).UnixNano())
+	return r, nil
+}
+
+// GetCertificate returns the current certificate
+// Interface: tls.Config.GetCertificate
+func (r *certReloader) GetCertificate(*tls.ClientHelloInfo) (*tls.Certificate, error) {
+	r.maybeReload()
+	return r.cert.Load(), nil
+}
+
+// maybeReload reloads the pair if a check is due and either file changed.
+// Handshakes arriving while another one checks keep the current pair.
+func (r *certReloader) maybeReload() {
+	now := time.Now()
+	if now.UnixNano() < r.nextCheck.Load() || !r.mu.TryLock() {
+		return
+	}
+	defer r.mu.Unlock()
+	r.nextCheck.Store(now.Add(certCheckInterval).UnixNano())
+
+	certStamp, keyStamp, err := r.stamps()
+	if err != nil {
+		logging.App.Warn("Failed to check TLS certificate", "error", err)
+		return
+	}
+	if certStamp.Equal(r.certStamp) && keyStamp.Equal(r.keyStamp) {
+		return
+	}
+	// A failed load, such as a renewal caught between writing the cert and
+	// the key, keeps the old pair and is retried at the next check
+	if err := r.load(certStamp, keyStamp); err != nil {
+		logging.App.Warn("Failed to reload TLS certificate, keeping the current one", "error", err)
+		return
+	}
+	logging.App.Info("Reloaded TLS certificate", "cert_file", r.certFile)
+}
+
+// stamps returns the current stamps of the certificate and key files
+func (r *certReloader) stamps() (filewatch.Stamp, filewatch.Stamp, error) {
+	certStamp, err := filewatch.StatStamp(r.certFile)
+	if err != nil {
+		return filewatch.Stamp{}, filewatch.Stamp{}, fmt.Errorf("checking TLS cert: %w", err)
+	}
+	keyStamp, err := filewatch.StatStamp(r.keyFile)
+	if err != nil {
+		return filewatch.Stamp{}, filewatch.Stamp{}, fmt.Errorf("checking TLS key: %w", err)
+	}
+	return certStamp, keyStamp, nil
+}
+
+// load parses the pair and makes it current, recording the stamps the files
+// had before they were read
+func (r *certReloader) load(certStamp, keyStamp filewatch.Stamp) error {
+	cert, err := tls.LoadX509KeyPair(r.certFile, r.keyFile)
+	if err != nil {
+		return fmt.Errorf("loading TLS cert/key pair: %w", err)
+	}
+	r.cert.Store(&cert)
+	r.certStamp, r.keyStamp = certStamp, keyStamp
+	return nil
+}
+
+// tlsConfig returns the server's TLS configuration, creating it on first use.
+// Every connection shares the one config, so the session ticket keys it
+// generates let data connections resume the control connection's session.
+func (s *Server) tlsConfig() (*tls.Config, error) {
+	s.tlsMu.Lock()
+	defer s.tlsMu.Unlock()
+	if s.tls != nil {
+		return s.tls, nil
+	}
+
+	certs, err := newCertReloader(s.config.TLSCertFile, s.config.TLSKeyFile)
+	if err != nil {
+		return nil, err
+	}
+	s.tls = &tls.Config{
+		GetCertificate: certs.GetCertificate,
+		MinVersion:     tls.VersionTLS12,
+		VerifyConnection: func(cs tls.ConnectionState) error {
+			// Called for every handshake, resumed or not
+			s.tlsHandshakes.Add(1)
+			if cs.DidResume {
+				s.tlsResumed.Add(1)
+			}
+			return nil
+		},
+	}
+	return s.tls, nil
+}
@@ -0,0 +1,190 @@
+package ftpserver
+
+import (
+	"crypto/ecdsa"
+	"crypto/tls"
+	"crypto/x509"
+	"encoding/pem"
+	"io"
+	"net"
+	"os"
+	"path/filepath"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/assert"
+)
+
+// writeKeyPair writes a fresh self-signed pair to certFile and keyFile and
+// returns its leaf certificate, dating the files at mtime
+func writeKeyPair(t *testing.T, certFile, keyFile string, mtime time.Time) *x509.Certificate {
+	t.Helper()
+	cert := testCertificate(t)
+	keyDER, err := x509.MarshalECPrivateKey(cert.PrivateKey.(*ecdsa.PrivateKey))
+	if err != nil {
+		t.Fatal(err)
+	}
+	certPEM := pem.EncodeToMemory(&pem.Block{Type: "CERTIFICATE", Bytes: cert.Certificate[0]})
+	keyPEM := pem.EncodeToMemory(&pem.Block{Type: "EC PRIVATE KEY", Bytes: keyDER})
+	for file, data := range map[string][]byte{certFile: certPEM, keyFile: keyPEM} {
+		if err := os.WriteFile(file, data, 0600); err != nil {
+			t.Fatal(err)
+		}
+		if err := os.Chtimes(file, mtime, mtime); err != nil {
+			t.Fatal(err)
+		}
+	}
+	leaf, err := x509.ParseCertificate(cert.Certificate[0])
+	if err != nil {
+		t.Fatal(err)
+	}
+	return leaf
+}
+
+// servedSerial returns the serial number of the certificate r serves
+func servedSerial(t *testing.T, r *certReloader) string {
+	t.Helper()
+	cert, err := r.GetCertificate(nil)
+	assert.NoError(t, err)
+	leaf, err := x509.ParseCertificate(cert.Certificate[0])
+	assert.NoError(t, err)
+	return leaf.SerialNumber.String()
+}
+
+func TestCertReloader(t *testing.T) {
+	dir := t.TempDir()
+	certFile, keyFile := filepath.Join(dir, "cert.pem"), filepath.Join(dir, "key.pem")
+	first := writeKeyPair(t, certFile, keyFile, time.Now().Add(-time.Hour))
+
+	r, err := newCertReloader(certFile, keyFile)
+	assert.NoError(t, err)
+	assert.Equal(t, first.SerialNumber.String(), servedSerial(t, r))
+
+	// A renewal is picked up at the next check
+	second := writeKeyPair(t, certFile, keyFile, time.Now())
+	assert.Equal(t, first.SerialNumber.String(), servedSerial(t, r))
+	r.nextCheck.Store(0)
+	assert.Equal(t, second.SerialNumber.String(), servedSerial(t, r))
+
+	// A broken pair keeps the current certificate
+	assert.NoError(t, os.WriteFile(keyFile, []byte("not a key"), 0600))
+	r.nextCheck.Store(0)
+	assert.Equal(t, second.SerialNumber.String(), servedSerial(t, r))
+}
+
+func TestNewCertReloader_Missing(t *testing.T) {
+	dir := t.TempDir()
+	_, err := newCertReloader(filepath.Join(dir, "cert.pem"), filepath.Join(dir, "key.pem"))
+	assert.Error(t, err)
+}
+
+// handshake connects a client over loopback, reads one byte so a TLS 1.3
+// session ticket is received, and reports whether the session was resumed
+func handshake(t *testing.T, server *tls.Config, client *tls.Config) bool {
+	t.Helper()
+	ln, err := net.Listen("tcp", "127.0.0.1:0")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer ln.Close()
+
+	served := make(chan error, 1)
+	go func() {
+		conn, err := ln.Accept()
+		if err != nil {
+			served <- err
+			return
+		}
+		tc := tls.Server(conn, server)
+		_, err = tc.Write([]byte{1})
+		tc.Close()
+		served <- err
+	}()
+
+	conn, err := tls.Dial("tcp", ln.Addr().String(), client)
+	if err != nil {
+		t.Fatal(err)
+	}
+	_, err = io.ReadFull(conn, make([]byte, 1))
+	assert.NoError(t, err)
+	resumed := conn.ConnectionState().DidResume
+	conn.Close()
+	assert.NoError(t, <-served)
+	return resumed
+}
+
+func TestServer_TLSConfigResumesSessions(t *testing.T) {
+	dir := t.TempDir()
+	certFile, keyFile := filepath.Join(dir, "cert.pem"), filepath.Join(dir, "key.pem")
+	writeKeyPair(t, certFile, keyFile, time.Now())
+	s := &Server{config: &Config{TLSCertFile: certFile, TLSKeyFile: keyFile}}
+	d := &ftpDriver{server: s}
+
+	// The control connection and each data connection get the same config
+	control, err := d.GetTLSConfig()
+	assert.NoError(t, err)
+	data, err := d.GetTLSConfig()
+	assert.NoError(t, err)
+	assert.True(t, control == data)
+
+	client := &tls.Config{InsecureSkipVerify: true, ClientSessionCache: tls.NewLRUClientSessionCache(4)}
+	assert.False(t, handshake(t, control, client))
+	assert.True(t, handshake(t, data, client))
+	assert.True(t, handshake(t, data, client))
+
+	assert.Equal(t, int64(3), s.GetTLSHandshakes())
+	assert.Equal(t, int64(2), s.GetTLSResumedHandshakes())
+}
+
+func TestServer_TLSConfigNotConfigured(t *testing.T) {
+	d := &ftpDriver{server: &Server{config: &Config{}}}
+	_, err := d.GetTLSConfig()
+	assert.Equal(t, errNoTLS, err)
+}
+
+// BenchmarkTLSHandshake compares full handshakes, as every FTPS data
+// connection did when each got a new config, with resumed ones
+func BenchmarkTLSHandshake(b *testing.B) {
+	cert := testCertificate(b)
+	for _, resume := range []bool{false, true} {
+		name := "full"
+		if resume {
+			name = "resumed"
+		}
+		b.Run(name, func(b *testing.B) {
+			server := &tls.Config{Certificates: []tls.Certificate{cert}}
+			client := &tls.Config{InsecureSkipVerify: true}
+			if resume {
+				client.ClientSessionCache = tls.NewLRUClientSessionCache(4)
+			}
+			ln, err := net.Listen("tcp", "127.0.0.1:0")
+			if err != nil {
+				b.Fatal(err)
+			}
+			defer ln.Close()
+			go func() {
+				for {
+					conn, err := ln.Accept()
+					if err != nil {
+						return
+					}
+					tc := tls.Server(conn, server)
+					_, _ = tc.Write([]byte{1})
+					tc.Close()
+				}
+			}()
+
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				tc, err := tls.Dial("tcp", ln.Addr().String(), client)
+				if err != nil {
+					b.Fatal(err)
+				}
+				if _, err := io.ReadFull(tc, make([]byte, 1)); err != nil {
+					b.Fatal(err)
+				}
+				tc.Close()
+			}
+		})
+	}
+}
@@ -0,0 +1,114 @@
+package ftpserver
+
+import (
+	"io"
+	"os"
+	"sync"
+
+	"github.com/mmcdole/viking-ftpd/pkg/metrics"
+	"github.com/spf13/afero"
+)
+
+// transferBufferSize is the size of the pooled buffers used to copy
+// downloads to connections that can't take the file directly, such as TLS
+const transferBufferSize = 256 * 1024
+
+var transferBufferPool = sync.Pool{
+	New: func() interface{} {
+		buf := make([]byte, transferBufferSize)
+		return &buf
+	},
+}
+
+// downloadFile is a file opened for reading whose contents can be written
+// to the data connection without passing through ftpserverlib's buffer.
+// ftpserverlib copies downloads with io.Copy, which prefers WriteTo.
+type downloadFile struct {
+	afero.File
+	os   *os.File
+	flow *flow            // nil when the session is not throttled
+	sent *metrics.Counter // bytes sent, or nil
+}
+
+// newDownloadFile wraps file for fast downloads, throttled through flow and
+// counted in sent, when it is backed by an *os.File. Other files are
+// returned unchanged.
+func newDownloadFile(file afero.File, flow *flow, sent *metrics.Counter) afero.File {
+	if f := osFileOf(file); f != nil {
+		return &downloadFile{File: file, os: f, flow: flow, sent: sent}
+	}
+	return file
+}
+
+// osFileOf returns the *os.File behind file, or nil if there is none
+func osFileOf(file afero.File) *os.File {
+	switch f := file.(type) {
+	case *os.File:
+		return f
+	case *afero.BasePathFile:
+		if of, ok := f.File.(*os.File); ok {
+			return of
+		}
+	}
+	return nil
+}
+
+// WriteTo writes the rest of the file to w. A plain TCP connection is handed
+// the *os.File itself, so the kernel moves the data with sendfile or splice.
+// Any other writer, such as a TLS connection, is fed from a large pooled
+// buffer. Copying starts at the current offset, so REST is honored. A
+// throttled session moves the file a grant of its bandwidth flow at a time.
+func (d *downloadFile) WriteTo(w io.Writer) (int64, error) {
+	n, err := d.writeTo(w)
+	d.sent.Add(n)
+	return n, err
+}
+
+func (d *downloadFile) writeTo(w io.Writer) (int64, error) {
+	rf, direct := w.(io.ReaderFrom)
+	if direct && d.flow == nil {
+		return rf.ReadFrom(d.os)
+	}
+
+	buf := transferBufferPool.Get().(*[]byte)
+	defer transferBufferPool.Put(buf)
+	if d.flow == nil {
+		// Hide the file's own WriteTo so the copy uses buf
+		return io.CopyBuffer(w, struct{ io.Reader }{d.os}, *buf)
+	}
+
+	// Throttled, the file is moved a grant at a time. A LimitedReader over
+	// the *os.File still lets a TCP connection use sendfile.
+	var total int64
+	for {
+		granted := d.flow.take(len(*buf))
+		chunk := &io.LimitedReader{R: d.os, N: int64(granted)}
+		var written int64
+		var err error
+		if direct {
+			written, err = rf.ReadFrom(chunk)
+		} else {
+			written, err = io.CopyBuffer(w, chunk, *buf)
+		}
+		total += written
+		if err != nil || written < int64(granted) {
+			d.flow.refund(granted - int(written))
+			return total, err
+		}
+	}
+}
+
+// Read reads from the file, throttled when the session is, counting the
+// bytes read as sent
+func (d *downloadFile) Read(p []byte) (int, error) {
+	if d.flow == nil {
+		n, err := d.File.Read(p)
+		d.sent.Add(int64(n))
+		return n, err
+	}
+	granted := d.flow.take(len(p))
+	n, err := d.File.Read(p[:granted])
+	d.flow.refund(granted - n)
+	d.sent.Add(int64(n))
+	return n, err
+}
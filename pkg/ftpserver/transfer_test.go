@@ -0,0 +1,186 @@
+package ftpserver
+
+import (
+	"bytes"
+	"crypto/ecdsa"
+	"crypto/elliptic"
+	"crypto/rand"
+	"crypto/tls"
+	"crypto/x509"
+	"crypto/x509/pkix"
+	"fmt"
+	"io"
+	"math/big"
+	"net"
+	"os"
+	"path/filepath"
+	"testing"
+	"time"
+
+	"github.com/spf13/afero"
+	"github.com/stretchr/testify/assert"
+)
+
+// downloadSource creates a file of size bytes and opens it the way ftpClient
+// does, through a BasePathFs
+func downloadSource(t testing.TB, size int) (afero.Fs, string, []byte) {
+	t.Helper()
+	root := t.TempDir()
+	data := make([]byte, size)
+	for i := range data {
+		data[i] = byte(i * 7)
+	}
+	if err := os.WriteFile(filepath.Join(root, "area.o"), data, 0644); err != nil {
+		t.Fatal(err)
+	}
+	return afero.NewBasePathFs(afero.NewOsFs(), root), "/area.o", data
+}
+
+// testCertificate returns a self-signed certificate for localhost
+func testCertificate(t testing.TB) tls.Certificate {
+	t.Helper()
+	key, err := ecdsa.GenerateKey(elliptic.P256(), rand.Reader)
+	if err != nil {
+		t.Fatal(err)
+	}
+	tmpl := &x509.Certificate{
+		SerialNumber: big.NewInt(1),
+		Subject:      pkix.Name{CommonName: "localhost"},
+		NotBefore:    time.Now().Add(-time.Hour),
+		NotAfter:     time.Now().Add(time.Hour),
+		IPAddresses:  []net.IP{net.IPv4(127, 0, 0, 1)},
+	}
+	der, err := x509.CreateCertificate(rand.Reader, tmpl, tmpl, &key.PublicKey, key)
+	if err != nil {
+		t.Fatal(err)
+	}
+	return tls.Certificate{Certificate: [][]byte{der}, PrivateKey: key}
+}
+
+// dataConnection returns the sending end of a loopback data connection and
+// a channel receiving everything read at the other end. With cert set, the
+// connection is wrapped in TLS like an FTPS data channel.
+func dataConnection(t testing.TB, cert *tls.Certificate, sink io.Writer) (net.Conn, <-chan error) {
+	t.Helper()
+	ln, err := net.Listen("tcp", "127.0.0.1:0")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer ln.Close()
+
+	received := make(chan error, 1)
+	go func() {
+		conn, err := net.Dial("tcp", ln.Addr().String())
+		if err != nil {
+			received <- err
+			return
+		}
+		var r net.Conn = conn
+		if cert != nil {
+			r = tls.Client(conn, &tls.Config{InsecureSkipVerify: true})
+		}
+		_, err = io.Copy(sink, r)
+		r.Close()
+		received <- err
+	}()
+
+	conn, err := ln.Accept()
+	if err != nil {
+		t.Fatal(err)
+	}
+	if cert != nil {
+		conn = tls.Server(conn, &tls.Config{Certificates: []tls.Certificate{*cert}})
+	}
+	return conn, received
+}
+
+func TestDownloadFile_WriteTo(t *testing.T) {
+	fs, path, data := downloadSource(t, 3*transferBufferSize+123)
+	cert := testCertificate(t)
+
+	tests := []struct {
+		name   string
+		cert   *tls.Certificate
+		offset int64
+	}{
+		{"plain", nil, 0},
+		{"plain with REST", nil, 1000},
+		{"tls", &cert, 0},
+		{"tls with REST", &cert, transferBufferSize + 1},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			f, err := fs.Open(path)
+			assert.NoError(t, err)
+			file := newDownloadFile(f, nil, nil)
+			defer file.Close()
+			_, ok := file.(io.WriterTo)
+			assert.True(t, ok)
+
+			_, err = file.Seek(tt.offset, io.SeekStart)
+			assert.NoError(t, err)
+
+			var got bytes.Buffer
+			conn, received := dataConnection(t, tt.cert, &got)
+			n, err := io.Copy(conn, file)
+			assert.NoError(t, err)
+			assert.Equal(t, int64(len(data))-tt.offset, n)
+			conn.Close()
+			assert.NoError(t, <-received)
+			assert.True(t, bytes.Equal(data[tt.offset:], got.Bytes()))
+		})
+	}
+}
+
+func TestNewDownloadFile_Directory(t *testing.T) {
+	fs, _, _ := downloadSource(t, 1)
+	f, err := fs.Open("/")
+	assert.NoError(t, err)
+	defer f.Close()
+
+	// Directories are os.Files too; wrapping them must keep Readdir working
+	names, err := newDownloadFile(f, nil, nil).Readdirnames(-1)
+	assert.NoError(t, err)
+	assert.Equal(t, []string{"area.o"}, names)
+}
+
+// BenchmarkRETR measures download throughput over loopback with and without
+// the fast path. Without it, ftpserverlib's io.Copy moves the file through a
+// 32 KiB user-space buffer.
+func BenchmarkRETR(b *testing.B) {
+	const size = 64 << 20
+	fs, path, _ := downloadSource(b, size)
+	cert := testCertificate(b)
+
+	for _, mode := range []struct {
+		name string
+		cert *tls.Certificate
+	}{{"Plain", nil}, {"TLS", &cert}} {
+		for _, fast := range []bool{false, true} {
+			b.Run(fmt.Sprintf("%s/fast=%v", mode.name, fast), func(b *testing.B) {
+				conn, received := dataConnection(b, mode.cert, io.Discard)
+				b.SetBytes(size)
+				b.ReportAllocs()
+				b.ResetTimer()
+				for i := 0; i < b.N; i++ {
+					file, err := fs.Open(path)
+					if err != nil {
+						b.Fatal(err)
+					}
+					if fast {
+						file = newDownloadFile(file, nil, nil)
+					}
+					if _, err := io.Copy(conn, file); err != nil {
+						b.Fatal(err)
+					}
+					file.Close()
+				}
+				b.StopTimer()
+				conn.Close()
+				if err := <-received; err != nil {
+					b.Fatal(err)
+				}
+			})
+		}
+	}
+}
@@ -0,0 +1,397 @@
+package ftpserver
+
+import (
+	"fmt"
+	"io"
+	"os"
+	"sync"
+	"time"
+
+	"github.com/mmcdole/viking-ftpd/pkg/logging"
+	"github.com/spf13/afero"
+)
+
+// DefaultUploadBufferSize is the default size of the buffer uploads are
+// written through
+const DefaultUploadBufferSize = 256 * 1024
+
+// DefaultSyncInterval is the default time between grouped upload syncs
+const DefaultSyncInterval = time.Second
+
+// UploadSync selects when uploaded files are flushed to stable storage
+type UploadSync string
+
+const (
+	// SyncNone leaves flushing to the operating system
+	SyncNone UploadSync = "none"
+	// SyncFile syncs each upload before its transfer completes
+	SyncFile UploadSync = "file"
+	// SyncBatch syncs uploads in groups after their transfers complete
+	SyncBatch UploadSync = "batch"
+)
+
+// ParseUploadSync converts a configuration value to an UploadSync. An empty
+// string selects SyncNone.
+func ParseUploadSync(s string) (UploadSync, error) {
+	switch UploadSync(s) {
+	case "", SyncNone:
+		return SyncNone, nil
+	case SyncFile:
+		return SyncFile, nil
+	case SyncBatch:
+		return SyncBatch, nil
+	}
+	return "", fmt.Errorf("unknown upload sync %q (expected none, file or batch)", s)
+}
+
+// bufferPool reuses upload buffers of one size
+type bufferPool struct {
+	size int
+	pool sync.Pool
+}
+
+func newBufferPool(size int) *bufferPool {
+	p := &bufferPool{size: size}
+	p.pool.New = func() interface{} {
+		buf := make([]byte, size)
+		return &buf
+	}
+	return p
+}
+
+func (p *bufferPool) get() *[]byte  { return p.pool.Get().(*[]byte) }
+func (p *bufferPool) put(b *[]byte) { p.pool.Put(b) }
+
+// uploadFile is a file opened for writing whose writes are gathered in a
+// pooled buffer, so each write system call moves a full buffer whatever
+// segment sizes the client's data arrives in. Every other operation flushes
+// the buffer first, so reads, seeks and Stat see all data written.
+type uploadFile struct {
+	afero.File
+	os      *os.File
+	server  *Server
+	buffers *bufferPool
+	buf     *[]byte
+	n       int   // bytes waiting in buf
+	err     error // first failed flush, returned by every later call
+	flow    *flow // nil when the session is not throttled
+
+	preallocated bool
+	onClose      func()
+}
+
+// newUploadFile wraps file for buffered uploads, throttled through flow,
+// when it is backed by an *os.File, preallocating allocate bytes past its
+// end when allocate is set. onClose runs once the file is closed. Other files
+// are returned unchanged.
+func (s *Server) newUploadFile(file afero.File, allocate int64, flow *flow, onClose func()) afero.File {
+	f := osFileOf(file)
+	if f == nil {
+		return file
+	}
+	u := &uploadFile{File: file, os: f, server: s, buffers: s.uploadBuffers, flow: flow, onClose: onClose}
+	if u.buffers == nil {
+		u.buffers = defaultUploadBuffers
+	}
+	u.buf = u.buffers.get()
+
+	if allocate > 0 {
+		if fi, err := f.Stat(); err == nil {
+			if err := preallocate(f, fi.Size(), allocate); err != nil {
+				if logging.App.IsDebug() {
+					logging.App.Debug("Upload preallocation failed", "path", f.Name(), "size", allocate, "error", err)
+				}
+			} else {
+				u.preallocated = true
+			}
+		}
+	}
+	return u
+}
+
+var defaultUploadBuffers = newBufferPool(DefaultUploadBufferSize)
+
+// flush writes the buffered bytes to the file
+func (u *uploadFile) flush() error {
+	if u.err != nil {
+		return u.err
+	}
+	if u.n == 0 {
+		return nil
+	}
+	written, err := u.os.Write((*u.buf)[:u.n])
+	if err == nil && written < u.n {
+		err = io.ErrShortWrite
+	}
+	if err != nil {
+		u.err = err
+		return err
+	}
+	u.n = 0
+	return nil
+}
+
+// Write buffers p, writing the buffer to the file whenever it fills
+func (u *uploadFile) Write(p []byte) (int, error) {
+	if u.buf == nil {
+		return 0, os.ErrClosed
+	}
+	if u.flow == nil {
+		n, err := u.write(p)
+		u.server.metrics.storBytes.Add(int64(n))
+		return n, err
+	}
+	total := 0
+	for len(p) > 0 {
+		granted := u.flow.take(len(p))
+		n, err := u.write(p[:granted])
+		total += n
+		u.server.metrics.storBytes.Add(int64(n))
+		if err != nil {
+			u.flow.refund(granted - n)
+			return total, err
+		}
+		p = p[granted:]
+	}
+	return total, nil
+}
+
+// write buffers p without throttling
+func (u *uploadFile) write(p []byte) (int, error) {
+	total := 0
+	for len(p) > 0 {
+		if u.err != nil {
+			return total, u.err
+		}
+		buf := *u.buf
+		if u.n == 0 && len(p) >= len(buf) {
+			// Nothing waiting and at least a buffer's worth: skip the copy
+			written, err := u.os.Write(p)
+			total += written
+			if err != nil {
+				u.err = err
+				return total, err
+			}
+			return total, nil
+		}
+		copied := copy(buf[u.n:], p)
+		u.n += copied
+		total += copied
+		p = p[copied:]
+		if u.n == len(buf) {
+			if err := u.flush(); err != nil {
+				return total, err
+			}
+		}
+	}
+	return total, nil
+}
+
+// WriteString buffers s like Write
+func (u *uploadFile) WriteString(s string) (int, error) {
+	return u.Write([]byte(s))
+}
+
+// ReadFrom reads r straight into the buffer until EOF. ftpserverlib copies
+// uploads with io.Copy, which prefers ReadFrom, so the data connection is
+// read a buffer at a time instead of through io.Copy's 32 KiB buffer.
+func (u *uploadFile) ReadFrom(r io.Reader) (int64, error) {
+	if u.buf == nil {
+		return 0, os.ErrClosed
+	}
+	var total int64
+	buf := *u.buf
+	for {
+		if u.n == len(buf) {
+			if err := u.flush(); err != nil {
+				return total, err
+			}
+		}
+		want := u.flow.take(len(buf) - u.n)
+		read, err := r.Read(buf[u.n : u.n+want])
+		u.flow.refund(want - read)
+		u.n += read
+		total += int64(read)
+		u.server.metrics.storBytes.Add(int64(read))
+		if err == io.EOF {
+			return total, nil
+		}
+		if err != nil {
+			return total, err
+		}
+	}
+}
+
+// WriteAt flushes the buffer and writes p at off
+func (u *uploadFile) WriteAt(p []byte, off int64) (int, error) {
+	if err := u.flush(); err != nil {
+		return 0, err
+	}
+	return u.File.WriteAt(p, off)
+}
+
+// Read flushes the buffer and reads from the file
+func (u *uploadFile) Read(p []byte) (int, error) {
+	if err := u.flush(); err != nil {
+		return 0, err
+	}
+	return u.File.Read(p)
+}
+
+// ReadAt flushes the buffer and reads from the file at off
+func (u *uploadFile) ReadAt(p []byte, off int64) (int, error) {
+	if err := u.flush(); err != nil {
+		return 0, err
+	}
+	return u.File.ReadAt(p, off)
+}
+
+// Seek flushes the buffer and sets the file offset
+func (u *uploadFile) Seek(offset int64, whence int) (int64, error) {
+	if err := u.flush(); err != nil {
+		return 0, err
+	}
+	return u.File.Seek(offset, whence)
+}
+
+// Stat flushes the buffer and returns the file's info
+func (u *uploadFile) Stat() (os.FileInfo, error) {
+	if err := u.flush(); err != nil {
+		return nil, err
+	}
+	return u.File.Stat()
+}
+
+// Truncate flushes the buffer and changes the file's size
+func (u *uploadFile) Truncate(size int64) error {
+	if err := u.flush(); err != nil {
+		return err
+	}
+	return u.File.Truncate(size)
+}
+
+// Sync flushes the buffer and commits the file to stable storage
+func (u *uploadFile) Sync() error {
+	if err := u.flush(); err != nil {
+		return err
+	}
+	return u.File.Sync()
+}
+
+// Close flushes the buffer, releases space preallocated past the end of the
+// file and closes it, syncing it first or handing it to the server's sync
+// batcher as configured
+func (u *uploadFile) Close() error {
+	if u.buf == nil {
+		return os.ErrClosed
+	}
+	err := u.flush()
+	u.buffers.put(u.buf)
+	u.buf = nil
+
+	if err == nil && u.preallocated {
+		// Blocks allocated beyond the data stay reserved until truncation
+		if fi, statErr := u.os.Stat(); statErr == nil {
+			err = u.os.Truncate(fi.Size())
+		}
+	}
+
+	var syncer *syncBatcher
+	switch u.server.uploadSync {
+	case SyncFile:
+		if err == nil {
+			err = u.os.Sync()
+		}
+	case SyncBatch:
+		syncer = u.server.syncer
+	}
+
+	if syncer != nil && err == nil {
+		syncer.add(u.File)
+	} else if closeErr := u.File.Close(); err == nil {
+		err = closeErr
+	}
+
+	if u.onClose != nil {
+		u.onClose()
+	}
+	return err
+}
+
+// syncBatcher syncs closed uploads in groups, off the transfer path. Files
+// handed to it stay open until a batch has synced them, so an mput waits for
+// no barrier and the syncs of its files are issued back to back.
+type syncBatcher struct {
+	interval time.Duration
+
+	mu      sync.Mutex
+	pending []afero.File
+
+	stop chan struct{}
+	done chan struct{}
+}
+
+// newSyncBatcher starts a batcher syncing waiting files every interval
+func newSyncBatcher(interval time.Duration) *syncBatcher {
+	b := &syncBatcher{
+		interval: interval,
+		stop:     make(chan struct{}),
+		done:     make(chan struct{}),
+	}
+	go b.run()
+	return b
+}
+
+// add queues file to be synced and closed by the next batch
+func (b *syncBatcher) add(file afero.File) {
+	b.mu.Lock()
+	b.pending = append(b.pending, file)
+	b.mu.Unlock()
+}
+
+func (b *syncBatcher) run() {
+	defer close(b.done)
+	ticker := time.NewTicker(b.interval)
+	defer ticker.Stop()
+	for {
+		select {
+		case <-ticker.C:
+			b.syncPending()
+		case <-b.stop:
+			b.syncPending()
+			return
+		}
+	}
+}
+
+// syncPending syncs and closes every waiting file
+func (b *syncBatcher) syncPending() {
+	b.mu.Lock()
+	files := b.pending
+	b.pending = nil
+	b.mu.Unlock()
+	if len(files) == 0 {
+		return
+	}
+
+	osFiles := make([]*os.File, 0, len(files))
+	for _, file := range files {
+		if f := osFileOf(file); f != nil {
+			osFiles = append(osFiles, f)
+		}
+	}
+	if err := syncFiles(osFiles); err != nil {
+		logging.App.Error("Failed to sync uploads", "files", len(files), "error", err)
+	}
+	for _, file := range files {
+		if err := file.Close(); err != nil {
+			logging.App.Error("Failed to close synced upload", "path", file.Name(), "error", err)
+		}
+	}
+}
+
+// Close syncs the files still waiting and stops the batcher
+func (b *syncBatcher) Close() {
+	close(b.stop)
+	<-b.done
+}
@@ -0,0 +1,27 @@
+package ftpserver
+
+import (
+	"os"
+	"syscall"
+)
+
+// fallocKeepSize reserves blocks without changing the file size
+const fallocKeepSize = 0x1 // FALLOC_FL_KEEP_SIZE
+
+// preallocate reserves size bytes of disk space starting at off, so an
+// upload of known size is laid out in few extents
+func preallocate(f *os.File, off, size int64) error {
+	return syscall.Fallocate(int(f.Fd()), fallocKeepSize, off, size)
+}
+
+// syncFiles commits the data of each file to stable storage. fdatasync
+// skips the metadata-only flush fsync would add for the timestamps.
+func syncFiles(files []*os.File) error {
+	var first error
+	for _, f := range files {
+		if err := syscall.Fdatasync(int(f.Fd())); err != nil && first == nil {
+			first = &os.PathError{Op: "fdatasync", Path: f.Name(), Err: err}
+		}
+	}
+	return first
+}
@@ -0,0 +1,21 @@
+//go:build !linux
+
+package ftpserver
+
+import "os"
+
+// preallocate is a no-op where fallocate is unavailable
+func preallocate(f *os.File, off, size int64) error {
+	return nil
+}
+
+// syncFiles commits each file to stable storage
+func syncFiles(files []*os.File) error {
+	var first error
+	for _, f := range files {
+		if err := f.Sync(); err != nil && first == nil {
+			first = err
+		}
+	}
+	return first
+}
@@ -0,0 +1,230 @@
+package ftpserver
+
+import (
+	"bytes"
+	"fmt"
+	"io"
+	"os"
+	"path/filepath"
+	"testing"
+	"time"
+
+	"github.com/spf13/afero"
+	"github.com/stretchr/testify/assert"
+)
+
+// uploadData returns size bytes of test content
+func uploadData(size int) []byte {
+	data := make([]byte, size)
+	for i := range data {
+		data[i] = byte(i * 13)
+	}
+	return data
+}
+
+// segmentedReader returns data a few bytes at a time, like a slow data
+// connection
+type segmentedReader struct {
+	data    []byte
+	segment int
+}
+
+func (r *segmentedReader) Read(p []byte) (int, error) {
+	if len(r.data) == 0 {
+		return 0, io.EOF
+	}
+	n := r.segment
+	if n > len(p) {
+		n = len(p)
+	}
+	if n > len(r.data) {
+		n = len(r.data)
+	}
+	copy(p, r.data[:n])
+	r.data = r.data[n:]
+	return n, nil
+}
+
+func TestUploadFile_Writes(t *testing.T) {
+	data := uploadData(10*1024 + 17)
+	tests := []struct {
+		name  string
+		write func(f afero.File) error
+	}{
+		{"small writes", func(f afero.File) error {
+			for p := data; len(p) > 0; {
+				n := 100
+				if n > len(p) {
+					n = len(p)
+				}
+				if _, err := f.Write(p[:n]); err != nil {
+					return err
+				}
+				p = p[n:]
+			}
+			return nil
+		}},
+		{"one large write", func(f afero.File) error {
+			_, err := f.Write(data)
+			return err
+		}},
+		{"io.Copy", func(f afero.File) error {
+			_, err := io.Copy(f, &segmentedReader{data: data, segment: 1460})
+			return err
+		}},
+		{"seek between writes", func(f afero.File) error {
+			if _, err := f.Write(data[:5000]); err != nil {
+				return err
+			}
+			if _, err := f.Seek(0, io.SeekEnd); err != nil {
+				return err
+			}
+			_, err := f.Write(data[5000:])
+			return err
+		}},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			root := t.TempDir()
+			fs := afero.NewBasePathFs(afero.NewOsFs(), root)
+			s := &Server{}
+			s.SetUploadBufferSize(4096)
+
+			f, err := fs.Create("/upload.c")
+			assert.NoError(t, err)
+			closed := 0
+			file := s.newUploadFile(f, 0, nil, func() { closed++ })
+			_, ok := file.(*uploadFile)
+			assert.True(t, ok)
+
+			assert.NoError(t, tt.write(file))
+			fi, err := file.Stat()
+			assert.NoError(t, err)
+			assert.Equal(t, int64(len(data)), fi.Size())
+			assert.NoError(t, file.Close())
+			assert.Equal(t, 1, closed)
+
+			got, err := os.ReadFile(filepath.Join(root, "upload.c"))
+			assert.NoError(t, err)
+			assert.True(t, bytes.Equal(data, got))
+		})
+	}
+}
+
+func TestUploadFile_Preallocate(t *testing.T) {
+	root := t.TempDir()
+	fs := afero.NewBasePathFs(afero.NewOsFs(), root)
+	s := &Server{}
+
+	f, err := fs.Create("/area.o")
+	assert.NoError(t, err)
+	file := s.newUploadFile(f, 1<<20, nil, nil)
+	_, err = file.Write([]byte("small"))
+	assert.NoError(t, err)
+	assert.NoError(t, file.Close())
+
+	// The announced size is only reserved; the file holds what was written
+	fi, err := os.Stat(filepath.Join(root, "area.o"))
+	assert.NoError(t, err)
+	assert.Equal(t, int64(5), fi.Size())
+}
+
+func TestUploadFile_Sync(t *testing.T) {
+	for _, mode := range []UploadSync{SyncNone, SyncFile, SyncBatch} {
+		t.Run(string(mode), func(t *testing.T) {
+			root := t.TempDir()
+			fs := afero.NewBasePathFs(afero.NewOsFs(), root)
+			s := &Server{}
+			s.SetUploadSync(mode, time.Millisecond)
+
+			for i := 0; i < 5; i++ {
+				f, err := fs.Create(fmt.Sprintf("/file%d.c", i))
+				assert.NoError(t, err)
+				file := s.newUploadFile(f, 0, nil, nil)
+				_, err = file.Write([]byte("inherit \"/std/room\";\n"))
+				assert.NoError(t, err)
+				assert.NoError(t, file.Close())
+			}
+			if s.syncer != nil {
+				s.syncer.Close()
+				s.syncer.mu.Lock()
+				assert.Equal(t, 0, len(s.syncer.pending))
+				s.syncer.mu.Unlock()
+			}
+
+			for i := 0; i < 5; i++ {
+				got, err := os.ReadFile(filepath.Join(root, fmt.Sprintf("file%d.c", i)))
+				assert.NoError(t, err)
+				assert.Equal(t, "inherit \"/std/room\";\n", string(got))
+			}
+		})
+	}
+}
+
+func TestUploadFile_WriteAfterClose(t *testing.T) {
+	fs := afero.NewBasePathFs(afero.NewOsFs(), t.TempDir())
+	f, err := fs.Create("/x.c")
+	assert.NoError(t, err)
+	file := (&Server{}).newUploadFile(f, 0, nil, nil)
+	assert.NoError(t, file.Close())
+
+	_, err = file.Write([]byte("late"))
+	assert.Equal(t, os.ErrClosed, err)
+	assert.Equal(t, os.ErrClosed, file.Close())
+}
+
+func TestParseUploadSync(t *testing.T) {
+	tests := []struct {
+		input   string
+		want    UploadSync
+		wantErr bool
+	}{
+		{"", SyncNone, false},
+		{"none", SyncNone, false},
+		{"file", SyncFile, false},
+		{"batch", SyncBatch, false},
+		{"always", "", true},
+	}
+	for _, tt := range tests {
+		got, err := ParseUploadSync(tt.input)
+		if got != tt.want || (err != nil) != tt.wantErr {
+			t.Errorf("ParseUploadSync(%q) = %v, %v; want %v, error %v", tt.input, got, err, tt.want, tt.wantErr)
+		}
+	}
+}
+
+// BenchmarkUpload measures an mput of small LPC files arriving in
+// network-sized segments, written directly and through the upload buffer
+func BenchmarkUpload(b *testing.B) {
+	const files = 100
+	data := uploadData(24 * 1024)
+	root := b.TempDir()
+	fs := afero.NewBasePathFs(afero.NewOsFs(), root)
+
+	for _, buffered := range []bool{false, true} {
+		b.Run(fmt.Sprintf("buffered=%v", buffered), func(b *testing.B) {
+			s := &Server{}
+			b.SetBytes(files * int64(len(data)))
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				for n := 0; n < files; n++ {
+					file, err := fs.Create(fmt.Sprintf("/file%d.c", n))
+					if err != nil {
+						b.Fatal(err)
+					}
+					if buffered {
+						file = s.newUploadFile(file, 0, nil, nil)
+					}
+					// Without the buffer, each segment read is one write call
+					if _, err := io.Copy(file, &segmentedReader{data: data, segment: 1460}); err != nil {
+						b.Fatal(err)
+					}
+					if err := file.Close(); err != nil {
+						b.Fatal(err)
+					}
+				}
+			}
+		})
+	}
+}
@@ -0,0 +1,289 @@
+package logging
+
+import (
+	"fmt"
+	"io"
+	"sync"
+	"sync/atomic"
+)
+
+// FullPolicy selects what an AsyncWriter does with a record when its buffer
+// is full
+type FullPolicy string
+
+const (
+	// PolicyBlock makes the logging goroutine wait for room in the buffer
+	PolicyBlock FullPolicy = "block"
+	// PolicyDrop discards the record and counts it
+	PolicyDrop FullPolicy = "drop"
+)
+
+// ParseFullPolicy converts a configuration value to a FullPolicy. An empty
+// string selects PolicyBlock.
+func ParseFullPolicy(s string) (FullPolicy, error) {
+	switch FullPolicy(s) {
+	case "", PolicyBlock:
+		return PolicyBlock, nil
+	case PolicyDrop:
+		return PolicyDrop, nil
+	}
+	return "", fmt.Errorf("unknown full policy %q (expected block or drop)", s)
+}
+
+const (
+	// DefaultAsyncBufferSize is the default number of records an AsyncWriter buffers
+	DefaultAsyncBufferSize = 8192
+
+	// asyncBatchSize bounds the bytes handed to one write call
+	asyncBatchSize = 64 * 1024
+
+	// maxPooledRecord is the largest record buffer kept for reuse
+	maxPooledRecord = 4 * 1024
+)
+
+// AsyncWriter buffers log records in a bounded lock-free ring and writes
+// them from a single goroutine, batching all records that are waiting into
+// one write call. Each Write call is one record; it is copied, so callers
+// may reuse their buffer.
+//
+// Write calls after Close go straight to the underlying writer. A record
+// queued while Close stops the writer goroutine is written out by its
+// Write call.
+type AsyncWriter struct {
+	out    io.Writer
+	policy FullPolicy
+
+	slots []ringSlot
+	mask  uint64
+	head  atomic.Uint64 // next position producers claim
+	tail  uint64        // next position the writer goroutine reads
+
+	wake    chan struct{} // records are waiting, capacity 1
+	flushCh chan chan struct{}
+	stop    chan struct{}
+	done    chan struct{}
+	closed  atomic.Bool
+	drainMu sync.Mutex // serializes drains once the writer goroutine is done
+
+	// Producers waiting for room under PolicyBlock
+	spaceMu sync.Mutex
+	space   *sync.Cond
+	waiters atomic.Int32
+
+	records sync.Pool
+	dropped atomic.Uint64
+}
+
+// ringSlot holds one record. seq tells producers and the writer goroutine
+// whose turn the slot is, as in Vyukov's bounded queue.
+type ringSlot struct {
+	seq atomic.Uint64
+	buf *[]byte
+}
+
+// NewAsyncWriter starts a writer goroutine writing to out, buffering up to
+// size records (rounded up to a power of two)
+func NewAsyncWriter(out io.Writer, size int, policy FullPolicy) *AsyncWriter {
+	if size <= 0 {
+		size = DefaultAsyncBufferSize
+	}
+	n := 1
+	for n < size {
+		n <<= 1
+	}
+
+	w := &AsyncWriter{
+		out:     out,
+		policy:  policy,
+		slots:   make([]ringSlot, n),
+		mask:    uint64(n - 1),
+		wake:    make(chan struct{}, 1),
+		flushCh: make(chan chan struct{}),
+		stop:    make(chan struct{}),
+		done:    make(chan struct{}),
+	}
+	w.space = sync.NewCond(&w.spaceMu)
+	w.records.New = func() interface{} {
+		buf := make([]byte, 0, 256)
+		return &buf
+	}
+	for i := range w.slots {
+		w.slots[i].seq.Store(uint64(i))
+	}
+
+	go w.run()
+	return w
+}
+
+// Write implements io.Writer. It queues a copy of p and returns without
+// waiting for it to be written, unless the buffer is full and the policy
+// is PolicyBlock.
+func (w *AsyncWriter) Write(p []byte) (int, error) {
+	if w.closed.Load() {
+		return w.out.Write(p)
+	}
+	if w.enqueue(p) {
+		w.queued()
+		return len(p), nil
+	}
+
+	if w.policy == PolicyDrop {
+		w.dropped.Add(1)
+		return len(p), nil
+	}
+
+	w.spaceMu.Lock()
+	w.waiters.Add(1)
+	for !w.enqueue(p) {
+		if w.closed.Load() {
+			w.waiters.Add(-1)
+			w.spaceMu.Unlock()
+			return w.out.Write(p)
+		}
+		w.signal()
+		w.space.Wait()
+	}
+	w.waiters.Add(-1)
+	w.spaceMu.Unlock()
+	w.queued()
+	return len(p), nil
+}
+
+// queued wakes the writer goroutine for a record just queued. If Close has
+// started, the goroutine's last drain may have missed the record, so it is
+// written out once the goroutine is done.
+func (w *AsyncWriter) queued() {
+	w.signal()
+	if !w.closed.Load() {
+		return
+	}
+	<-w.done
+	w.drainMu.Lock()
+	w.drain(nil)
+	w.drainMu.Unlock()
+}
+
+// Flush waits until every record written before the call has been handed
+// to the underlying writer
+func (w *AsyncWriter) Flush() {
+	ack := make(chan struct{})
+	select {
+	case w.flushCh <- ack:
+		<-ack
+	case <-w.done:
+	}
+}
+
+// Close writes out the buffered records and stops the writer goroutine. It
+// does not close the underlying writer.
+func (w *AsyncWriter) Close() error {
+	if !w.closed.CompareAndSwap(false, true) {
+		return nil
+	}
+	close(w.stop)
+	<-w.done
+
+	// Wake producers blocked on a full buffer so they write directly
+	w.spaceMu.Lock()
+	w.space.Broadcast()
+	w.spaceMu.Unlock()
+	return nil
+}
+
+// Dropped returns the number of records discarded because the buffer was full
+func (w *AsyncWriter) Dropped() uint64 {
+	return w.dropped.Load()
+}
+
+// signal wakes the writer goroutine unless a wake-up is already pending
+func (w *AsyncWriter) signal() {
+	select {
+	case w.wake <- struct{}{}:
+	default:
+	}
+}
+
+// enqueue claims a slot and copies p into it, reporting false if the ring
+// is full
+func (w *AsyncWriter) enqueue(p []byte) bool {
+	for {
+		pos := w.head.Load()
+		slot := &w.slots[pos&w.mask]
+		seq := slot.seq.Load()
+		switch {
+		case seq == pos:
+			if w.head.CompareAndSwap(pos, pos+1) {
+				buf := w.records.Get().(*[]byte)
+				*buf = append((*buf)[:0], p...)
+				slot.buf = buf
+				slot.seq.Store(pos + 1)
+				return true
+			}
+		case seq < pos:
+			// The writer goroutine has not freed this slot yet
+			return false
+		}
+		// Another producer claimed the slot first; retry
+	}
+}
+
+// dequeue takes the next record, if one is ready. Only the writer goroutine
+// calls it.
+func (w *AsyncWriter) dequeue() (*[]byte, bool) {
+	slot := &w.slots[w.tail&w.mask]
+	if slot.seq.Load() != w.tail+1 {
+		return nil, false
+	}
+	buf := slot.buf
+	slot.buf = nil
+	slot.seq.Store(w.tail + w.mask + 1)
+	w.tail++
+	return buf, true
+}
+
+// run is the writer goroutine
+func (w *AsyncWriter) run() {
+	defer close(w.done)
+	batch := make([]byte, 0, asyncBatchSize)
+	for {
+		select {
+		case <-w.wake:
+			batch = w.drain(batch)
+		case ack := <-w.flushCh:
+			batch = w.drain(batch)
+			close(ack)
+		case <-w.stop:
+			w.drain(batch)
+			return
+		}
+	}
+}
+
+// drain writes every ready record, in batches of up to asyncBatchSize bytes
+func (w *AsyncWriter) drain(batch []byte) []byte {
+	for {
+		batch = batch[:0]
+		freed := false
+		for len(batch) < asyncBatchSize {
+			buf, ok := w.dequeue()
+			if !ok {
+				break
+			}
+			batch = append(batch, *buf...)
+			if cap(*buf) <= maxPooledRecord {
+				w.records.Put(buf)
+			}
+			freed = true
+		}
+		if freed && w.waiters.Load() > 0 {
+			w.spaceMu.Lock()
+			w.space.Broadcast()
+			w.spaceMu.Unlock()
+		}
+		if len(batch) == 0 {
+			return batch
+		}
+		// Errors have nowhere to go; the rotating writer reopens its file
+		_, _ = w.out.Write(batch)
+	}
+}
@@ -0,0 +1,171 @@
+package logging
+
+import (
+	"bytes"
+	"fmt"
+	"strings"
+	"sync"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+)
+
+// recordingWriter records what it is given, optionally waiting for release
+// before each write
+type recordingWriter struct {
+	release chan struct{}
+
+	mu     sync.Mutex
+	buf    bytes.Buffer
+	writes int
+}
+
+func (w *recordingWriter) Write(p []byte) (int, error) {
+	if w.release != nil {
+		<-w.release
+	}
+	w.mu.Lock()
+	defer w.mu.Unlock()
+	w.writes++
+	return w.buf.Write(p)
+}
+
+func (w *recordingWriter) String() string {
+	w.mu.Lock()
+	defer w.mu.Unlock()
+	return w.buf.String()
+}
+
+func TestParseFullPolicy(t *testing.T) {
+	tests := []struct {
+		input   string
+		want    FullPolicy
+		wantErr bool
+	}{
+		{"", PolicyBlock, false},
+		{"block", PolicyBlock, false},
+		{"drop", PolicyDrop, false},
+		{"wait", "", true},
+	}
+	for _, tt := range tests {
+		t.Run(tt.input, func(t *testing.T) {
+			got, err := ParseFullPolicy(tt.input)
+			if tt.wantErr {
+				assert.Error(t, err)
+				return
+			}
+			assert.NoError(t, err)
+			assert.Equal(t, tt.want, got)
+		})
+	}
+}
+
+func TestAsyncWriter_Flush(t *testing.T) {
+	out := &recordingWriter{}
+	w := NewAsyncWriter(out, 16, PolicyBlock)
+	defer w.Close()
+
+	buf := []byte("first\n")
+	w.Write(buf)
+	copy(buf, "XXXXX") // the record was copied
+	w.Write([]byte("second\n"))
+	w.Flush()
+
+	assert.Equal(t, "first\nsecond\n", out.String())
+}
+
+func TestAsyncWriter_Batches(t *testing.T) {
+	out := &recordingWriter{release: make(chan struct{})}
+	w := NewAsyncWriter(out, 64, PolicyBlock)
+
+	// The first record is held in the writer while the rest queue behind it
+	w.Write([]byte("0\n"))
+	for i := 1; i < 10; i++ {
+		w.Write([]byte(fmt.Sprintf("%d\n", i)))
+	}
+	close(out.release)
+	w.Close()
+
+	assert.Equal(t, "0\n1\n2\n3\n4\n5\n6\n7\n8\n9\n", out.String())
+	assert.True(t, out.writes <= 3, "queued records should share a write")
+}
+
+func TestAsyncWriter_DropPolicy(t *testing.T) {
+	out := &recordingWriter{release: make(chan struct{})}
+	w := NewAsyncWriter(out, 4, PolicyDrop)
+
+	for i := 0; i < 20; i++ {
+		n, err := w.Write([]byte("record\n"))
+		assert.NoError(t, err)
+		assert.Equal(t, 7, n)
+	}
+	close(out.release)
+	w.Close()
+
+	written := uint64(strings.Count(out.String(), "record"))
+	assert.True(t, w.Dropped() > 0, "a full buffer should drop records")
+	assert.Equal(t, uint64(20), written+w.Dropped())
+}
+
+func TestAsyncWriter_BlockPolicy(t *testing.T) {
+	out := &recordingWriter{}
+	w := NewAsyncWriter(out, 4, PolicyBlock)
+
+	var wg sync.WaitGroup
+	for g := 0; g < 8; g++ {
+		wg.Add(1)
+		go func(g int) {
+			defer wg.Done()
+			for i := 0; i < 200; i++ {
+				w.Write([]byte(fmt.Sprintf("g%d-%d\n", g, i)))
+			}
+		}(g)
+	}
+	wg.Wait()
+	w.Close()
+
+	assert.Equal(t, uint64(0), w.Dropped())
+	assert.Equal(t, 8*200, strings.Count(out.String(), "\n"))
+}
+
+func TestAsyncWriter_WriteAfterClose(t *testing.T) {
+	out := &recordingWriter{}
+	w := NewAsyncWriter(out, 4, PolicyBlock)
+	w.Write([]byte("before\n"))
+	assert.NoError(t, w.Close())
+	assert.NoError(t, w.Close())
+
+	w.Write([]byte("after\n"))
+	assert.Equal(t, "before\nafter\n", out.String())
+}
+
+func TestAsyncWriter_WriteDuringClose(t *testing.T) {
+	for _, policy := range []FullPolicy{PolicyBlock, PolicyDrop} {
+		t.Run(string(policy), func(t *testing.T) {
+			for round := 0; round < 200; round++ {
+				out := &recordingWriter{}
+				w := NewAsyncWriter(out, 4, policy)
+
+				var started, wg sync.WaitGroup
+				for g := 0; g < 4; g++ {
+					started.Add(1)
+					wg.Add(1)
+					go func() {
+						defer wg.Done()
+						started.Done()
+						for i := 0; i < 50; i++ {
+							w.Write([]byte("record\n"))
+						}
+					}()
+				}
+				started.Wait()
+				w.Close()
+				wg.Wait()
+
+				// Every accepted record is written or counted as dropped
+				written := uint64(strings.Count(out.String(), "record"))
+				assert.Equal(t, uint64(4*50), written+w.Dropped())
+			}
+		})
+	}
+}
@@ -0,0 +1,213 @@
+package logging
+
+import (
+	"fmt"
+	"strconv"
+	"sync"
+	"sync/atomic"
+	"time"
+	"unicode"
+	"unicode/utf8"
+)
+
+// timestampLayout is the layout of the timestamp starting every record
+const timestampLayout = "2006-01-02 15:04:05 -0700"
+
+// maxPooledEncoder is the largest encoder buffer kept for reuse
+const maxPooledEncoder = 16 * 1024
+
+// encoder builds one log record in a reusable buffer. Values are written in
+// logfmt style: a value containing a space, '=' or '"' is quoted, with
+// quotes escaped.
+type encoder struct {
+	buf []byte
+}
+
+var encoderPool = sync.Pool{
+	New: func() interface{} {
+		return &encoder{buf: make([]byte, 0, 512)}
+	},
+}
+
+// getEncoder returns an empty encoder from the pool
+func getEncoder() *encoder {
+	e := encoderPool.Get().(*encoder)
+	e.buf = e.buf[:0]
+	return e
+}
+
+// putEncoder returns an encoder to the pool
+func putEncoder(e *encoder) {
+	if cap(e.buf) <= maxPooledEncoder {
+		encoderPool.Put(e)
+	}
+}
+
+// cachedTimestamp is a formatted timestamp for one second
+type cachedTimestamp struct {
+	unix int64
+	text []byte
+}
+
+var lastTimestamp atomic.Pointer[cachedTimestamp]
+
+// appendTimestamp appends the current UTC time, formatting it at most once
+// per second
+func (e *encoder) appendTimestamp() {
+	now := time.Now()
+	unix := now.Unix()
+	if ts := lastTimestamp.Load(); ts != nil && ts.unix == unix {
+		e.buf = append(e.buf, ts.text...)
+		return
+	}
+	ts := &cachedTimestamp{unix: unix}
+	ts.text = now.UTC().AppendFormat(make([]byte, 0, len(timestampLayout)), timestampLayout)
+	lastTimestamp.Store(ts)
+	e.buf = append(e.buf, ts.text...)
+}
+
+// appendField appends " key=value". With clean set, runs of whitespace in
+// the key and value are collapsed to one space, as the application log does.
+func (e *encoder) appendField(key, value interface{}, clean bool) {
+	e.buf = append(e.buf, ' ')
+	if clean {
+		e.appendCleaned(key)
+	} else {
+		e.appendRaw(key)
+	}
+	e.buf = append(e.buf, '=')
+
+	start := len(e.buf)
+	if clean {
+		e.appendCleaned(value)
+	} else {
+		e.appendRaw(value)
+	}
+	e.quoteFrom(start)
+}
+
+// appendString appends " key=value" for a value that needs no cleaning
+func (e *encoder) appendString(key, value string) {
+	e.buf = append(e.buf, ' ')
+	e.buf = append(e.buf, key...)
+	e.buf = append(e.buf, '=')
+	start := len(e.buf)
+	e.buf = append(e.buf, value...)
+	e.quoteFrom(start)
+}
+
+// appendRaw appends v as fmt's %v would print it
+func (e *encoder) appendRaw(v interface{}) {
+	switch v := v.(type) {
+	case string:
+		e.buf = append(e.buf, v...)
+	case int:
+		e.buf = strconv.AppendInt(e.buf, int64(v), 10)
+	case int64:
+		e.buf = strconv.AppendInt(e.buf, v, 10)
+	case int32:
+		e.buf = strconv.AppendInt(e.buf, int64(v), 10)
+	case uint:
+		e.buf = strconv.AppendUint(e.buf, uint64(v), 10)
+	case uint64:
+		e.buf = strconv.AppendUint(e.buf, v, 10)
+	case uint32:
+		e.buf = strconv.AppendUint(e.buf, uint64(v), 10)
+	case bool:
+		e.buf = strconv.AppendBool(e.buf, v)
+	case float64:
+		e.buf = strconv.AppendFloat(e.buf, v, 'g', -1, 64)
+	case float32:
+		e.buf = strconv.AppendFloat(e.buf, float64(v), 'g', -1, 32)
+	case error, fmt.Stringer:
+		e.appendMethod(v)
+	default:
+		e.buf = fmt.Appendf(e.buf, "%v", v)
+	}
+}
+
+// appendMethod appends the result of v's Error or String method. Like fmt,
+// it prints a nil receiver whose method panics as "<nil>".
+func (e *encoder) appendMethod(v interface{}) {
+	defer func() {
+		if recover() != nil {
+			e.buf = append(e.buf, "<nil>"...)
+		}
+	}()
+	switch v := v.(type) {
+	case error:
+		e.buf = append(e.buf, v.Error()...)
+	case fmt.Stringer:
+		e.buf = append(e.buf, v.String()...)
+	}
+}
+
+// appendCleaned appends v with leading and trailing whitespace removed and
+// inner runs of whitespace replaced by one space. nil appends nothing.
+func (e *encoder) appendCleaned(v interface{}) {
+	if v == nil {
+		return
+	}
+	start := len(e.buf)
+	e.appendRaw(v)
+
+	// Collapse in place; the result is never longer than the input
+	out := start
+	pendingSpace := false
+	for i := start; i < len(e.buf); {
+		r, size := rune(e.buf[i]), 1
+		if r >= utf8.RuneSelf {
+			r, size = utf8.DecodeRune(e.buf[i:])
+		}
+		if unicode.IsSpace(r) {
+			pendingSpace = out > start
+			i += size
+			continue
+		}
+		if pendingSpace {
+			e.buf[out] = ' '
+			out++
+			pendingSpace = false
+		}
+		out += copy(e.buf[out:], e.buf[i:i+size])
+		i += size
+	}
+	e.buf = e.buf[:out]
+}
+
+// quoteFrom quotes the value starting at start if it contains a space, '='
+// or '"', escaping its quotes
+func (e *encoder) quoteFrom(start int) {
+	quotes, needsQuoting := 0, false
+	for _, c := range e.buf[start:] {
+		switch c {
+		case '"':
+			quotes++
+			needsQuoting = true
+		case ' ', '=':
+			needsQuoting = true
+		}
+	}
+	if !needsQuoting {
+		return
+	}
+
+	// Grow by the two enclosing quotes and one backslash per quote, then
+	// shift the value right from its end
+	end := len(e.buf)
+	for i := 0; i < quotes+2; i++ {
+		e.buf = append(e.buf, 0)
+	}
+	dst := len(e.buf) - 1
+	e.buf[dst] = '"'
+	dst--
+	for src := end - 1; src >= start; src-- {
+		e.buf[dst] = e.buf[src]
+		dst--
+		if e.buf[src] == '"' {
+			e.buf[dst] = '\\'
+			dst--
+		}
+	}
+	e.buf[dst] = '"'
+}
@@ -0,0 +1,205 @@
+package logging
+
+import (
+	"bytes"
+	"errors"
+	"fmt"
+	"io"
+	"log"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/assert"
+)
+
+// The fmt-based formatting the encoder replaced, kept as the reference for
+// output compatibility and as the benchmark baseline
+
+func legacyToString(v interface{}) string {
+	if v == nil {
+		return ""
+	}
+	str := fmt.Sprintf("%v", v)
+	str = strings.ReplaceAll(str, "\n", " ")
+	str = strings.ReplaceAll(str, "\r", " ")
+	str = strings.ReplaceAll(str, "\t", " ")
+	return strings.Join(strings.Fields(str), " ")
+}
+
+func legacyFormatValue(v interface{}) string {
+	s := fmt.Sprintf("%v", v)
+	if strings.ContainsAny(s, " =\"") {
+		s = strings.ReplaceAll(s, "\"", "\\\"")
+		return fmt.Sprintf("\"%s\"", s)
+	}
+	return s
+}
+
+func legacyAppLog(logger *log.Logger, minLevel LogLevel, level LogLevel, message string, keyvals ...interface{}) {
+	levels := map[LogLevel]int{
+		LogLevelDebug: 0,
+		LogLevelInfo:  1,
+		LogLevelWarn:  2,
+		LogLevelError: 3,
+		LogLevelPanic: 4,
+	}
+	if levels[level] < levels[minLevel] {
+		return
+	}
+	var kvStrings []string
+	for i := 0; i+1 < len(keyvals); i += 2 {
+		kvStrings = append(kvStrings, fmt.Sprintf("%s=%s", legacyToString(keyvals[i]), legacyFormatValue(legacyToString(keyvals[i+1]))))
+	}
+	timestamp := time.Now().UTC().Format(timestampLayout)
+	logger.Printf("%s %s: %s %s", timestamp, level, message, strings.Join(kvStrings, " "))
+}
+
+func legacyLogAccess(logger *log.Logger, operation, user, path, status string, details ...interface{}) {
+	var parts []string
+	parts = append(parts, fmt.Sprintf("op=%s", legacyFormatValue(operation)))
+	if user != "" {
+		parts = append(parts, fmt.Sprintf("user=%s", legacyFormatValue(user)))
+	}
+	if path != "" {
+		parts = append(parts, fmt.Sprintf("path=%s", legacyFormatValue(path)))
+	}
+	parts = append(parts, fmt.Sprintf("status=%s", legacyFormatValue(status)))
+	for i := 0; i+1 < len(details); i += 2 {
+		parts = append(parts, fmt.Sprintf("%v=%s", details[i], legacyFormatValue(details[i+1])))
+	}
+	timestamp := time.Now().UTC().Format(timestampLayout)
+	logger.Printf("%s %s", timestamp, strings.Join(parts, " "))
+}
+
+// stripTimestamp removes the timestamp from every line
+func stripTimestamp(s string) string {
+	lines := strings.SplitAfter(s, "\n")
+	for i, line := range lines {
+		if len(line) > len(timestampLayout) {
+			lines[i] = line[len(timestampLayout):]
+		}
+	}
+	return strings.Join(lines, "")
+}
+
+type nilStringer struct{ name string }
+
+func (s *nilStringer) String() string { return s.name }
+
+var keyvalCases = []struct {
+	name    string
+	keyvals []interface{}
+}{
+	{"none", nil},
+	{"odd", []interface{}{"orphan"}},
+	{"strings", []interface{}{"user", "drake", "path", "/players/drake"}},
+	{"quoting", []interface{}{"msg", `say "hi" now`, "eq", "a=b"}},
+	{"whitespace", []interface{}{"key\twith space", "  line one\n\tline two  \r\n"}},
+	{"unicode", []interface{}{"name", "Ænima x", "blank", " "}},
+	{"numbers", []interface{}{"int", 42, "neg", int64(-7), "uint", uint32(9), "float", 1.5, "big", 1e21, "f32", float32(0.1)}},
+	{"other types", []interface{}{"ok", true, "err", errors.New("no such file"), "dur", 1500 * time.Millisecond, "list", []string{"a", "b"}, "nil", nil}},
+	{"nil receiver", []interface{}{"s", (*nilStringer)(nil)}},
+}
+
+func TestAppLogger_MatchesLegacyFormat(t *testing.T) {
+	for _, tt := range keyvalCases {
+		t.Run(tt.name, func(t *testing.T) {
+			var got, want bytes.Buffer
+			l := &AppLogger{level: LogLevelDebug, out: &logOutput{Writer: &got}}
+			l.Info("Something happened", tt.keyvals...)
+			legacyAppLog(log.New(&want, "", 0), LogLevelDebug, LogLevelInfo, "Something happened", tt.keyvals...)
+			assert.Equal(t, stripTimestamp(want.String()), stripTimestamp(got.String()))
+		})
+	}
+}
+
+func TestAccessLogger_MatchesLegacyFormat(t *testing.T) {
+	for _, tt := range keyvalCases {
+		t.Run(tt.name, func(t *testing.T) {
+			var got, want bytes.Buffer
+			l := &accessLogger{out: &logOutput{Writer: &got}}
+			l.LogAccess("RETR", "drake", "/players/drake/my file.c", "success", tt.keyvals...)
+			l.LogAuth("LOGIN", "", "failure", tt.keyvals...)
+			legacy := log.New(&want, "", 0)
+			legacyLogAccess(legacy, "RETR", "drake", "/players/drake/my file.c", "success", tt.keyvals...)
+			legacyLogAccess(legacy, "LOGIN", "", "", "failure", tt.keyvals...)
+			assert.Equal(t, stripTimestamp(want.String()), stripTimestamp(got.String()))
+		})
+	}
+}
+
+func TestAppLogger_Levels(t *testing.T) {
+	var out bytes.Buffer
+	l := &AppLogger{level: LogLevelWarn, minLevel: levelRank(LogLevelWarn), out: &logOutput{Writer: &out}}
+	l.Debug("debug")
+	l.Info("info")
+	l.Warn("warn")
+	l.Error("error")
+
+	assert.False(t, l.IsDebug())
+	assert.False(t, l.Enabled(LogLevelInfo))
+	assert.True(t, l.Enabled(LogLevelError))
+	assert.Equal(t, 2, strings.Count(out.String(), "\n"))
+	assert.True(t, strings.Contains(out.String(), " warn: warn "))
+	assert.False(t, strings.Contains(out.String(), "info"))
+}
+
+func TestEncoder_Timestamp(t *testing.T) {
+	e := getEncoder()
+	defer putEncoder(e)
+	e.appendTimestamp()
+	ts, err := time.Parse(timestampLayout, string(e.buf))
+	assert.NoError(t, err)
+	assert.True(t, time.Since(ts) < 2*time.Second)
+}
+
+func BenchmarkAppLogger(b *testing.B) {
+	keyvals := []interface{}{"user", "drake", "path", "/players/drake/workroom.c", "permission", "Write"}
+
+	b.Run("Legacy", func(b *testing.B) {
+		logger := log.New(io.Discard, "", 0)
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			legacyAppLog(logger, LogLevelDebug, LogLevelDebug, "Resolved permission", "user", "drake", "path", "/players/drake/workroom.c", "permission", "Write")
+		}
+	})
+	b.Run("Encoder", func(b *testing.B) {
+		l := &AppLogger{level: LogLevelDebug, out: &logOutput{Writer: io.Discard}}
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			l.Debug("Resolved permission", "user", "drake", "path", "/players/drake/workroom.c", "permission", "Write")
+		}
+	})
+	b.Run("LegacyDisabled", func(b *testing.B) {
+		logger := log.New(io.Discard, "", 0)
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			legacyAppLog(logger, LogLevelInfo, LogLevelDebug, "Resolved permission", keyvals...)
+		}
+	})
+	b.Run("Disabled", func(b *testing.B) {
+		l := &AppLogger{level: LogLevelInfo, minLevel: rankInfo, out: &logOutput{Writer: io.Discard}}
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			l.Debug("Resolved permission", keyvals...)
+		}
+	})
+}
+
+func BenchmarkAccessLogger(b *testing.B) {
+	b.Run("Legacy", func(b *testing.B) {
+		logger := log.New(io.Discard, "", 0)
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			legacyLogAccess(logger, "RETR", "drake", "/players/drake/workroom.c", "success", "bytes", "1024")
+		}
+	})
+	b.Run("Encoder", func(b *testing.B) {
+		l := &accessLogger{out: &logOutput{Writer: io.Discard}}
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			l.LogAccess("RETR", "drake", "/players/drake/workroom.c", "success", "bytes", "1024")
+		}
+	})
+}
@@ -1,10 +1,7 @@
 package logging
 
 import (
-	"fmt"
 	"io"
-	"log"
-	"strings"
 	"time"
 )
 
@@ -19,75 +16,68 @@ type AccessLogger interface {
 }
 
 type accessLogger struct {
-	logger *log.Logger
-	writer *RotatingWriter // nil if logging to io.Discard
+	out     *logOutput
+	discard bool // no log file is configured
 }
 
 // NewAccessLogger creates a new access logger
 func NewAccessLogger(logPath string, maxSize int64, verifyInterval time.Duration) (AccessLogger, error) {
-	var writer io.Writer
-	var rotatingWriter *RotatingWriter
+	return newAccessLogger(logPath, maxSize, verifyInterval, Options{})
+}
 
-	if logPath == "" {
-		writer = io.Discard
-	} else {
-		rw, err := NewRotatingWriter(logPath, maxSize, verifyInterval)
-		if err != nil {
-			return nil, fmt.Errorf("creating rotating writer: %w", err)
-		}
-		writer = rw
-		rotatingWriter = rw
+func newAccessLogger(logPath string, maxSize int64, verifyInterval time.Duration, opts Options) (AccessLogger, error) {
+	out, err := openLogOutput(logPath, io.Discard, maxSize, verifyInterval, opts)
+	if err != nil {
+		return nil, err
 	}
 
 	return &accessLogger{
-		logger: log.New(writer, "", 0), // No flags, we'll handle formatting ourselves
-		writer: rotatingWriter,
+		out:     out,
+		discard: logPath == "",
 	}, nil
 }
 
 func (l *accessLogger) LogAccess(operation string, user string, path string, status string, details ...interface{}) {
-	var parts []string
-	parts = append(parts, fmt.Sprintf("op=%s", formatValue(operation)))
-	if user != "" {
-		parts = append(parts, fmt.Sprintf("user=%s", formatValue(user)))
+	if l.discard {
+		return
 	}
+	e := l.begin(operation, user)
 	if path != "" {
-		parts = append(parts, fmt.Sprintf("path=%s", formatValue(path)))
+		e.appendString("path", path)
 	}
-	parts = append(parts, fmt.Sprintf("status=%s", formatValue(status)))
+	l.finish(e, status, details)
+}
 
-	for i := 0; i < len(details); i += 2 {
-		if i+1 < len(details) {
-			parts = append(parts, fmt.Sprintf("%v=%s", details[i], formatValue(details[i+1])))
-		}
+func (l *accessLogger) LogAuth(operation string, user string, status string, details ...interface{}) {
+	if l.discard {
+		return
 	}
-
-	timestamp := time.Now().UTC().Format("2006-01-02 15:04:05 -0700")
-	l.logger.Printf("%s %s", timestamp, strings.Join(parts, " "))
+	l.finish(l.begin(operation, user), status, details)
 }
 
-func (l *accessLogger) LogAuth(operation string, user string, status string, details ...interface{}) {
-	var parts []string
-	parts = append(parts, fmt.Sprintf("op=%s", formatValue(operation)))
+// begin starts a record with the timestamp, operation and user
+func (l *accessLogger) begin(operation string, user string) *encoder {
+	e := getEncoder()
+	e.appendTimestamp()
+	e.appendString("op", operation)
 	if user != "" {
-		parts = append(parts, fmt.Sprintf("user=%s", formatValue(user)))
+		e.appendString("user", user)
 	}
-	parts = append(parts, fmt.Sprintf("status=%s", formatValue(status)))
+	return e
+}
 
-	for i := 0; i < len(details); i += 2 {
-		if i+1 < len(details) {
-			parts = append(parts, fmt.Sprintf("%v=%s", details[i], formatValue(details[i+1])))
-		}
+// finish appends the status and details and writes the record
+func (l *accessLogger) finish(e *encoder, status string, details []interface{}) {
+	e.appendString("status", status)
+	for i := 0; i+1 < len(details); i += 2 {
+		e.appendField(details[i], details[i+1], false)
 	}
-
-	timestamp := time.Now().UTC().Format("2006-01-02 15:04:05 -0700")
-	l.logger.Printf("%s %s", timestamp, strings.Join(parts, " "))
+	e.buf = append(e.buf, '\n')
+	_, _ = l.out.Write(e.buf)
+	putEncoder(e)
 }
 
 // Close closes the logger and stops background rotation
 func (l *accessLogger) Close() error {
-	if l.writer != nil {
-		return l.writer.Close()
-	}
-	return nil
+	return l.out.Close()
 }
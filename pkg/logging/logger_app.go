@@ -1,11 +1,7 @@
 package logging
 
 import (
-	"fmt"
-	"io"
-	"log"
 	"os"
-	"strings"
 	"time"
 
 	golog "github.com/fclairamb/go-log"
@@ -13,101 +9,80 @@ import (
 
 // AppLogger implements the go-log.Logger interface
 type AppLogger struct {
-	level  LogLevel
-	logger *log.Logger
-	writer *RotatingWriter // nil if logging to stdout
+	level    LogLevel
+	minLevel int // levelRank of level; records below it are skipped
+	out      *logOutput
 }
 
 // NewAppLogger creates a new application logger
 func NewAppLogger(logPath string, level LogLevel, maxSize int64, verifyInterval time.Duration) (*AppLogger, error) {
-	var writer io.Writer = os.Stdout
-	var rotatingWriter *RotatingWriter
-
-	if logPath != "" {
-		rw, err := NewRotatingWriter(logPath, maxSize, verifyInterval)
-		if err != nil {
-			return nil, fmt.Errorf("creating rotating writer: %w", err)
-		}
-		writer = rw
-		rotatingWriter = rw
+	return newAppLogger(logPath, level, maxSize, verifyInterval, Options{})
+}
+
+func newAppLogger(logPath string, level LogLevel, maxSize int64, verifyInterval time.Duration, opts Options) (*AppLogger, error) {
+	out, err := openLogOutput(logPath, os.Stdout, maxSize, verifyInterval, opts)
+	if err != nil {
+		return nil, err
 	}
 
 	return &AppLogger{
-		level:  level,
-		logger: log.New(writer, "", 0), // No flags, we'll handle formatting ourselves
-		writer: rotatingWriter,
+		level:    level,
+		minLevel: levelRank(level),
+		out:      out,
 	}, nil
 }
 
-func (l *AppLogger) shouldLog(level LogLevel) bool {
-	levels := map[LogLevel]int{
-		LogLevelDebug: 0,
-		LogLevelInfo:  1,
-		LogLevelWarn:  2,
-		LogLevelError: 3,
-		LogLevelPanic: 4,
-	}
-	return levels[level] >= levels[l.level]
+// Enabled reports whether records at level are written. Call sites can use
+// it to skip building arguments for records that would be discarded.
+func (l *AppLogger) Enabled(level LogLevel) bool {
+	return levelRank(level) >= l.minLevel
 }
 
-func (l *AppLogger) log(level LogLevel, message string, keyvals ...interface{}) {
-	if !l.shouldLog(level) {
+func (l *AppLogger) log(rank int, level LogLevel, message string, keyvals []interface{}) {
+	if rank < l.minLevel {
 		return
 	}
 
-	// Format key-value pairs
-	var kvStrings []string
-	for i := 0; i < len(keyvals); i += 2 {
-		if i+1 < len(keyvals) {
-			key := toString(keyvals[i])
-			value := toString(keyvals[i+1])
-			kvStrings = append(kvStrings, fmt.Sprintf("%s=%s", key, formatValue(value)))
-		}
+	e := getEncoder()
+	e.appendTimestamp()
+	e.buf = append(e.buf, ' ')
+	e.buf = append(e.buf, level...)
+	e.buf = append(e.buf, ": "...)
+	e.buf = append(e.buf, message...)
+	if len(keyvals) < 2 {
+		e.buf = append(e.buf, ' ') // the separator before the (empty) fields
 	}
-	kvStr := strings.Join(kvStrings, " ")
-
-	timestamp := time.Now().UTC().Format("2006-01-02 15:04:05 -0700")
-	l.logger.Printf("%s %s: %s %s", timestamp, level, message, kvStr)
-}
-
-func toString(v interface{}) string {
-	if v == nil {
-		return ""
+	for i := 0; i+1 < len(keyvals); i += 2 {
+		e.appendField(keyvals[i], keyvals[i+1], true)
 	}
-
-	str := fmt.Sprintf("%v", v)
-	// Clean up the string
-	str = strings.ReplaceAll(str, "\n", " ")
-	str = strings.ReplaceAll(str, "\r", " ")
-	str = strings.ReplaceAll(str, "\t", " ")
-	// Collapse multiple spaces into one
-	str = strings.Join(strings.Fields(str), " ")
-	return str
+	e.buf = append(e.buf, '\n')
+	_, _ = l.out.Write(e.buf)
+	putEncoder(e)
 }
 
 // Debug implements go-log.Logger
 func (l *AppLogger) Debug(message string, keyvals ...interface{}) {
-	l.log(LogLevelDebug, message, keyvals...)
+	l.log(rankDebug, LogLevelDebug, message, keyvals)
 }
 
 // Info implements go-log.Logger
 func (l *AppLogger) Info(message string, keyvals ...interface{}) {
-	l.log(LogLevelInfo, message, keyvals...)
+	l.log(rankInfo, LogLevelInfo, message, keyvals)
 }
 
 // Warn implements go-log.Logger
 func (l *AppLogger) Warn(message string, keyvals ...interface{}) {
-	l.log(LogLevelWarn, message, keyvals...)
+	l.log(rankWarn, LogLevelWarn, message, keyvals)
 }
 
 // Error implements go-log.Logger
 func (l *AppLogger) Error(message string, keyvals ...interface{}) {
-	l.log(LogLevelError, message, keyvals...)
+	l.log(rankError, LogLevelError, message, keyvals)
 }
 
 // Panic implements go-log.Logger
 func (l *AppLogger) Panic(message string, keyvals ...interface{}) {
-	l.log(LogLevelPanic, message, keyvals...)
+	l.log(rankPanic, LogLevelPanic, message, keyvals)
 }
 
 // With implements go-log.Logger
@@ -119,13 +94,10 @@ func (l *AppLogger) With(keyvals ...interface{}) golog.Logger {
 
 // IsDebug returns true if the logger is at debug level
 func (l *AppLogger) IsDebug() bool {
-	return l.level == LogLevelDebug
+	return l.minLevel <= rankDebug
 }
 
 // Close closes the logger and stops background rotation
 func (l *AppLogger) Close() error {
-	if l.writer != nil {
-		return l.writer.Close()
-	}
-	return nil
+	return l.out.Close()
 }
@@ -5,20 +5,31 @@ import (
 	"os"
 	"path/filepath"
 	"sync"
+	"sync/atomic"
 	"time"
 )
 
 // RotatingWriter is a file writer that automatically rotates log files
 // based on size and verifies file identity periodically to handle external moves.
+//
+// By default a Write that fills the file rotates it inline, and
+// verification holds the same lock as writes. A writer created with
+// NewBackgroundRotatingWriter instead leaves rotation and verification to
+// its background goroutine: writes only share a read lock around the file
+// handle, which the goroutine takes exclusively just to swap in a file it
+// has already renamed, opened or checked.
 type RotatingWriter struct {
-	mu             sync.Mutex
+	mu             sync.Mutex   // serializes inline writes, rotation and verification
+	swapMu         sync.RWMutex // in background mode, guards f against being swapped mid-write
 	f              *os.File
 	path           string
 	dir            string
 	base           string
 	maxSize        int64
-	approxSize     int64
+	approxSize     atomic.Int64
 	verifyInterval time.Duration
+	background     bool
+	rotateCh       chan struct{} // rotation requests in background mode, capacity 1
 	stopCh         chan struct{}
 	wg             sync.WaitGroup
 }
@@ -28,12 +39,25 @@ type RotatingWriter struct {
 // - Periodically verifies file identity (handles external moves/deletes)
 // - Rotates immediately if existing file already exceeds maxSize
 func NewRotatingWriter(path string, maxSize int64, verifyInterval time.Duration) (*RotatingWriter, error) {
+	return newRotatingWriter(path, maxSize, verifyInterval, false)
+}
+
+// NewBackgroundRotatingWriter creates a rotating writer whose writes never
+// wait for a rename, open or stat: rotation and verification run on the
+// background goroutine
+func NewBackgroundRotatingWriter(path string, maxSize int64, verifyInterval time.Duration) (*RotatingWriter, error) {
+	return newRotatingWriter(path, maxSize, verifyInterval, true)
+}
+
+func newRotatingWriter(path string, maxSize int64, verifyInterval time.Duration, background bool) (*RotatingWriter, error) {
 	w := &RotatingWriter{
 		path:           path,
 		dir:            filepath.Dir(path),
 		base:           filepath.Base(path),
 		maxSize:        maxSize,
 		verifyInterval: verifyInterval,
+		background:     background,
+		rotateCh:       make(chan struct{}, 1),
 		stopCh:         make(chan struct{}),
 	}
 
@@ -43,7 +67,7 @@ func NewRotatingWriter(path string, maxSize int64, verifyInterval time.Duration)
 	}
 
 	// If existing file already exceeds max, rotate now so we start clean
-	if w.approxSize >= w.maxSize {
+	if w.approxSize.Load() >= w.maxSize {
 		if err := w.rotateLocked(); err != nil {
 			return nil, err
 		}
@@ -61,6 +85,10 @@ func NewRotatingWriter(path string, maxSize int64, verifyInterval time.Duration)
 				w.mu.Lock()
 				_ = w.verifyLocked()
 				w.mu.Unlock()
+			case <-w.rotateCh:
+				w.mu.Lock()
+				_ = w.rotateBackgroundLocked()
+				w.mu.Unlock()
 			case <-w.stopCh:
 				return
 			}
@@ -72,18 +100,39 @@ func NewRotatingWriter(path string, maxSize int64, verifyInterval time.Duration)
 
 // Write implements io.Writer
 func (w *RotatingWriter) Write(p []byte) (int, error) {
+	if w.background {
+		return w.writeShared(p)
+	}
+
 	w.mu.Lock()
 	defer w.mu.Unlock()
 
 	// Size-based rotation uses internal counter
-	if w.approxSize+int64(len(p)) >= w.maxSize {
+	if w.approxSize.Load()+int64(len(p)) >= w.maxSize {
 		if err := w.rotateLocked(); err != nil {
 			return 0, err
 		}
 	}
 
 	n, err := w.f.Write(p)
-	w.approxSize += int64(n)
+	w.approxSize.Add(int64(n))
+	return n, err
+}
+
+// writeShared writes in background mode. Writes run concurrently; a full
+// file is rotated by the background goroutine, and records written until
+// then still land in the file being archived.
+func (w *RotatingWriter) writeShared(p []byte) (int, error) {
+	w.swapMu.RLock()
+	n, err := w.f.Write(p)
+	w.swapMu.RUnlock()
+
+	if w.approxSize.Add(int64(n)) >= w.maxSize {
+		select {
+		case w.rotateCh <- struct{}{}:
+		default:
+		}
+	}
 	return n, err
 }
 
@@ -93,6 +142,8 @@ func (w *RotatingWriter) Close() error {
 	w.wg.Wait()
 	w.mu.Lock()
 	defer w.mu.Unlock()
+	w.swapMu.Lock()
+	defer w.swapMu.Unlock()
 	if w.f != nil {
 		return w.f.Close()
 	}
@@ -101,27 +152,48 @@ func (w *RotatingWriter) Close() error {
 
 // openForAppendLocked opens the file for appending and initializes state
 func (w *RotatingWriter) openForAppendLocked() error {
+	f, size, err := w.openForAppend()
+	if err != nil {
+		return err
+	}
+	w.swapLocked(f, size)
+	return nil
+}
+
+// openForAppend opens the file for appending and returns its current size
+func (w *RotatingWriter) openForAppend() (*os.File, int64, error) {
 	// Ensure directory exists
 	if err := os.MkdirAll(w.dir, 0755); err != nil {
-		return fmt.Errorf("creating log directory: %w", err)
+		return nil, 0, fmt.Errorf("creating log directory: %w", err)
 	}
 
 	// Open file for append/create
 	f, err := os.OpenFile(w.path, os.O_CREATE|os.O_APPEND|os.O_WRONLY, 0644)
 	if err != nil {
-		return fmt.Errorf("opening log file: %w", err)
+		return nil, 0, fmt.Errorf("opening log file: %w", err)
 	}
 
 	// Get current file size
 	fi, err := f.Stat()
 	if err != nil {
 		f.Close()
-		return fmt.Errorf("stat log file: %w", err)
+		return nil, 0, fmt.Errorf("stat log file: %w", err)
 	}
+	return f, fi.Size(), nil
+}
 
+// swapLocked installs f as the open file and closes the previous one. In
+// background mode the exclusive swap lock is held only for the assignment,
+// so writes in flight finish on the old file before it is closed.
+func (w *RotatingWriter) swapLocked(f *os.File, size int64) {
+	w.swapMu.Lock()
+	old := w.f
 	w.f = f
-	w.approxSize = fi.Size()
-	return nil
+	w.approxSize.Store(size)
+	w.swapMu.Unlock()
+	if old != nil {
+		_ = old.Close()
+	}
 }
 
 // rotateLocked rotates the current log file to an archive with timestamp
@@ -133,10 +205,36 @@ func (w *RotatingWriter) rotateLocked() error {
 		w.f = nil
 	}
 
+	f, err := w.archiveAndCreate()
+	if err != nil {
+		return err
+	}
+	w.swapLocked(f, 0)
+	return nil
+}
+
+// rotateBackgroundLocked rotates in background mode. Writers keep writing
+// to the open file, which is renamed into old/, until the new file is
+// swapped in. If rotation fails the current file stays in use and the next
+// full write asks again.
+func (w *RotatingWriter) rotateBackgroundLocked() error {
+	if w.approxSize.Load() < w.maxSize {
+		return nil // already rotated, by an earlier request or a reopen
+	}
+	f, err := w.archiveAndCreate()
+	if err != nil {
+		return err
+	}
+	w.swapLocked(f, 0)
+	return nil
+}
+
+// archiveAndCreate moves the log to old/ and creates a fresh, empty log file
+func (w *RotatingWriter) archiveAndCreate() (*os.File, error) {
 	// Create old/ directory next to the log file
 	oldDir := filepath.Join(w.dir, "old")
 	if err := os.MkdirAll(oldDir, 0755); err != nil {
-		return fmt.Errorf("creating old/ directory: %w", err)
+		return nil, fmt.Errorf("creating old/ directory: %w", err)
 	}
 
 	// Generate timestamped archive name: <basename>.YYYYMMDD-HHMMSS
@@ -150,12 +248,9 @@ func (w *RotatingWriter) rotateLocked() error {
 	// Create fresh log file
 	f, err := os.OpenFile(w.path, os.O_CREATE|os.O_WRONLY|os.O_TRUNC, 0644)
 	if err != nil {
-		return fmt.Errorf("creating new log file: %w", err)
+		return nil, fmt.Errorf("creating new log file: %w", err)
 	}
-
-	w.f = f
-	w.approxSize = 0
-	return nil
+	return f, nil
 }
 
 // verifyLocked checks if the open file descriptor still points to the expected path
@@ -181,16 +276,17 @@ func (w *RotatingWriter) verifyLocked() error {
 
 	realSize := fiOpen.Size()
 	// If drift exceeds 8KB, sync with actual size
-	if abs64(realSize-w.approxSize) > 8*1024 {
-		w.approxSize = realSize
+	if abs64(realSize-w.approxSize.Load()) > 8*1024 {
+		w.approxSize.Store(realSize)
 	}
 
 	return nil
 }
 
-// reopenLocked closes and reopens the file
+// reopenLocked closes and reopens the file. In background mode the old file
+// stays open for writers until the new one is ready.
 func (w *RotatingWriter) reopenLocked() error {
-	if w.f != nil {
+	if !w.background && w.f != nil {
 		_ = w.f.Close()
 		w.f = nil
 	}
@@ -0,0 +1,107 @@
+package logging
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"strings"
+	"sync"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/assert"
+)
+
+// readLogs returns the current log and its archives, concatenated
+func readLogs(t *testing.T, path string) string {
+	t.Helper()
+	var all strings.Builder
+	archives, _ := filepath.Glob(filepath.Join(filepath.Dir(path), "old", filepath.Base(path)+".*"))
+	for _, p := range append(archives, path) {
+		data, err := os.ReadFile(p)
+		if err != nil && !os.IsNotExist(err) {
+			t.Fatalf("reading %s: %v", p, err)
+		}
+		all.Write(data)
+	}
+	return all.String()
+}
+
+// waitFor polls cond until it holds or a deadline passes
+func waitFor(t *testing.T, cond func() bool, msg string) {
+	t.Helper()
+	deadline := time.Now().Add(5 * time.Second)
+	for !cond() {
+		if time.Now().After(deadline) {
+			t.Fatal(msg)
+		}
+		time.Sleep(time.Millisecond)
+	}
+}
+
+func TestRotatingWriter_Modes(t *testing.T) {
+	for _, background := range []bool{false, true} {
+		t.Run(fmt.Sprintf("background=%v", background), func(t *testing.T) {
+			path := filepath.Join(t.TempDir(), "test.log")
+			w, err := newRotatingWriter(path, 1024, time.Hour, background)
+			assert.NoError(t, err)
+
+			record := strings.Repeat("x", 99) + "\n"
+			for i := 0; i < 15; i++ {
+				_, err := w.Write([]byte(record))
+				assert.NoError(t, err)
+			}
+			waitFor(t, func() bool {
+				archives, _ := filepath.Glob(filepath.Join(filepath.Dir(path), "old", "test.log.*"))
+				return len(archives) == 1
+			}, "log was not rotated")
+			assert.NoError(t, w.Close())
+
+			// Nothing written around the rotation is lost
+			assert.Equal(t, strings.Repeat(record, 15), readLogs(t, path))
+		})
+	}
+}
+
+func TestRotatingWriter_BackgroundConcurrentWrites(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "test.log")
+	w, err := NewBackgroundRotatingWriter(path, 1<<20, time.Millisecond)
+	assert.NoError(t, err)
+
+	var wg sync.WaitGroup
+	for g := 0; g < 8; g++ {
+		wg.Add(1)
+		go func(g int) {
+			defer wg.Done()
+			for i := 0; i < 500; i++ {
+				fmt.Fprintf(w, "g%d-%d\n", g, i)
+			}
+		}(g)
+	}
+	wg.Wait()
+	assert.NoError(t, w.Close())
+
+	assert.Equal(t, 8*500, strings.Count(readLogs(t, path), "\n"))
+}
+
+func TestRotatingWriter_BackgroundReopensMovedFile(t *testing.T) {
+	dir := t.TempDir()
+	path := filepath.Join(dir, "test.log")
+	w, err := NewBackgroundRotatingWriter(path, 1<<20, 5*time.Millisecond)
+	assert.NoError(t, err)
+	defer w.Close()
+
+	_, _ = w.Write([]byte("before\n"))
+	assert.NoError(t, os.Rename(path, filepath.Join(dir, "moved.log")))
+
+	// The verifier notices the move and recreates the log at its path
+	waitFor(t, func() bool {
+		_, err := os.Stat(path)
+		return err == nil
+	}, "log file was not recreated")
+	waitFor(t, func() bool {
+		_, _ = w.Write([]byte("after\n"))
+		data, _ := os.ReadFile(path)
+		return strings.Contains(string(data), "after")
+	}, "writes did not reach the recreated file")
+}
@@ -2,7 +2,7 @@ package logging
 
 import (
 	"fmt"
-	"strings"
+	"io"
 	"time"
 )
 
@@ -22,6 +22,30 @@ const (
 	LogLevelPanic LogLevel = "panic"
 )
 
+// Level ranks, in order of severity
+const (
+	rankDebug = iota
+	rankInfo
+	rankWarn
+	rankError
+	rankPanic
+)
+
+// levelRank returns the rank of a level. Unknown levels rank as debug.
+func levelRank(level LogLevel) int {
+	switch level {
+	case LogLevelInfo:
+		return rankInfo
+	case LogLevelWarn:
+		return rankWarn
+	case LogLevelError:
+		return rankError
+	case LogLevelPanic:
+		return rankPanic
+	}
+	return rankDebug
+}
+
 var (
 	// App is the global application logger
 	App *AppLogger
@@ -45,8 +69,65 @@ func init() {
 	}
 }
 
+// Options holds optional logging settings
+type Options struct {
+	Async              bool       // hand records to a background writer instead of writing them inline
+	BufferSize         int        // records buffered per log file in async mode
+	FullPolicy         FullPolicy // what async mode does when the buffer is full
+	BackgroundRotation bool       // rotate and verify log files off the write path
+}
+
+// logOutput is where a logger writes: a rotating file, optionally behind an
+// AsyncWriter, or a fallback writer when no path is configured
+type logOutput struct {
+	io.Writer
+	rotating *RotatingWriter // nil for the fallback writer
+	async    *AsyncWriter    // nil unless async mode is on
+}
+
+// openLogOutput opens the output for a log file path
+func openLogOutput(path string, fallback io.Writer, maxSize int64, verifyInterval time.Duration, opts Options) (*logOutput, error) {
+	if path == "" {
+		return &logOutput{Writer: fallback}, nil
+	}
+	newWriter := NewRotatingWriter
+	if opts.BackgroundRotation {
+		newWriter = NewBackgroundRotatingWriter
+	}
+	rw, err := newWriter(path, maxSize, verifyInterval)
+	if err != nil {
+		return nil, fmt.Errorf("creating rotating writer: %w", err)
+	}
+	out := &logOutput{Writer: rw, rotating: rw}
+	if opts.Async {
+		out.async = NewAsyncWriter(rw, opts.BufferSize, opts.FullPolicy)
+		out.Writer = out.async
+	}
+	return out, nil
+}
+
+// Close writes out buffered records, then closes the file
+func (o *logOutput) Close() error {
+	if o.async != nil {
+		_ = o.async.Close()
+		if dropped := o.async.Dropped(); dropped > 0 {
+			fmt.Fprintf(o.rotating, "%s warn: Log records dropped because the buffer was full count=%d\n",
+				time.Now().UTC().Format("2006-01-02 15:04:05 -0700"), dropped)
+		}
+	}
+	if o.rotating != nil {
+		return o.rotating.Close()
+	}
+	return nil
+}
+
 // Initialize sets up the global loggers
 func Initialize(accessLogPath, appLogPath string, level LogLevel, maxSize int64, verifyInterval time.Duration) error {
+	return InitializeWithOptions(accessLogPath, appLogPath, level, maxSize, verifyInterval, Options{})
+}
+
+// InitializeWithOptions sets up the global loggers with optional settings
+func InitializeWithOptions(accessLogPath, appLogPath string, level LogLevel, maxSize int64, verifyInterval time.Duration, opts Options) error {
 	var err error
 
 	// Set default level if not specified
@@ -55,14 +136,15 @@ func Initialize(accessLogPath, appLogPath string, level LogLevel, maxSize int64,
 	}
 
 	// Initialize access logger
-	newAccess, err := NewAccessLogger(accessLogPath, maxSize, verifyInterval)
+	newAccess, err := newAccessLogger(accessLogPath, maxSize, verifyInterval, opts)
 	if err != nil {
 		return fmt.Errorf("failed to initialize access logger: %w", err)
 	}
 
 	// Initialize application logger
-	newApp, err := NewAppLogger(appLogPath, level, maxSize, verifyInterval)
+	newApp, err := newAppLogger(appLogPath, level, maxSize, verifyInterval, opts)
 	if err != nil {
+		_ = newAccess.Close()
 		return fmt.Errorf("failed to initialize app logger: %w", err)
 	}
 
@@ -88,7 +170,8 @@ func MustInitialize(accessLogPath, appLogPath string, level LogLevel, maxSize in
 	}
 }
 
-// Shutdown closes all loggers and stops background rotation
+// Shutdown writes out buffered records, closes all loggers and stops
+// background rotation
 func Shutdown() {
 	if Access != nil {
 		_ = Access.Close()
@@ -97,15 +180,3 @@ func Shutdown() {
 		_ = App.Close()
 	}
 }
-
-// formatValue formats a value for logfmt, quoting if necessary
-func formatValue(v interface{}) string {
-	s := fmt.Sprintf("%v", v)
-	// Quote if contains space, equals, or quotes
-	if strings.ContainsAny(s, " =\"") {
-		// Escape existing quotes
-		s = strings.ReplaceAll(s, "\"", "\\\"")
-		return fmt.Sprintf("\"%s\"", s)
-	}
-	return s
-}
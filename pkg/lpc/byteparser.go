@@ -0,0 +1,704 @@
+package lpc
+
+import (
+	"bytes"
+	"fmt"
+	"strconv"
+	"strings"
+	"unicode"
+	"unicode/utf8"
+)
+
+// ParseObjectBytes parses an LPC object from a byte slice, such as the data
+// returned by os.ReadFile, without first copying it into a string.
+// It accepts the same format and produces the same result as ParseObject,
+// but scans lines with bytes.IndexByte, decodes ASCII without going through
+// utf8, and parses integers in place. The input is not retained.
+func (p *ObjectParser) ParseObjectBytes(input []byte) (*ParseResult, error) {
+	return p.parseLines(input, nil)
+}
+
+// ParseObjectFields parses only the top-level entries named by keys, such as
+// the password and level of a character file. Other lines are skipped
+// without parsing their values, so errors in them are not reported. If a
+// key appears more than once, the last occurrence is used, as ParseObject
+// does, so the whole input is scanned.
+func (p *ObjectParser) ParseObjectFields(input []byte, keys ...string) (*ParseResult, error) {
+	if keys == nil {
+		keys = []string{} // nil would select every entry
+	}
+	return p.parseLines(input, keys)
+}
+
+// parseLines parses input line by line, keeping every entry if keys is nil
+// and only the named ones otherwise
+func (p *ObjectParser) parseLines(input []byte, keys []string) (*ParseResult, error) {
+	if len(input) == 0 {
+		return nil, fmt.Errorf("input string is empty")
+	}
+
+	result := &ParseResult{
+		Object: make(map[string]interface{}, len(keys)),
+		Errors: make([]*ParseError, 0),
+	}
+
+	filter := newKeyFilter(keys)
+	if filter.empty() {
+		return result, nil
+	}
+
+	lineNum := 0
+	for startPos := 0; startPos <= len(input); {
+		lineNum++
+		end := bytes.IndexByte(input[startPos:], '\n')
+		if end < 0 {
+			end = len(input)
+		} else {
+			end += startPos
+		}
+		line := input[startPos:end]
+
+		// Skip empty lines and comments
+		if len(line) == 0 || line[0] == '#' {
+			startPos = end + 1
+			continue
+		}
+
+		// Values never span lines, so an unwanted entry is skipped by moving
+		// on to the next newline without looking at its value
+		if !filter.match(line) {
+			startPos = end + 1
+			continue
+		}
+
+		// Parse key and value
+		bp := byteParser{s: line}
+		key, value, err := bp.parseLine()
+		if err != nil {
+			parseErr := &ParseError{
+				Line:     lineNum,
+				Position: startPos + bp.pos,
+				Err:      err,
+			}
+
+			if p.strict {
+				return nil, parseErr
+			}
+			result.Errors = append(result.Errors, parseErr)
+		} else {
+			result.Object[key] = value
+		}
+
+		startPos = end + 1 // +1 for newline
+	}
+
+	if len(result.Object) == 0 && len(result.Errors) > 0 {
+		return result, fmt.Errorf("no valid entries found")
+	}
+
+	return result, nil
+}
+
+// keyFilter selects the top-level entries to parse. A nil filter selects
+// every entry.
+type keyFilter struct {
+	keys []string
+}
+
+// newKeyFilter returns a filter for keys, or nil if keys is nil
+func newKeyFilter(keys []string) *keyFilter {
+	if keys == nil {
+		return nil
+	}
+	return &keyFilter{keys: keys}
+}
+
+// match reports whether the entry on line should be parsed. Every
+// occurrence of a key matches, so a later one overrides an earlier one.
+func (f *keyFilter) match(line []byte) bool {
+	if f == nil {
+		return true
+	}
+	n := bytes.IndexByte(line, ' ')
+	if n < 0 {
+		n = len(line)
+	}
+	for _, key := range f.keys {
+		if string(line[:n]) == key {
+			return true
+		}
+	}
+	return false
+}
+
+// empty reports whether the filter selects no entry at all
+func (f *keyFilter) empty() bool {
+	return f != nil && len(f.keys) == 0
+}
+
+// byteParser is the []byte counterpart of LineParser. It follows the same
+// format rules and reports the same errors, but reads bytes rather than
+// runes and only decodes UTF-8 where a non-ASCII byte is encountered.
+// A zero byte reads the same as the end of input, as it does for LineParser.
+type byteParser struct {
+	s   []byte // input line
+	pos int    // current position in s
+}
+
+// parseLine parses a single line of LPC object format, returning the key and value
+func (p *byteParser) parseLine() (string, interface{}, error) {
+	// Skip comment and empty lines
+	if c := p.peek(0); c == '#' || c == '\n' || c == 0 {
+		return "", nil, nil
+	}
+
+	key, err := p.parseKey()
+	if err != nil {
+		return "", nil, err
+	}
+
+	value, err := p.parseValue()
+	if err != nil {
+		return "", nil, err
+	}
+
+	if err := p.parseEnd(); err != nil {
+		return "", nil, err
+	}
+	return key, value, nil
+}
+
+// parseKey parses the key of a line and the single space that follows it,
+// leaving the position at the start of the value
+func (p *byteParser) parseKey() (string, error) {
+	// Leading whitespace is not allowed
+	if p.peek(0) == ' ' || p.peek(0) == '\t' {
+		return "", fmt.Errorf("leading whitespace not allowed at position %d", p.pos)
+	}
+
+	// Parse identifier - must start with letter or underscore
+	key, err := p.parseIdentifier()
+	if err != nil {
+		return "", err
+	}
+
+	// Check for exactly one space after key
+	if p.peek(0) != ' ' {
+		return "", fmt.Errorf("expected single space after key at position %d", p.pos)
+	}
+	p.pos++ // consume the single space
+	if p.peek(0) == ' ' || p.peek(0) == '\t' {
+		return "", fmt.Errorf("multiple spaces or tabs not allowed at position %d", p.pos)
+	}
+	return key, nil
+}
+
+// parseEnd checks that nothing but the end of the line follows a value
+func (p *byteParser) parseEnd() error {
+	c := p.peek(0)
+	if c == ' ' || c == '\t' {
+		return fmt.Errorf("trailing whitespace not allowed at position %d", p.pos)
+	}
+	if c != '\n' && c != 0 {
+		return fmt.Errorf("expected newline or end of file at position %d", p.pos)
+	}
+	return nil
+}
+
+// parseValue parses any valid value type
+func (p *byteParser) parseValue() (interface{}, error) {
+	p.skipSpaces()
+
+	c := p.peek(0)
+	switch {
+	case c == '"':
+		return p.parseString()
+	case isDigit(c) || c == '-':
+		return p.parseNumber()
+	case c == '(':
+		// Could be array or map
+		if p.peek(1) == '{' {
+			return p.parseArray()
+		} else if p.peek(1) == '[' {
+			return p.parseMap()
+		}
+		return nil, fmt.Errorf("invalid value starting with '(' at position %d", p.pos)
+	case c == 'n':
+		// Try parsing nil
+		pos := p.pos
+		if p.match("nil") && isTerminator(p.peek(0)) {
+			return nil, nil
+		}
+		p.pos = pos
+		return nil, fmt.Errorf("invalid nil value at position %d", p.pos)
+	}
+
+	return nil, fmt.Errorf("invalid value starting with '%c' at position %d", p.peekRune(), p.pos)
+}
+
+// parseArray parses an array value.
+// Format: ({size|val1,val2,...})
+func (p *byteParser) parseArray() ([]interface{}, error) {
+	if !p.match("({") {
+		return nil, fmt.Errorf("error in array: expected '({' at position %d", p.pos)
+	}
+
+	// Parse size
+	size, err := p.parseInt()
+	if err != nil {
+		return nil, fmt.Errorf("error in array: invalid size at position %d: %v", p.pos, err)
+	}
+
+	if !p.expect('|') {
+		return nil, fmt.Errorf("error in array: expected '|' after size at position %d", p.pos)
+	}
+
+	elements := make([]interface{}, 0, p.sizeHint(size))
+
+	// Handle empty array cases (with or without trailing comma)
+	p.skipSpaces()
+	if p.peek(0) == '}' && p.peek(1) == ')' {
+		p.pos += 2
+		if size != 0 {
+			return nil, fmt.Errorf("error in array: empty array but size is %d", size)
+		}
+		return elements, nil
+	}
+	if p.peek(0) == ',' && p.peek(1) == '}' && p.peek(2) == ')' {
+		p.pos += 3
+		if size != 0 {
+			return nil, fmt.Errorf("error in array: empty array but size is %d", size)
+		}
+		return elements, nil
+	}
+
+	for {
+		element, err := p.parseValue()
+		if err != nil {
+			return nil, fmt.Errorf("error in array: %v", err)
+		}
+		elements = append(elements, element)
+
+		p.skipSpaces()
+		if p.peek(0) == ',' {
+			p.pos++ // consume comma
+			p.skipSpaces()
+			// Check for trailing comma
+			if p.peek(0) == '}' && p.peek(1) == ')' {
+				p.pos += 2
+				break
+			}
+			continue
+		} else if p.peek(0) == '}' && p.peek(1) == ')' {
+			p.pos += 2
+			break
+		}
+		return nil, fmt.Errorf("error in array: expected ',' or '})' at position %d", p.pos)
+	}
+
+	// Verify size matches number of elements
+	if len(elements) > size {
+		return nil, fmt.Errorf("error in array: too many elements, expected %d", size)
+	} else if len(elements) < size {
+		return nil, fmt.Errorf("error in array: too few elements, expected %d", size)
+	}
+
+	return elements, nil
+}
+
+// parseMap parses a mapping value.
+// Format: ([size|key1:val1,key2:val2,...])
+func (p *byteParser) parseMap() (map[string]interface{}, error) {
+	if !p.match("([") {
+		return nil, fmt.Errorf("error in map: expected '([' at position %d", p.pos)
+	}
+
+	// Parse size
+	size, err := p.parseInt()
+	if err != nil {
+		return nil, fmt.Errorf("error in map: invalid size at position %d: %v", p.pos, err)
+	}
+
+	if !p.expect('|') {
+		return nil, fmt.Errorf("error in map: expected '|' after size at position %d", p.pos)
+	}
+
+	result := make(map[string]interface{}, p.sizeHint(size))
+	totalEntries := 0
+
+	// Handle empty map
+	p.skipSpaces()
+	if p.peek(0) == ']' && p.peek(1) == ')' {
+		p.pos += 2
+		if size != 0 {
+			return nil, fmt.Errorf("error in map: empty map but size is %d", size)
+		}
+		return result, nil
+	}
+
+	for {
+		key, value, skipped, err := p.parseMapEntry()
+		if err != nil {
+			return nil, err
+		}
+
+		totalEntries++
+		if !skipped {
+			result[key] = value
+		}
+
+		p.skipSpaces()
+		if p.peek(0) == ',' {
+			p.pos++ // consume comma
+			p.skipSpaces()
+			if p.peek(0) == ']' && p.peek(1) == ')' {
+				p.pos += 2
+				break
+			}
+			continue
+		} else if p.peek(0) == ']' && p.peek(1) == ')' {
+			p.pos += 2
+			break
+		}
+		return nil, fmt.Errorf("error in map: expected ',' or '])' at position %d", p.pos)
+	}
+
+	// Verify size matches total number of entries (including skipped ones)
+	if totalEntries > size {
+		return nil, fmt.Errorf("error in map: too many entries, expected %d", size)
+	} else if totalEntries < size {
+		return nil, fmt.Errorf("error in map: too few entries, expected %d", size)
+	}
+
+	return result, nil
+}
+
+// parseMapEntry parses a single key:value pair in a mapping.
+// As with LineParser, array and map keys are parsed but skipped.
+func (p *byteParser) parseMapEntry() (string, interface{}, bool, error) {
+	p.skipSpaces()
+
+	keyValue, err := p.parseValue()
+	if err != nil {
+		return "", nil, false, fmt.Errorf("error in map entry: invalid key at position %d: %v", p.pos, err)
+	}
+
+	// Convert key to string representation
+	var key string
+	switch v := keyValue.(type) {
+	case string:
+		key = v
+	case int:
+		key = strconv.Itoa(v)
+	case float64:
+		key = strconv.FormatFloat(v, 'f', -1, 64)
+	case []interface{}, map[string]interface{}:
+		// Skip array and map keys but count them
+		p.skipSpaces()
+		if p.peek(0) == ':' {
+			p.pos++
+			if _, err := p.parseValue(); err != nil {
+				return "", nil, false, err
+			}
+		}
+		return "", nil, true, nil
+	case nil:
+		key = "nil"
+	}
+
+	p.skipSpaces()
+	if !p.expect(':') {
+		return "", nil, false, fmt.Errorf("error in map entry: expected ':' after key at position %d", p.pos)
+	}
+
+	value, err := p.parseValue()
+	if err != nil {
+		return "", nil, false, err
+	}
+
+	return key, value, false, nil
+}
+
+// parseNumber parses either an integer or float value
+func (p *byteParser) parseNumber() (interface{}, error) {
+	// Look ahead to see if this is a float
+	offset := 0
+	if p.peek(offset) == '-' {
+		offset++
+	}
+	for isDigit(p.peek(offset)) {
+		offset++
+	}
+	if c := p.peek(offset); c == '.' || c == '=' {
+		return p.parseFloat()
+	}
+	return p.parseInt()
+}
+
+// parseInt parses a decimal integer in place, accepting exactly the values
+// strconv.Atoi would
+func (p *byteParser) parseInt() (int, error) {
+	neg := false
+	if p.peek(0) == '-' {
+		neg = true
+		p.pos++
+	}
+
+	// The magnitude limit differs by one between negative and positive values
+	limit := uint64(1)<<(strconv.IntSize-1) - 1
+	if neg {
+		limit++
+	}
+
+	start := p.pos
+	var n uint64
+	overflow := false
+	for p.pos < len(p.s) && isDigit(p.s[p.pos]) {
+		d := uint64(p.s[p.pos] - '0')
+		if n > (limit-d)/10 {
+			overflow = true
+		} else {
+			n = n*10 + d
+		}
+		p.pos++
+	}
+
+	if p.pos == start || overflow {
+		return 0, fmt.Errorf("error in integer: invalid number at position %d", p.pos)
+	}
+	if neg {
+		return int(-n), nil
+	}
+	return int(n), nil
+}
+
+// parseFloat parses a float value, optionally with hex notation.
+// Format: [-]digits[.digits][=hexdigits]
+// The decimal part is converted by strconv.ParseFloat to keep correct
+// rounding, the hex part is validated and skipped.
+func (p *byteParser) parseFloat() (float64, error) {
+	start := p.pos
+
+	if p.peek(0) == '-' {
+		p.pos++
+	}
+
+	// Must have at least one digit
+	if !isDigit(p.peek(0)) {
+		return 0, fmt.Errorf("float value must start with a digit at position %d", p.pos)
+	}
+	for isDigit(p.peek(0)) {
+		p.pos++
+	}
+
+	// Parse optional decimal part
+	hasDot := false
+	if p.peek(0) == '.' {
+		hasDot = true
+		p.pos++
+		// Must have at least one digit after the decimal point
+		if !isDigit(p.peek(0)) {
+			return 0, fmt.Errorf("float value must have digits after decimal point at position %d", p.pos)
+		}
+		for isDigit(p.peek(0)) {
+			p.pos++
+		}
+	}
+
+	if p.peek(0) != '=' && !hasDot {
+		return 0, fmt.Errorf("float value must contain a decimal point or hex representation at position %d", p.pos)
+	}
+
+	result, err := strconv.ParseFloat(string(p.s[start:p.pos]), 64)
+	if err != nil {
+		return 0, fmt.Errorf("error in float: invalid number at position %d", p.pos)
+	}
+
+	// Parse optional hex part
+	if p.peek(0) == '=' {
+		p.pos++ // skip =
+		if !isHexDigit(rune(p.peek(0))) {
+			return 0, fmt.Errorf("invalid hex digits after = at position %d", p.pos)
+		}
+		for isHexDigit(rune(p.peek(0))) {
+			p.pos++
+		}
+	}
+
+	return result, nil
+}
+
+// parseString parses a double-quoted string with escape sequences.
+// Strings made of plain ASCII or valid UTF-8 without escapes are copied out
+// in one step; anything else is decoded by parseStringSlow.
+func (p *byteParser) parseString() (string, error) {
+	if p.peek(0) != '"' {
+		return "", fmt.Errorf("expected '\"' at position %d", p.pos)
+	}
+	p.pos++
+
+	start := p.pos
+	for i := start; i < len(p.s); i++ {
+		c := p.s[i]
+		switch {
+		case c == '"':
+			p.pos = i + 1
+			return string(p.s[start:i]), nil
+		case c == '\\' || c == '\n':
+			return p.parseStringSlow(start, i)
+		case c >= utf8.RuneSelf:
+			// Invalid UTF-8 is replaced with U+FFFD, which needs the slow path
+			r, w := utf8.DecodeRune(p.s[i:])
+			if r == utf8.RuneError && w == 1 {
+				return p.parseStringSlow(start, i)
+			}
+			i += w - 1
+		}
+	}
+	p.pos = len(p.s)
+	return "", fmt.Errorf("unterminated string at position %d", p.pos)
+}
+
+// parseStringSlow finishes a string whose bytes from start to i need no
+// decoding, handling escapes, newlines and invalid UTF-8 from i onwards
+func (p *byteParser) parseStringSlow(start, i int) (string, error) {
+	var b strings.Builder
+	b.Grow(i - start + 16)
+	b.Write(p.s[start:i])
+
+	p.pos = i
+	for p.pos < len(p.s) {
+		c := p.s[p.pos]
+		if c >= utf8.RuneSelf {
+			r, w := utf8.DecodeRune(p.s[p.pos:])
+			p.pos += w
+			b.WriteRune(r)
+			continue
+		}
+		p.pos++
+		switch c {
+		case '"':
+			return b.String(), nil
+		case '\\':
+			if p.pos >= len(p.s) {
+				return "", fmt.Errorf("unterminated string at position %d", p.pos)
+			}
+			r, w := utf8.DecodeRune(p.s[p.pos:])
+			p.pos += w
+			if escaped, ok := escapeSequences[r]; ok {
+				b.WriteRune(escaped)
+			} else {
+				b.WriteRune(r) // Unknown escape sequences are taken literally
+			}
+		case '\n':
+			return "", fmt.Errorf("newline in string at position %d", p.pos)
+		default:
+			b.WriteByte(c)
+		}
+	}
+	return "", fmt.Errorf("unterminated string at position %d", p.pos)
+}
+
+// parseIdentifier parses an identifier of letters, digits and underscores
+// starting with a letter. ASCII is checked directly; other characters are
+// decoded and classified with the unicode package.
+func (p *byteParser) parseIdentifier() (string, error) {
+	start := p.pos
+	r, w := p.peekIdentRune()
+	if !unicode.IsLetter(r) {
+		p.pos += w
+		return "", fmt.Errorf("identifier must start with a letter at position %d", p.pos)
+	}
+	p.pos += w
+	for p.pos < len(p.s) {
+		c := p.s[p.pos]
+		if c < utf8.RuneSelf {
+			if !isIdentByte(c) {
+				break
+			}
+			p.pos++
+			continue
+		}
+		r, w := utf8.DecodeRune(p.s[p.pos:])
+		if !unicode.IsLetter(r) && !unicode.IsDigit(r) {
+			break
+		}
+		p.pos += w
+	}
+	return string(p.s[start:p.pos]), nil
+}
+
+// peekIdentRune returns the rune at the current position and its width,
+// with an ASCII fast path
+func (p *byteParser) peekIdentRune() (rune, int) {
+	if p.pos >= len(p.s) {
+		return 0, 0
+	}
+	if c := p.s[p.pos]; c < utf8.RuneSelf {
+		return rune(c), 1
+	}
+	return utf8.DecodeRune(p.s[p.pos:])
+}
+
+// peekRune decodes the rune at the current position, for error messages
+func (p *byteParser) peekRune() rune {
+	r, _ := p.peekIdentRune()
+	return r
+}
+
+// peek returns the byte n positions ahead, or 0 past the end of input
+func (p *byteParser) peek(n int) byte {
+	if p.pos+n >= len(p.s) {
+		return 0
+	}
+	return p.s[p.pos+n]
+}
+
+// expect consumes c if it is the next byte
+func (p *byteParser) expect(c byte) bool {
+	if p.peek(0) == c {
+		p.pos++
+		return true
+	}
+	return false
+}
+
+// skipSpaces skips spaces and tabs
+func (p *byteParser) skipSpaces() {
+	for p.pos < len(p.s) && (p.s[p.pos] == ' ' || p.s[p.pos] == '\t') {
+		p.pos++
+	}
+}
+
+// match consumes s if the input continues with it
+func (p *byteParser) match(s string) bool {
+	if len(p.s)-p.pos >= len(s) && string(p.s[p.pos:p.pos+len(s)]) == s {
+		p.pos += len(s)
+		return true
+	}
+	return false
+}
+
+// sizeHint bounds a declared array or mapping size by the remaining input,
+// so a corrupt size cannot trigger a huge allocation
+func (p *byteParser) sizeHint(size int) int {
+	if size <= 0 {
+		return 0
+	}
+	if remaining := len(p.s) - p.pos; size > remaining {
+		return remaining
+	}
+	return size
+}
+
+func isDigit(c byte) bool {
+	return c >= '0' && c <= '9'
+}
+
+func isIdentByte(c byte) bool {
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || isDigit(c) || c == '_'
+}
+
+func isTerminator(c byte) bool {
+	return c == ',' || c == ':' || c == ']' || c == '}' || c == ')' || c == '\n' || c == 0
+}
@@ -0,0 +1,281 @@
+package lpc
+
+import (
+	"fmt"
+	"reflect"
+	"strings"
+	"testing"
+
+	"github.com/mmcdole/viking-ftpd/pkg/fixtures"
+)
+
+// byteParserCorpus holds object inputs that ParseObject and ParseObjectBytes
+// must agree on, including their errors
+var byteParserCorpus = []string{
+	`name "Drake"`,
+	"name \"Drake\"\nlevel 30\ntitle \"wizard\"",
+	"# Header comment\nname \"Drake\"\n# Mid comment\nlevel 30\n# End comment",
+	"name \"Drake\"\n\nlevel 30\n\ntitle \"wizard\"\n",
+	"name \"Drake\"\ninvalid line\nlevel 30\nanother bad line",
+	"age 25",
+	"name",
+	"name\"Drake\"",
+	"name  \"Drake\"",
+	"user name \"Drake\"",
+	"name\t\"Drake\"",
+	"\t",
+	"   ",
+	" name \"Drake\"",
+	"name \"Drake\" ",
+	"12.34.56",
+	"name \"Drake\"\r\nlevel 30\r\n",
+	"_hidden 1",
+	"näme \"Dräke\"",
+	"name \"Dr\xffke\"",
+	"name \"\\é\"",
+	"name \"日本語\\n\"",
+	"level 5\x00junk",
+	"\x00level 5",
+	"big 9223372036854775807",
+	"small -9223372036854775808",
+	"overflow 9223372036854775808",
+	"huge 99999999999999999999",
+	"dash -",
+	"dot 1.",
+	"eq 1=",
+	"neg -.5",
+	"map ([2|1:\"a\",2.5:\"b\"])",
+	"map ([1|nil:1])",
+}
+
+// byteParserValues are value inputs shared with TestValueParsing
+var byteParserValues = []string{
+	`""`, `"hello"`, `"line1\nline2"`, `"col1\tcol2"`, `"return\rhere"`, `"form\ffeed"`,
+	`"vert\vtab"`, `"alert\a"`, `"back\bspace"`, `"quote\"here"`, `"C:\\path\\to\\file"`,
+	`"hello\0world"`, `"hello\zworld"`, `"hello\`, `"hello`, `"line1\nline2\tcolumn2\nline3"`,
+	"0", "42", "-42", "3.14", "-3.14", "3.14=0x4048f5c3", "-1=bff0000000000000",
+	"0=0000000000000000", "1.0=xyz", "nil", "nill", "NIL",
+	"({0|})", "({0|,})", "({2|1,2,})", "({1|1,2})", "({2|1})", "({1|2}", "({1|nil})",
+	"({not an array})", "{1|2})", "([0|])",
+	`({3|"a",1,2})`, `({4|"hello",42,3.14,nil})`, `({2|({2|1,2}),({2|3,4})})`,
+	`([1|"a" 1])`, `([2|"a":1])`, `([2|"a":1,"b":2])`, `([2|"a":1,"b":2,])`,
+	`([3|"a":"hello","b":42,"c":3.14])`, `([1|"arr":({3|1,2,3})])`,
+	`({1|([1|"key":"value"])})`, `({1|([1|"arr":({2|1,2})])})`, `([1|"arr":({2|1,([1|"x":1})])`,
+	`([1|([1|"x":1]):42])`, `([1|({0|}):42])`, `([1|({2|1,2}):"hello"])`,
+	`([3|({2|1,2}):3,"a":1,([1|"x":1]):2])`,
+}
+
+func TestParseObjectBytesMatchesParseObject(t *testing.T) {
+	inputs := append([]string{}, byteParserCorpus...)
+	for _, v := range byteParserValues {
+		inputs = append(inputs, "value "+v)
+	}
+	inputs = append(inputs, strings.Join(inputs, "\n"))
+
+	for _, input := range inputs {
+		for _, strict := range []bool{true, false} {
+			t.Run(fmt.Sprintf("%q/strict=%v", input, strict), func(t *testing.T) {
+				p := NewObjectParser(strict)
+				want, wantErr := p.ParseObject(input)
+				got, gotErr := p.ParseObjectBytes([]byte(input))
+
+				if fmt.Sprint(gotErr) != fmt.Sprint(wantErr) {
+					t.Fatalf("ParseObjectBytes() error = %v, ParseObject() error = %v", gotErr, wantErr)
+				}
+				if !reflect.DeepEqual(got, want) {
+					t.Errorf("ParseObjectBytes() = %#v, ParseObject() = %#v", got, want)
+				}
+			})
+		}
+	}
+}
+
+func TestParseObjectBytesEmpty(t *testing.T) {
+	if _, err := NewObjectParser(true).ParseObjectBytes(nil); err == nil {
+		t.Error("expected error for empty input")
+	}
+}
+
+func TestParseObjectBytesDoesNotRetainInput(t *testing.T) {
+	input := []byte("name \"Drake\"\ntitle \"the wizard\"")
+	result, err := NewObjectParser(true).ParseObjectBytes(input)
+	if err != nil {
+		t.Fatalf("ParseObjectBytes() error = %v", err)
+	}
+
+	// The caller may reuse its buffer once parsing returns
+	for i := range input {
+		input[i] = 'x'
+	}
+	if result.Object["name"] != "Drake" || result.Object["title"] != "the wizard" {
+		t.Errorf("parsed values changed with the input buffer: %v", result.Object)
+	}
+}
+
+// benchmarkObject builds an object shaped like a large save file: a few
+// scalar fields followed by long string arrays and nested mappings
+func benchmarkObject() []byte {
+	var b strings.Builder
+	b.WriteString("# /players/d/drake\n")
+	b.WriteString("password \"$argon2id$v=19$m=65536,t=3,p=4$c2FsdHNhbHQ$aGFzaGhhc2hoYXNo\"\n")
+	b.WriteString("level 40\n")
+	b.WriteString("experience 123456789\n")
+	b.WriteString("weight 73.25=4052500000000000\n")
+
+	for i := 0; i < 50; i++ {
+		fmt.Fprintf(&b, "alias%d ({20|", i)
+		for j := 0; j < 20; j++ {
+			if j > 0 {
+				b.WriteByte(',')
+			}
+			fmt.Fprintf(&b, "\"say hello number %d to everyone in the room\"", j)
+		}
+		b.WriteString("})\n")
+	}
+
+	fmt.Fprintf(&b, "quests ([%d|", 200)
+	for i := 0; i < 200; i++ {
+		if i > 0 {
+			b.WriteByte(',')
+		}
+		fmt.Fprintf(&b, "\"quest_%d\":([2|\"done\":%d,\"notes\":({2|\"first\",\"second\"})])", i, i*1000)
+	}
+	b.WriteString("])\n")
+	return []byte(b.String())
+}
+
+// benchmarkInputs returns the large inputs the parsers are benchmarked on
+func benchmarkInputs() []struct {
+	name string
+	data []byte
+} {
+	return []struct {
+		name string
+		data []byte
+	}{
+		{"SaveFile", benchmarkObject()},
+		{"AccessFile", fixtures.AccessFile(fixtures.DefaultConfig())},
+	}
+}
+
+func BenchmarkParseObject(b *testing.B) {
+	for _, input := range benchmarkInputs() {
+		b.Run(input.name, func(b *testing.B) {
+			p := NewObjectParser(false)
+			b.SetBytes(int64(len(input.data)))
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				// Callers convert their file contents first
+				if _, err := p.ParseObject(string(input.data)); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
+
+func BenchmarkParseObjectBytes(b *testing.B) {
+	for _, input := range benchmarkInputs() {
+		b.Run(input.name, func(b *testing.B) {
+			p := NewObjectParser(false)
+			b.SetBytes(int64(len(input.data)))
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				if _, err := p.ParseObjectBytes(input.data); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
+
+func TestParseObjectFields(t *testing.T) {
+	input := []byte(`# /players/d/drake
+inventory ({2|"sword",broken
+password "hash"
+title "the wizard"
+level 30
+aliases this line is never looked at`)
+
+	tests := []struct {
+		name     string
+		keys     []string
+		strict   bool
+		want     map[string]interface{}
+		errCount int
+		wantErr  bool
+	}{
+		{
+			name:   "Requested Keys Only",
+			keys:   []string{"password", "level"},
+			strict: true,
+			want:   map[string]interface{}{"password": "hash", "level": 30},
+		},
+		{
+			name:   "Missing Key",
+			keys:   []string{"password", "race"},
+			strict: true,
+			want:   map[string]interface{}{"password": "hash"},
+		},
+		{
+			name: "No Keys",
+			want: map[string]interface{}{},
+		},
+		{
+			name:    "Invalid Requested Line In Strict Mode",
+			keys:    []string{"inventory"},
+			strict:  true,
+			wantErr: true,
+		},
+		{
+			name:     "Invalid Requested Line In Non-Strict Mode",
+			keys:     []string{"inventory", "title"},
+			want:     map[string]interface{}{"title": "the wizard"},
+			errCount: 1,
+		},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			got, err := NewObjectParser(tt.strict).ParseObjectFields(input, tt.keys...)
+			if (err != nil) != tt.wantErr {
+				t.Fatalf("ParseObjectFields() error = %v, wantErr %v", err, tt.wantErr)
+			}
+			if tt.wantErr {
+				return
+			}
+			if len(got.Errors) != tt.errCount {
+				t.Errorf("ParseObjectFields() error count = %d, want %d", len(got.Errors), tt.errCount)
+			}
+			if !reflect.DeepEqual(got.Object, tt.want) {
+				t.Errorf("ParseObjectFields() = %v, want %v", got.Object, tt.want)
+			}
+		})
+	}
+}
+
+func BenchmarkParseObjectFields(b *testing.B) {
+	data := benchmarkObject()
+	p := NewObjectParser(false)
+
+	b.Run("Found", func(b *testing.B) {
+		b.SetBytes(int64(len(data)))
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			if _, err := p.ParseObjectFields(data, "password", "level"); err != nil {
+				b.Fatal(err)
+			}
+		}
+	})
+
+	// A missing key means every line is skipped without finding it
+	b.Run("Missing", func(b *testing.B) {
+		b.SetBytes(int64(len(data)))
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			if _, err := p.ParseObjectFields(data, "password", "race"); err != nil {
+				b.Fatal(err)
+			}
+		}
+	})
+}
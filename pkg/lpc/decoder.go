@@ -0,0 +1,203 @@
+package lpc
+
+import (
+	"bufio"
+	"bytes"
+	"fmt"
+	"io"
+)
+
+// decoderBufferSize is the size of the read buffer of a Decoder. Lines that
+// fit in it are parsed straight out of the buffer.
+const decoderBufferSize = 32 * 1024
+
+// Decoder reads an LPC object from an io.Reader and hands each entry to a
+// callback as soon as its line has been parsed. Only one line is held in
+// memory at a time, so peak memory depends on the longest entry rather than
+// the size of the input; lines of unrequested keys are discarded as they are
+// read. A Decoder can be reused for several inputs with Reset.
+type Decoder struct {
+	r      *bufio.Reader
+	strict bool
+	keys   []string
+	buf    []byte // holds lines that do not fit in the read buffer
+	errors []*ParseError
+}
+
+// NewDecoder creates a decoder reading from r. Strict has the same meaning
+// as for NewObjectParser.
+func NewDecoder(r io.Reader, strict bool) *Decoder {
+	return newDecoderSize(r, strict, decoderBufferSize)
+}
+
+func newDecoderSize(r io.Reader, strict bool, size int) *Decoder {
+	return &Decoder{
+		r:      bufio.NewReaderSize(r, size),
+		strict: strict,
+	}
+}
+
+// Reset discards the decoder's state and requested keys and makes it read
+// from r, keeping its read buffer
+func (d *Decoder) Reset(r io.Reader) {
+	d.r.Reset(r)
+	d.keys = nil
+	d.buf = d.buf[:0]
+	d.errors = nil
+}
+
+// SetKeys restricts decoding to the top-level entries named by keys, as
+// ParseObjectFields does. A key that appears more than once is handed to
+// the callback each time, so a callback storing values keeps the last one.
+func (d *Decoder) SetKeys(keys ...string) {
+	if keys == nil {
+		keys = []string{} // nil would select every entry
+	}
+	d.keys = keys
+}
+
+// Errors returns the errors skipped in non-strict mode by the last Decode
+func (d *Decoder) Errors() []*ParseError {
+	return d.errors
+}
+
+// Decode reads entries until the end of input, calling fn for each of them. It returns the first error
+// returned by fn, a read error, or in strict mode the first *ParseError.
+// Like ParseObject it fails on empty input, and on input that has errors
+// but no valid entries.
+func (d *Decoder) Decode(fn func(key string, value interface{}) error) error {
+	return d.decode(func(bp *byteParser) (error, error) {
+		key, value, err := bp.parseLine()
+		if err != nil {
+			return err, nil
+		}
+		return nil, fn(key, value)
+	})
+}
+
+// DecodeRaw is like Decode, but hands fn the unparsed text of each value
+// instead of building it, for callers that decode values into their own
+// types with a ValueReader. Only the keys are checked by the decoder;
+// errors in a value are up to fn to report. The value slice is only valid
+// until fn returns.
+func (d *Decoder) DecodeRaw(fn func(key string, value []byte) error) error {
+	return d.decode(func(bp *byteParser) (error, error) {
+		if c := bp.peek(0); c == 0 {
+			return nil, nil // a line starting with a zero byte holds no entry
+		}
+		key, err := bp.parseKey()
+		if err != nil {
+			return err, nil
+		}
+		return nil, fn(key, bp.s[bp.pos:])
+	})
+}
+
+// decode runs the line loop shared by Decode and DecodeRaw. handle parses
+// one selected line, returning either a parse error for that line or an
+// error that stops decoding.
+func (d *Decoder) decode(handle func(bp *byteParser) (parseErr error, err error)) error {
+	d.errors = nil
+	defer d.releaseBuffer()
+
+	filter := newKeyFilter(d.keys)
+	if filter.empty() {
+		if _, err := d.r.Peek(1); err == io.EOF {
+			return fmt.Errorf("input string is empty")
+		}
+		return nil
+	}
+
+	entries := 0
+	offset := 0
+	for lineNum := 1; ; lineNum++ {
+		line, n, err := d.readLine(filter)
+		if err == io.EOF && n == 0 && lineNum == 1 {
+			return fmt.Errorf("input string is empty")
+		}
+		if err != nil && err != io.EOF {
+			return err
+		}
+
+		if line != nil {
+			bp := byteParser{s: line}
+			perr, herr := handle(&bp)
+			if perr != nil {
+				parseErr := &ParseError{
+					Line:     lineNum,
+					Position: offset + bp.pos,
+					Err:      perr,
+				}
+				if d.strict {
+					return parseErr
+				}
+				d.errors = append(d.errors, parseErr)
+			} else {
+				if herr != nil {
+					return herr
+				}
+				entries++
+			}
+		}
+
+		if err == io.EOF {
+			break
+		}
+		offset += n
+	}
+
+	if entries == 0 && len(d.errors) > 0 {
+		return fmt.Errorf("no valid entries found")
+	}
+	return nil
+}
+
+// readLine reads the next line and returns it without its newline, along
+// with the number of bytes consumed. A nil line means there is nothing to
+// parse: the line was empty, a comment, or not selected by filter, in which
+// case the rest of it is discarded without being buffered. At the end of
+// input it returns io.EOF, possibly together with a final line.
+func (d *Decoder) readLine(filter *keyFilter) ([]byte, int, error) {
+	chunk, err := d.r.ReadSlice('\n')
+	n := len(chunk)
+
+	skip := len(chunk) == 0 || chunk[0] == '#' || chunk[0] == '\n'
+	if !skip && filter != nil {
+		// Keys are short, so the first chunk always holds the whole key
+		skip = !filter.match(trimNewline(chunk))
+	}
+
+	if err == bufio.ErrBufferFull {
+		// Long line: keep reading it, buffering only if it will be parsed
+		if !skip {
+			d.buf = append(d.buf[:0], chunk...)
+		}
+		for err == bufio.ErrBufferFull {
+			chunk, err = d.r.ReadSlice('\n')
+			n += len(chunk)
+			if !skip {
+				d.buf = append(d.buf, chunk...)
+			}
+		}
+		chunk = d.buf
+	}
+	if err != nil && err != io.EOF {
+		return nil, n, err
+	}
+	if skip {
+		return nil, n, err
+	}
+	return trimNewline(chunk), n, err
+}
+
+// releaseBuffer drops the line buffer after it grew for an unusually long
+// line, so a decoder kept for reuse does not pin it
+func (d *Decoder) releaseBuffer() {
+	if cap(d.buf) > decoderBufferSize {
+		d.buf = nil
+	}
+}
+
+func trimNewline(line []byte) []byte {
+	return bytes.TrimSuffix(line, []byte{'\n'})
+}
@@ -0,0 +1,171 @@
+package lpc
+
+import (
+	"errors"
+	"fmt"
+	"io"
+	"reflect"
+	"strings"
+	"testing"
+	"testing/iotest"
+)
+
+// decodeAll runs a decoder over input and collects its entries the way
+// ParseObjectBytes returns them
+func decodeAll(d *Decoder) (*ParseResult, error) {
+	result := &ParseResult{Object: make(map[string]interface{})}
+	err := d.Decode(func(key string, value interface{}) error {
+		result.Object[key] = value
+		return nil
+	})
+	result.Errors = append(make([]*ParseError, 0), d.Errors()...)
+	return result, err
+}
+
+func TestDecoderMatchesParseObjectBytes(t *testing.T) {
+	inputs := append([]string{}, byteParserCorpus...)
+	for _, v := range byteParserValues {
+		inputs = append(inputs, "value "+v)
+	}
+	inputs = append(inputs, strings.Join(inputs, "\n"), "")
+
+	// A 16 byte buffer forces long lines through the slow path
+	for _, size := range []int{16, decoderBufferSize} {
+		for _, input := range inputs {
+			for _, strict := range []bool{true, false} {
+				t.Run(fmt.Sprintf("%d/%q/strict=%v", size, input, strict), func(t *testing.T) {
+					want, wantErr := NewObjectParser(strict).ParseObjectBytes([]byte(input))
+
+					r := iotest.OneByteReader(strings.NewReader(input))
+					got, gotErr := decodeAll(newDecoderSize(r, strict, size))
+					if fmt.Sprint(gotErr) != fmt.Sprint(wantErr) {
+						t.Fatalf("Decode() error = %v, ParseObjectBytes() error = %v", gotErr, wantErr)
+					}
+					if wantErr != nil && want == nil {
+						return
+					}
+					if !reflect.DeepEqual(got, want) {
+						t.Errorf("Decode() = %#v, ParseObjectBytes() = %#v", got, want)
+					}
+				})
+			}
+		}
+	}
+}
+
+func TestDecoderKeys(t *testing.T) {
+	longValue := strings.Repeat(`"filler",`, 1000)
+	input := "inventory ({1001|" + longValue + `"end"})` + "\npassword \"hash\"\nlevel 30\n" + strings.Repeat("x 1\n", 100)
+
+	d := newDecoderSize(strings.NewReader(input), true, 64)
+	d.SetKeys("password", "level")
+	got, err := decodeAll(d)
+	if err != nil {
+		t.Fatalf("Decode() error = %v", err)
+	}
+
+	want := map[string]interface{}{"password": "hash", "level": 30}
+	if !reflect.DeepEqual(got.Object, want) {
+		t.Errorf("Decode() = %v, want %v", got.Object, want)
+	}
+	// The long inventory line was skipped without being buffered
+	if cap(d.buf) > 64 {
+		t.Errorf("Decode() buffered %d bytes for an unrequested line", cap(d.buf))
+	}
+}
+
+// TestDuplicateKeys checks that every parser, with or without a key
+// filter, keeps the last occurrence of a repeated key
+func TestDuplicateKeys(t *testing.T) {
+	input := "level 1\npassword \"first\"\ntitle \"x\"\npassword \"second\"\nlevel 30\n"
+	want := map[string]interface{}{"password": "second", "level": 30}
+
+	parsers := []struct {
+		name  string
+		parse func() (*ParseResult, error)
+	}{
+		{"ParseObject", func() (*ParseResult, error) { return NewObjectParser(true).ParseObject(input) }},
+		{"ParseObjectBytes", func() (*ParseResult, error) { return NewObjectParser(true).ParseObjectBytes([]byte(input)) }},
+		{"ParseObjectFields", func() (*ParseResult, error) {
+			return NewObjectParser(true).ParseObjectFields([]byte(input), "password", "level")
+		}},
+		{"Decoder", func() (*ParseResult, error) { return decodeAll(NewDecoder(strings.NewReader(input), true)) }},
+		{"DecoderKeys", func() (*ParseResult, error) {
+			d := NewDecoder(strings.NewReader(input), true)
+			d.SetKeys("password", "level")
+			return decodeAll(d)
+		}},
+	}
+	for _, p := range parsers {
+		t.Run(p.name, func(t *testing.T) {
+			got, err := p.parse()
+			if err != nil {
+				t.Fatalf("%s() error = %v", p.name, err)
+			}
+			delete(got.Object, "title")
+			if !reflect.DeepEqual(got.Object, want) {
+				t.Errorf("%s() = %v, want %v", p.name, got.Object, want)
+			}
+		})
+	}
+}
+
+func TestDecoderCallbackError(t *testing.T) {
+	stop := errors.New("stop")
+	calls := 0
+	d := NewDecoder(strings.NewReader("a 1\nb 2\nc 3\n"), true)
+	err := d.Decode(func(key string, value interface{}) error {
+		calls++
+		return stop
+	})
+	if err != stop {
+		t.Errorf("Decode() error = %v, want %v", err, stop)
+	}
+	if calls != 1 {
+		t.Errorf("Decode() called fn %d times after it failed, want 1", calls)
+	}
+}
+
+func TestDecoderReadError(t *testing.T) {
+	broken := errors.New("disk error")
+	r := io.MultiReader(strings.NewReader("a 1\nb "), iotest.ErrReader(broken))
+	err := NewDecoder(r, false).Decode(func(string, interface{}) error { return nil })
+	if !errors.Is(err, broken) {
+		t.Errorf("Decode() error = %v, want %v", err, broken)
+	}
+}
+
+func TestDecoderReset(t *testing.T) {
+	d := NewDecoder(strings.NewReader("a 1\n"), false)
+	d.SetKeys("a")
+	if _, err := decodeAll(d); err != nil {
+		t.Fatalf("Decode() error = %v", err)
+	}
+
+	// Reset clears the requested keys along with the input
+	d.Reset(strings.NewReader("b 2\nc 3\n"))
+	got, err := decodeAll(d)
+	if err != nil {
+		t.Fatalf("Decode() after Reset error = %v", err)
+	}
+	want := map[string]interface{}{"b": 2, "c": 3}
+	if !reflect.DeepEqual(got.Object, want) {
+		t.Errorf("Decode() after Reset = %v, want %v", got.Object, want)
+	}
+}
+
+func BenchmarkDecoder(b *testing.B) {
+	data := benchmarkObject()
+	r := strings.NewReader(string(data))
+	d := NewDecoder(r, false)
+	b.SetBytes(int64(len(data)))
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		r.Seek(0, io.SeekStart)
+		d.Reset(r)
+		if err := d.Decode(func(string, interface{}) error { return nil }); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
@@ -0,0 +1,243 @@
+package lpc
+
+import (
+	"fmt"
+	"unicode/utf8"
+)
+
+// Kind identifies the type of the next value read by a ValueReader
+type Kind int
+
+const (
+	KindInvalid Kind = iota
+	KindString
+	KindInt
+	KindFloat
+	KindArray
+	KindMap
+	KindNil
+)
+
+var kindNames = [...]string{"invalid", "string", "int", "float", "array", "map", "nil"}
+
+// String returns the name of the kind
+func (k Kind) String() string {
+	if k < 0 || int(k) >= len(kindNames) {
+		return fmt.Sprintf("Kind(%d)", int(k))
+	}
+	return kindNames[k]
+}
+
+// ValueReader reads a single LPC value piece by piece, such as the raw value
+// handed out by Decoder.DecodeRaw. It lets callers decode values straight
+// into their own types instead of building interface{} values first.
+//
+// Arrays and mappings are read by calling ReadArrayStart or ReadMapStart,
+// then More before each element; More consumes the separators and the
+// closing bracket. Mapping entries are a key, ReadColon and a value. The
+// declared sizes are returned but not enforced, so callers should compare
+// them with the number of elements they read.
+type ValueReader struct {
+	p     byteParser
+	stack []container
+}
+
+// container is an array or mapping being read
+type container struct {
+	close byte // '}' for arrays, ']' for mappings
+	first bool // no element has been read yet
+}
+
+// NewValueReader creates a reader for the value in data
+func NewValueReader(data []byte) *ValueReader {
+	return &ValueReader{p: byteParser{s: data}}
+}
+
+// Kind returns the kind of the next value without consuming it
+func (r *ValueReader) Kind() Kind {
+	r.p.skipSpaces()
+	c := r.p.peek(0)
+	switch {
+	case c == '"':
+		return KindString
+	case isDigit(c) || c == '-':
+		offset := 0
+		if c == '-' {
+			offset++
+		}
+		for isDigit(r.p.peek(offset)) {
+			offset++
+		}
+		if d := r.p.peek(offset); d == '.' || d == '=' {
+			return KindFloat
+		}
+		return KindInt
+	case c == '(' && r.p.peek(1) == '{':
+		return KindArray
+	case c == '(' && r.p.peek(1) == '[':
+		return KindMap
+	case c == 'n':
+		return KindNil
+	}
+	return KindInvalid
+}
+
+// ReadString reads a string value
+func (r *ValueReader) ReadString() (string, error) {
+	r.p.skipSpaces()
+	return r.p.parseString()
+}
+
+// ReadStringBytes reads a string value without allocating when it contains
+// no escapes or invalid UTF-8. The returned slice may alias the input and
+// must not be modified.
+func (r *ValueReader) ReadStringBytes() ([]byte, error) {
+	r.p.skipSpaces()
+	p := &r.p
+	if p.peek(0) != '"' {
+		return nil, fmt.Errorf("expected '\"' at position %d", p.pos)
+	}
+	start := p.pos + 1
+	for i := start; i < len(p.s); i++ {
+		c := p.s[i]
+		switch {
+		case c == '"':
+			p.pos = i + 1
+			return p.s[start:i], nil
+		case c == '\\' || c == '\n':
+			return r.readStringCopy()
+		case c >= utf8.RuneSelf:
+			rr, w := utf8.DecodeRune(p.s[i:])
+			if rr == utf8.RuneError && w == 1 {
+				return r.readStringCopy()
+			}
+			i += w - 1
+		}
+	}
+	p.pos = len(p.s)
+	return nil, fmt.Errorf("unterminated string at position %d", p.pos)
+}
+
+func (r *ValueReader) readStringCopy() ([]byte, error) {
+	s, err := r.p.parseString()
+	if err != nil {
+		return nil, err
+	}
+	return []byte(s), nil
+}
+
+// ReadInt reads an integer value
+func (r *ValueReader) ReadInt() (int, error) {
+	r.p.skipSpaces()
+	return r.p.parseInt()
+}
+
+// ReadNumber reads an integer or float value as a float64
+func (r *ValueReader) ReadNumber() (float64, error) {
+	r.p.skipSpaces()
+	v, err := r.p.parseNumber()
+	if err != nil {
+		return 0, err
+	}
+	switch n := v.(type) {
+	case int:
+		return float64(n), nil
+	case float64:
+		return n, nil
+	}
+	return 0, fmt.Errorf("invalid number at position %d", r.p.pos)
+}
+
+// ReadValue reads any value into the representation ParseObject uses
+func (r *ValueReader) ReadValue() (interface{}, error) {
+	return r.p.parseValue()
+}
+
+// ReadArrayStart consumes the opening of an array and returns its declared size
+func (r *ValueReader) ReadArrayStart() (int, error) {
+	return r.readStart("({", '}', "array")
+}
+
+// ReadMapStart consumes the opening of a mapping and returns its declared size
+func (r *ValueReader) ReadMapStart() (int, error) {
+	return r.readStart("([", ']', "map")
+}
+
+func (r *ValueReader) readStart(open string, close byte, what string) (int, error) {
+	r.p.skipSpaces()
+	if !r.p.match(open) {
+		return 0, fmt.Errorf("error in %s: expected '%s' at position %d", what, open, r.p.pos)
+	}
+	size, err := r.p.parseInt()
+	if err != nil {
+		return 0, fmt.Errorf("error in %s: invalid size at position %d: %v", what, r.p.pos, err)
+	}
+	if !r.p.expect('|') {
+		return 0, fmt.Errorf("error in %s: expected '|' after size at position %d", what, r.p.pos)
+	}
+	r.stack = append(r.stack, container{close: close, first: true})
+	return size, nil
+}
+
+// More reports whether another element follows in the innermost array or
+// mapping. When it returns false the container has been closed.
+func (r *ValueReader) More() (bool, error) {
+	if len(r.stack) == 0 {
+		return false, fmt.Errorf("no array or map is open at position %d", r.p.pos)
+	}
+	top := &r.stack[len(r.stack)-1]
+	p := &r.p
+	p.skipSpaces()
+
+	if top.first {
+		top.first = false
+		if p.peek(0) == top.close && p.peek(1) == ')' {
+			p.pos += 2
+			r.stack = r.stack[:len(r.stack)-1]
+			return false, nil
+		}
+		// Arrays may also be written empty with a lone comma
+		if top.close == '}' && p.peek(0) == ',' && p.peek(1) == '}' && p.peek(2) == ')' {
+			p.pos += 3
+			r.stack = r.stack[:len(r.stack)-1]
+			return false, nil
+		}
+		return true, nil
+	}
+
+	if p.peek(0) == ',' {
+		p.pos++
+		p.skipSpaces()
+		// A trailing comma may precede the closing bracket
+		if p.peek(0) == top.close && p.peek(1) == ')' {
+			p.pos += 2
+			r.stack = r.stack[:len(r.stack)-1]
+			return false, nil
+		}
+		return true, nil
+	}
+	if p.peek(0) == top.close && p.peek(1) == ')' {
+		p.pos += 2
+		r.stack = r.stack[:len(r.stack)-1]
+		return false, nil
+	}
+	return false, fmt.Errorf("expected ',' or '%c)' at position %d", top.close, p.pos)
+}
+
+// ReadColon consumes the ':' between a mapping key and its value
+func (r *ValueReader) ReadColon() error {
+	r.p.skipSpaces()
+	if !r.p.expect(':') {
+		return fmt.Errorf("error in map entry: expected ':' after key at position %d", r.p.pos)
+	}
+	return nil
+}
+
+// Finish checks that the whole value has been read and nothing but the end
+// of the line follows it
+func (r *ValueReader) Finish() error {
+	if len(r.stack) > 0 {
+		return fmt.Errorf("unclosed array or map at position %d", r.p.pos)
+	}
+	return r.p.parseEnd()
+}
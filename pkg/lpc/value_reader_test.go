@@ -0,0 +1,108 @@
+package lpc
+
+import (
+	"reflect"
+	"testing"
+)
+
+func TestValueReader(t *testing.T) {
+	r := NewValueReader([]byte(`([3|"name":"Dr\"ake","ids":({3|1,-2,3.5,}),"none":nil,])`))
+
+	if kind := r.Kind(); kind != KindMap {
+		t.Fatalf("Kind() = %v, want %v", kind, KindMap)
+	}
+	size, err := r.ReadMapStart()
+	if err != nil || size != 3 {
+		t.Fatalf("ReadMapStart() = %d, %v", size, err)
+	}
+
+	got := make(map[string]interface{})
+	for {
+		more, err := r.More()
+		if err != nil {
+			t.Fatalf("More() error = %v", err)
+		}
+		if !more {
+			break
+		}
+		key, err := r.ReadStringBytes()
+		if err != nil {
+			t.Fatalf("ReadStringBytes() error = %v", err)
+		}
+		if err := r.ReadColon(); err != nil {
+			t.Fatalf("ReadColon() error = %v", err)
+		}
+
+		switch r.Kind() {
+		case KindString:
+			got[string(key)], err = r.ReadString()
+		case KindArray:
+			var numbers []float64
+			if _, err = r.ReadArrayStart(); err != nil {
+				break
+			}
+			for {
+				more, merr := r.More()
+				if merr != nil || !more {
+					err = merr
+					break
+				}
+				n, nerr := r.ReadNumber()
+				if nerr != nil {
+					err = nerr
+					break
+				}
+				numbers = append(numbers, n)
+			}
+			got[string(key)] = numbers
+		default:
+			got[string(key)], err = r.ReadValue()
+		}
+		if err != nil {
+			t.Fatalf("reading %s: %v", key, err)
+		}
+	}
+	if err := r.Finish(); err != nil {
+		t.Fatalf("Finish() error = %v", err)
+	}
+
+	want := map[string]interface{}{
+		"name": `Dr"ake`,
+		"ids":  []float64{1, -2, 3.5},
+		"none": nil,
+	}
+	if !reflect.DeepEqual(got, want) {
+		t.Errorf("read %v, want %v", got, want)
+	}
+}
+
+func TestValueReaderErrors(t *testing.T) {
+	t.Run("Unclosed", func(t *testing.T) {
+		r := NewValueReader([]byte(`({1|1`))
+		if _, err := r.ReadArrayStart(); err != nil {
+			t.Fatalf("ReadArrayStart() error = %v", err)
+		}
+		r.More()
+		r.ReadNumber()
+		if _, err := r.More(); err == nil {
+			t.Error("More() should fail on a missing '})'")
+		}
+		if err := r.Finish(); err == nil {
+			t.Error("Finish() should fail with an open array")
+		}
+	})
+
+	t.Run("Trailing", func(t *testing.T) {
+		r := NewValueReader([]byte(`1 `))
+		r.ReadInt()
+		if err := r.Finish(); err == nil {
+			t.Error("Finish() should fail on trailing whitespace")
+		}
+	})
+
+	t.Run("More Without Container", func(t *testing.T) {
+		if _, err := NewValueReader([]byte(`1`)).More(); err == nil {
+			t.Error("More() should fail outside an array or map")
+		}
+	})
+}
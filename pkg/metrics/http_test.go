@@ -0,0 +1,40 @@
+package metrics
+
+import (
+	"io"
+	"net/http"
+	"net/http/httptest"
+	"strings"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+)
+
+func TestNewServeMux(t *testing.T) {
+	r := NewRegistry()
+	r.NewCounter("vkftpd_logins_total", "Logins.").Inc()
+	srv := httptest.NewServer(NewServeMux(r))
+	defer srv.Close()
+
+	tests := []struct {
+		path        string
+		contentType string
+		contains    string
+	}{
+		{"/metrics", contentType, "vkftpd_logins_total 1"},
+		{"/debug/pprof/", "text/html; charset=utf-8", "goroutine"},
+		{"/debug/pprof/cmdline", "text/plain; charset=utf-8", ""},
+	}
+	for _, tt := range tests {
+		t.Run(tt.path, func(t *testing.T) {
+			resp, err := http.Get(srv.URL + tt.path)
+			assert.NoError(t, err)
+			defer resp.Body.Close()
+			body, err := io.ReadAll(resp.Body)
+			assert.NoError(t, err)
+			assert.Equal(t, http.StatusOK, resp.StatusCode)
+			assert.Equal(t, tt.contentType, resp.Header.Get("Content-Type"))
+			assert.True(t, strings.Contains(string(body), tt.contains), "body: %s", body)
+		})
+	}
+}
@@ -0,0 +1,372 @@
+// Package metrics provides the few metric types the server exports, written
+// in the Prometheus text exposition format. Counters and histograms are
+// updated with atomic operations only, and every method is a no-op on a nil
+// metric, so instrumented code pays next to nothing when metrics are off.
+package metrics
+
+import (
+	"bufio"
+	"fmt"
+	"io"
+	"math"
+	"sort"
+	"strconv"
+	"sync"
+	"sync/atomic"
+)
+
+// DurationBuckets are histogram bounds in seconds, from 100µs to 10s
+var DurationBuckets = []float64{
+	.0001, .00025, .0005, .001, .0025, .005, .01, .025, .05, .1, .25, .5, 1, 2.5, 5, 10,
+}
+
+// SizeBuckets are histogram bounds in bytes, from 1 KiB to 256 MiB
+var SizeBuckets = []float64{
+	1 << 10, 1 << 12, 1 << 14, 1 << 16, 1 << 18, 1 << 20, 1 << 22, 1 << 24, 1 << 26, 1 << 28,
+}
+
+// Registry holds the metrics of one process and writes them out
+type Registry struct {
+	mu      sync.Mutex
+	metrics []metric // in registration order
+	names   map[string]bool
+}
+
+// metric is one named metric family
+type metric interface {
+	write(w *bufio.Writer)
+}
+
+// NewRegistry creates an empty Registry
+func NewRegistry() *Registry {
+	return &Registry{names: make(map[string]bool)}
+}
+
+// register adds a metric family, panicking on a duplicate name like
+// flag.Var does, since that is always a programming error
+func (r *Registry) register(name string, m metric) {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	if r.names[name] {
+		panic("metrics: duplicate metric " + name)
+	}
+	r.names[name] = true
+	r.metrics = append(r.metrics, m)
+}
+
+// WriteTo writes every metric in the Prometheus text format
+func (r *Registry) WriteTo(w io.Writer) (int64, error) {
+	r.mu.Lock()
+	metrics := append([]metric(nil), r.metrics...)
+	r.mu.Unlock()
+
+	cw := &countingWriter{w: w}
+	bw := bufio.NewWriter(cw)
+	for _, m := range metrics {
+		m.write(bw)
+	}
+	err := bw.Flush()
+	return cw.n, err
+}
+
+type countingWriter struct {
+	w io.Writer
+	n int64
+}
+
+func (c *countingWriter) Write(p []byte) (int, error) {
+	n, err := c.w.Write(p)
+	c.n += int64(n)
+	return n, err
+}
+
+// writeHeader writes the HELP and TYPE lines of a family
+func writeHeader(w *bufio.Writer, name, help, kind string) {
+	fmt.Fprintf(w, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, kind)
+}
+
+// formatFloat formats a sample value the way Prometheus parses it
+func formatFloat(v float64) string {
+	switch {
+	case math.IsInf(v, 1):
+		return "+Inf"
+	case math.IsInf(v, -1):
+		return "-Inf"
+	case math.IsNaN(v):
+		return "NaN"
+	}
+	return strconv.FormatFloat(v, 'g', -1, 64)
+}
+
+// labelPair formats one label for a sample line
+func labelPair(label, value string) string {
+	return label + "=" + strconv.Quote(value)
+}
+
+// Counter is a value that only goes up
+type Counter struct {
+	v atomic.Int64
+}
+
+// Add increases the counter by n
+func (c *Counter) Add(n int64) {
+	if c != nil {
+		c.v.Add(n)
+	}
+}
+
+// Inc increases the counter by one
+func (c *Counter) Inc() {
+	c.Add(1)
+}
+
+// Value returns the current count
+func (c *Counter) Value() int64 {
+	if c == nil {
+		return 0
+	}
+	return c.v.Load()
+}
+
+type counterFamily struct {
+	name, help, label string
+	values            []string
+	counters          []*Counter
+}
+
+func (f *counterFamily) write(w *bufio.Writer) {
+	writeHeader(w, f.name, f.help, "counter")
+	for i, c := range f.counters {
+		if f.label == "" {
+			fmt.Fprintf(w, "%s %d\n", f.name, c.Value())
+		} else {
+			fmt.Fprintf(w, "%s{%s} %d\n", f.name, labelPair(f.label, f.values[i]), c.Value())
+		}
+	}
+}
+
+// NewCounter registers a counter
+func (r *Registry) NewCounter(name, help string) *Counter {
+	c := &Counter{}
+	r.register(name, &counterFamily{name: name, help: help, counters: []*Counter{c}})
+	return c
+}
+
+// NewCounterVec registers one counter per value of label, returned in the
+// order of values
+func (r *Registry) NewCounterVec(name, help, label string, values ...string) []*Counter {
+	f := &counterFamily{name: name, help: help, label: label, values: values}
+	for range values {
+		f.counters = append(f.counters, &Counter{})
+	}
+	r.register(name, f)
+	return f.counters
+}
+
+type funcFamily struct {
+	name, help, kind string
+	fn               func() float64
+}
+
+func (f *funcFamily) write(w *bufio.Writer) {
+	writeHeader(w, f.name, f.help, f.kind)
+	fmt.Fprintf(w, "%s %s\n", f.name, formatFloat(f.fn()))
+}
+
+// NewGaugeFunc registers a gauge whose value is read from fn when the
+// metrics are written
+func (r *Registry) NewGaugeFunc(name, help string, fn func() float64) {
+	r.register(name, &funcFamily{name: name, help: help, kind: "gauge", fn: fn})
+}
+
+// NewCounterFunc registers a counter whose value is read from fn when the
+// metrics are written, for counts a component already keeps
+func (r *Registry) NewCounterFunc(name, help string, fn func() float64) {
+	r.register(name, &funcFamily{name: name, help: help, kind: "counter", fn: fn})
+}
+
+// Histogram counts observations into buckets with fixed upper bounds
+type Histogram struct {
+	bounds []float64       // sorted upper bounds; +Inf is implied
+	counts []atomic.Uint64 // per bucket, not cumulative; the last is +Inf
+	sum    atomic.Uint64   // float64 bits
+}
+
+func newHistogram(bounds []float64) *Histogram {
+	bounds = append([]float64(nil), bounds...)
+	sort.Float64s(bounds)
+	return &Histogram{bounds: bounds, counts: make([]atomic.Uint64, len(bounds)+1)}
+}
+
+// Observe records one value
+func (h *Histogram) Observe(v float64) {
+	if h == nil {
+		return
+	}
+	h.counts[sort.SearchFloat64s(h.bounds, v)].Add(1)
+	for {
+		old := h.sum.Load()
+		if h.sum.CompareAndSwap(old, math.Float64bits(math.Float64frombits(old)+v)) {
+			return
+		}
+	}
+}
+
+// Count returns the number of observations
+func (h *Histogram) Count() uint64 {
+	if h == nil {
+		return 0
+	}
+	var n uint64
+	for i := range h.counts {
+		n += h.counts[i].Load()
+	}
+	return n
+}
+
+// write writes the samples of h, with labels prefixed to its own
+func (h *Histogram) write(w *bufio.Writer, name, labels string) {
+	sep := ""
+	if labels != "" {
+		sep = ","
+	}
+	var cumulative uint64
+	for i := range h.counts {
+		cumulative += h.counts[i].Load()
+		le := "+Inf"
+		if i < len(h.bounds) {
+			le = formatFloat(h.bounds[i])
+		}
+		fmt.Fprintf(w, "%s_bucket{%s%s%s} %d\n", name, labels, sep, labelPair("le", le), cumulative)
+	}
+	if labels != "" {
+		labels = "{" + labels + "}"
+	}
+	fmt.Fprintf(w, "%s_sum%s %s\n", name, labels, formatFloat(math.Float64frombits(h.sum.Load())))
+	fmt.Fprintf(w, "%s_count%s %d\n", name, labels, cumulative)
+}
+
+type histogramFamily struct {
+	name, help, label string
+	values            []string
+	histograms        []*Histogram
+}
+
+func (f *histogramFamily) write(w *bufio.Writer) {
+	writeHeader(w, f.name, f.help, "histogram")
+	for i, h := range f.histograms {
+		labels := ""
+		if f.label != "" {
+			labels = labelPair(f.label, f.values[i])
+		}
+		h.write(w, f.name, labels)
+	}
+}
+
+// NewHistogram registers a histogram with the given bucket upper bounds
+func (r *Registry) NewHistogram(name, help string, bounds []float64) *Histogram {
+	h := newHistogram(bounds)
+	r.register(name, &histogramFamily{name: name, help: help, histograms: []*Histogram{h}})
+	return h
+}
+
+// NewHistogramVec registers one histogram per value of label, returned in
+// the order of values
+func (r *Registry) NewHistogramVec(name, help string, bounds []float64, label string, values ...string) []*Histogram {
+	f := &histogramFamily{name: name, help: help, label: label, values: values}
+	for range values {
+		f.histograms = append(f.histograms, newHistogram(bounds))
+	}
+	r.register(name, f)
+	return f.histograms
+}
+
+// HistogramSnapshot is a copy of a histogram's bucket counts, for computing
+// quantiles over the observations made between two snapshots
+type HistogramSnapshot struct {
+	Bounds []float64 // sorted upper bounds; +Inf is implied
+	Counts []uint64  // per bucket, not cumulative; the last is +Inf
+}
+
+// Snapshot returns the current bucket counts of h. A nil histogram has an
+// empty snapshot.
+func (h *Histogram) Snapshot() HistogramSnapshot {
+	if h == nil {
+		return HistogramSnapshot{}
+	}
+	s := HistogramSnapshot{Bounds: h.bounds, Counts: make([]uint64, len(h.counts))}
+	for i := range h.counts {
+		s.Counts[i] = h.counts[i].Load()
+	}
+	return s
+}
+
+// compatible reports whether s and o count the same buckets
+func (s HistogramSnapshot) compatible(o HistogramSnapshot) bool {
+	return len(s.Counts) == len(o.Counts) && len(s.Bounds) == len(o.Bounds)
+}
+
+// Add returns the combined counts of s and o, which must share bounds; an
+// empty snapshot on either side returns the other
+func (s HistogramSnapshot) Add(o HistogramSnapshot) HistogramSnapshot {
+	if len(s.Counts) == 0 {
+		return o
+	}
+	if !s.compatible(o) {
+		return s
+	}
+	sum := HistogramSnapshot{Bounds: s.Bounds, Counts: make([]uint64, len(s.Counts))}
+	for i := range s.Counts {
+		sum.Counts[i] = s.Counts[i] + o.Counts[i]
+	}
+	return sum
+}
+
+// Sub returns the observations counted by s but not by the earlier snapshot
+// prev. An empty or incompatible prev returns s.
+func (s HistogramSnapshot) Sub(prev HistogramSnapshot) HistogramSnapshot {
+	if !s.compatible(prev) {
+		return s
+	}
+	diff := HistogramSnapshot{Bounds: s.Bounds, Counts: make([]uint64, len(s.Counts))}
+	for i := range s.Counts {
+		if s.Counts[i] > prev.Counts[i] {
+			diff.Counts[i] = s.Counts[i] - prev.Counts[i]
+		}
+	}
+	return diff
+}
+
+// Count returns the number of observations
+func (s HistogramSnapshot) Count() uint64 {
+	var n uint64
+	for _, c := range s.Counts {
+		n += c
+	}
+	return n
+}
+
+// Quantile returns an upper estimate of the q-quantile, 0 <= q <= 1: the
+// upper bound of the bucket holding it. Observations past the last bound
+// are reported as the last bound, and an empty snapshot as 0.
+func (s HistogramSnapshot) Quantile(q float64) float64 {
+	total := s.Count()
+	if total == 0 {
+		return 0
+	}
+	rank := uint64(math.Ceil(q * float64(total)))
+	if rank == 0 {
+		rank = 1
+	}
+	var cumulative uint64
+	for i, c := range s.Counts {
+		cumulative += c
+		if cumulative >= rank && i < len(s.Bounds) {
+			return s.Bounds[i]
+		}
+	}
+	if len(s.Bounds) == 0 {
+		return 0
+	}
+	return s.Bounds[len(s.Bounds)-1]
+}
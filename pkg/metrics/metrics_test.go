@@ -0,0 +1,122 @@
+package metrics
+
+import (
+	"strings"
+	"sync"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+)
+
+func TestRegistry_WriteTo(t *testing.T) {
+	r := NewRegistry()
+	logins := r.NewCounter("vkftpd_logins_total", "Logins.")
+	bytes := r.NewCounterVec("vkftpd_transfer_bytes_total", "Bytes moved.", "op", "retr", "stor")
+	r.NewGaugeFunc("vkftpd_active_connections", "Open sessions.", func() float64 { return 3 })
+	auth := r.NewHistogramVec("vkftpd_auth_duration_seconds", "Login time.", []float64{0.1, 1}, "result", "success")
+
+	logins.Inc()
+	bytes[1].Add(4096)
+	auth[0].Observe(0.05)
+	auth[0].Observe(0.5)
+	auth[0].Observe(7)
+
+	var out strings.Builder
+	_, err := r.WriteTo(&out)
+	assert.NoError(t, err)
+	want := `# HELP vkftpd_logins_total Logins.
+# TYPE vkftpd_logins_total counter
+vkftpd_logins_total 1
+# HELP vkftpd_transfer_bytes_total Bytes moved.
+# TYPE vkftpd_transfer_bytes_total counter
+vkftpd_transfer_bytes_total{op="retr"} 0
+vkftpd_transfer_bytes_total{op="stor"} 4096
+# HELP vkftpd_active_connections Open sessions.
+# TYPE vkftpd_active_connections gauge
+vkftpd_active_connections 3
+# HELP vkftpd_auth_duration_seconds Login time.
+# TYPE vkftpd_auth_duration_seconds histogram
+vkftpd_auth_duration_seconds_bucket{result="success",le="0.1"} 1
+vkftpd_auth_duration_seconds_bucket{result="success",le="1"} 2
+vkftpd_auth_duration_seconds_bucket{result="success",le="+Inf"} 3
+vkftpd_auth_duration_seconds_sum{result="success"} 7.55
+vkftpd_auth_duration_seconds_count{result="success"} 3
+`
+	assert.Equal(t, want, out.String())
+}
+
+func TestRegistry_Duplicate(t *testing.T) {
+	r := NewRegistry()
+	r.NewCounter("vkftpd_logins_total", "Logins.")
+	defer func() {
+		assert.True(t, recover() != nil)
+	}()
+	r.NewHistogram("vkftpd_logins_total", "Logins.", DurationBuckets)
+}
+
+func TestNilMetrics(t *testing.T) {
+	var c *Counter
+	var h *Histogram
+	c.Add(5)
+	h.Observe(1)
+	assert.Equal(t, int64(0), c.Value())
+	assert.Equal(t, uint64(0), h.Count())
+}
+
+func TestHistogram_Concurrent(t *testing.T) {
+	h := NewRegistry().NewHistogram("vkftpd_test_seconds", "Test.", DurationBuckets)
+	var wg sync.WaitGroup
+	for g := 0; g < 8; g++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for i := 0; i < 1000; i++ {
+				h.Observe(0.001)
+			}
+		}()
+	}
+	wg.Wait()
+	assert.Equal(t, uint64(8000), h.Count())
+}
+
+func BenchmarkHistogramObserve(b *testing.B) {
+	h := NewRegistry().NewHistogram("vkftpd_test_seconds", "Test.", DurationBuckets)
+	b.ReportAllocs()
+	b.RunParallel(func(pb *testing.PB) {
+		for pb.Next() {
+			h.Observe(0.003)
+		}
+	})
+}
+
+func TestHistogramSnapshot(t *testing.T) {
+	h := newHistogram([]float64{0.001, 0.01, 0.1})
+	assert.Equal(t, 0.0, h.Snapshot().Quantile(0.99))
+	assert.Equal(t, uint64(0), (*Histogram)(nil).Snapshot().Count())
+
+	for i := 0; i < 98; i++ {
+		h.Observe(0.0005)
+	}
+	h.Observe(0.005)
+	h.Observe(0.05)
+	before := h.Snapshot()
+
+	assert.Equal(t, uint64(100), before.Count())
+	assert.Equal(t, 0.001, before.Quantile(0.5))
+	assert.Equal(t, 0.01, before.Quantile(0.99))
+	assert.Equal(t, 0.1, before.Quantile(1))
+
+	// Only what was observed since the earlier snapshot counts
+	h.Observe(5)
+	h.Observe(0.05)
+	since := h.Snapshot().Sub(before)
+	assert.Equal(t, uint64(2), since.Count())
+	assert.Equal(t, 0.1, since.Quantile(0.5))
+	// past the last bound
+	assert.Equal(t, 0.1, since.Quantile(1))
+
+	other := newHistogram([]float64{0.001, 0.01, 0.1})
+	other.Observe(0.0001)
+	assert.Equal(t, uint64(3), since.Add(other.Snapshot()).Count())
+	assert.Equal(t, uint64(2), HistogramSnapshot{}.Add(since).Count())
+}
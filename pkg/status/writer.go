@@ -2,13 +2,16 @@ package status
 
 import (
 	"fmt"
+	"math"
 	"os"
 	"path/filepath"
-	"runtime"
+	rtmetrics "runtime/metrics"
+	"strconv"
 	"sync"
 	"time"
 
 	"github.com/mmcdole/viking-ftpd/pkg/logging"
+	"github.com/mmcdole/viking-ftpd/pkg/metrics"
 )
 
 // MetricsProvider defines the interface for collecting runtime metrics
@@ -18,6 +21,63 @@ type MetricsProvider interface {
 	GetStartTime() time.Time
 }
 
+// PermissionCacheMetricsProvider is implemented by metrics providers that
+// also report session permission cache usage. It is optional; the cache
+// fields are omitted from the running file when the provider lacks it.
+type PermissionCacheMetricsProvider interface {
+	GetPermissionCacheHits() int64
+	GetPermissionCacheMisses() int64
+}
+
+// VerificationMetricsProvider is implemented by metrics providers that also
+// report the password verification queue. It is optional, like
+// PermissionCacheMetricsProvider.
+type VerificationMetricsProvider interface {
+	GetVerifyQueueDepth() int
+	GetVerifyWaitAverage() time.Duration
+	GetVerifyWaitMax() time.Duration
+	GetVerifyRejected() int64
+}
+
+// AdmissionMetricsProvider is implemented by metrics providers that also
+// report session admission. It is optional, like
+// PermissionCacheMetricsProvider.
+type AdmissionMetricsProvider interface {
+	GetPendingLogins() int
+	GetRejectedConnections() int64
+	GetRejectedLogins() int64
+}
+
+// TLSMetricsProvider is implemented by metrics providers that also report
+// TLS handshakes. It is optional, like PermissionCacheMetricsProvider.
+type TLSMetricsProvider interface {
+	GetTLSHandshakes() int64
+	GetTLSResumedHandshakes() int64
+}
+
+// AuthLatencyMetricsProvider is implemented by metrics providers that also
+// report how long logins take to verify, as histogram bucket counts since
+// the server started. It is optional, like PermissionCacheMetricsProvider.
+type AuthLatencyMetricsProvider interface {
+	GetAuthLatency() metrics.HistogramSnapshot
+}
+
+// ListingCacheMetricsProvider is implemented by metrics providers that also
+// report directory listing cache usage. It is optional, like
+// PermissionCacheMetricsProvider.
+type ListingCacheMetricsProvider interface {
+	GetListingCacheHits() int64
+	GetListingCacheMisses() int64
+}
+
+// AccessTreeMetricsProvider is implemented by metrics providers that also
+// report which access trees are in use. It is optional, like
+// PermissionCacheMetricsProvider.
+type AccessTreeMetricsProvider interface {
+	GetAccessGeneration() uint64
+	GetAccessLoadedAt() time.Time
+}
+
 // Writer manages status files for daemon health monitoring
 type Writer struct {
 	dir             string
@@ -26,6 +86,14 @@ type Writer struct {
 	version         string
 	metricsProvider MetricsProvider
 
+	// Heartbeat state, reused from one running file to the next
+	samples     []rtmetrics.Sample
+	buf         []byte
+	nextRunning *os.File                     // temp file for the next running file
+	gcPauses    [2]metrics.HistogramSnapshot // now and at the previous heartbeat
+	gcRecent    metrics.HistogramSnapshot    // pauses between the two
+	authLatency metrics.HistogramSnapshot    // at the previous heartbeat
+
 	stopCh       chan struct{}
 	wg           sync.WaitGroup
 	shutdownOnce sync.Once
@@ -43,6 +111,8 @@ func New(dir string, updateInterval time.Duration, version string) (*Writer, err
 		updateInterval: updateInterval,
 		pid:            os.Getpid(),
 		version:        version,
+		samples:        newRuntimeSamples(),
+		buf:            make([]byte, 0, 1024),
 		stopCh:         make(chan struct{}),
 	}, nil
 }
@@ -103,6 +173,7 @@ func (w *Writer) StartHeartbeat() {
 	w.wg.Add(1)
 	go func() {
 		defer w.wg.Done()
+		defer w.closeRunningFile()
 
 		ticker := time.NewTicker(w.updateInterval)
 		defer ticker.Stop()
@@ -160,7 +231,86 @@ func (w *Writer) Shutdown(reason string) error {
 	return shutdownErr
 }
 
-// writeRunningFile writes the current runtime status to the running file
+// runtimeSamples are the runtime/metrics values the heartbeat reads. Unlike
+// runtime.ReadMemStats, reading them does not stop the world.
+var runtimeSamples = [...]string{
+	sampleHeapObjects: "/memory/classes/heap/objects:bytes",
+	sampleTotalMemory: "/memory/classes/total:bytes",
+	sampleGoroutines:  "/sched/goroutines:goroutines",
+	sampleGCCPU:       "/cpu/classes/gc/total:cpu-seconds",
+	sampleTotalCPU:    "/cpu/classes/total:cpu-seconds",
+	sampleGCCycles:    "/gc/cycles/total:gc-cycles",
+	sampleGCPauses:    "/gc/pauses:seconds",
+}
+
+const (
+	sampleHeapObjects = iota
+	sampleTotalMemory
+	sampleGoroutines
+	sampleGCCPU
+	sampleTotalCPU
+	sampleGCCycles
+	sampleGCPauses
+)
+
+func newRuntimeSamples() []rtmetrics.Sample {
+	samples := make([]rtmetrics.Sample, len(runtimeSamples))
+	for i, name := range runtimeSamples {
+		samples[i].Name = name
+	}
+	return samples
+}
+
+// sampleUint64 returns a sample's value, or 0 if the runtime lacks it
+func sampleUint64(s rtmetrics.Sample) uint64 {
+	if s.Value.Kind() != rtmetrics.KindUint64 {
+		return 0
+	}
+	return s.Value.Uint64()
+}
+
+// sampleFloat64 returns a sample's value, or 0 if the runtime lacks it
+func sampleFloat64(s rtmetrics.Sample) float64 {
+	if s.Value.Kind() != rtmetrics.KindFloat64 {
+		return 0
+	}
+	return s.Value.Float64()
+}
+
+// sampleHistogram copies a histogram sample into dst, reusing its counts,
+// in the form of a metrics.HistogramSnapshot. It is empty if the runtime
+// lacks the sample.
+func sampleHistogram(s rtmetrics.Sample, dst metrics.HistogramSnapshot) metrics.HistogramSnapshot {
+	if s.Value.Kind() != rtmetrics.KindFloat64Histogram {
+		return metrics.HistogramSnapshot{}
+	}
+	h := s.Value.Float64Histogram()
+	// Bucket i spans Buckets[i] to Buckets[i+1], and the last normally
+	// ends at +Inf, which HistogramSnapshot leaves implied
+	counts := append(dst.Counts[:0], h.Counts...)
+	bounds := h.Buckets[1:]
+	if n := len(bounds); n > 0 && math.IsInf(bounds[n-1], 1) {
+		bounds = bounds[:n-1]
+	} else {
+		counts = append(counts, 0)
+	}
+	return metrics.HistogramSnapshot{Bounds: bounds, Counts: counts}
+}
+
+// subHistogram is metrics.HistogramSnapshot.Sub reusing the counts of dst
+func subHistogram(dst, s, prev metrics.HistogramSnapshot) metrics.HistogramSnapshot {
+	counts := append(dst.Counts[:0], s.Counts...)
+	if len(prev.Counts) == len(counts) {
+		for i := range counts {
+			counts[i] -= min(counts[i], prev.Counts[i])
+		}
+	}
+	return metrics.HistogramSnapshot{Bounds: s.Bounds, Counts: counts}
+}
+
+// writeRunningFile writes the current runtime status to the running file.
+// It is only called from the heartbeat goroutine, which owns the sample and
+// content buffers it reuses.
 func (w *Writer) writeRunningFile() error {
 	now := time.Now()
 
@@ -179,38 +329,167 @@ func (w *Writer) writeRunningFile() error {
 		uptime = int64(now.Sub(startTime).Seconds())
 	}
 
-	// Collect memory statistics
-	var memStats runtime.MemStats
-	runtime.ReadMemStats(&memStats)
+	rtmetrics.Read(w.samples)
+	goroutines := sampleUint64(w.samples[sampleGoroutines])
+	gcCPUFraction := 0.0
+	if total := sampleFloat64(w.samples[sampleTotalCPU]); total > 0 {
+		gcCPUFraction = sampleFloat64(w.samples[sampleGCCPU]) / total
+	}
 
-	content := fmt.Sprintf(`timestamp_unix: %d
-uptime_seconds: %d
-active_connections: %d
-total_connections: %d
-memory_alloc_mb: %d
-memory_sys_mb: %d
-goroutines: %d
-gc_cpu_fraction: %.6f
-`,
-		now.Unix(),
-		uptime,
-		activeConnections,
-		totalConnections,
-		memStats.Alloc/1024/1024,
-		memStats.Sys/1024/1024,
-		runtime.NumGoroutine(),
-		memStats.GCCPUFraction,
-	)
+	b := w.buf[:0]
+	b = appendInt(b, "timestamp_unix", now.Unix())
+	b = appendInt(b, "uptime_seconds", uptime)
+	b = appendInt(b, "active_connections", int64(activeConnections))
+	b = appendInt(b, "total_connections", totalConnections)
+	b = appendInt(b, "memory_alloc_mb", int64(sampleUint64(w.samples[sampleHeapObjects])/1024/1024))
+	b = appendInt(b, "memory_sys_mb", int64(sampleUint64(w.samples[sampleTotalMemory])/1024/1024))
+	b = appendInt(b, "goroutines", int64(goroutines))
+	b = appendFloat(b, "gc_cpu_fraction", gcCPUFraction, 6)
+	b = appendInt(b, "gc_cycles", int64(sampleUint64(w.samples[sampleGCCycles])))
+
+	// Pause and login quantiles cover the time since the previous heartbeat
+	w.gcPauses[0], w.gcPauses[1] = sampleHistogram(w.samples[sampleGCPauses], w.gcPauses[1]), w.gcPauses[0]
+	w.gcRecent = subHistogram(w.gcRecent, w.gcPauses[0], w.gcPauses[1])
+	recent := w.gcRecent
+	b = appendInt(b, "gc_pause_p50_us", int64(recent.Quantile(0.5)*1e6))
+	b = appendInt(b, "gc_pause_p99_us", int64(recent.Quantile(0.99)*1e6))
+	b = appendInt(b, "gc_pause_max_us", int64(recent.Quantile(1)*1e6))
+
+	if authMetrics, ok := w.metricsProvider.(AuthLatencyMetricsProvider); ok {
+		latency := authMetrics.GetAuthLatency()
+		recent := latency.Sub(w.authLatency)
+		w.authLatency = latency
+		b = appendInt(b, "auth_count", int64(recent.Count()))
+		b = appendFloat(b, "auth_p50_ms", recent.Quantile(0.5)*1000, 3)
+		b = appendFloat(b, "auth_p99_ms", recent.Quantile(0.99)*1000, 3)
+	}
 
-	path := filepath.Join(w.dir, "running")
-	if err := w.atomicWrite(path, []byte(content)); err != nil {
+	if cacheMetrics, ok := w.metricsProvider.(PermissionCacheMetricsProvider); ok {
+		hits, misses := cacheMetrics.GetPermissionCacheHits(), cacheMetrics.GetPermissionCacheMisses()
+		b = appendInt(b, "permission_cache_hits", hits)
+		b = appendInt(b, "permission_cache_misses", misses)
+		b = appendFloat(b, "permission_cache_hit_ratio", ratio(hits, hits+misses), 3)
+	}
+
+	if listingMetrics, ok := w.metricsProvider.(ListingCacheMetricsProvider); ok {
+		hits, misses := listingMetrics.GetListingCacheHits(), listingMetrics.GetListingCacheMisses()
+		b = appendInt(b, "listing_cache_hits", hits)
+		b = appendInt(b, "listing_cache_misses", misses)
+		b = appendFloat(b, "listing_cache_hit_ratio", ratio(hits, hits+misses), 3)
+	}
+
+	if accessMetrics, ok := w.metricsProvider.(AccessTreeMetricsProvider); ok {
+		age := int64(-1)
+		if loadedAt := accessMetrics.GetAccessLoadedAt(); !loadedAt.IsZero() {
+			age = int64(now.Sub(loadedAt).Seconds())
+		}
+		b = appendInt(b, "access_generation", int64(accessMetrics.GetAccessGeneration()))
+		b = appendInt(b, "access_age_seconds", age)
+	}
+
+	if verifyMetrics, ok := w.metricsProvider.(VerificationMetricsProvider); ok {
+		b = appendInt(b, "verify_queue_depth", int64(verifyMetrics.GetVerifyQueueDepth()))
+		b = appendInt(b, "verify_wait_avg_ms", verifyMetrics.GetVerifyWaitAverage().Milliseconds())
+		b = appendInt(b, "verify_wait_max_ms", verifyMetrics.GetVerifyWaitMax().Milliseconds())
+		b = appendInt(b, "verify_rejected", verifyMetrics.GetVerifyRejected())
+	}
+
+	if admissionMetrics, ok := w.metricsProvider.(AdmissionMetricsProvider); ok {
+		b = appendInt(b, "pending_logins", int64(admissionMetrics.GetPendingLogins()))
+		b = appendInt(b, "rejected_connections", admissionMetrics.GetRejectedConnections())
+		b = appendInt(b, "rejected_logins", admissionMetrics.GetRejectedLogins())
+	}
+
+	if tlsMetrics, ok := w.metricsProvider.(TLSMetricsProvider); ok {
+		handshakes := tlsMetrics.GetTLSHandshakes()
+		resumed := tlsMetrics.GetTLSResumedHandshakes()
+		b = appendInt(b, "tls_handshakes", handshakes)
+		b = appendInt(b, "tls_resumed", resumed)
+		b = appendFloat(b, "tls_resume_ratio", ratio(resumed, handshakes), 3)
+	}
+	w.buf = b
+
+	if err := w.replaceRunningFile(b); err != nil {
 		return fmt.Errorf("failed to write running: %w", err)
 	}
 
-	logging.App.Debug("Updated running file", "active_connections", activeConnections, "goroutines", runtime.NumGoroutine())
+	logging.App.Debug("Updated running file", "active_connections", activeConnections, "goroutines", goroutines)
+	return nil
+}
+
+// appendInt appends a "key: value" line
+func appendInt(b []byte, key string, v int64) []byte {
+	b = append(b, key...)
+	b = append(b, ": "...)
+	b = strconv.AppendInt(b, v, 10)
+	return append(b, '\n')
+}
+
+// appendFloat appends a "key: value" line with prec decimals
+func appendFloat(b []byte, key string, v float64, prec int) []byte {
+	b = append(b, key...)
+	b = append(b, ": "...)
+	b = strconv.AppendFloat(b, v, 'f', prec, 64)
+	return append(b, '\n')
+}
+
+// ratio returns part/whole, or 0 if whole is 0
+func ratio(part, whole int64) float64 {
+	if whole <= 0 {
+		return 0
+	}
+	return float64(part) / float64(whole)
+}
+
+// replaceRunningFile atomically replaces the running file with content.
+// Renaming the temp file over the running file consumes its name, so the
+// next one is opened right after, and a heartbeat then only writes, closes
+// and renames a file that is already open.
+func (w *Writer) replaceRunningFile(content []byte) error {
+	path := filepath.Join(w.dir, "running")
+	tmpPath := path + ".tmp"
+
+	f := w.nextRunning
+	w.nextRunning = nil
+	if f == nil {
+		var err error
+		if f, err = createTemp(tmpPath); err != nil {
+			return err
+		}
+	}
+
+	_, err := f.Write(content)
+	if closeErr := f.Close(); err == nil {
+		err = closeErr
+	}
+	if err == nil {
+		err = os.Rename(tmpPath, path)
+	}
+	if err != nil {
+		os.Remove(tmpPath) // Clean up temp file on error
+		return err
+	}
+
+	// A failure here is retried by the next heartbeat
+	w.nextRunning, _ = createTemp(tmpPath)
 	return nil
 }
 
+// closeRunningFile closes and removes the temp file opened for the next
+// heartbeat
+func (w *Writer) closeRunningFile() {
+	if w.nextRunning != nil {
+		w.nextRunning.Close()
+		os.Remove(w.nextRunning.Name())
+		w.nextRunning = nil
+	}
+}
+
+// createTemp creates or truncates a temp file for writing
+func createTemp(path string) (*os.File, error) {
+	return os.OpenFile(path, os.O_WRONLY|os.O_CREATE|os.O_TRUNC, 0644)
+}
+
 // atomicWrite writes content to a file atomically by writing to a temp file
 // and then renaming it. This prevents readers from seeing partial writes.
 func (w *Writer) atomicWrite(path string, content []byte) error {
@@ -6,6 +6,8 @@ import (
 	"strings"
 	"testing"
 	"time"
+
+	"github.com/mmcdole/viking-ftpd/pkg/metrics"
 )
 
 // mockMetricsProvider implements MetricsProvider for testing
@@ -175,6 +177,10 @@ func TestWriteRunningFile(t *testing.T) {
 		"memory_sys_mb:",
 		"goroutines:",
 		"gc_cpu_fraction:",
+		"gc_cycles:",
+		"gc_pause_p50_us:",
+		"gc_pause_p99_us:",
+		"gc_pause_max_us:",
 	}
 
 	for _, field := range requiredFields {
@@ -189,6 +195,249 @@ func TestWriteRunningFile(t *testing.T) {
 	}
 }
 
+// mockCacheMetricsProvider also reports permission cache counters
+type mockCacheMetricsProvider struct {
+	mockMetricsProvider
+	hits   int64
+	misses int64
+}
+
+func (m *mockCacheMetricsProvider) GetPermissionCacheHits() int64 {
+	return m.hits
+}
+
+func (m *mockCacheMetricsProvider) GetPermissionCacheMisses() int64 {
+	return m.misses
+}
+
+func TestWriteRunningFileCacheMetrics(t *testing.T) {
+	tmpDir := t.TempDir()
+
+	w, err := New(tmpDir, 10*time.Second, "v1.0.0")
+	if err != nil {
+		t.Fatalf("Failed to create writer: %v", err)
+	}
+
+	// Without cache metrics the fields are omitted
+	w.SetMetricsProvider(&mockMetricsProvider{startTime: time.Now()})
+	if err := w.writeRunningFile(); err != nil {
+		t.Fatalf("Failed to write running file: %v", err)
+	}
+	content, err := os.ReadFile(filepath.Join(tmpDir, "running"))
+	if err != nil {
+		t.Fatalf("Failed to read running file: %v", err)
+	}
+	if strings.Contains(string(content), "permission_cache_hits:") {
+		t.Error("Running file should not contain cache fields without a cache metrics provider")
+	}
+
+	w.SetMetricsProvider(&mockCacheMetricsProvider{
+		mockMetricsProvider: mockMetricsProvider{startTime: time.Now()},
+		hits:                1234,
+		misses:              56,
+	})
+	if err := w.writeRunningFile(); err != nil {
+		t.Fatalf("Failed to write running file: %v", err)
+	}
+	content, err = os.ReadFile(filepath.Join(tmpDir, "running"))
+	if err != nil {
+		t.Fatalf("Failed to read running file: %v", err)
+	}
+
+	for _, field := range []string{"permission_cache_hits: 1234", "permission_cache_misses: 56", "permission_cache_hit_ratio: 0.957"} {
+		if !strings.Contains(string(content), field) {
+			t.Errorf("Running file missing field: %s", field)
+		}
+	}
+}
+
+// mockRuntimeMetricsProvider also reports login latency, listing cache
+// usage and the access trees in use
+type mockRuntimeMetricsProvider struct {
+	mockMetricsProvider
+	auth     *metrics.Histogram
+	loadedAt time.Time
+}
+
+func (m *mockRuntimeMetricsProvider) GetAuthLatency() metrics.HistogramSnapshot {
+	return m.auth.Snapshot()
+}
+
+func (m *mockRuntimeMetricsProvider) GetListingCacheHits() int64 { return 3 }
+
+func (m *mockRuntimeMetricsProvider) GetListingCacheMisses() int64 { return 1 }
+
+func (m *mockRuntimeMetricsProvider) GetAccessGeneration() uint64 { return 9 }
+
+func (m *mockRuntimeMetricsProvider) GetAccessLoadedAt() time.Time { return m.loadedAt }
+
+func TestWriteRunningFileRuntimeMetrics(t *testing.T) {
+	tmpDir := t.TempDir()
+
+	w, err := New(tmpDir, 10*time.Second, "v1.0.0")
+	if err != nil {
+		t.Fatalf("Failed to create writer: %v", err)
+	}
+
+	auth := metrics.NewRegistry().NewHistogram("auth", "Login time.", metrics.DurationBuckets)
+	w.SetMetricsProvider(&mockRuntimeMetricsProvider{
+		mockMetricsProvider: mockMetricsProvider{startTime: time.Now()},
+		auth:                auth,
+		loadedAt:            time.Now().Add(-90 * time.Second),
+	})
+
+	read := func() string {
+		t.Helper()
+		if err := w.writeRunningFile(); err != nil {
+			t.Fatalf("Failed to write running file: %v", err)
+		}
+		content, err := os.ReadFile(filepath.Join(tmpDir, "running"))
+		if err != nil {
+			t.Fatalf("Failed to read running file: %v", err)
+		}
+		return string(content)
+	}
+
+	for i := 0; i < 99; i++ {
+		auth.Observe(0.002)
+	}
+	auth.Observe(0.2)
+	content := read()
+	for _, field := range []string{
+		"auth_count: 100",
+		"auth_p50_ms: 2.500",
+		"auth_p99_ms: 2.500",
+		"listing_cache_hits: 3",
+		"listing_cache_misses: 1",
+		"listing_cache_hit_ratio: 0.750",
+		"access_generation: 9",
+		"access_age_seconds: 9",
+	} {
+		if !strings.Contains(content, field) {
+			t.Errorf("Running file missing field: %s", field)
+		}
+	}
+
+	// Login quantiles only cover the logins since the previous heartbeat
+	auth.Observe(0.2)
+	content = read()
+	for _, field := range []string{"auth_count: 1", "auth_p99_ms: 250.000"} {
+		if !strings.Contains(content, field) {
+			t.Errorf("Running file missing field: %s", field)
+		}
+	}
+	content = read()
+	for _, field := range []string{"auth_count: 0", "auth_p99_ms: 0.000"} {
+		if !strings.Contains(content, field) {
+			t.Errorf("Running file missing field: %s", field)
+		}
+	}
+}
+
+// mockVerifyMetricsProvider also reports the password verification queue
+type mockVerifyMetricsProvider struct {
+	mockMetricsProvider
+}
+
+func (m *mockVerifyMetricsProvider) GetVerifyQueueDepth() int { return 7 }
+
+func (m *mockVerifyMetricsProvider) GetVerifyWaitAverage() time.Duration {
+	return 250 * time.Millisecond
+}
+
+func (m *mockVerifyMetricsProvider) GetVerifyWaitMax() time.Duration { return 2 * time.Second }
+
+func (m *mockVerifyMetricsProvider) GetVerifyRejected() int64 { return 42 }
+
+func TestWriteRunningFileVerifyMetrics(t *testing.T) {
+	tmpDir := t.TempDir()
+
+	w, err := New(tmpDir, 10*time.Second, "v1.0.0")
+	if err != nil {
+		t.Fatalf("Failed to create writer: %v", err)
+	}
+	w.SetMetricsProvider(&mockVerifyMetricsProvider{mockMetricsProvider{startTime: time.Now()}})
+	if err := w.writeRunningFile(); err != nil {
+		t.Fatalf("Failed to write running file: %v", err)
+	}
+	content, err := os.ReadFile(filepath.Join(tmpDir, "running"))
+	if err != nil {
+		t.Fatalf("Failed to read running file: %v", err)
+	}
+
+	for _, field := range []string{"verify_queue_depth: 7", "verify_wait_avg_ms: 250", "verify_wait_max_ms: 2000", "verify_rejected: 42"} {
+		if !strings.Contains(string(content), field) {
+			t.Errorf("Running file missing field: %s", field)
+		}
+	}
+}
+
+// mockAdmissionMetricsProvider also reports session admission
+type mockAdmissionMetricsProvider struct {
+	mockMetricsProvider
+}
+
+func (m *mockAdmissionMetricsProvider) GetPendingLogins() int { return 2 }
+
+func (m *mockAdmissionMetricsProvider) GetRejectedConnections() int64 { return 17 }
+
+func (m *mockAdmissionMetricsProvider) GetRejectedLogins() int64 { return 3 }
+
+func TestWriteRunningFileAdmissionMetrics(t *testing.T) {
+	tmpDir := t.TempDir()
+
+	w, err := New(tmpDir, 10*time.Second, "v1.0.0")
+	if err != nil {
+		t.Fatalf("Failed to create writer: %v", err)
+	}
+	w.SetMetricsProvider(&mockAdmissionMetricsProvider{mockMetricsProvider{startTime: time.Now()}})
+	if err := w.writeRunningFile(); err != nil {
+		t.Fatalf("Failed to write running file: %v", err)
+	}
+	content, err := os.ReadFile(filepath.Join(tmpDir, "running"))
+	if err != nil {
+		t.Fatalf("Failed to read running file: %v", err)
+	}
+
+	for _, field := range []string{"pending_logins: 2", "rejected_connections: 17", "rejected_logins: 3"} {
+		if !strings.Contains(string(content), field) {
+			t.Errorf("Running file missing field: %s", field)
+		}
+	}
+}
+
+// mockTLSMetricsProvider also reports TLS handshakes
+type mockTLSMetricsProvider struct {
+	mockMetricsProvider
+}
+
+func (m *mockTLSMetricsProvider) GetTLSHandshakes() int64 { return 40 }
+
+func (m *mockTLSMetricsProvider) GetTLSResumedHandshakes() int64 { return 30 }
+
+func TestWriteRunningFileTLSMetrics(t *testing.T) {
+	tmpDir := t.TempDir()
+
+	w, err := New(tmpDir, 10*time.Second, "v1.0.0")
+	if err != nil {
+		t.Fatalf("Failed to create writer: %v", err)
+	}
+	w.SetMetricsProvider(&mockTLSMetricsProvider{mockMetricsProvider{startTime: time.Now()}})
+	if err := w.writeRunningFile(); err != nil {
+		t.Fatalf("Failed to write running file: %v", err)
+	}
+	content, err := os.ReadFile(filepath.Join(tmpDir, "running"))
+	if err != nil {
+		t.Fatalf("Failed to read running file: %v", err)
+	}
+
+	for _, field := range []string{"tls_handshakes: 40", "tls_resumed: 30", "tls_resume_ratio: 0.750"} {
+		if !strings.Contains(string(content), field) {
+			t.Errorf("Running file missing field: %s", field)
+		}
+	}
+}
+
 func TestHeartbeat(t *testing.T) {
 	tmpDir := t.TempDir()
 
@@ -251,6 +500,59 @@ func TestHeartbeat(t *testing.T) {
 	if string(content2) != string(content3) {
 		t.Error("Running file was updated after heartbeat was stopped")
 	}
+
+	// and the temp file it kept open is gone
+	if _, err := os.Stat(path + ".tmp"); !os.IsNotExist(err) {
+		t.Error("Temp file was left behind after heartbeat was stopped")
+	}
+}
+
+func TestRunningFileTempIsReused(t *testing.T) {
+	tmpDir := t.TempDir()
+
+	w, err := New(tmpDir, 10*time.Second, "v1.0.0")
+	if err != nil {
+		t.Fatalf("Failed to create writer: %v", err)
+	}
+	w.SetMetricsProvider(&mockMetricsProvider{activeConnections: 1, startTime: time.Now()})
+
+	// Each heartbeat leaves the temp file for the next one open
+	for i := 0; i < 3; i++ {
+		if err := w.writeRunningFile(); err != nil {
+			t.Fatalf("Failed to write running file: %v", err)
+		}
+		if w.nextRunning == nil {
+			t.Fatal("Expected the next temp file to be open")
+		}
+	}
+	content, err := os.ReadFile(filepath.Join(tmpDir, "running"))
+	if err != nil {
+		t.Fatalf("Failed to read running file: %v", err)
+	}
+	if !strings.Contains(string(content), "active_connections: 1\n") {
+		t.Errorf("Unexpected running file: %s", content)
+	}
+
+	w.closeRunningFile()
+	if _, err := os.Stat(filepath.Join(tmpDir, "running.tmp")); !os.IsNotExist(err) {
+		t.Error("Temp file was not removed")
+	}
+}
+
+func BenchmarkWriteRunningFile(b *testing.B) {
+	w, err := New(b.TempDir(), 10*time.Second, "v1.0.0")
+	if err != nil {
+		b.Fatal(err)
+	}
+	w.SetMetricsProvider(&mockMetricsProvider{startTime: time.Now()})
+	defer w.closeRunningFile()
+
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		if err := w.writeRunningFile(); err != nil {
+			b.Fatal(err)
+		}
+	}
 }
 
 func TestAtomicWrite(t *testing.T) {
@@ -5,7 +5,10 @@ import (
 	"os"
 	"path/filepath"
 	"strings"
+	"sync"
+	"sync/atomic"
 
+	"github.com/mmcdole/viking-ftpd/pkg/filewatch"
 	"github.com/mmcdole/viking-ftpd/pkg/logging"
 	"github.com/mmcdole/viking-ftpd/pkg/lpc"
 )
@@ -21,12 +24,115 @@ const (
 type FileSource struct {
 	// rootDir is the path to the directory containing user subdirectories
 	rootDir string
+
+	// detectChanges keeps parsed characters and only re-parses a file once
+	// its stamp changes; watched additionally trusts kept characters until a
+	// watch notification invalidates them, skipping even the stat
+	detectChanges bool
+	watched       atomic.Bool
+	forgets       atomic.Uint64 // bumped whenever kept characters are dropped
+	onChange      func(username string)
+
+	mu     sync.RWMutex
+	parsed map[string]parsedCharacter
+}
+
+// parsedCharacter is a character kept by change detection along with the
+// stamp of the file it was parsed from
+type parsedCharacter struct {
+	stamp filewatch.Stamp
+	user  *User
 }
 
 // NewFileSource creates a new FileSource
 func NewFileSource(rootDir string) *FileSource {
 	return &FileSource{
 		rootDir: rootDir,
+		parsed:  make(map[string]parsedCharacter),
+	}
+}
+
+// SetChangeDetection controls whether character files are re-parsed on every
+// load. When enabled, a parsed character is reused for as long as its file's
+// identity, size and modification time are unchanged. It should be called
+// before the source is used.
+func (s *FileSource) SetChangeDetection(enabled bool) {
+	s.detectChanges = enabled
+}
+
+// SetChangeHandler registers fn to be called with the username of every
+// character file a watch notification reports as changed, or with an empty
+// username when any character may have changed. Caches layered on top of the
+// source use it to drop stale entries. It should be called before Watch.
+func (s *FileSource) SetChangeHandler(fn func(username string)) {
+	s.onChange = fn
+}
+
+// Watch registers the character directories with w so that kept characters
+// are dropped as soon as their file changes, and no longer need to be
+// examined on each load. It implies change detection.
+func (s *FileSource) Watch(w *filewatch.Watcher) error {
+	s.detectChanges = true
+
+	entries, err := os.ReadDir(s.rootDir)
+	if err != nil {
+		return fmt.Errorf("listing character directory: %w", err)
+	}
+
+	// Watch the root too, so letter directories created later are picked up
+	if err := w.WatchDir(s.rootDir, func(name string) {
+		if name == "" {
+			s.forgetAll()
+			return
+		}
+		dir := filepath.Join(s.rootDir, name)
+		if fi, err := os.Stat(dir); err == nil && fi.IsDir() {
+			if err := w.WatchDir(dir, s.forgetCharacter); err != nil {
+				logging.App.Warn("Failed to watch character directory", "dir", dir, "error", err)
+			}
+		}
+	}); err != nil {
+		return err
+	}
+	for _, entry := range entries {
+		if !entry.IsDir() {
+			continue
+		}
+		if err := w.WatchDir(filepath.Join(s.rootDir, entry.Name()), s.forgetCharacter); err != nil {
+			return err
+		}
+	}
+
+	// Characters parsed before the watch started may already be stale
+	s.forgetAll()
+	s.watched.Store(true)
+	return nil
+}
+
+// forgetCharacter drops the kept character for a changed file name ("drake.o")
+func (s *FileSource) forgetCharacter(name string) {
+	if name == "" {
+		s.forgetAll()
+		return
+	}
+	username := strings.TrimSuffix(name, ".o")
+	s.mu.Lock()
+	delete(s.parsed, username)
+	s.forgets.Add(1)
+	s.mu.Unlock()
+	if s.onChange != nil {
+		s.onChange(username)
+	}
+}
+
+// forgetAll drops every kept character
+func (s *FileSource) forgetAll() {
+	s.mu.Lock()
+	s.parsed = make(map[string]parsedCharacter)
+	s.forgets.Add(1)
+	s.mu.Unlock()
+	if s.onChange != nil {
+		s.onChange("")
 	}
 }
 
@@ -45,57 +151,146 @@ func (s *FileSource) getCharacterPath(username string) string {
 func (s *FileSource) LoadUser(username string) (*User, error) {
 	path := s.getCharacterPath(username)
 	if path == "" {
-		logging.App.Debug("Invalid username provided", "username", username)
+		if logging.App.IsDebug() {
+			logging.App.Debug("Invalid username provided", "username", username)
+		}
 		return nil, fmt.Errorf("invalid username")
 	}
 
+	if !s.detectChanges {
+		return s.parseUser(username, path)
+	}
+
+	// Under a watch, kept characters are valid until a notification says otherwise
+	if s.watched.Load() {
+		s.mu.RLock()
+		kept, ok := s.parsed[username]
+		s.mu.RUnlock()
+		if ok {
+			return kept.user, nil
+		}
+	}
+
+	forgets := s.forgets.Load()
+	stamp, err := filewatch.StatStamp(path)
+	if err != nil {
+		if os.IsNotExist(err) {
+			if logging.App.IsDebug() {
+				logging.App.Debug("User file not found", "username", username, "path", path)
+			}
+			return nil, ErrUserNotFound
+		}
+		if logging.App.IsDebug() {
+			logging.App.Debug("Error reading user file", "username", username, "path", path, "error", err)
+		}
+		return nil, fmt.Errorf("reading user file: %w", err)
+	}
+
+	s.mu.RLock()
+	kept, ok := s.parsed[username]
+	s.mu.RUnlock()
+	if ok && kept.stamp.Equal(stamp) {
+		return kept.user, nil
+	}
+
+	user, err := s.parseUser(username, path)
+	if err != nil {
+		return nil, err
+	}
+
+	s.mu.Lock()
+	// A notification that arrived while parsing may concern this file, so
+	// only keep the result if nothing was dropped in the meantime
+	if s.forgets.Load() == forgets {
+		s.parsed[username] = parsedCharacter{stamp: stamp, user: user}
+	}
+	s.mu.Unlock()
+	return user, nil
+}
+
+// decoderPool holds decoders for reading character files, so their read
+// buffers are reused across loads
+var decoderPool = sync.Pool{
+	New: func() interface{} {
+		return lpc.NewDecoder(nil, false) // non-strict mode for better error handling
+	},
+}
+
+// parseUser reads and parses the character file at path. The file is
+// streamed and only the password and level lines are parsed.
+func (s *FileSource) parseUser(username, path string) (*User, error) {
+	debug := logging.App.IsDebug()
+
 	// Check if file exists
-	data, err := os.ReadFile(path)
+	f, err := os.Open(path)
 	if err != nil {
 		if os.IsNotExist(err) {
-			logging.App.Debug("User file not found", "username", username, "path", path)
+			if debug {
+				logging.App.Debug("User file not found", "username", username, "path", path)
+			}
 			return nil, ErrUserNotFound
 		}
-		logging.App.Debug("Error reading user file", "username", username, "path", path, "error", err)
+		if debug {
+			logging.App.Debug("Error reading user file", "username", username, "path", path, "error", err)
+		}
 		return nil, fmt.Errorf("reading user file: %w", err)
 	}
+	defer f.Close()
 
 	// Parse LPC object
-	parser := lpc.NewObjectParser(false) // non-strict mode for better error handling
-	result, err := parser.ParseObject(string(data))
+	fields := make(map[string]interface{}, 2)
+	decoder := decoderPool.Get().(*lpc.Decoder)
+	decoder.Reset(f)
+	decoder.SetKeys(PasswordField, LevelField)
+	err = decoder.Decode(func(key string, value interface{}) error {
+		fields[key] = value
+		return nil
+	})
+	decoder.Reset(nil)
+	decoderPool.Put(decoder)
 	if err != nil {
-		logging.App.Debug("Error parsing user file", "username", username, "path", path, "error", err)
+		if debug {
+			logging.App.Debug("Error parsing user file", "username", username, "path", path, "error", err)
+		}
 		return nil, fmt.Errorf("parsing user file: %w", err)
 	}
 
 	// Extract password hash
-	passwordRaw, ok := result.Object[PasswordField]
+	passwordRaw, ok := fields[PasswordField]
 	if !ok {
-		logging.App.Debug("Password field missing in user file", "username", username, "path", path)
+		if debug {
+			logging.App.Debug("Password field missing in user file", "username", username, "path", path)
+		}
 		return nil, ErrInvalidHash
 	}
 	passwordHash, ok := passwordRaw.(string)
 	if !ok {
-		logging.App.Debug("Invalid password hash type in user file", "username", username, "path", path, "type", fmt.Sprintf("%T", passwordRaw))
+		if debug {
+			logging.App.Debug("Invalid password hash type in user file", "username", username, "path", path, "type", fmt.Sprintf("%T", passwordRaw))
+		}
 		return nil, ErrInvalidHash
 	}
 
 	// Extract level, defaulting to MORTAL_FIRST if not found
 	level := MORTAL_FIRST // Default to mortal if not found
-	if levelRaw, ok := result.Object[LevelField]; ok {
+	if levelRaw, ok := fields[LevelField]; ok {
 		switch v := levelRaw.(type) {
 		case float64:
 			level = int(v)
 		case int:
 			level = v
 		default:
-			logging.App.Debug("Invalid level type in user file", "username", username, "path", path, "type", fmt.Sprintf("%T", levelRaw))
+			if debug {
+				logging.App.Debug("Invalid level type in user file", "username", username, "path", path, "type", fmt.Sprintf("%T", levelRaw))
+			}
 		}
-	} else {
+	} else if debug {
 		logging.App.Debug("Level field missing, using default", "username", username, "path", path, "default_level", MORTAL_FIRST)
 	}
 
-	logging.App.Debug("Successfully loaded user", "username", username, "path", path, "level", level)
+	if debug {
+		logging.App.Debug("Successfully loaded user", "username", username, "path", path, "level", level)
+	}
 	return &User{
 		Username:     username,
 		PasswordHash: passwordHash,
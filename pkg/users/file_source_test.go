@@ -1,9 +1,14 @@
 package users
 
 import (
+	"errors"
 	"os"
 	"path/filepath"
 	"testing"
+	"time"
+
+	"github.com/mmcdole/viking-ftpd/pkg/filewatch"
+	"github.com/mmcdole/viking-ftpd/pkg/fixtures"
 )
 
 func TestFileSource_LoadUser(t *testing.T) {
@@ -110,3 +115,143 @@ gender 1`
 		t.Errorf("Expected default level %d, got %d", MORTAL_FIRST, user.Level)
 	}
 }
+
+func TestFileSource_ChangeDetection(t *testing.T) {
+	tempDir := t.TempDir()
+	userDir := filepath.Join(tempDir, "d")
+	if err := os.MkdirAll(userDir, 0755); err != nil {
+		t.Fatalf("Failed to create user dir: %v", err)
+	}
+	userFile := filepath.Join(userDir, "drake.o")
+	if err := os.WriteFile(userFile, []byte("password \"hash1\"\nlevel 30\n"), 0644); err != nil {
+		t.Fatalf("Failed to write test file: %v", err)
+	}
+
+	source := NewFileSource(tempDir)
+	source.SetChangeDetection(true)
+
+	first, err := source.LoadUser("drake")
+	if err != nil {
+		t.Fatalf("LoadUser failed: %v", err)
+	}
+	again, err := source.LoadUser("drake")
+	if err != nil {
+		t.Fatalf("LoadUser failed: %v", err)
+	}
+	if first != again {
+		t.Error("Unchanged character file was parsed again")
+	}
+
+	// Rewrite the file through a rename so its identity changes
+	tmpFile := userFile + ".tmp"
+	if err := os.WriteFile(tmpFile, []byte("password \"hash2\"\nlevel 31\n"), 0644); err != nil {
+		t.Fatalf("Failed to write test file: %v", err)
+	}
+	if err := os.Rename(tmpFile, userFile); err != nil {
+		t.Fatalf("Failed to replace test file: %v", err)
+	}
+
+	changed, err := source.LoadUser("drake")
+	if err != nil {
+		t.Fatalf("LoadUser failed: %v", err)
+	}
+	if changed.Level != 31 || changed.PasswordHash != "hash2" {
+		t.Errorf("Changed character not re-parsed: got level %d hash %q", changed.Level, changed.PasswordHash)
+	}
+
+	if err := os.Remove(userFile); err != nil {
+		t.Fatalf("Failed to remove test file: %v", err)
+	}
+	if _, err := source.LoadUser("drake"); err != ErrUserNotFound {
+		t.Errorf("Expected ErrUserNotFound after removal, got %v", err)
+	}
+}
+
+func TestFileSource_Watch(t *testing.T) {
+	watcher, err := filewatch.New()
+	if errors.Is(err, filewatch.ErrUnsupported) {
+		t.Skip("file watching is not supported on this platform")
+	}
+	if err != nil {
+		t.Fatalf("Failed to create watcher: %v", err)
+	}
+	defer watcher.Close()
+
+	tempDir := t.TempDir()
+	userDir := filepath.Join(tempDir, "d")
+	if err := os.MkdirAll(userDir, 0755); err != nil {
+		t.Fatalf("Failed to create user dir: %v", err)
+	}
+	userFile := filepath.Join(userDir, "drake.o")
+	if err := os.WriteFile(userFile, []byte("password \"hash1\"\nlevel 30\n"), 0644); err != nil {
+		t.Fatalf("Failed to write test file: %v", err)
+	}
+
+	source := NewFileSource(tempDir)
+	cache := NewRepository(source, time.Hour)
+	source.SetChangeHandler(cache.Invalidate)
+	if err := source.Watch(watcher); err != nil {
+		t.Fatalf("Watch failed: %v", err)
+	}
+
+	if user, err := cache.LoadUser("drake"); err != nil || user.Level != 30 {
+		t.Fatalf("LoadUser = %v, %v; want level 30", user, err)
+	}
+
+	if err := os.WriteFile(userFile, []byte("password \"hash1\"\nlevel 45\n"), 0644); err != nil {
+		t.Fatalf("Failed to write test file: %v", err)
+	}
+
+	// The change handler drops the cached entry despite the hour-long TTL
+	deadline := time.Now().Add(2 * time.Second)
+	for {
+		user, err := cache.LoadUser("drake")
+		if err != nil {
+			t.Fatalf("LoadUser failed: %v", err)
+		}
+		if user.Level == 45 {
+			break
+		}
+		if time.Now().After(deadline) {
+			t.Fatal("Watched character change was not picked up by the cache")
+		}
+		time.Sleep(5 * time.Millisecond)
+	}
+}
+
+func BenchmarkFileSource_LoadUser(b *testing.B) {
+	cfg := fixtures.DefaultConfig()
+	cfg.Wizards = 500
+	cfg.Mortals = 500
+	dir := b.TempDir()
+	if err := fixtures.WriteCharacters(dir, cfg); err != nil {
+		b.Fatal(err)
+	}
+
+	for _, detect := range []bool{false, true} {
+		name := "Parse"
+		if detect {
+			name = "ChangeDetection"
+		}
+		b.Run(name, func(b *testing.B) {
+			source := NewFileSource(dir)
+			source.SetChangeDetection(detect)
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				if _, err := source.LoadUser(fixtures.WizardName(i % cfg.Wizards)); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+
+	b.Run("Missing", func(b *testing.B) {
+		source := NewFileSource(dir)
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			if _, err := source.LoadUser("nobody"); !errors.Is(err, ErrUserNotFound) {
+				b.Fatalf("LoadUser() error = %v, want %v", err, ErrUserNotFound)
+			}
+		}
+	})
+}
@@ -9,7 +9,7 @@ import (
 // ParseUserFile parses a user file in LPC object format
 func ParseUserFile(data []byte) (*User, error) {
 	parser := lpc.NewObjectParser(false) // non-strict mode for better error handling
-	result, err := parser.ParseObject(string(data))
+	result, err := parser.ParseObjectFields(data, PasswordField, LevelField)
 	if err != nil {
 		return nil, fmt.Errorf("parsing user file: %w", err)
 	}
@@ -1,82 +1,184 @@
 package users
 
 import (
+	"container/list"
 	"sync"
 	"time"
 
 	"github.com/mmcdole/viking-ftpd/pkg/logging"
 )
 
-// Repository provides cached access to user data
+// DefaultMaxCachedUsers is the default bound on the number of users a
+// Repository keeps, counting both found and not-found entries
+const DefaultMaxCachedUsers = 4096
+
+// Repository provides cached access to user data.
+// It implements Source, so it can sit in front of a FileSource wherever a
+// Source is expected. Concurrent loads of the same user share a single call
+// to the underlying source, lookups of missing users are cached too so that
+// login sprays do not reach the disk, and the least recently used entries
+// are evicted once the cache is full.
 type Repository struct {
-	source        Source
-	cacheDuration time.Duration
+	source           Source
+	cacheDuration    time.Duration
+	negativeDuration time.Duration
+	maxEntries       int
+	prepare          func(hash string) (PreparedHash, error)
+
+	mu       sync.Mutex
+	entries  map[string]*list.Element // username -> element holding a *cacheEntry
+	lru      *list.List               // front is most recently used
+	inflight map[string]*loadCall
+	forgets  uint64 // bumped by Invalidate, so loads it overtook are not kept
+}
+
+// cacheEntry is a cached result of loading one user
+type cacheEntry struct {
+	username string
+	user     *User // nil for a cached ErrUserNotFound
+	loadedAt time.Time
+}
 
-	mu          sync.RWMutex
-	cache       map[string]*User
-	lastRefresh map[string]time.Time
+// loadCall is a load from the source that other callers can wait on
+type loadCall struct {
+	done    chan struct{}
+	user    *User
+	err     error
+	forgets uint64 // Repository.forgets when the load started
 }
 
 // NewRepository creates a new Repository
 func NewRepository(source Source, cacheDuration time.Duration) *Repository {
 	return &Repository{
-		source:        source,
-		cacheDuration: cacheDuration,
-		cache:         make(map[string]*User),
-		lastRefresh:   make(map[string]time.Time),
+		source:           source,
+		cacheDuration:    cacheDuration,
+		negativeDuration: cacheDuration,
+		maxEntries:       DefaultMaxCachedUsers,
+		entries:          make(map[string]*list.Element),
+		lru:              list.New(),
+		inflight:         make(map[string]*loadCall),
 	}
 }
 
+// SetMaxEntries bounds the number of cached users. It should be called
+// before the Repository is used.
+func (r *Repository) SetMaxEntries(n int) {
+	if n < 1 {
+		n = 1
+	}
+	r.maxEntries = n
+}
+
+// SetNegativeCacheDuration sets how long a missing user is remembered.
+// It defaults to the cache duration and should be called before the
+// Repository is used.
+func (r *Repository) SetNegativeCacheDuration(d time.Duration) {
+	r.negativeDuration = d
+}
+
+// SetPrepare registers fn to decode the password hash of every user loaded
+// from the source, so the decoded form is cached along with the user and
+// logins skip parsing it. It should be called before the Repository is used.
+func (r *Repository) SetPrepare(fn func(hash string) (PreparedHash, error)) {
+	r.prepare = fn
+}
+
+// LoadUser implements Source
+func (r *Repository) LoadUser(username string) (*User, error) {
+	return r.GetUser(username)
+}
+
 // GetUser returns user data, using cache if available
 func (r *Repository) GetUser(username string) (*User, error) {
-	// Check cache first
-	r.mu.RLock()
-	user, exists := r.cache[username]
-	lastRefresh := r.lastRefresh[username]
-	r.mu.RUnlock()
-
-	// Return cached value if still fresh
-	if exists && time.Since(lastRefresh) < r.cacheDuration {
-		logging.App.Debug("Using cached user data", "username", username, "cache_age", time.Since(lastRefresh))
-		return user, nil
+	r.mu.Lock()
+	if elem, ok := r.entries[username]; ok {
+		entry := elem.Value.(*cacheEntry)
+		if time.Since(entry.loadedAt) < r.ttl(entry) {
+			r.lru.MoveToFront(elem)
+			r.mu.Unlock()
+			if entry.user == nil {
+				return nil, ErrUserNotFound
+			}
+			return entry.user, nil
+		}
 	}
 
-	// Load from source
-	user, err := r.source.LoadUser(username)
-	if err != nil {
-		logging.App.Debug("Failed to load user from source", "username", username, "error", err)
-		return nil, err
+	// Share a load that is already in progress, unless it started before
+	// an invalidation and may have read the old character
+	if call, ok := r.inflight[username]; ok && call.forgets == r.forgets {
+		r.mu.Unlock()
+		<-call.done
+		return call.user, call.err
 	}
 
-	// Update cache
+	call := &loadCall{done: make(chan struct{}), forgets: r.forgets}
+	r.inflight[username] = call
+	r.mu.Unlock()
+
+	call.user, call.err = r.load(username)
+
 	r.mu.Lock()
-	r.cache[username] = user
-	r.lastRefresh[username] = time.Now()
+	if r.inflight[username] == call {
+		delete(r.inflight, username)
+	}
+	if r.forgets == call.forgets {
+		r.storeLocked(username, call.user, call.err)
+	}
 	r.mu.Unlock()
+	close(call.done)
 
-	logging.App.Debug("Updated user cache", "username", username)
-	return user, nil
+	return call.user, call.err
 }
 
 // RefreshUser forces a refresh of user data from the source
 func (r *Repository) RefreshUser(username string) error {
-	logging.App.Debug("Forcing user cache refresh", "username", username)
+	debug := logging.App.IsDebug()
+	if debug {
+		logging.App.Debug("Forcing user cache refresh", "username", username)
+	}
+
+	// Load without holding the lock; an invalidation meanwhile wins
+	r.mu.Lock()
+	forgets := r.forgets
+	r.mu.Unlock()
+	user, err := r.load(username)
+
+	r.mu.Lock()
+	if r.forgets == forgets {
+		r.storeLocked(username, user, err)
+	}
+	r.mu.Unlock()
 
-	// Load fresh data first before acquiring lock
-	user, err := r.source.LoadUser(username)
 	if err != nil {
-		logging.App.Debug("Failed to refresh user data", "username", username, "error", err)
+		if debug {
+			logging.App.Debug("Failed to refresh user data", "username", username, "error", err)
+		}
 		return err
 	}
+	if debug {
+		logging.App.Debug("Successfully refreshed user cache", "username", username)
+	}
+	return nil
+}
 
-	// Update cache with fresh data
+// Invalidate drops the cached entry for username, or every entry if username
+// is empty, so the next lookup goes to the source. Loads already running
+// are not cached, as they may have read the old character.
+func (r *Repository) Invalidate(username string) {
 	r.mu.Lock()
-	r.cache[username] = user
-	r.lastRefresh[username] = time.Now()
-	r.mu.Unlock()
+	defer r.mu.Unlock()
 
-	logging.App.Debug("Successfully refreshed user cache", "username", username)
-	return nil
+	r.forgets++
+
+	if username == "" {
+		r.entries = make(map[string]*list.Element)
+		r.lru.Init()
+		return
+	}
+	if elem, ok := r.entries[username]; ok {
+		r.lru.Remove(elem)
+		delete(r.entries, username)
+	}
 }
 
 // UserExists checks if a user exists
@@ -90,3 +192,71 @@ func (r *Repository) UserExists(username string) (bool, error) {
 	}
 	return true, nil
 }
+
+// load reads a user from the source and prepares its password hash
+func (r *Repository) load(username string) (*User, error) {
+	user, err := r.source.LoadUser(username)
+	if err != nil {
+		if err != ErrUserNotFound && logging.App.IsDebug() {
+			logging.App.Debug("Failed to load user from source", "username", username, "error", err)
+		}
+		return nil, err
+	}
+	if r.prepare == nil {
+		return user, nil
+	}
+
+	// Sources may hand out shared users, so prepare a copy
+	prepared, err := r.prepare(user.PasswordHash)
+	if err != nil {
+		if logging.App.IsDebug() {
+			logging.App.Debug("Failed to prepare password hash", "username", username, "error", err)
+		}
+		return user, nil
+	}
+	copied := *user
+	copied.Prepared = prepared
+	return &copied, nil
+}
+
+// ttl returns how long an entry stays fresh
+func (r *Repository) ttl(entry *cacheEntry) time.Duration {
+	if entry.user == nil {
+		return r.negativeDuration
+	}
+	return r.cacheDuration
+}
+
+// storeLocked caches the result of a load. Errors other than ErrUserNotFound
+// are not cached, and drop any previous entry so the next lookup retries.
+func (r *Repository) storeLocked(username string, user *User, err error) {
+	if err != nil && err != ErrUserNotFound {
+		if elem, ok := r.entries[username]; ok {
+			r.lru.Remove(elem)
+			delete(r.entries, username)
+		}
+		return
+	}
+	if err != nil {
+		user = nil
+	}
+
+	if elem, ok := r.entries[username]; ok {
+		entry := elem.Value.(*cacheEntry)
+		entry.user = user
+		entry.loadedAt = time.Now()
+		r.lru.MoveToFront(elem)
+		return
+	}
+
+	r.entries[username] = r.lru.PushFront(&cacheEntry{
+		username: username,
+		user:     user,
+		loadedAt: time.Now(),
+	})
+	for r.lru.Len() > r.maxEntries {
+		oldest := r.lru.Back()
+		r.lru.Remove(oldest)
+		delete(r.entries, oldest.Value.(*cacheEntry).username)
+	}
+}
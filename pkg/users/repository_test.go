@@ -1,6 +1,11 @@
 package users
 
 import (
+	"errors"
+	"fmt"
+	"strings"
+	"sync"
+	"sync/atomic"
 	"testing"
 	"time"
 )
@@ -122,3 +127,257 @@ func TestRepository(t *testing.T) {
 		}
 	})
 }
+
+// countingSource wraps a MemorySource, counting loads and optionally
+// blocking them until release is closed
+type countingSource struct {
+	*MemorySource
+	loads   atomic.Int32
+	release chan struct{}
+	err     error
+}
+
+func (s *countingSource) LoadUser(username string) (*User, error) {
+	s.loads.Add(1)
+	if s.release != nil {
+		<-s.release
+	}
+	if s.err != nil {
+		return nil, s.err
+	}
+	return s.MemorySource.LoadUser(username)
+}
+
+func TestRepository_NegativeCaching(t *testing.T) {
+	source := &countingSource{MemorySource: NewMemorySource()}
+	repository := NewRepository(source, time.Hour)
+
+	for i := 0; i < 5; i++ {
+		if _, err := repository.GetUser("ghost"); err != ErrUserNotFound {
+			t.Fatalf("expected ErrUserNotFound, got %v", err)
+		}
+	}
+	if got := source.loads.Load(); got != 1 {
+		t.Errorf("expected 1 load for repeated misses, got %d", got)
+	}
+
+	// A short negative duration lets a newly created user show up quickly
+	repository.SetNegativeCacheDuration(0)
+	source.AddUser(&User{Username: "ghost", Level: MORTAL_FIRST})
+	if _, err := repository.GetUser("ghost"); err != nil {
+		t.Errorf("expected user after negative entry expired, got %v", err)
+	}
+}
+
+func TestRepository_ErrorsAreNotCached(t *testing.T) {
+	source := &countingSource{MemorySource: NewMemorySource(), err: errors.New("disk on fire")}
+	repository := NewRepository(source, time.Hour)
+
+	for i := 0; i < 3; i++ {
+		if _, err := repository.GetUser("drake"); err == nil || err == ErrUserNotFound {
+			t.Fatalf("expected source error, got %v", err)
+		}
+	}
+	if got := source.loads.Load(); got != 3 {
+		t.Errorf("expected every lookup to retry after an error, got %d loads", got)
+	}
+}
+
+func TestRepository_SingleFlight(t *testing.T) {
+	source := &countingSource{MemorySource: NewMemorySource(), release: make(chan struct{})}
+	source.AddUser(&User{Username: "drake", Level: WIZARD})
+	repository := NewRepository(source, time.Hour)
+
+	const callers = 8
+	var wg sync.WaitGroup
+	for i := 0; i < callers; i++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			user, err := repository.GetUser("drake")
+			if err != nil || user.Level != WIZARD {
+				t.Errorf("GetUser = %v, %v", user, err)
+			}
+		}()
+	}
+
+	// Wait for the first load to start, give the rest a chance to queue up
+	for source.loads.Load() == 0 {
+		time.Sleep(time.Millisecond)
+	}
+	time.Sleep(10 * time.Millisecond)
+	close(source.release)
+	wg.Wait()
+
+	if got := source.loads.Load(); got != 1 {
+		t.Errorf("expected concurrent lookups to share 1 load, got %d", got)
+	}
+}
+
+func TestRepository_LRUBound(t *testing.T) {
+	source := &countingSource{MemorySource: NewMemorySource()}
+	for i := 0; i < 3; i++ {
+		source.AddUser(&User{Username: fmt.Sprintf("user%d", i)})
+	}
+	repository := NewRepository(source, time.Hour)
+	repository.SetMaxEntries(2)
+
+	repository.GetUser("user0")
+	repository.GetUser("user1")
+	repository.GetUser("user0") // user1 is now least recently used
+	repository.GetUser("user2") // evicts user1
+
+	source.loads.Store(0)
+	repository.GetUser("user0")
+	repository.GetUser("user2")
+	if got := source.loads.Load(); got != 0 {
+		t.Errorf("expected recently used users to stay cached, got %d loads", got)
+	}
+	repository.GetUser("user1")
+	if got := source.loads.Load(); got != 1 {
+		t.Errorf("expected evicted user to be reloaded, got %d loads", got)
+	}
+}
+
+func TestRepository_Invalidate(t *testing.T) {
+	source := &countingSource{MemorySource: NewMemorySource()}
+	source.AddUser(&User{Username: "drake", Level: WIZARD})
+	source.AddUser(&User{Username: "frost", Level: WIZARD})
+	repository := NewRepository(source, time.Hour)
+
+	repository.GetUser("drake")
+	repository.GetUser("frost")
+
+	source.AddUser(&User{Username: "drake", Level: ELDER})
+	repository.Invalidate("drake")
+	if user, _ := repository.GetUser("drake"); user.Level != ELDER {
+		t.Errorf("expected reloaded level %d after Invalidate, got %d", ELDER, user.Level)
+	}
+
+	source.loads.Store(0)
+	repository.Invalidate("")
+	repository.GetUser("drake")
+	repository.GetUser("frost")
+	if got := source.loads.Load(); got != 2 {
+		t.Errorf("expected every user to be reloaded after Invalidate(\"\"), got %d loads", got)
+	}
+}
+
+// slowFirstSource returns the user as it was when the first load started,
+// holding that load until release is closed; later loads read the current
+// user at once
+type slowFirstSource struct {
+	*MemorySource
+	started chan struct{}
+	release chan struct{}
+	calls   atomic.Int32
+}
+
+func (s *slowFirstSource) LoadUser(username string) (*User, error) {
+	user, err := s.MemorySource.LoadUser(username)
+	if s.calls.Add(1) == 1 {
+		close(s.started)
+		<-s.release
+	}
+	return user, err
+}
+
+func TestRepository_InvalidateDuringLoad(t *testing.T) {
+	source := &slowFirstSource{MemorySource: NewMemorySource(), started: make(chan struct{}), release: make(chan struct{})}
+	source.AddUser(&User{Username: "drake", Level: WIZARD})
+	repository := NewRepository(source, time.Hour)
+
+	stale := make(chan *User)
+	go func() {
+		user, _ := repository.GetUser("drake")
+		stale <- user
+	}()
+	<-source.started
+
+	// The character changes while the first load still runs
+	source.AddUser(&User{Username: "drake", Level: ELDER})
+	repository.Invalidate("drake")
+
+	// A lookup after the invalidation does not join the running load
+	fresh := make(chan *User)
+	go func() {
+		user, _ := repository.GetUser("drake")
+		fresh <- user
+	}()
+	select {
+	case user := <-fresh:
+		if user.Level != ELDER {
+			t.Errorf("GetUser after Invalidate = level %d, want %d", user.Level, ELDER)
+		}
+		close(source.release)
+	case <-time.After(5 * time.Second):
+		t.Error("GetUser after Invalidate waited for the overtaken load")
+		close(source.release)
+		<-fresh
+	}
+
+	// The overtaken load finishes without replacing the fresh entry
+	if user := <-stale; user.Level != WIZARD {
+		t.Fatalf("first load returned level %d, want %d", user.Level, WIZARD)
+	}
+	if user, _ := repository.GetUser("drake"); user.Level != ELDER {
+		t.Errorf("cached level %d after the overtaken load, want %d", user.Level, ELDER)
+	}
+	if got := source.calls.Load(); got != 2 {
+		t.Errorf("expected 2 loads, got %d", got)
+	}
+}
+
+// testHash is a prepared hash for repository tests
+type testHash string
+
+func (h testHash) Verify(password string) error {
+	if password != string(h) {
+		return errors.New("password mismatch")
+	}
+	return nil
+}
+
+func TestRepository_Prepare(t *testing.T) {
+	source := NewMemorySource()
+	source.AddUser(&User{Username: "good", PasswordHash: "hash:secret"})
+	source.AddUser(&User{Username: "bad", PasswordHash: "garbage"})
+
+	var prepares atomic.Int32
+	repository := NewRepository(source, time.Hour)
+	repository.SetPrepare(func(hash string) (PreparedHash, error) {
+		prepares.Add(1)
+		password, ok := strings.CutPrefix(hash, "hash:")
+		if !ok {
+			return nil, errors.New("unsupported hash")
+		}
+		return testHash(password), nil
+	})
+
+	for i := 0; i < 3; i++ {
+		user, err := repository.GetUser("good")
+		if err != nil {
+			t.Fatalf("GetUser failed: %v", err)
+		}
+		if user.Prepared == nil || user.Prepared.Verify("secret") != nil {
+			t.Errorf("GetUser() prepared hash = %v, want one accepting the password", user.Prepared)
+		}
+	}
+	if got := prepares.Load(); got != 1 {
+		t.Errorf("hash prepared %d times, want once per load", got)
+	}
+
+	// The source's own user is not modified
+	if stored, _ := source.LoadUser("good"); stored.Prepared != nil {
+		t.Error("Repository should prepare a copy of the source's user")
+	}
+
+	// A hash that can't be prepared still loads
+	user, err := repository.GetUser("bad")
+	if err != nil {
+		t.Fatalf("GetUser failed: %v", err)
+	}
+	if user.Prepared != nil {
+		t.Errorf("GetUser() prepared hash = %v, want nil", user.Prepared)
+	}
+}
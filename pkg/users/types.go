@@ -5,6 +5,17 @@ type User struct {
 	Username     string
 	PasswordHash string
 	Level        int
+
+	// Prepared is PasswordHash decoded for verification, or nil if it was
+	// not prepared when the user was loaded
+	Prepared PreparedHash
+}
+
+// PreparedHash is a password hash decoded once, so that checking a password
+// against it involves no parsing
+type PreparedHash interface {
+	// Verify checks a plaintext password against the hash
+	Verify(password string) error
 }
 
 // Source represents a source of user data